@@ -0,0 +1,735 @@
+#include <TH.h>
+#include <luaT.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <setjmp.h>
+#include <jpeglib.h>
+#ifdef USE_PNG
+#include <png.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/*
+ * Batch decode-and-augment pipeline.
+ *
+ * Each sample is an encoded JPEG/PNG image (in a ByteTensor, or in a file),
+ * which is decoded, randomly cropped and resized, flipped, colour jittered
+ * and normalized, and written straight into its slot of a preallocated
+ * N x 3 x height x width FloatTensor. Samples are processed in parallel on
+ * the OpenMP thread pool, without any Lua involvement.
+ *
+ * The random crop is chosen from the image header, before decoding, such
+ * that JPEG images can be decoded at reduced resolution (IDCT scaling), and
+ * only down to the last row of the crop.
+ *
+ * Random draws come from a stream per sample, seeded with the pipeline seed
+ * and the sample number: results do not depend on the number of threads.
+ */
+
+#define BATCH_ERRLEN 256
+
+typedef struct {
+  int crop;               /* random-resized-crop? (otherwise full image) */
+  double scale[2];        /* range of the crop area, relative to the image */
+  double ratio[2];        /* range of the crop aspect ratio (width/height) */
+  double flip;            /* horizontal flip probability */
+  double brightness;      /* colour jitter factors are drawn in [1-x, 1+x] */
+  double contrast;
+  double saturation;
+  float mean[3];          /* per-channel normalization */
+  float std[3];
+  int nthread;
+  unsigned long long seed;
+} batch_Spec;
+
+typedef struct {
+  const unsigned char *data;    /* encoded image in memory, or NULL */
+  long size;
+  const char *filename;         /* encoded image in a file */
+} batch_Source;
+
+/* crop box, in full resolution pixels */
+typedef struct {
+  double x, y, w, h;
+} batch_Box;
+
+/* output channel weights for grayscale (Rec. 601 luma) */
+static const float batch_luma[3] = {0.299f, 0.587f, 0.114f};
+
+/******************** random numbers ********************/
+
+/* splitmix64 */
+static unsigned long long batch_random(unsigned long long *state)
+{
+  unsigned long long z = (*state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+/* uniform in [a, b) */
+static double batch_uniform(unsigned long long *state, double a, double b)
+{
+  return a + (b-a) * (double)(batch_random(state) >> 11) * (1.0/9007199254740992.0);
+}
+
+/******************** crop ********************/
+
+/* random-resized-crop: a random area fraction and (log-uniform) aspect ratio,
+   at a random position, with a central crop as fallback */
+static void batch_crop(const batch_Spec *spec, unsigned long long *state,
+                       int width, int height, batch_Box *box)
+{
+  double area = (double)width * height;
+  double ratio;
+  int attempt;
+
+  if (!spec->crop) {
+    box->x = 0;
+    box->y = 0;
+    box->w = width;
+    box->h = height;
+    return;
+  }
+
+  for (attempt = 0; attempt < 10; attempt++) {
+    double target = area * batch_uniform(state, spec->scale[0], spec->scale[1]);
+    double w, h;
+    ratio = exp(batch_uniform(state, log(spec->ratio[0]), log(spec->ratio[1])));
+    w = floor(sqrt(target * ratio) + 0.5);
+    h = floor(sqrt(target / ratio) + 0.5);
+    if (w > 0 && h > 0 && w <= width && h <= height) {
+      box->x = floor(batch_uniform(state, 0, width - w + 1));
+      box->y = floor(batch_uniform(state, 0, height - h + 1));
+      box->w = w;
+      box->h = h;
+      return;
+    }
+  }
+
+  ratio = (double)width / height;
+  if (ratio < spec->ratio[0]) {
+    box->w = width;
+    box->h = floor(width / spec->ratio[0] + 0.5);
+  } else if (ratio > spec->ratio[1]) {
+    box->h = height;
+    box->w = floor(height * spec->ratio[1] + 0.5);
+  } else {
+    box->w = width;
+    box->h = height;
+  }
+  box->x = floor((width - box->w) / 2);
+  box->y = floor((height - box->h) / 2);
+}
+
+/******************** resampling ********************/
+
+/*
+ * Linear (triangle) filter coefficients, mapping [start, start+length) in the
+ * source onto n output pixels. When downscaling, the filter support is
+ * stretched by the scale factor, such that every source pixel contributes
+ * (antialiasing). Taps which fall outside of the source are dropped, and the
+ * remaining weights renormalized.
+ */
+typedef struct {
+  int n;
+  int ntap;       /* taps per output pixel */
+  int *first;     /* first source pixel of each output pixel */
+  float *weight;  /* n x ntap */
+} batch_Filter;
+
+static int batch_filter(batch_Filter *f, double start, double length, int n, int size)
+{
+  double scale = length / n;
+  double support = scale > 1 ? scale : 1;
+  int i, k;
+
+  f->n = n;
+  f->ntap = (int)ceil(support) * 2 + 1;
+  f->first = malloc(sizeof(int) * n);
+  f->weight = malloc(sizeof(float) * n * f->ntap);
+  if (!f->first || !f->weight)
+    return 0;
+
+  for (i = 0; i < n; i++) {
+    double center = start + (i + 0.5) * scale;
+    int first = (int)floor(center - support);
+    int last = (int)ceil(center + support);
+    float *weight = f->weight + i * f->ntap;
+    double total = 0;
+    if (first < 0)
+      first = 0;
+    if (last > size)
+      last = size;
+    if (last - first > f->ntap)
+      last = first + f->ntap;
+    for (k = 0; k < f->ntap; k++) {
+      double w = 0;
+      if (first + k < last) {
+        w = 1 - fabs((first + k + 0.5 - center) / support);
+        if (w < 0)
+          w = 0;
+      }
+      weight[k] = (float)w;
+      total += w;
+    }
+    if (total > 0) {
+      for (k = 0; k < f->ntap; k++)
+        weight[k] = (float)(weight[k] / total);
+    } else {
+      /* nearest pixel */
+      first = (int)floor(center);
+      first = first < 0 ? 0 : (first >= size ? size-1 : first);
+      weight[0] = 1;
+    }
+    f->first[i] = first;
+  }
+  return 1;
+}
+
+static void batch_filter_free(batch_Filter *f)
+{
+  free(f->first);
+  free(f->weight);
+}
+
+/*
+ * Resamples box (in the pixel coordinates of the given interleaved 8-bit
+ * image, with 1 or 3 channels) into 3 x height x width floats in [0, 1],
+ * horizontally flipped if requested.
+ */
+static int batch_resample(const unsigned char *pixels, int iwidth, int iheight, int nchannel,
+                          const batch_Box *box, int flip,
+                          float *output, int width, int height)
+{
+  batch_Filter fx, fy;
+  float *rows = NULL;
+  int ymin, ymax, x, y, c, k;
+  int status = 0;
+  long plane = (long)width * height;
+
+  memset(&fx, 0, sizeof(fx));
+  memset(&fy, 0, sizeof(fy));
+  if (!batch_filter(&fx, box->x, box->w, width, iwidth) ||
+      !batch_filter(&fy, box->y, box->h, height, iheight))
+    goto cleanup;
+
+  /* horizontal pass over the rows spanned by the vertical filter */
+  ymin = fy.first[0];
+  ymax = fy.first[height-1] + fy.ntap;
+  if (ymax > iheight)
+    ymax = iheight;
+  rows = malloc(sizeof(float) * (ymax - ymin) * width * nchannel);
+  if (!rows)
+    goto cleanup;
+  for (y = ymin; y < ymax; y++) {
+    const unsigned char *src = pixels + (long)y * iwidth * nchannel;
+    float *dst = rows + (long)(y - ymin) * width * nchannel;
+    for (x = 0; x < width; x++) {
+      const unsigned char *s = src + (long)fx.first[x] * nchannel;
+      const float *w = fx.weight + x * fx.ntap;
+      int ntap = fx.ntap;
+      if (fx.first[x] + ntap > iwidth)
+        ntap = iwidth - fx.first[x];
+      for (c = 0; c < nchannel; c++) {
+        float sum = 0;
+        for (k = 0; k < ntap; k++)
+          sum += w[k] * s[k * nchannel + c];
+        dst[x * nchannel + c] = sum * (1.f/255.f);
+      }
+    }
+  }
+
+  /* vertical pass, into the output planes */
+  for (y = 0; y < height; y++) {
+    const float *w = fy.weight + y * fy.ntap;
+    const float *src = rows + (long)(fy.first[y] - ymin) * width * nchannel;
+    int ntap = fy.ntap;
+    if (fy.first[y] + ntap > ymax)
+      ntap = ymax - fy.first[y];
+    for (x = 0; x < width; x++) {
+      long offset = (long)y * width + (flip ? width - 1 - x : x);
+      for (c = 0; c < nchannel; c++) {
+        float sum = 0;
+        for (k = 0; k < ntap; k++)
+          sum += w[k] * src[(long)k * width * nchannel + x * nchannel + c];
+        output[c * plane + offset] = sum;
+      }
+    }
+  }
+  /* grayscale images are replicated on the 3 channels */
+  if (nchannel == 1) {
+    memcpy(output + plane, output, sizeof(float) * plane);
+    memcpy(output + 2*plane, output, sizeof(float) * plane);
+  }
+  status = 1;
+
+cleanup:
+  batch_filter_free(&fx);
+  batch_filter_free(&fy);
+  free(rows);
+  return status;
+}
+
+/******************** colour jitter and normalization ********************/
+
+static void batch_clamp(float *data, long n)
+{
+  long i;
+  for (i = 0; i < n; i++)
+    data[i] = data[i] < 0 ? 0 : (data[i] > 1 ? 1 : data[i]);
+}
+
+/* brightness, contrast, then saturation, as in torchvision ColorJitter
+   (which uses a random order) */
+static void batch_jitter(const batch_Spec *spec, unsigned long long *state,
+                         float *output, long plane)
+{
+  float *r = output, *g = output + plane, *b = output + 2*plane;
+  long i;
+
+  if (spec->brightness > 0) {
+    float factor = (float)batch_uniform(state, 1 - spec->brightness, 1 + spec->brightness);
+    for (i = 0; i < 3*plane; i++)
+      output[i] *= factor;
+    batch_clamp(output, 3*plane);
+  }
+  if (spec->contrast > 0) {
+    float factor = (float)batch_uniform(state, 1 - spec->contrast, 1 + spec->contrast);
+    double sum = 0;
+    float mean;
+    for (i = 0; i < plane; i++)
+      sum += batch_luma[0]*r[i] + batch_luma[1]*g[i] + batch_luma[2]*b[i];
+    mean = (float)(sum / plane);
+    for (i = 0; i < 3*plane; i++)
+      output[i] = mean + factor * (output[i] - mean);
+    batch_clamp(output, 3*plane);
+  }
+  if (spec->saturation > 0) {
+    float factor = (float)batch_uniform(state, 1 - spec->saturation, 1 + spec->saturation);
+    for (i = 0; i < plane; i++) {
+      float gray = batch_luma[0]*r[i] + batch_luma[1]*g[i] + batch_luma[2]*b[i];
+      r[i] = gray + factor * (r[i] - gray);
+      g[i] = gray + factor * (g[i] - gray);
+      b[i] = gray + factor * (b[i] - gray);
+    }
+    batch_clamp(output, 3*plane);
+  }
+}
+
+static void batch_normalize(const batch_Spec *spec, float *output, long plane)
+{
+  int c;
+  long i;
+  for (c = 0; c < 3; c++) {
+    float *data = output + c * plane;
+    float mean = spec->mean[c];
+    float istd = 1.f / spec->std[c];
+    if (mean == 0 && istd == 1)
+      continue;
+    for (i = 0; i < plane; i++)
+      data[i] = (data[i] - mean) * istd;
+  }
+}
+
+/******************** decoding ********************/
+
+struct batch_jpeg_error {
+  struct jpeg_error_mgr pub;
+  jmp_buf setjmp_buffer;
+  char *msg;
+};
+
+static void batch_jpeg_error_exit(j_common_ptr cinfo)
+{
+  struct batch_jpeg_error *err = (struct batch_jpeg_error *)cinfo->err;
+  char msg[JMSG_LENGTH_MAX];
+  (*cinfo->err->format_message)(cinfo, msg);
+  snprintf(err->msg, BATCH_ERRLEN, "%s", msg);
+  longjmp(err->setjmp_buffer, 1);
+}
+
+static void batch_jpeg_output_message(j_common_ptr cinfo)
+{
+  /* warnings are ignored */
+}
+
+/* decode, crop and resize a JPEG image; the crop is drawn from the
+   header, then the smallest IDCT scaling covering the output is used */
+static int batch_decode_jpeg(const batch_Spec *spec, unsigned long long *state,
+                             const unsigned char *data, long size,
+                             float *output, int width, int height, int *flip, char *errmsg)
+{
+#if defined(HAVE_JPEG_MEM_SRC)
+  struct jpeg_decompress_struct cinfo;
+  struct batch_jpeg_error jerr;
+  unsigned char * volatile pixels = NULL;
+  batch_Box box;
+  int status = 0;
+  unsigned int denom;
+  int nchannel, last;
+  double sx, sy;
+
+  cinfo.err = jpeg_std_error(&jerr.pub);
+  jerr.pub.error_exit = batch_jpeg_error_exit;
+  jerr.pub.output_message = batch_jpeg_output_message;
+  jerr.msg = errmsg;
+  if (setjmp(jerr.setjmp_buffer)) {
+    jpeg_destroy_decompress(&cinfo);
+    free(pixels);
+    return 0;
+  }
+  jpeg_create_decompress(&cinfo);
+  jpeg_mem_src(&cinfo, (unsigned char *)data, size);
+  jpeg_read_header(&cinfo, TRUE);
+
+  if (cinfo.jpeg_color_space == JCS_CMYK || cinfo.jpeg_color_space == JCS_YCCK) {
+    snprintf(errmsg, BATCH_ERRLEN, "CMYK JPEG images are not supported");
+    jpeg_destroy_decompress(&cinfo);
+    return 0;
+  }
+  cinfo.out_color_space = (cinfo.num_components == 1 ? JCS_GRAYSCALE : JCS_RGB);
+
+  batch_crop(spec, state, cinfo.image_width, cinfo.image_height, &box);
+  *flip = (spec->flip > 0 && batch_uniform(state, 0, 1) < spec->flip);
+
+  for (denom = 8; denom >= 1; denom /= 2) {
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = denom;
+    jpeg_calc_output_dimensions(&cinfo);
+    sx = (double)cinfo.output_width / cinfo.image_width;
+    sy = (double)cinfo.output_height / cinfo.image_height;
+    if (box.w * sx >= width && box.h * sy >= height)
+      break;
+  }
+  if (denom > 1)
+    cinfo.dct_method = JDCT_IFAST;
+  box.x *= sx;
+  box.y *= sy;
+  box.w *= sx;
+  box.h *= sy;
+
+  jpeg_start_decompress(&cinfo);
+  nchannel = cinfo.output_components;
+  pixels = malloc((size_t)cinfo.output_width * cinfo.output_height * nchannel);
+  if (!pixels) {
+    snprintf(errmsg, BATCH_ERRLEN, "out of memory");
+    jpeg_destroy_decompress(&cinfo);
+    return 0;
+  }
+
+  /* rows below the crop (and its filter support) are not decoded */
+  last = (int)ceil(box.y + box.h + (box.h > height ? box.h / height : 1)) + 1;
+  if (last > (int)cinfo.output_height)
+    last = cinfo.output_height;
+  while ((int)cinfo.output_scanline < last) {
+    JSAMPROW row = pixels + (size_t)cinfo.output_scanline * cinfo.output_width * nchannel;
+    jpeg_read_scanlines(&cinfo, &row, 1);
+  }
+
+  if (batch_resample(pixels, cinfo.output_width, last, nchannel, &box, *flip,
+                     output, width, height))
+    status = 1;
+  else
+    snprintf(errmsg, BATCH_ERRLEN, "out of memory");
+
+  jpeg_destroy_decompress(&cinfo);
+  free(pixels);
+  return status;
+#else
+  snprintf(errmsg, BATCH_ERRLEN, "`jpeg_mem_src` is not defined. Use libjpeg v8+, "
+           "libjpeg-turbo 1.3+ or build libjpeg-turbo with `--with-mem-srcdst`.");
+  return 0;
+#endif
+}
+
+#ifdef USE_PNG
+typedef struct {
+  const unsigned char *data;
+  png_size_t size;
+  png_size_t offset;
+  char *msg;
+} batch_png_source;
+
+static void batch_png_read(png_structp png_ptr, png_bytep dest, png_size_t length)
+{
+  batch_png_source *src = png_get_io_ptr(png_ptr);
+  if (src->offset + length > src->size)
+    png_error(png_ptr, "truncated PNG image");
+  memcpy(dest, src->data + src->offset, length);
+  src->offset += length;
+}
+
+static void batch_png_error(png_structp png_ptr, png_const_charp error_msg)
+{
+  batch_png_source *src = png_get_error_ptr(png_ptr);
+  snprintf(src->msg, BATCH_ERRLEN, "%s", error_msg);
+  longjmp(png_jmpbuf(png_ptr), 1);
+}
+
+static void batch_png_warning(png_structp png_ptr, png_const_charp warning_msg)
+{
+}
+
+/* decode, crop and resize a PNG image: decoded as 8-bit gray or RGB,
+   without alpha */
+static int batch_decode_png(const batch_Spec *spec, unsigned long long *state,
+                            const unsigned char *data, long size,
+                            float *output, int width, int height, int *flip, char *errmsg)
+{
+  png_structp png_ptr;
+  png_infop info_ptr = NULL;
+  batch_png_source src;
+  unsigned char * volatile pixels = NULL;
+  png_bytep * volatile rows = NULL;
+  png_uint_32 iwidth, iheight, y;
+  int color_type, nchannel;
+  batch_Box box;
+  int status = 0;
+
+  src.data = data;
+  src.size = size;
+  src.offset = 0;
+  src.msg = errmsg;
+  png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, &src, batch_png_error, batch_png_warning);
+  if (!png_ptr || !(info_ptr = png_create_info_struct(png_ptr))) {
+    snprintf(errmsg, BATCH_ERRLEN, "png_create_read_struct failed");
+    png_destroy_read_struct(&png_ptr, NULL, NULL);
+    return 0;
+  }
+  if (setjmp(png_jmpbuf(png_ptr))) {
+    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+    free(rows);
+    free(pixels);
+    return 0;
+  }
+  png_set_read_fn(png_ptr, &src, batch_png_read);
+  png_read_info(png_ptr, info_ptr);
+
+  iwidth = png_get_image_width(png_ptr, info_ptr);
+  iheight = png_get_image_height(png_ptr, info_ptr);
+  color_type = png_get_color_type(png_ptr, info_ptr);
+  png_set_strip_16(png_ptr);
+  png_set_strip_alpha(png_ptr);
+  png_set_packing(png_ptr);
+  if (color_type == PNG_COLOR_TYPE_PALETTE)
+    png_set_palette_to_rgb(png_ptr);
+  if (color_type == PNG_COLOR_TYPE_GRAY || color_type == PNG_COLOR_TYPE_GRAY_ALPHA)
+    png_set_expand_gray_1_2_4_to_8(png_ptr);
+  png_read_update_info(png_ptr, info_ptr);
+  nchannel = png_get_channels(png_ptr, info_ptr);
+  if (nchannel != 1 && nchannel != 3)
+    png_error(png_ptr, "unsupported PNG colour type");
+
+  batch_crop(spec, state, iwidth, iheight, &box);
+  *flip = (spec->flip > 0 && batch_uniform(state, 0, 1) < spec->flip);
+
+  pixels = malloc((size_t)iwidth * iheight * nchannel);
+  rows = malloc(sizeof(png_bytep) * iheight);
+  if (!pixels || !rows)
+    png_error(png_ptr, "out of memory");
+  for (y = 0; y < iheight; y++)
+    rows[y] = pixels + (size_t)y * iwidth * nchannel;
+  png_read_image(png_ptr, rows);
+
+  if (batch_resample(pixels, iwidth, iheight, nchannel, &box, *flip, output, width, height))
+    status = 1;
+  else
+    snprintf(errmsg, BATCH_ERRLEN, "out of memory");
+
+  png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+  free(rows);
+  free(pixels);
+  return status;
+}
+#endif
+
+static unsigned char *batch_readfile(const char *filename, long *size, char *errmsg)
+{
+  FILE *f = fopen(filename, "rb");
+  unsigned char *data;
+  if (!f) {
+    snprintf(errmsg, BATCH_ERRLEN, "cannot open file <%s> for reading", filename);
+    return NULL;
+  }
+  fseek(f, 0, SEEK_END);
+  *size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  data = malloc(*size > 0 ? *size : 1);
+  if (!data || (long)fread(data, 1, *size, f) != *size) {
+    snprintf(errmsg, BATCH_ERRLEN, "cannot read file <%s>", filename);
+    free(data);
+    data = NULL;
+  }
+  fclose(f);
+  return data;
+}
+
+/* full pipeline for one sample, returns 0 (and an error message) on failure */
+static int batch_process(const batch_Spec *spec, const batch_Source *source, long sample,
+                         float *output, int width, int height, char *errmsg)
+{
+  unsigned long long state = spec->seed + ((unsigned long long)sample << 20) * 0x9E3779B97F4A7C15ULL;
+  const unsigned char *data = source->data;
+  unsigned char *filedata = NULL;
+  long size = source->size;
+  long plane = (long)width * height;
+  int flip = 0;
+  int status = 0;
+
+  if (source->filename) {
+    filedata = batch_readfile(source->filename, &size, errmsg);
+    if (!filedata)
+      return 0;
+    data = filedata;
+  }
+
+  if (size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF)
+    status = batch_decode_jpeg(spec, &state, data, size, output, width, height, &flip, errmsg);
+  else if (size >= 8 && !memcmp(data, "\x89PNG\r\n\x1a\n", 8))
+#ifdef USE_PNG
+    status = batch_decode_png(spec, &state, data, size, output, width, height, &flip, errmsg);
+#else
+    snprintf(errmsg, BATCH_ERRLEN, "PNG support was not compiled");
+#endif
+  else
+    snprintf(errmsg, BATCH_ERRLEN, "unknown image format (JPEG or PNG expected)");
+  free(filedata);
+
+  if (status) {
+    batch_jitter(spec, &state, output, plane);
+    batch_normalize(spec, output, plane);
+  }
+  return status;
+}
+
+/******************** Lua interface ********************/
+
+static double batch_getnumber(lua_State *L, int idx, const char *field, int i, double def)
+{
+  double value = def;
+  lua_getfield(L, idx, field);
+  if (i > 0 && lua_istable(L, -1)) {
+    lua_rawgeti(L, -1, i);
+    lua_remove(L, -2);
+  }
+  if (!lua_isnil(L, -1)) {
+    if (!lua_isnumber(L, -1))
+      luaL_error(L, "invalid pipeline spec: number expected for field <%s>", field);
+    value = lua_tonumber(L, -1);
+  }
+  lua_pop(L, 1);
+  return value;
+}
+
+/*
+ * process(sources, output, spec, offset)
+ *   sources: table of ByteTensors (encoded images) or filenames
+ *   output: N x 3 x height x width contiguous FloatTensor, with N >= #sources
+ *   spec: table {crop, scale, ratio, flip, brightness, contrast, saturation,
+ *                mean, std, nthread, seed}
+ *   offset: number of the first sample in the random streams
+ */
+static int batch_run(lua_State *L)
+{
+  THFloatTensor *output = luaT_checkudata(L, 2, "torch.FloatTensor");
+  long offset = (long)luaL_optnumber(L, 4, 0);
+  batch_Spec spec;
+  batch_Source *sources;
+  char (*errors)[BATCH_ERRLEN];
+  float *output_data;
+  long n, i, stride;
+  int width, height, c, failed = -1;
+
+  luaL_checktype(L, 1, LUA_TTABLE);
+  luaL_checktype(L, 3, LUA_TTABLE);
+  luaL_argcheck(L, output->nDimension == 4 && output->size[1] == 3, 2,
+                "N x 3 x height x width tensor expected");
+  luaL_argcheck(L, THFloatTensor_isContiguous(output), 2, "contiguous tensor expected");
+  n = lua_objlen(L, 1);
+  luaL_argcheck(L, n <= output->size[0], 2, "output tensor has less slots than samples");
+  height = output->size[2];
+  width = output->size[3];
+
+  spec.crop = (int)batch_getnumber(L, 3, "crop", 0, 0);
+  spec.scale[0] = batch_getnumber(L, 3, "scale", 1, 0.08);
+  spec.scale[1] = batch_getnumber(L, 3, "scale", 2, 1);
+  spec.ratio[0] = batch_getnumber(L, 3, "ratio", 1, 3./4.);
+  spec.ratio[1] = batch_getnumber(L, 3, "ratio", 2, 4./3.);
+  spec.flip = batch_getnumber(L, 3, "flip", 0, 0);
+  spec.brightness = batch_getnumber(L, 3, "brightness", 0, 0);
+  spec.contrast = batch_getnumber(L, 3, "contrast", 0, 0);
+  spec.saturation = batch_getnumber(L, 3, "saturation", 0, 0);
+  for (c = 0; c < 3; c++) {
+    spec.mean[c] = (float)batch_getnumber(L, 3, "mean", c+1, 0);
+    spec.std[c] = (float)batch_getnumber(L, 3, "std", c+1, 1);
+  }
+  spec.nthread = (int)batch_getnumber(L, 3, "nthread", 0, 1);
+  spec.seed = (unsigned long long)batch_getnumber(L, 3, "seed", 0, 0);
+  luaL_argcheck(L, spec.scale[0] > 0 && spec.scale[0] <= spec.scale[1], 3, "invalid crop scale range");
+  luaL_argcheck(L, spec.ratio[0] > 0 && spec.ratio[0] <= spec.ratio[1], 3, "invalid crop ratio range");
+  luaL_argcheck(L, spec.std[0] != 0 && spec.std[1] != 0 && spec.std[2] != 0, 3, "non-zero std expected");
+  if (spec.nthread < 1)
+    spec.nthread = 1;
+
+  /* the Lua state is only accessed from this thread */
+  sources = lua_newuserdata(L, sizeof(batch_Source) * (n > 0 ? n : 1));
+  for (i = 0; i < n; i++) {
+    THByteTensor *tensor;
+    lua_rawgeti(L, 1, i+1);
+    sources[i].data = NULL;
+    sources[i].size = 0;
+    sources[i].filename = NULL;
+    if (lua_type(L, -1) == LUA_TSTRING)
+      sources[i].filename = lua_tostring(L, -1);
+    else if ((tensor = luaT_toudata(L, -1, "torch.ByteTensor"))) {
+      if (!THByteTensor_isContiguous(tensor))
+        luaL_error(L, "sample %d: contiguous ByteTensor expected", (int)(i+1));
+      sources[i].data = THByteTensor_data(tensor);
+      sources[i].size = THByteTensor_nElement(tensor);
+    }
+    else
+      luaL_error(L, "sample %d: ByteTensor or filename expected", (int)(i+1));
+    /* strings and tensors stay referenced by the sources table */
+    lua_pop(L, 1);
+  }
+  errors = lua_newuserdata(L, BATCH_ERRLEN * (n > 0 ? n : 1));
+
+  output_data = THFloatTensor_data(output);
+  stride = output->stride[0];
+#pragma omp parallel for schedule(dynamic, 1) num_threads(spec.nthread)
+  for (i = 0; i < n; i++) {
+    errors[i][0] = '\0';
+    if (!batch_process(&spec, &sources[i], offset + i, output_data + i*stride, width, height, errors[i]))
+      if (!errors[i][0])
+        snprintf(errors[i], BATCH_ERRLEN, "unknown error");
+  }
+
+  for (i = 0; i < n; i++) {
+    if (errors[i][0]) {
+      failed = (int)i;
+      break;
+    }
+  }
+  if (failed >= 0)
+    luaL_error(L, "sample %d: %s", failed+1, errors[failed]);
+
+  lua_pushvalue(L, 2);
+  return 1;
+}
+
+static const luaL_Reg batch__ [] = {
+  {"process", batch_run},
+  {NULL, NULL}
+};
+
+DLL_EXPORT int luaopen_libimagebatch(lua_State *L)
+{
+  lua_newtable(L);
+  luaT_setfuncs(L, batch__, 0);
+  return 1;
+}
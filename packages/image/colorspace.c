@@ -0,0 +1,101 @@
+/*
+ * Helpers for the colour space conversions.
+ */
+
+#define IMAGE_PRAGMA(P) _Pragma(#P)
+
+/* a colour conversion costs roughly this many multiply-adds per pixel */
+#define IMAGE_COLOR_COST 16
+
+/*
+ * Runs the code given as last argument on every pixel of the image src
+ * (3 x height x width), writing the image dst (3 x height x width, or
+ * height x width for a single channel). The code reads the source channels
+ * c0, c1, c2 and sets the output channels o0 (, o1, o2), as temp_t values;
+ * byte images are scaled to [0, 1] by IMAGE_COLOR_RANGE. Rows run in
+ * parallel; rows of unit stride in both images get their own loop, which
+ * the compiler can vectorize.
+ */
+#define IMAGE_COLOR_PIXELS(sst, dst, ...)                               \
+  for (x_ = 0; x_ < width_; x_++) {                                     \
+    temp_t c0 = s_[x_*(sst)] / (temp_t)IMAGE_COLOR_RANGE;               \
+    temp_t c1 = s_[x_*(sst) + ss0_] / (temp_t)IMAGE_COLOR_RANGE;        \
+    temp_t c2 = s_[x_*(sst) + 2*ss0_] / (temp_t)IMAGE_COLOR_RANGE;      \
+    temp_t o0, o1 = 0, o2 = 0;                                          \
+    __VA_ARGS__                                                         \
+    d_[x_*(dst)] = image_(FromIntermediate)(o0 * IMAGE_COLOR_RANGE);    \
+    if (ndst_ == 3) {                                                   \
+      d_[x_*(dst) + ds0_] = image_(FromIntermediate)(o1 * IMAGE_COLOR_RANGE); \
+      d_[x_*(dst) + 2*ds0_] = image_(FromIntermediate)(o2 * IMAGE_COLOR_RANGE); \
+    }                                                                   \
+  }
+
+#define IMAGE_COLOR_LOOP(src, dst, ...)                                 \
+  {                                                                     \
+    real *src_data_ = THTensor_(data)(src);                             \
+    real *dst_data_ = THTensor_(data)(dst);                             \
+    long height_ = (src)->size[1], width_ = (src)->size[2];             \
+    long ss0_ = (src)->stride[0], ss1_ = (src)->stride[1], ss2_ = (src)->stride[2]; \
+    int ndst_ = (dst)->nDimension == 2 ? 1 : 3;                         \
+    long ds0_ = ndst_ == 1 ? 0 : (dst)->stride[0];                      \
+    long ds1_ = (dst)->stride[(dst)->nDimension - 2];                   \
+    long ds2_ = (dst)->stride[(dst)->nDimension - 1];                   \
+    long y_;                                                            \
+    IMAGE_PRAGMA(omp parallel for if(height_*width_*IMAGE_COLOR_COST > IMAGE_OMP_THRESHOLD)) \
+    for (y_ = 0; y_ < height_; y_++) {                                  \
+      const real *s_ = src_data_ + y_*ss1_;                             \
+      real *d_ = dst_data_ + y_*ds1_;                                   \
+      long x_;                                                          \
+      if (ss2_ == 1 && ds2_ == 1) {                                     \
+        IMAGE_COLOR_PIXELS(1, 1, __VA_ARGS__)                           \
+      } else {                                                          \
+        IMAGE_COLOR_PIXELS(ss2_, ds2_, __VA_ARGS__)                     \
+      }                                                                 \
+    }                                                                   \
+  }
+
+/*
+ * sRGB gamma curves. Float images use lookup tables over [0, 1], linearly
+ * interpolated (the curves are smooth enough for a maximum error of about
+ * 1e-6); other values fall back to the exact curves.
+ */
+#define IMAGE_SRGB_LUT_SIZE 16384
+
+static float image_srgb_expand_lut[IMAGE_SRGB_LUT_SIZE + 2];
+static float image_srgb_compress_lut[IMAGE_SRGB_LUT_SIZE + 2];
+
+static double image_srgb_expand(double nonlinear)
+{
+  return (nonlinear <= 0.04045) ? (nonlinear / 12.92)
+                                : (pow((nonlinear+0.055)/1.055, 2.4));
+}
+
+static double image_srgb_compress(double linear)
+{
+  return (linear <= 0.0031308) ? (12.92 * linear)
+                               : (1.055 * pow(linear, 1.0/2.4) - 0.055);
+}
+
+static void image_srgb_init(void)
+{
+  static int initialized = 0;
+  int i;
+  if (initialized)
+    return;
+  for (i = 0; i <= IMAGE_SRGB_LUT_SIZE; i++) {
+    double x = (double)i / IMAGE_SRGB_LUT_SIZE;
+    image_srgb_expand_lut[i] = (float)image_srgb_expand(x);
+    image_srgb_compress_lut[i] = (float)image_srgb_compress(x);
+  }
+  /* guard for x == 1 */
+  image_srgb_expand_lut[IMAGE_SRGB_LUT_SIZE + 1] = image_srgb_expand_lut[IMAGE_SRGB_LUT_SIZE];
+  image_srgb_compress_lut[IMAGE_SRGB_LUT_SIZE + 1] = image_srgb_compress_lut[IMAGE_SRGB_LUT_SIZE];
+  initialized = 1;
+}
+
+static inline float image_srgb_lookup(const float *lut, float x)
+{
+  float p = x * IMAGE_SRGB_LUT_SIZE;
+  int i = (int)p;
+  return lut[i] + (p - i) * (lut[i+1] - lut[i]);
+}
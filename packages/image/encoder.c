@@ -0,0 +1,584 @@
+#include <TH.h>
+#include <luaT.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <jpeglib.h>
+#include <jerror.h>
+#ifdef USE_PNG
+#include <png.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if LUA_VERSION_NUM >= 503
+#define luaL_checkint(L,n)      ((int)luaL_checkinteger(L, (n)))
+#endif
+
+/*
+ * Reusable JPEG/PNG encoder.
+ *
+ * An encoder owns one slot per thread. A slot keeps its JPEG compressor,
+ * its scanline buffer and its output buffer between calls, so encoding a
+ * stream of frames does not allocate once the buffers have grown to the
+ * frame size. Images are read through their strides (no contiguous copy),
+ * float and double images being saturated to [0, 1] and scaled to
+ * [0, 255] on the fly, like image.compressJPG/compressPNG do.
+ *
+ * Batches are spread over the slots with OpenMP. The Lua state is only
+ * touched before and after the parallel loop.
+ */
+
+enum {
+  ENCODER_JPEG,
+  ENCODER_PNG
+};
+
+enum {
+  ENCODER_BYTE,
+  ENCODER_FLOAT,
+  ENCODER_DOUBLE
+};
+
+typedef struct {
+  unsigned char *data;
+  size_t size;
+  size_t capacity;
+} encoder_Buffer;
+
+typedef struct {
+  struct jpeg_destination_mgr pub;
+  encoder_Buffer *out;
+} encoder_Dest;
+
+typedef struct {
+  struct jpeg_error_mgr pub;
+  jmp_buf setjmp_buffer;
+  char msg[JMSG_LENGTH_MAX];
+} encoder_Error;
+
+typedef struct {
+  struct jpeg_compress_struct cinfo;
+  encoder_Error jerr;
+  encoder_Dest dest;
+  int has_cinfo;
+  encoder_Buffer out;
+  encoder_Buffer row;
+} encoder_Slot;
+
+typedef struct {
+  int format;
+  int quality;
+  int level;
+  int nslot;
+  encoder_Slot *slots;
+} encoder_Encoder;
+
+/* an image to encode, and where its encoding ended up */
+typedef struct {
+  const void *data;
+  int type;
+  long channels, height, width;
+  long stride[3];
+  int slot;
+  size_t offset, size;
+  char err[JMSG_LENGTH_MAX];
+} encoder_Image;
+
+/* makes room for n more bytes (buffers only grow) */
+static int encoder_reserve(encoder_Buffer *b, size_t n)
+{
+  if (b->size + n > b->capacity) {
+    size_t capacity = b->capacity ? b->capacity : 65536;
+    unsigned char *data;
+    while (capacity < b->size + n)
+      capacity *= 2;
+    data = realloc(b->data, capacity);
+    if (!data)
+      return 0;
+    b->data = data;
+    b->capacity = capacity;
+  }
+  return 1;
+}
+
+static inline unsigned char encoder_tobyte(double x)
+{
+  /* saturate, then truncate as the tensor to byte copies do */
+  return x <= 0 ? 0 : x >= 1 ? 255 : (unsigned char)(x * 255);
+}
+
+/* writes row y of the image, with interleaved channels */
+static void encoder_fill_row(const encoder_Image *im, long y, unsigned char *row)
+{
+  long ch = im->channels, c, x;
+  for (c = 0; c < ch; c++) {
+    long offset = c*im->stride[0] + y*im->stride[1], s = im->stride[2];
+    unsigned char *r = row + c;
+    switch (im->type) {
+    case ENCODER_BYTE: {
+      const unsigned char *src = (const unsigned char *)im->data + offset;
+      for (x = 0; x < im->width; x++)
+        r[x*ch] = src[x*s];
+      break;
+    }
+    case ENCODER_FLOAT: {
+      const float *src = (const float *)im->data + offset;
+      for (x = 0; x < im->width; x++)
+        r[x*ch] = encoder_tobyte(src[x*s]);
+      break;
+    }
+    default: {
+      const double *src = (const double *)im->data + offset;
+      for (x = 0; x < im->width; x++)
+        r[x*ch] = encoder_tobyte(src[x*s]);
+      break;
+    }
+    }
+  }
+}
+
+/******************** JPEG ********************/
+
+static void encoder_jpeg_error(j_common_ptr cinfo)
+{
+  encoder_Error *err = (encoder_Error *)cinfo->err;
+  (*cinfo->err->format_message)(cinfo, err->msg);
+  longjmp(err->setjmp_buffer, 1);
+}
+
+static void encoder_jpeg_message(j_common_ptr cinfo)
+{
+  encoder_Error *err = (encoder_Error *)cinfo->err;
+  (*cinfo->err->format_message)(cinfo, err->msg);
+}
+
+/* destination manager appending to the slot's output buffer */
+static void encoder_jpeg_init_destination(j_compress_ptr cinfo)
+{
+  encoder_Dest *dest = (encoder_Dest *)cinfo->dest;
+  if (!encoder_reserve(dest->out, 65536))
+    ERREXIT1(cinfo, JERR_OUT_OF_MEMORY, 0);
+  dest->pub.next_output_byte = dest->out->data + dest->out->size;
+  dest->pub.free_in_buffer = dest->out->capacity - dest->out->size;
+}
+
+static boolean encoder_jpeg_empty_output_buffer(j_compress_ptr cinfo)
+{
+  encoder_Dest *dest = (encoder_Dest *)cinfo->dest;
+  /* the whole free space has been written */
+  dest->out->size = dest->out->capacity;
+  if (!encoder_reserve(dest->out, dest->out->capacity))
+    ERREXIT1(cinfo, JERR_OUT_OF_MEMORY, 1);
+  dest->pub.next_output_byte = dest->out->data + dest->out->size;
+  dest->pub.free_in_buffer = dest->out->capacity - dest->out->size;
+  return TRUE;
+}
+
+static void encoder_jpeg_term_destination(j_compress_ptr cinfo)
+{
+  encoder_Dest *dest = (encoder_Dest *)cinfo->dest;
+  dest->out->size = dest->pub.next_output_byte - dest->out->data;
+}
+
+static void encoder_jpeg_slot_init(encoder_Slot *slot)
+{
+  slot->cinfo.err = jpeg_std_error(&slot->jerr.pub);
+  slot->jerr.pub.error_exit = encoder_jpeg_error;
+  slot->jerr.pub.output_message = encoder_jpeg_message;
+  jpeg_create_compress(&slot->cinfo);
+  slot->dest.pub.init_destination = encoder_jpeg_init_destination;
+  slot->dest.pub.empty_output_buffer = encoder_jpeg_empty_output_buffer;
+  slot->dest.pub.term_destination = encoder_jpeg_term_destination;
+  slot->dest.out = &slot->out;
+  slot->cinfo.dest = &slot->dest.pub;
+  slot->has_cinfo = 1;
+}
+
+static int encoder_jpeg(encoder_Encoder *enc, encoder_Slot *slot, encoder_Image *im)
+{
+  struct jpeg_compress_struct *cinfo = &slot->cinfo;
+  JSAMPROW row = slot->row.data;
+
+  if (setjmp(slot->jerr.setjmp_buffer)) {
+    /* the compressor stays usable */
+    jpeg_abort_compress(cinfo);
+    strcpy(im->err, slot->jerr.msg);
+    return 0;
+  }
+
+  cinfo->image_width = im->width;
+  cinfo->image_height = im->height;
+  cinfo->input_components = im->channels;
+  cinfo->in_color_space = im->channels == 3 ? JCS_RGB : JCS_GRAYSCALE;
+  jpeg_set_defaults(cinfo);
+  jpeg_set_quality(cinfo, enc->quality, FALSE);
+
+  jpeg_start_compress(cinfo, TRUE);
+  while (cinfo->next_scanline < cinfo->image_height) {
+    encoder_fill_row(im, cinfo->next_scanline, row);
+    jpeg_write_scanlines(cinfo, &row, 1);
+  }
+  jpeg_finish_compress(cinfo);
+  return 1;
+}
+
+/******************** PNG ********************/
+
+#ifdef USE_PNG
+static void encoder_png_error(png_structp png_ptr, png_const_charp msg)
+{
+  char *err = png_get_error_ptr(png_ptr);
+  strncpy(err, msg, JMSG_LENGTH_MAX - 1);
+  err[JMSG_LENGTH_MAX - 1] = '\0';
+  longjmp(png_jmpbuf(png_ptr), 1);
+}
+
+static void encoder_png_write(png_structp png_ptr, png_bytep data, png_size_t length)
+{
+  encoder_Buffer *out = png_get_io_ptr(png_ptr);
+  if (!encoder_reserve(out, length))
+    png_error(png_ptr, "out of memory");
+  memcpy(out->data + out->size, data, length);
+  out->size += length;
+}
+
+static void encoder_png_flush(png_structp png_ptr)
+{
+}
+
+/* libpng write structs cannot be reset: only the buffers are reused */
+static int encoder_png(encoder_Encoder *enc, encoder_Slot *slot, encoder_Image *im)
+{
+  png_structp png_ptr;
+  png_infop info_ptr;
+  long y;
+
+  png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, im->err, encoder_png_error, NULL);
+  info_ptr = png_ptr ? png_create_info_struct(png_ptr) : NULL;
+  if (!info_ptr) {
+    png_destroy_write_struct(&png_ptr, NULL);
+    strcpy(im->err, "could not create the PNG write structs");
+    return 0;
+  }
+
+  if (setjmp(png_jmpbuf(png_ptr))) {
+    png_destroy_write_struct(&png_ptr, &info_ptr);
+    return 0;
+  }
+
+  png_set_write_fn(png_ptr, &slot->out, encoder_png_write, encoder_png_flush);
+  if (enc->level >= 0)
+    png_set_compression_level(png_ptr, enc->level);
+  png_set_IHDR(png_ptr, info_ptr, im->width, im->height, 8,
+               im->channels == 4 ? PNG_COLOR_TYPE_RGBA :
+               im->channels == 3 ? PNG_COLOR_TYPE_RGB : PNG_COLOR_TYPE_GRAY,
+               PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+  png_write_info(png_ptr, info_ptr);
+  for (y = 0; y < im->height; y++) {
+    encoder_fill_row(im, y, slot->row.data);
+    png_write_row(png_ptr, slot->row.data);
+  }
+  png_write_end(png_ptr, NULL);
+  png_destroy_write_struct(&png_ptr, &info_ptr);
+  return 1;
+}
+#endif
+
+/******************** encoding ********************/
+
+/* encodes im, appending to the output buffer of the slot */
+static void encoder_encode(encoder_Encoder *enc, int slot_index, encoder_Image *im)
+{
+  encoder_Slot *slot = &enc->slots[slot_index];
+  int ok;
+
+  im->slot = slot_index;
+  im->offset = slot->out.size;
+  im->size = 0;
+  slot->row.size = 0;
+  if (!encoder_reserve(&slot->row, im->width * im->channels)) {
+    strcpy(im->err, "out of memory");
+    return;
+  }
+#ifdef USE_PNG
+  if (enc->format == ENCODER_PNG)
+    ok = encoder_png(enc, slot, im);
+  else
+#endif
+    ok = encoder_jpeg(enc, slot, im);
+  if (ok) {
+    im->size = slot->out.size - im->offset;
+  } else {
+    slot->out.size = im->offset;
+    if (!im->err[0])
+      strcpy(im->err, "encoding failed");
+  }
+}
+
+/* reads the image at index idx of the Lua stack */
+static void encoder_checkimage(lua_State *L, int idx, encoder_Encoder *enc, encoder_Image *im)
+{
+  THByteTensor *b;
+  THFloatTensor *f;
+  THDoubleTensor *d;
+  long *size, *stride;
+  int ndim;
+
+  if ((b = luaT_toudata(L, idx, "torch.ByteTensor"))) {
+    im->type = ENCODER_BYTE;
+    im->data = THByteTensor_data(b);
+    ndim = b->nDimension; size = b->size; stride = b->stride;
+  } else if ((f = luaT_toudata(L, idx, "torch.FloatTensor"))) {
+    im->type = ENCODER_FLOAT;
+    im->data = THFloatTensor_data(f);
+    ndim = f->nDimension; size = f->size; stride = f->stride;
+  } else if ((d = luaT_toudata(L, idx, "torch.DoubleTensor"))) {
+    im->type = ENCODER_DOUBLE;
+    im->data = THDoubleTensor_data(d);
+    ndim = d->nDimension; size = d->size; stride = d->stride;
+  } else {
+    luaL_error(L, "image.Encoder: images must be Byte, Float or Double tensors");
+    return;
+  }
+
+  if (ndim == 2) {
+    im->channels = 1;
+    im->stride[0] = 0;
+    im->height = size[0]; im->stride[1] = stride[0];
+    im->width = size[1]; im->stride[2] = stride[1];
+  } else if (ndim == 3) {
+    im->channels = size[0]; im->stride[0] = stride[0];
+    im->height = size[1]; im->stride[1] = stride[1];
+    im->width = size[2]; im->stride[2] = stride[2];
+  } else {
+    luaL_error(L, "image.Encoder: images must be 2D or 3D");
+  }
+  if (enc->format == ENCODER_JPEG && im->channels != 1 && im->channels != 3)
+    luaL_error(L, "image.Encoder: JPEG images must have 1 or 3 channels");
+  if (enc->format == ENCODER_PNG && im->channels != 1 && im->channels != 3 && im->channels != 4)
+    luaL_error(L, "image.Encoder: PNG images must have 1, 3 or 4 channels");
+  if (im->width <= 0 || im->height <= 0)
+    luaL_error(L, "image.Encoder: empty image");
+  im->err[0] = '\0';
+}
+
+/* copies the encoding of im into a ByteTensor */
+static void encoder_copyout(encoder_Encoder *enc, encoder_Image *im, THByteTensor *dst)
+{
+  THByteTensor_resize1d(dst, im->size);
+  memcpy(THByteTensor_data(dst), enc->slots[im->slot].out.data + im->offset, im->size);
+}
+
+static void encoder_clear(encoder_Encoder *enc)
+{
+  int i;
+  for (i = 0; i < enc->nslot; i++)
+    enc->slots[i].out.size = 0;
+}
+
+/******************** Lua ********************/
+
+/* Encoder(format, quality, level, nthread) */
+static int encoder_new(lua_State *L)
+{
+  static const char *formats[] = {"jpg", "png", NULL};
+  int format = luaL_checkoption(L, 1, "jpg", formats);
+  int quality = luaL_checkint(L, 2);
+  int level = luaL_checkint(L, 3);
+  int nslot = luaL_checkint(L, 4);
+  encoder_Encoder *enc;
+  int i;
+
+#ifndef USE_PNG
+  if (format == ENCODER_PNG)
+    luaL_error(L, "image.Encoder: PNG support not compiled (libpng not found)");
+#endif
+  luaL_argcheck(L, quality >= 0 && quality <= 100, 2, "quality should be between 0 and 100");
+  luaL_argcheck(L, level >= -1 && level <= 9, 3, "level should be between 0 and 9 (-1 for default)");
+  luaL_argcheck(L, nslot >= 1, 4, "at least one thread expected");
+
+  enc = luaT_alloc(L, sizeof(encoder_Encoder));
+  enc->format = format;
+  enc->quality = quality;
+  enc->level = level;
+  enc->nslot = nslot;
+  enc->slots = calloc(nslot, sizeof(encoder_Slot));
+  if (!enc->slots) {
+    luaT_free(L, enc);
+    luaL_error(L, "image.Encoder: out of memory");
+  }
+  if (format == ENCODER_JPEG)
+    for (i = 0; i < nslot; i++)
+      encoder_jpeg_slot_init(&enc->slots[i]);
+  luaT_pushudata(L, enc, "image.Encoder");
+  return 1;
+}
+
+static int encoder_free(lua_State *L)
+{
+  encoder_Encoder *enc = luaT_checkudata(L, 1, "image.Encoder");
+  int i;
+  for (i = 0; i < enc->nslot; i++) {
+    if (enc->slots[i].has_cinfo)
+      jpeg_destroy_compress(&enc->slots[i].cinfo);
+    free(enc->slots[i].out.data);
+    free(enc->slots[i].row.data);
+  }
+  free(enc->slots);
+  luaT_free(L, enc);
+  return 0;
+}
+
+/* encoder:encode(image, [dst]): returns a ByteTensor */
+static int encoder_lua_encode(lua_State *L)
+{
+  encoder_Encoder *enc = luaT_checkudata(L, 1, "image.Encoder");
+  THByteTensor *dst;
+  encoder_Image im;
+
+  encoder_checkimage(L, 2, enc, &im);
+  if (lua_isnoneornil(L, 3)) {
+    dst = THByteTensor_new();
+    luaT_pushudata(L, dst, "torch.ByteTensor");
+  } else {
+    dst = luaT_checkudata(L, 3, "torch.ByteTensor");
+    lua_pushvalue(L, 3);
+  }
+
+  encoder_clear(enc);
+  encoder_encode(enc, 0, &im);
+  if (im.err[0])
+    luaL_error(L, "image.Encoder: %s", im.err);
+  encoder_copyout(enc, &im, dst);
+  return 1;
+}
+
+/* encoder:encodeBatch(images, [dsts]): images is a table of images, or a
+   N x C x H x W tensor; returns dsts, a table of ByteTensors (reused when
+   given) */
+static int encoder_lua_encodeBatch(lua_State *L)
+{
+  encoder_Encoder *enc = luaT_checkudata(L, 1, "image.Encoder");
+  int istable = lua_istable(L, 2);
+  encoder_Image *images;
+  long n, i;
+
+  if (istable) {
+    n = lua_objlen(L, 2);
+  } else {
+    lua_getfield(L, 2, "size");
+    lua_pushvalue(L, 2);
+    lua_pushinteger(L, 1);
+    lua_call(L, 2, 1);
+    n = lua_tointeger(L, -1);
+    lua_pop(L, 1);
+  }
+  if (lua_isnoneornil(L, 3)) {
+    lua_settop(L, 2);
+    lua_newtable(L);
+  } else {
+    luaL_checktype(L, 3, LUA_TTABLE);
+    lua_settop(L, 3);
+  }
+  /* slices of a batch tensor, kept alive while encoding */
+  lua_newtable(L);
+
+  images = lua_newuserdata(L, sizeof(encoder_Image) * (n > 0 ? n : 1));
+  for (i = 0; i < n; i++) {
+    if (istable) {
+      lua_rawgeti(L, 2, i+1);
+    } else {
+      lua_getfield(L, 2, "select");
+      lua_pushvalue(L, 2);
+      lua_pushinteger(L, 1);
+      lua_pushinteger(L, i+1);
+      lua_call(L, 3, 1);
+    }
+    encoder_checkimage(L, -1, enc, &images[i]);
+    lua_rawseti(L, 4, i+1);
+  }
+
+  encoder_clear(enc);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(enc->nslot) if(n > 1)
+  for (i = 0; i < n; i++) {
+#ifdef _OPENMP
+    encoder_encode(enc, omp_get_thread_num(), &images[i]);
+#else
+    encoder_encode(enc, 0, &images[i]);
+#endif
+  }
+
+  for (i = 0; i < n; i++)
+    if (images[i].err[0])
+      luaL_error(L, "image.Encoder: image %d: %s", (int)i+1, images[i].err);
+
+  for (i = 0; i < n; i++) {
+    THByteTensor *dst;
+    lua_rawgeti(L, 3, i+1);
+    dst = luaT_toudata(L, -1, "torch.ByteTensor");
+    lua_pop(L, 1);
+    if (!dst) {
+      dst = THByteTensor_new();
+      luaT_pushudata(L, dst, "torch.ByteTensor");
+      lua_rawseti(L, 3, i+1);
+    }
+    encoder_copyout(enc, &images[i], dst);
+  }
+  lua_pushvalue(L, 3);
+  return 1;
+}
+
+/* encoder:save(filename, image) */
+static int encoder_lua_save(lua_State *L)
+{
+  encoder_Encoder *enc = luaT_checkudata(L, 1, "image.Encoder");
+  const char *filename = luaL_checkstring(L, 2);
+  encoder_Image im;
+  FILE *f;
+  size_t written;
+
+  encoder_checkimage(L, 3, enc, &im);
+  encoder_clear(enc);
+  encoder_encode(enc, 0, &im);
+  if (im.err[0])
+    luaL_error(L, "image.Encoder: %s", im.err);
+
+  f = fopen(filename, "wb");
+  if (!f)
+    luaL_error(L, "image.Encoder: could not open %s for writing", filename);
+  written = fwrite(enc->slots[0].out.data + im.offset, 1, im.size, f);
+  fclose(f);
+  if (written != im.size)
+    luaL_error(L, "image.Encoder: could not write %s", filename);
+  return 0;
+}
+
+static int encoder_lua_tostring(lua_State *L)
+{
+  encoder_Encoder *enc = luaT_checkudata(L, 1, "image.Encoder");
+  if (enc->format == ENCODER_JPEG)
+    lua_pushfstring(L, "image.Encoder [jpg, quality %d, %d threads]", enc->quality, enc->nslot);
+  else
+    lua_pushfstring(L, "image.Encoder [png, level %d, %d threads]", enc->level, enc->nslot);
+  return 1;
+}
+
+static const struct luaL_Reg encoder_methods[] = {
+  {"encode", encoder_lua_encode},
+  {"encodeBatch", encoder_lua_encodeBatch},
+  {"save", encoder_lua_save},
+  {"__tostring__", encoder_lua_tostring},
+  {NULL, NULL}
+};
+
+DLL_EXPORT int luaopen_libimageencoder(lua_State *L)
+{
+  lua_newtable(L);
+  luaT_newlocalmetatable(L, "image.Encoder", NULL, encoder_new, encoder_free, NULL, lua_gettop(L));
+  luaT_setfuncs(L, encoder_methods, 0);
+  lua_pop(L, 1);
+  return 1;
+}
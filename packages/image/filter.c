@@ -0,0 +1,75 @@
+/*
+ * Helpers for the separable filters (image.convolve with rank-1 kernels,
+ * image.boxfilter, image.gaussianblur).
+ *
+ * A 2D separable filter runs in two passes: the rows of a plane are
+ * filtered into a buffer, whose rows are then combined, a whole row at a
+ * time. Both passes are loops over contiguous rows, which the compiler can
+ * vectorize, and a k x k kernel costs 2k instead of k^2 multiply-adds per
+ * pixel. Pixels outside the image are zeros, as for image.convolve.
+ */
+
+/* columns per chunk of the vertical passes that cannot run row by row */
+#define IMAGE_FILTER_CHUNK 256
+
+/*
+ * Recursive (IIR) Gaussian filter of Young and van Vliet ("Recursive
+ * implementation of the Gaussian filter", 1995): a causal and an anticausal
+ * third order recursion, for a cost that does not depend on sigma. The
+ * coefficients are c[0] (gain) and c[1..3] (feedback).
+ */
+static void image_iir_coefficients(double sigma, double *c)
+{
+  double q, q2, q3, b0;
+  if (sigma >= 2.5)
+    q = 0.98711 * sigma - 0.96330;
+  else
+    q = 3.97156 - 4.14554 * sqrt(1 - 0.26891 * sigma);
+  q2 = q * q;
+  q3 = q2 * q;
+  b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+  c[1] = (2.44413 * q + 2.85619 * q2 + 1.26661 * q3) / b0;
+  c[2] = -(1.4281 * q2 + 1.26661 * q3) / b0;
+  c[3] = 0.422205 * q3 / b0;
+  c[0] = 1 - (c[1] + c[2] + c[3]);
+}
+
+/* samples past the end of a line over which the causal response is carried
+   before the anticausal recursion starts (from zero) */
+static long image_iir_margin(double sigma)
+{
+  return (long)ceil(4 * sigma);
+}
+
+/*
+ * Filters a line in place: line[-3 .. -1] and line[n .. n+2] are zeros,
+ * and the signal is zero from line[n - margin] on.
+ */
+static void image_iir_line(double *line, long n, const double *c)
+{
+  long i;
+  for (i = 0; i < n; i++)
+    line[i] = c[0] * line[i] + c[1] * line[i-1] + c[2] * line[i-2] + c[3] * line[i-3];
+  for (i = n - 1; i >= 0; i--)
+    line[i] = c[0] * line[i] + c[1] * line[i+1] + c[2] * line[i+2] + c[3] * line[i+3];
+}
+
+/*
+ * Same, along the columns [c0, c1) of n rows of the given stride (padded
+ * as above): the recursions run on whole row segments.
+ */
+static void image_iir_columns(double *rows, long stride, long n, long c0, long c1,
+                              const double *c)
+{
+  long i, x;
+  for (i = 0; i < n; i++) {
+    double *r = rows + i*stride;
+    for (x = c0; x < c1; x++)
+      r[x] = c[0] * r[x] + c[1] * r[x - stride] + c[2] * r[x - 2*stride] + c[3] * r[x - 3*stride];
+  }
+  for (i = n - 1; i >= 0; i--) {
+    double *r = rows + i*stride;
+    for (x = c0; x < c1; x++)
+      r[x] = c[0] * r[x] + c[1] * r[x + stride] + c[2] * r[x + 2*stride] + c[3] * r[x + 3*stride];
+  }
+}
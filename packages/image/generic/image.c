@@ -22,6 +22,35 @@
 #define temp_t float
 #endif
 
+/* colour conversions work on [0, 1] values: byte images are scaled, and
+   their chroma channels centered */
+#undef IMAGE_COLOR_RANGE
+#undef IMAGE_CHROMA_OFFSET
+#ifdef TH_REAL_IS_BYTE
+#define IMAGE_COLOR_RANGE 255
+#define IMAGE_CHROMA_OFFSET 0.5
+#else
+#define IMAGE_COLOR_RANGE 1
+#define IMAGE_CHROMA_OFFSET 0
+#endif
+
+/* normalized images are float, or double for double sources */
+#undef image_norm_real
+#undef image_NormTensor
+#undef image_NormTensor_
+#undef image_norm_tensor
+#ifdef TH_REAL_IS_DOUBLE
+#define image_norm_real double
+#define image_NormTensor THDoubleTensor
+#define image_NormTensor_(NAME) THDoubleTensor_##NAME
+#define image_norm_tensor "torch.DoubleTensor"
+#else
+#define image_norm_real float
+#define image_NormTensor THFloatTensor
+#define image_NormTensor_(NAME) THFloatTensor_##NAME
+#define image_norm_tensor "torch.FloatTensor"
+#endif
+
 
 static inline real image_(FromIntermediate)(temp_t x) {
 #ifdef TH_REAL_IS_BYTE
@@ -65,78 +94,6 @@ static long image_(Main_op_depth)( THTensor *T){
   return 1; /* greyscale */
 }
 
-static void image_(Main_scaleLinear_rowcol)(THTensor *Tsrc,
-                                            THTensor *Tdst,
-                                            long src_start,
-                                            long dst_start,
-                                            long src_stride,
-                                            long dst_stride,
-                                            long src_len,
-                                            long dst_len ) {
-
-  real *src= THTensor_(data)(Tsrc);
-  real *dst= THTensor_(data)(Tdst);
-
-  if ( dst_len > src_len ){
-    long di;
-    float si_f;
-    long si_i;
-    float scale = (float)(src_len - 1) / (dst_len - 1);
-
-    if ( src_len == 1 ) {
-      for( di = 0; di < dst_len - 1; di++ ) {
-        long dst_pos = dst_start + di*dst_stride;
-        dst[dst_pos] = src[ src_start ];
-      }
-    } else {
-      for( di = 0; di < dst_len - 1; di++ ) {
-        long dst_pos = dst_start + di*dst_stride;
-        si_f = di * scale; si_i = (long)si_f; si_f -= si_i;
-
-        dst[dst_pos] = image_(FromIntermediate)(
-            (1 - si_f) * src[ src_start + si_i * src_stride ] +
-            si_f * src[ src_start + (si_i + 1) * src_stride ]);
-      }
-    }
-
-    dst[ dst_start + (dst_len - 1) * dst_stride ] =
-      src[ src_start + (src_len - 1) * src_stride ];
-  }
-  else if ( dst_len < src_len ) {
-    long di;
-    long si0_i = 0; float si0_f = 0;
-    long si1_i; float si1_f;
-    long si;
-    float scale = (float)src_len / dst_len;
-    float acc, n;
-
-    for( di = 0; di < dst_len; di++ )
-      {
-        si1_f = (di + 1) * scale; si1_i = (long)si1_f; si1_f -= si1_i;
-        acc = (1 - si0_f) * src[ src_start + si0_i * src_stride ];
-        n = 1 - si0_f;
-        for( si = si0_i + 1; si < si1_i; si++ )
-          {
-            acc += src[ src_start + si * src_stride ];
-            n += 1;
-          }
-        if( si1_i < src_len )
-          {
-            acc += si1_f * src[ src_start + si1_i*src_stride ];
-            n += si1_f;
-          }
-        dst[ dst_start + di*dst_stride ] = image_(FromIntermediate)(acc / n);
-        si0_i = si1_i; si0_f = si1_f;
-      }
-  }
-  else {
-    long i;
-    for( i = 0; i < dst_len; i++ )
-      dst[ dst_start + i*dst_stride ] = src[ src_start + i*src_stride ];
-  }
-}
-
-
 static inline temp_t image_(Main_cubicInterpolate)(temp_t p0,
                                                    temp_t p1,
                                                    temp_t p2,
@@ -150,190 +107,230 @@ static inline temp_t image_(Main_cubicInterpolate)(temp_t p0,
 }
 
 
-static void image_(Main_scaleCubic_rowcol)(THTensor *Tsrc,
-                                           THTensor *Tdst,
-                                           long src_start,
-                                           long dst_start,
-                                           long src_stride,
-                                           long dst_stride,
-                                           long src_len,
-                                           long dst_len ) {
-
-  real *src= THTensor_(data)(Tsrc);
-  real *dst= THTensor_(data)(Tdst);
-
-  if ( dst_len == src_len ){
-    long i;
-    for( i = 0; i < dst_len; i++ )
-      dst[ dst_start + i*dst_stride ] = src[ src_start + i*src_stride ];
-  } else if ( src_len == 1 ) {
-     long i;
-     for( i = 0; i < dst_len - 1; i++ ) {
-       long dst_pos = dst_start + i*dst_stride;
-       dst[dst_pos] = src[ src_start ];
-     }
-  } else {
-    long di;
-    float si_f;
-    long si_i;
-    float scale;
-    if (dst_len == 1)
-      scale = (float)(src_len - 1);
-    else
-      scale = (float)(src_len - 1) / (dst_len - 1);
-
-    for( di = 0; di < dst_len - 1; di++ ) {
-      long dst_pos = dst_start + di*dst_stride;
-      si_f = di * scale; si_i = (long)si_f; si_f -= si_i;
-
-      temp_t p0;
-      temp_t p1 = src[ src_start + si_i * src_stride ];
-      temp_t p2 = src[ src_start + (si_i + 1) * src_stride ];
-      temp_t p3;
-      if (si_i > 0) {
-        p0 = src[ src_start + (si_i - 1) * src_stride ];
-      } else {
-        p0 = 2 * p1 - p2;
-      }
-      if (si_i + 2 < src_len) {
-        p3 = src[ src_start + (si_i + 2) * src_stride ];
-      } else {
-        p3 = 2 * p2 - p1;
-      }
-
-      temp_t value = image_(Main_cubicInterpolate)(p0, p1, p2, p3, si_f);
-      dst[dst_pos] = image_(FromIntermediate)(value);
+/* resamples one row: dst[i] = sum_t weight[i][t] * src[first[i] + t] */
+static void image_(Main_scaleRow)(const real *src, long src_stride, real *dst,
+                                  const image_Filter *f) {
+  long ntap = f->ntap;
+  long i, t;
+  for (i = 0; i < f->dst_len; i++) {
+    const float *w = f->weight + i*ntap;
+    const real *s = src + f->first[i]*src_stride;
+    temp_t acc = 0;
+    if (src_stride == 1) {
+      for (t = 0; t < ntap; t++)
+        acc += w[t] * s[t];
+    } else {
+      for (t = 0; t < ntap; t++)
+        acc += w[t] * s[t*src_stride];
     }
-
-    dst[ dst_start + (dst_len - 1) * dst_stride ] =
-      src[ src_start + (src_len - 1) * src_stride ];
+    dst[i] = image_(FromIntermediate)(acc);
   }
 }
 
-static int image_(Main_scaleBilinear)(lua_State *L) {
+/* resamples row y of a column pass, from contiguous rows of width pixels:
+   dst[x] = sum_t weight[y][t] * src[first[y] + t][x] */
+static void image_(Main_scaleColumns)(const real *src, long width, real *dst, long dst_stride,
+                                      const image_Filter *f, long y) {
+  temp_t acc[IMAGE_SCALE_CHUNK];
+  long x0, x, t;
+  for (x0 = 0; x0 < width; x0 += IMAGE_SCALE_CHUNK) {
+    long n = MIN(IMAGE_SCALE_CHUNK, width - x0);
+    for (x = 0; x < n; x++)
+      acc[x] = 0;
+    for (t = 0; t < f->ntap; t++) {
+      float w = f->weight[y*f->ntap + t];
+      const real *s = src + (f->first[y] + t)*width + x0;
+      if (w == 0)
+        continue;
+      for (x = 0; x < n; x++)
+        acc[x] += w * s[x];
+    }
+    for (x = 0; x < n; x++)
+      dst[(x0 + x)*dst_stride] = image_(FromIntermediate)(acc[x]);
+  }
+}
 
+/*
+ * Separable resize of src into dst, with the filter tables of the given
+ * mode: rows first (into a temporary, of the src type), then columns.
+ * Both passes are parallel over rows.
+ */
+static int image_(Main_scaleFilter)(lua_State *L, int mode) {
   THTensor *Tsrc = luaT_checkudata(L, 1, torch_Tensor);
   THTensor *Tdst = luaT_checkudata(L, 2, torch_Tensor);
   THTensor *Ttmp;
-  long dst_stride0, dst_stride1, dst_stride2, dst_width, dst_height;
+  const image_Filter *fx, *fy;
+  real *src, *dst, *tmp;
   long src_stride0, src_stride1, src_stride2, src_width, src_height;
-  long tmp_stride0, tmp_stride1, tmp_stride2, tmp_width, tmp_height;
-  long i, j, k;
-
-  image_(Main_op_validate)(L, Tsrc,Tdst);
-
+  long dst_stride0, dst_stride1, dst_stride2, dst_width, dst_height;
+  long depth, r;
   int ndims;
-  if (Tdst->nDimension == 3) ndims = 3;
-  else ndims = 2;
-
-  Ttmp = THTensor_(newWithSize2d)(Tsrc->size[ndims-2], Tdst->size[ndims-1]);
-
-  dst_stride0= image_(Main_op_stride)(Tdst,0);
-  dst_stride1= image_(Main_op_stride)(Tdst,1);
-  dst_stride2= image_(Main_op_stride)(Tdst,2);
-  src_stride0= image_(Main_op_stride)(Tsrc,0);
-  src_stride1= image_(Main_op_stride)(Tsrc,1);
-  src_stride2= image_(Main_op_stride)(Tsrc,2);
-  tmp_stride0= image_(Main_op_stride)(Ttmp,0);
-  tmp_stride1= image_(Main_op_stride)(Ttmp,1);
-  tmp_stride2= image_(Main_op_stride)(Ttmp,2);
-  dst_width=   Tdst->size[ndims-1];
-  dst_height=  Tdst->size[ndims-2];
-  src_width=   Tsrc->size[ndims-1];
-  src_height=  Tsrc->size[ndims-2];
-  tmp_width=   Ttmp->size[1];
-  tmp_height=  Ttmp->size[0];
-
-  for(k=0;k<image_(Main_op_depth)(Tsrc);k++) {
-    /* compress/expand rows first */
-    for(j = 0; j < src_height; j++) {
-      image_(Main_scaleLinear_rowcol)(Tsrc,
-                                      Ttmp,
-                                      0*src_stride2+j*src_stride1+k*src_stride0,
-                                      0*tmp_stride2+j*tmp_stride1+k*tmp_stride0,
-                                      src_stride2,
-                                      tmp_stride2,
-                                      src_width,
-                                      tmp_width );
 
-    }
+  image_(Main_op_validate)(L, Tsrc, Tdst);
+  ndims = Tdst->nDimension;
+
+  src_stride0 = image_(Main_op_stride)(Tsrc,0);
+  src_stride1 = image_(Main_op_stride)(Tsrc,1);
+  src_stride2 = image_(Main_op_stride)(Tsrc,2);
+  dst_stride0 = image_(Main_op_stride)(Tdst,0);
+  dst_stride1 = image_(Main_op_stride)(Tdst,1);
+  dst_stride2 = image_(Main_op_stride)(Tdst,2);
+  src_width = Tsrc->size[ndims-1];
+  src_height = Tsrc->size[ndims-2];
+  dst_width = Tdst->size[ndims-1];
+  dst_height = Tdst->size[ndims-2];
+  depth = image_(Main_op_depth)(Tsrc);
+
+  /* both filters stay on the stack while in use */
+  fx = image_filter_get(L, mode, src_width, dst_width);
+  fy = image_filter_get(L, mode, src_height, dst_height);
+
+  Ttmp = THTensor_(newWithSize3d)(depth, src_height, dst_width);
+  src = THTensor_(data)(Tsrc);
+  dst = THTensor_(data)(Tdst);
+  tmp = THTensor_(data)(Ttmp);
+
+  /* compress/expand rows first */
+#pragma omp parallel for private(r) if(depth*src_height*dst_width*fx->ntap > IMAGE_OMP_THRESHOLD)
+  for (r = 0; r < depth*src_height; r++) {
+    long k = r / src_height, j = r % src_height;
+    image_(Main_scaleRow)(src + k*src_stride0 + j*src_stride1, src_stride2,
+                          tmp + r*dst_width, fx);
+  }
 
-    /* then columns */
-    for(i = 0; i < dst_width; i++) {
-      image_(Main_scaleLinear_rowcol)(Ttmp,
-                                      Tdst,
-                                      i*tmp_stride2+0*tmp_stride1+k*tmp_stride0,
-                                      i*dst_stride2+0*dst_stride1+k*dst_stride0,
-                                      tmp_stride1,
-                                      dst_stride1,
-                                      tmp_height,
-                                      dst_height );
-    }
+  /* then columns */
+#pragma omp parallel for private(r) if(depth*dst_height*dst_width*fy->ntap > IMAGE_OMP_THRESHOLD)
+  for (r = 0; r < depth*dst_height; r++) {
+    long k = r / dst_height, i = r % dst_height;
+    image_(Main_scaleColumns)(tmp + k*src_height*dst_width, dst_width,
+                              dst + k*dst_stride0 + i*dst_stride1, dst_stride2,
+                              fy, i);
   }
+
   THTensor_(free)(Ttmp);
   return 0;
 }
 
+static int image_(Main_scaleBilinear)(lua_State *L) {
+  return image_(Main_scaleFilter)(L, IMAGE_FILTER_BILINEAR);
+}
+
 static int image_(Main_scaleBicubic)(lua_State *L) {
+  return image_(Main_scaleFilter)(L, IMAGE_FILTER_BICUBIC);
+}
 
-  THTensor *Tsrc = luaT_checkudata(L, 1, torch_Tensor);
-  THTensor *Tdst = luaT_checkudata(L, 2, torch_Tensor);
-  THTensor *Ttmp;
-  long dst_stride0, dst_stride1, dst_stride2, dst_width, dst_height;
-  long src_stride0, src_stride1, src_stride2, src_width, src_height;
-  long tmp_stride0, tmp_stride1, tmp_stride2, tmp_width, tmp_height;
-  long i, j, k;
+static int image_(Main_scaleArea)(lua_State *L) {
+  return image_(Main_scaleFilter)(L, IMAGE_FILTER_AREA);
+}
 
-  image_(Main_op_validate)(L, Tsrc,Tdst);
+static int image_(Main_scaleLanczos)(lua_State *L) {
+  return image_(Main_scaleFilter)(L, IMAGE_FILTER_LANCZOS);
+}
 
-  int ndims;
-  if (Tdst->nDimension == 3) ndims = 3;
-  else ndims = 2;
-
-  Ttmp = THTensor_(newWithSize2d)(Tsrc->size[ndims-2], Tdst->size[ndims-1]);
-
-  dst_stride0= image_(Main_op_stride)(Tdst,0);
-  dst_stride1= image_(Main_op_stride)(Tdst,1);
-  dst_stride2= image_(Main_op_stride)(Tdst,2);
-  src_stride0= image_(Main_op_stride)(Tsrc,0);
-  src_stride1= image_(Main_op_stride)(Tsrc,1);
-  src_stride2= image_(Main_op_stride)(Tsrc,2);
-  tmp_stride0= image_(Main_op_stride)(Ttmp,0);
-  tmp_stride1= image_(Main_op_stride)(Ttmp,1);
-  tmp_stride2= image_(Main_op_stride)(Ttmp,2);
-  dst_width=   Tdst->size[ndims-1];
-  dst_height=  Tdst->size[ndims-2];
-  src_width=   Tsrc->size[ndims-1];
-  src_height=  Tsrc->size[ndims-2];
-  tmp_width=   Ttmp->size[1];
-  tmp_height=  Ttmp->size[0];
-
-  for(k=0;k<image_(Main_op_depth)(Tsrc);k++) {
-    /* compress/expand rows first */
-    for(j = 0; j < src_height; j++) {
-      image_(Main_scaleCubic_rowcol)(Tsrc,
-                                     Ttmp,
-                                     0*src_stride2+j*src_stride1+k*src_stride0,
-                                     0*tmp_stride2+j*tmp_stride1+k*tmp_stride0,
-                                     src_stride2,
-                                     tmp_stride2,
-                                     src_width,
-                                     tmp_width );
-    }
+/*
+ * Crops the box [x1, x2) x [y1, y2) of src, resizes it to the size of dst
+ * with the filter tables of the given mode, mirrors it horizontally if
+ * flip is set, and normalizes channel k to (pixel - mean[k]) / std[k].
+ * Byte pixels are scaled to [0, 1] first. dst is a float image (double
+ * for double sources), typically a slice of a batch: it is written in a
+ * single pass, each output row from a buffer holding the vertically
+ * filtered crop row.
+ */
+static int image_(Main_cropScaleNormalize)(lua_State *L) {
+  THTensor *Tsrc = luaT_checkudata(L, 1, torch_Tensor);
+  image_NormTensor *Tdst = luaT_checkudata(L, 2, image_norm_tensor);
+  long x1 = luaL_checklong(L, 3);
+  long y1 = luaL_checklong(L, 4);
+  long x2 = luaL_checklong(L, 5);
+  long y2 = luaL_checklong(L, 6);
+  int flip = lua_toboolean(L, 7);
+  static const char *modes[] = {"bilinear", "bicubic", "area", "lanczos", NULL};
+  int mode = luaL_checkoption(L, 10, "bilinear", modes);
+  const image_Filter *fx, *fy;
+  const real *src;
+  image_norm_real *dst;
+  image_norm_real offset[4], scale[4];
+  long src_stride0, src_stride1, src_stride2;
+  long dst_stride0, dst_stride1, dst_stride2;
+  long crop_width = x2 - x1, crop_height = y2 - y1;
+  long dst_width, dst_height, depth, c;
+  int ndims = Tsrc->nDimension;
+
+  luaL_argcheck(L, ndims == 2 || ndims == 3, 1, "src not 2 or 3 dimensional");
+  luaL_argcheck(L, Tdst->nDimension == ndims, 2, "src and dst not of same dimension");
+  depth = ndims == 3 ? Tsrc->size[0] : 1;
+  luaL_argcheck(L, ndims == 2 || Tdst->size[0] == depth, 2, "src and dst depths do not match");
+  luaL_argcheck(L, depth <= 4, 1, "at most 4 channels");
+  if (x1 < 0 || y1 < 0 || x2 > Tsrc->size[ndims-1] || y2 > Tsrc->size[ndims-2] ||
+      crop_width <= 0 || crop_height <= 0)
+    luaL_error(L, "image.cropScaleNormalize: box not inside src");
+  luaL_checktype(L, 8, LUA_TTABLE);
+  luaL_checktype(L, 9, LUA_TTABLE);
+
+  /* (pixel - mean) / std = pixel * scale - offset */
+  for (c = 0; c < depth; c++) {
+    double mean, std;
+    lua_rawgeti(L, 8, c+1);
+    lua_rawgeti(L, 9, c+1);
+    mean = luaL_checknumber(L, -2);
+    std = luaL_checknumber(L, -1);
+    lua_pop(L, 2);
+    if (std == 0)
+      luaL_error(L, "image.cropScaleNormalize: std must be non zero");
+    scale[c] = 1 / (std * IMAGE_COLOR_RANGE);
+    offset[c] = mean / std;
+  }
 
-    /* then columns */
-    for(i = 0; i < dst_width; i++) {
-      image_(Main_scaleCubic_rowcol)(Ttmp,
-                                     Tdst,
-                                     i*tmp_stride2+0*tmp_stride1+k*tmp_stride0,
-                                     i*dst_stride2+0*dst_stride1+k*dst_stride0,
-                                     tmp_stride1,
-                                     dst_stride1,
-                                     tmp_height,
-                                     dst_height );
+  src_stride0 = image_(Main_op_stride)(Tsrc, 0);
+  src_stride1 = image_(Main_op_stride)(Tsrc, 1);
+  src_stride2 = image_(Main_op_stride)(Tsrc, 2);
+  dst_stride0 = ndims == 3 ? Tdst->stride[0] : 0;
+  dst_stride1 = Tdst->stride[ndims-2];
+  dst_stride2 = Tdst->stride[ndims-1];
+  dst_width = Tdst->size[ndims-1];
+  dst_height = Tdst->size[ndims-2];
+  src = THTensor_(data)(Tsrc) + x1*src_stride2 + y1*src_stride1;
+  dst = image_NormTensor_(data)(Tdst);
+
+  /* both filters stay on the stack while in use */
+  fx = image_filter_get(L, mode, crop_width, dst_width);
+  fy = image_filter_get(L, mode, crop_height, dst_height);
+
+#pragma omp parallel if(depth*dst_height*(crop_width*fy->ntap + dst_width*fx->ntap) > IMAGE_OMP_THRESHOLD)
+  {
+    image_norm_real *row = THAlloc(sizeof(image_norm_real) * crop_width);
+    long r;
+#pragma omp for
+    for (r = 0; r < depth*dst_height; r++) {
+      long k = r / dst_height, i = r % dst_height;
+      const real *s = src + k*src_stride0 + fy->first[i]*src_stride1;
+      const float *wy = fy->weight + i*fy->ntap;
+      image_norm_real *d = dst + k*dst_stride0 + i*dst_stride1;
+      long x, t;
+
+      /* vertical filter: a crop row */
+      for (x = 0; x < crop_width; x++)
+        row[x] = wy[0] * s[x*src_stride2];
+      for (t = 1; t < fy->ntap; t++) {
+        const real *st = s + t*src_stride1;
+        for (x = 0; x < crop_width; x++)
+          row[x] += wy[t] * st[x*src_stride2];
+      }
+
+      /* horizontal filter, mirroring and normalization */
+      for (x = 0; x < dst_width; x++) {
+        const image_norm_real *rt = row + fx->first[x];
+        const float *wx = fx->weight + x*fx->ntap;
+        image_norm_real v = 0;
+        for (t = 0; t < fx->ntap; t++)
+          v += wx[t] * rt[t];
+        d[(flip ? dst_width - 1 - x : x)*dst_stride2] = v * scale[k] - offset[k];
+      }
     }
+    THFree(row);
   }
-  THTensor_(free)(Ttmp);
+
+  lua_pop(L, 2);
   return 0;
 }
 
@@ -473,6 +470,7 @@ static int image_(Main_rotate)(lua_State *L)
   sin_theta = sin(theta);
   cos_theta = cos(theta);
 
+#pragma omp parallel for private(i, k, ii, jj, id, jd) if(dst_height*dst_width*(src_depth+1) > IMAGE_OMP_THRESHOLD)
   for(j = 0; j < dst_height; j++) {
     jd=j;
     for(i = 0; i < dst_width; i++) {
@@ -519,6 +517,7 @@ static int image_(Main_rotateBilinear)(lua_State *L)
   long i, j, k;
   float xc, yc;
   float id,jd;
+  double cos_theta, sin_theta;
   long ii_0, ii_1, jj_0, jj_1;
 
   luaL_argcheck(L, Tsrc->nDimension==2 || Tsrc->nDimension==3, 1, "rotate: src not 2 or 3 dimensional");
@@ -562,14 +561,18 @@ static int image_(Main_rotateBilinear)(lua_State *L)
   xc = (src_width-1)/2.0;
   yc = (src_height-1)/2.0;
 
+  cos_theta = cos(theta);
+  sin_theta = sin(theta);
+
+#pragma omp parallel for private(i, k, ii_0, ii_1, jj_0, jj_1, id, jd) if(dst_height*dst_width*(src_depth+1)*IMAGE_TRANSFORM_COST > IMAGE_OMP_THRESHOLD)
   for(j = 0; j < dst_height; j++) {
     jd=j;
     for(i = 0; i < dst_width; i++) {
       float val = -1;
       temp_t ri, rj, wi, wj;
       id= i;
-      ri = cos(theta)*(id-xc)-sin(theta)*(jd-yc);
-      rj = cos(theta)*(jd-yc)+sin(theta)*(id-xc);
+      ri = cos_theta*(id-xc)-sin_theta*(jd-yc);
+      rj = cos_theta*(jd-yc)+sin_theta*(id-xc);
 
       ii_0 = (long)floor(ri+xc);
       ii_1 = ii_0 + 1;
@@ -622,6 +625,7 @@ static int image_(Main_polar)(lua_State *L)
     long src_stride0, src_stride1, src_stride2, src_width, src_height, src_depth;
     long i, j, k;
     float id, jd, a, r, m, midY, midX;
+    double cos_a, sin_a;
     long ii,jj;
 
     luaL_argcheck(L, Tsrc->nDimension==2 || Tsrc->nDimension==3, 1, "polar: src not 2 or 3 dimensional");
@@ -669,16 +673,19 @@ static int image_(Main_polar)(lua_State *L)
     }
 
     // loop to fill polar image
+#pragma omp parallel for private(i, k, ii, jj, id, jd, a, r, cos_a, sin_a) if(dst_height*dst_width*(src_depth+1) > IMAGE_OMP_THRESHOLD)
     for(j = 0; j < dst_height; j++) {               // orientation loop
         jd = (float) j;
-        a = (2 * M_PI * jd) / (float) dst_height;   // current angle
+        a = (2 * M_PI * jd) / (float) dst_height;
+        cos_a = cos(a);
+        sin_a = sin(a);   // current angle
         for(i = 0; i < dst_width; i++) {            // radius loop
             float val = -1;
             id = (float) i;
             r = (m * id) / (float) dst_width;       // current distance
 
-            jj = (long) floor( r * cos(a) + midY);  // y-location in source image
-            ii = (long) floor(-r * sin(a) + midX);  // x-location in source image
+            jj = (long) floor( r * cos_a + midY);  // y-location in source image
+            ii = (long) floor(-r * sin_a + midX);  // x-location in source image
 
             if(ii>src_width-1) val=0;
             if(jj>src_height-1) val=0;
@@ -715,6 +722,7 @@ static int image_(Main_polarBilinear)(lua_State *L)
     long src_stride0, src_stride1, src_stride2, src_width, src_height, src_depth;
     long i, j, k;
     float id, jd, a, r, m, midY, midX;
+    double cos_a, sin_a;
     long ii_0, ii_1, jj_0, jj_1;
 
     luaL_argcheck(L, Tsrc->nDimension==2 || Tsrc->nDimension==3, 1, "polar: src not 2 or 3 dimensional");
@@ -762,17 +770,20 @@ static int image_(Main_polarBilinear)(lua_State *L)
     }
 
     // loop to fill polar image
+#pragma omp parallel for private(i, k, ii_0, ii_1, jj_0, jj_1, id, jd, a, r, cos_a, sin_a) if(dst_height*dst_width*(src_depth+1)*IMAGE_TRANSFORM_COST > IMAGE_OMP_THRESHOLD)
     for(j = 0; j < dst_height; j++) {                 // orientation loop
         jd = (float) j;
-        a = (2 * M_PI * jd) / (float) dst_height;     // current angle
+        a = (2 * M_PI * jd) / (float) dst_height;
+        cos_a = cos(a);
+        sin_a = sin(a);     // current angle
         for(i = 0; i < dst_width; i++) {              // radius loop
             float val = -1;
             temp_t ri, rj, wi, wj;
             id = (float) i;
             r = (m * id) / (float) dst_width;         // current distance
 
-            rj =  r * cos(a) + midY;                  // y-location in source image
-            ri = -r * sin(a) + midX;                  // x-location in source image
+            rj =  r * cos_a + midY;                  // y-location in source image
+            ri = -r * sin_a + midX;                  // x-location in source image
 
             ii_0=(long)floor(ri);
             ii_1=ii_0 + 1;
@@ -843,6 +854,8 @@ static int image_(Main_logPolar)(lua_State *L)
     long src_stride0, src_stride1, src_stride2, src_width, src_height, src_depth;
     long i, j, k;
     float id, jd, a, r, m, midY, midX, fw;
+    double cos_a, sin_a;
+    float *radius;
     long ii,jj;
 
     luaL_argcheck(L, Tsrc->nDimension==2 || Tsrc->nDimension==3, 1, "polar: src not 2 or 3 dimensional");
@@ -890,18 +903,25 @@ static int image_(Main_logPolar)(lua_State *L)
     }
 
     // loop to fill polar image
+    // the radius only depends on the column
     fw = log(m) / (float) dst_width;
+    radius = THAlloc(sizeof(float) * dst_width);
+    for(i = 0; i < dst_width; i++) {
+        id = (float) i;
+        radius[i] = exp(id * fw);
+    }
+#pragma omp parallel for private(i, k, ii, jj, jd, a, r, cos_a, sin_a) if(dst_height*dst_width*(src_depth+1) > IMAGE_OMP_THRESHOLD)
     for(j = 0; j < dst_height; j++) {               // orientation loop
         jd = (float) j;
-        a = (2 * M_PI * jd) / (float) dst_height;   // current angle
+        a = (2 * M_PI * jd) / (float) dst_height;
+        cos_a = cos(a);
+        sin_a = sin(a);   // current angle
         for(i = 0; i < dst_width; i++) {            // radius loop
             float val = -1;
-            id = (float) i;
+            r = radius[i];
 
-            r = exp(id * fw);
-
-            jj = (long) floor( r * cos(a) + midY);  // y-location in source image
-            ii = (long) floor(-r * sin(a) + midX);  // x-location in source image
+            jj = (long) floor( r * cos_a + midY);  // y-location in source image
+            ii = (long) floor(-r * sin_a + midX);  // x-location in source image
 
             if(ii>src_width-1) val=0;
             if(jj>src_height-1) val=0;
@@ -926,6 +946,7 @@ static int image_(Main_logPolar)(lua_State *L)
             }
         }
     }
+    THFree(radius);
     return 0;
 }
 static int image_(Main_logPolarBilinear)(lua_State *L)
@@ -938,6 +959,8 @@ static int image_(Main_logPolarBilinear)(lua_State *L)
     long src_stride0, src_stride1, src_stride2, src_width, src_height, src_depth;
     long i, j, k;
     float id, jd, a, r, m, midY, midX, fw;
+    double cos_a, sin_a;
+    float *radius;
     long ii_0, ii_1, jj_0, jj_1;
 
     luaL_argcheck(L, Tsrc->nDimension==2 || Tsrc->nDimension==3, 1, "polar: src not 2 or 3 dimensional");
@@ -985,19 +1008,26 @@ static int image_(Main_logPolarBilinear)(lua_State *L)
     }
 
     // loop to fill polar image
+    // the radius only depends on the column
     fw = log(m) / (float) dst_width;
+    radius = THAlloc(sizeof(float) * dst_width);
+    for(i = 0; i < dst_width; i++) {
+        id = (float) i;
+        radius[i] = exp(id * fw);
+    }
+#pragma omp parallel for private(i, k, ii_0, ii_1, jj_0, jj_1, jd, a, r, cos_a, sin_a) if(dst_height*dst_width*(src_depth+1)*IMAGE_TRANSFORM_COST > IMAGE_OMP_THRESHOLD)
     for(j = 0; j < dst_height; j++) {                 // orientation loop
         jd = (float) j;
-        a = (2 * M_PI * jd) / (float) dst_height;     // current angle
+        a = (2 * M_PI * jd) / (float) dst_height;
+        cos_a = cos(a);
+        sin_a = sin(a);     // current angle
         for(i = 0; i < dst_width; i++) {              // radius loop
             float val = -1;
             float ri, rj, wi, wj;
-            id = (float) i;
-
-            r = exp(id * fw);
+            r = radius[i];
 
-            rj =  r * cos(a) + midY;                  // y-location in source image
-            ri = -r * sin(a) + midX;                  // x-location in source image
+            rj =  r * cos_a + midY;                  // y-location in source image
+            ri = -r * sin_a + midX;                  // x-location in source image
 
             ii_0=(long)floor(ri);
             ii_1=ii_0 + 1;
@@ -1055,6 +1085,7 @@ static int image_(Main_logPolarBilinear)(lua_State *L)
             }
         }
     }
+    THFree(radius);
     return 0;
 }
 
@@ -1171,17 +1202,21 @@ static int image_(Main_translate)(lua_State *L)
   if( Tdst->nDimension==3 && ( src_depth!=dst_depth) )
     luaL_error(L, "image.translate: src and dst depths do not match");
 
-  for(j = 0; j < src_height; j++) {
-    for(i = 0; i < src_width; i++) {
-      long ii=i+shiftx;
-      long jj=j+shifty;
-
-      // Check it's within destination bounds, else crop
-      if(ii<dst_width && jj<dst_height && ii>=0 && jj>=0) {
-        for(k=0;k<src_depth;k++) {
-          dst[ii*dst_stride2+jj*dst_stride1+k*dst_stride0] = src[i*src_stride2+j*src_stride1+k*src_stride0];
-        }
-      }
+  // source rows and columns that land inside the destination
+  long i0 = MAX(0, -shiftx), i1 = MIN(src_width, dst_width - shiftx);
+  long j0 = MAX(0, -shifty), j1 = MIN(src_height, dst_height - shifty);
+
+#pragma omp parallel for private(i, j) if((j1-j0)*(i1-i0)*src_depth > IMAGE_OMP_THRESHOLD)
+  for(k = 0; k < src_depth*(j1-j0); k++) {
+    long c = k / (j1-j0);
+    j = j0 + k % (j1-j0);
+    real *s = src + j*src_stride1 + c*src_stride0;
+    real *d = dst + (j+shifty)*dst_stride1 + c*dst_stride0;
+    if(src_stride2 == 1 && dst_stride2 == 1 && i1 > i0) {
+      memcpy(d + i0 + shiftx, s + i0, sizeof(real)*(i1-i0));
+    } else {
+      for(i = i0; i < i1; i++)
+        d[(i+shiftx)*dst_stride2] = s[i*src_stride2];
     }
   }
   return 0;
@@ -1200,6 +1235,22 @@ static int image_(Main_saturate)(lua_State *L) {
   return 1;
 }
 
+/* checks that src is a 3-channel image, and dst a dst_depth-channel image
+   (2D if a single channel) of the same size */
+static void image_(Main_color_validate)(lua_State *L, THTensor *src, THTensor *dst,
+                                        int dst_depth, const char *name)
+{
+  if (src->nDimension != 3 || src->size[0] < 3)
+    luaL_error(L, "image.%s: src must be a 3-channel image", name);
+  if (dst_depth == 1 && dst->nDimension != 2)
+    luaL_error(L, "image.%s: dst not 2D", name);
+  if (dst_depth == 3 && (dst->nDimension != 3 || dst->size[0] < 3))
+    luaL_error(L, "image.%s: dst must be a 3-channel image", name);
+  if (dst->size[dst->nDimension-2] != src->size[1] ||
+      dst->size[dst->nDimension-1] != src->size[2])
+    luaL_error(L, "image.%s: src and dst not of same height and width", name);
+}
+
 /*
  * Converts an RGB color value to HSL. Conversion formula
  * adapted from http://en.wikipedia.org/wiki/HSL_color_space.
@@ -1209,52 +1260,31 @@ static int image_(Main_saturate)(lua_State *L) {
 int image_(Main_rgb2hsl)(lua_State *L) {
   THTensor *rgb = luaT_checkudata(L, 1, torch_Tensor);
   THTensor *hsl = luaT_checkudata(L, 2, torch_Tensor);
-
-  int y,x;
-  temp_t r, g, b, h, s, l;
-  for (y=0; y<rgb->size[1]; y++) {
-    for (x=0; x<rgb->size[2]; x++) {
-      // get Rgb
-      r = THTensor_(get3d)(rgb, 0, y, x);
-      g = THTensor_(get3d)(rgb, 1, y, x);
-      b = THTensor_(get3d)(rgb, 2, y, x);
-#ifdef TH_REAL_IS_BYTE
-      r /= 255;
-      g /= 255;
-      b /= 255;
-#endif
-
-      temp_t mx = max(max(r, g), b);
-      temp_t mn = min(min(r, g), b);
-      if(mx == mn) {
-        h = 0; // achromatic
-        s = 0;
-        l = mx;
+  image_(Main_color_validate)(L, rgb, hsl, 3, "rgb2hsl");
+
+  IMAGE_COLOR_LOOP(rgb, hsl,
+    temp_t r = c0, g = c1, b = c2;
+    temp_t mx = max(max(r, g), b);
+    temp_t mn = min(min(r, g), b);
+    if(mx == mn) {
+      o0 = 0; // achromatic
+      o1 = 0;
+      o2 = mx;
+    } else {
+      temp_t d = mx - mn;
+      temp_t h;
+      if (mx == r) {
+        h = (g - b) / d + (g < b ? 6 : 0);
+      } else if (mx == g) {
+        h = (b - r) / d + 2;
       } else {
-        temp_t d = mx - mn;
-        if (mx == r) {
-          h = (g - b) / d + (g < b ? 6 : 0);
-        } else if (mx == g) {
-          h = (b - r) / d + 2;
-        } else {
-          h = (r - g) / d + 4;
-        }
-        h /= 6;
-        l = (mx + mn) / 2;
-        s = l > 0.5 ? d / (2 - mx - mn) : d / (mx + mn);
+        h = (r - g) / d + 4;
       }
-
-      // set hsl
-#ifdef TH_REAL_IS_BYTE
-      h *= 255;
-      s *= 255;
-      l *= 255;
-#endif
-      THTensor_(set3d)(hsl, 0, y, x, image_(FromIntermediate)(h));
-      THTensor_(set3d)(hsl, 1, y, x, image_(FromIntermediate)(s));
-      THTensor_(set3d)(hsl, 2, y, x, image_(FromIntermediate)(l));
+      o0 = h / 6;
+      o2 = (mx + mn) / 2;
+      o1 = o2 > 0.5 ? d / (2 - mx - mn) : d / (mx + mn);
     }
-  }
+  )
   return 0;
 }
 
@@ -1281,48 +1311,23 @@ static inline temp_t image_(hue2rgb)(temp_t p, temp_t q, temp_t t) {
 int image_(Main_hsl2rgb)(lua_State *L) {
   THTensor *hsl = luaT_checkudata(L, 1, torch_Tensor);
   THTensor *rgb = luaT_checkudata(L, 2, torch_Tensor);
-
-  int y,x;
-  temp_t r, g, b, h, s, l;
-  for (y=0; y<hsl->size[1]; y++) {
-    for (x=0; x<hsl->size[2]; x++) {
-      // get hsl
-      h = THTensor_(get3d)(hsl, 0, y, x);
-      s = THTensor_(get3d)(hsl, 1, y, x);
-      l = THTensor_(get3d)(hsl, 2, y, x);
-#ifdef TH_REAL_IS_BYTE
-      h /= 255;
-      s /= 255;
-      l /= 255;
-#endif
-
-      if(s == 0) {
-        // achromatic
-        r = l;
-        g = l;
-        b = l;
-      } else {
-        temp_t q = (l < 0.5) ? (l * (1 + s)) : (l + s - l * s);
-        temp_t p = 2 * l - q;
-        temp_t hr = h + 1./3;
-        temp_t hg = h;
-        temp_t hb = h - 1./3;
-        r = image_(hue2rgb)(p, q, hr);
-        g = image_(hue2rgb)(p, q, hg);
-        b = image_(hue2rgb)(p, q, hb);
-      }
-
-      // set rgb
-#ifdef TH_REAL_IS_BYTE
-      r *= 255;
-      g *= 255;
-      b *= 255;
-#endif
-      THTensor_(set3d)(rgb, 0, y, x, image_(FromIntermediate)(r));
-      THTensor_(set3d)(rgb, 1, y, x, image_(FromIntermediate)(g));
-      THTensor_(set3d)(rgb, 2, y, x, image_(FromIntermediate)(b));
+  image_(Main_color_validate)(L, hsl, rgb, 3, "hsl2rgb");
+
+  IMAGE_COLOR_LOOP(hsl, rgb,
+    temp_t h = c0, s = c1, l = c2;
+    if(s == 0) {
+      // achromatic
+      o0 = l;
+      o1 = l;
+      o2 = l;
+    } else {
+      temp_t q = (l < 0.5) ? (l * (1 + s)) : (l + s - l * s);
+      temp_t p = 2 * l - q;
+      o0 = image_(hue2rgb)(p, q, h + 1./3);
+      o1 = image_(hue2rgb)(p, q, h);
+      o2 = image_(hue2rgb)(p, q, h - 1./3);
     }
-  }
+  )
   return 0;
 }
 
@@ -1335,53 +1340,32 @@ int image_(Main_hsl2rgb)(lua_State *L) {
 int image_(Main_rgb2hsv)(lua_State *L) {
   THTensor *rgb = luaT_checkudata(L, 1, torch_Tensor);
   THTensor *hsv = luaT_checkudata(L, 2, torch_Tensor);
-
-  int y, x;
-  temp_t r, g, b, h, s, v;
-  for (y=0; y<rgb->size[1]; y++) {
-    for (x=0; x<rgb->size[2]; x++) {
-      // get Rgb
-      r = THTensor_(get3d)(rgb, 0, y, x);
-      g = THTensor_(get3d)(rgb, 1, y, x);
-      b = THTensor_(get3d)(rgb, 2, y, x);
-#ifdef TH_REAL_IS_BYTE
-      r /= 255;
-      g /= 255;
-      b /= 255;
-#endif
-
-      temp_t mx = max(max(r, g), b);
-      temp_t mn = min(min(r, g), b);
-      if(mx == mn) {
-        // achromatic
-        h = 0;
-        s = 0;
-        v = mx;
+  image_(Main_color_validate)(L, rgb, hsv, 3, "rgb2hsv");
+
+  IMAGE_COLOR_LOOP(rgb, hsv,
+    temp_t r = c0, g = c1, b = c2;
+    temp_t mx = max(max(r, g), b);
+    temp_t mn = min(min(r, g), b);
+    if(mx == mn) {
+      // achromatic
+      o0 = 0;
+      o1 = 0;
+      o2 = mx;
+    } else {
+      temp_t d = mx - mn;
+      temp_t h;
+      if (mx == r) {
+        h = (g - b) / d + (g < b ? 6 : 0);
+      } else if (mx == g) {
+        h = (b - r) / d + 2;
       } else {
-        temp_t d = mx - mn;
-        if (mx == r) {
-          h = (g - b) / d + (g < b ? 6 : 0);
-        } else if (mx == g) {
-          h = (b - r) / d + 2;
-        } else {
-          h = (r - g) / d + 4;
-        }
-        h /= 6;
-        s = d / mx;
-        v = mx;
+        h = (r - g) / d + 4;
       }
-
-      // set hsv
-#ifdef TH_REAL_IS_BYTE
-      h *= 255;
-      s *= 255;
-      v *= 255;
-#endif
-      THTensor_(set3d)(hsv, 0, y, x, image_(FromIntermediate)(h));
-      THTensor_(set3d)(hsv, 1, y, x, image_(FromIntermediate)(s));
-      THTensor_(set3d)(hsv, 2, y, x, image_(FromIntermediate)(v));
+      o0 = h / 6;
+      o1 = d / mx;
+      o2 = mx;
     }
-  }
+  )
   return 0;
 }
 
@@ -1394,68 +1378,54 @@ int image_(Main_rgb2hsv)(lua_State *L) {
 int image_(Main_hsv2rgb)(lua_State *L) {
   THTensor *hsv = luaT_checkudata(L, 1, torch_Tensor);
   THTensor *rgb = luaT_checkudata(L, 2, torch_Tensor);
-
-  int y, x;
-  temp_t r, g, b, h, s, v;
-  for (y=0; y<hsv->size[1]; y++) {
-    for (x=0; x<hsv->size[2]; x++) {
-      // get hsv
-      h = THTensor_(get3d)(hsv, 0, y, x);
-      s = THTensor_(get3d)(hsv, 1, y, x);
-      v = THTensor_(get3d)(hsv, 2, y, x);
-#ifdef TH_REAL_IS_BYTE
-      h /= 255;
-      s /= 255;
-      v /= 255;
-#endif
-
-      int i = floor(h*6.);
-      temp_t f = h*6-i;
-      temp_t p = v*(1-s);
-      temp_t q = v*(1-f*s);
-      temp_t t = v*(1-(1-f)*s);
-
-      switch (i % 6) {
-      case 0: r = v, g = t, b = p; break;
-      case 1: r = q, g = v, b = p; break;
-      case 2: r = p, g = v, b = t; break;
-      case 3: r = p, g = q, b = v; break;
-      case 4: r = t, g = p, b = v; break;
-      case 5: r = v, g = p, b = q; break;
-      default: r=0; g = 0, b = 0; break;
-      }
-
-      // set rgb
-#ifdef TH_REAL_IS_BYTE
-      r *= 255;
-      g *= 255;
-      b *= 255;
-#endif
-      THTensor_(set3d)(rgb, 0, y, x, image_(FromIntermediate)(r));
-      THTensor_(set3d)(rgb, 1, y, x, image_(FromIntermediate)(g));
-      THTensor_(set3d)(rgb, 2, y, x, image_(FromIntermediate)(b));
+  image_(Main_color_validate)(L, hsv, rgb, 3, "hsv2rgb");
+
+  IMAGE_COLOR_LOOP(hsv, rgb,
+    temp_t h = c0, s = c1, v = c2;
+    int i = floor(h*6.);
+    temp_t f = h*6-i;
+    temp_t p = v*(1-s);
+    temp_t q = v*(1-f*s);
+    temp_t t = v*(1-(1-f)*s);
+
+    switch (i % 6) {
+    case 0: o0 = v, o1 = t, o2 = p; break;
+    case 1: o0 = q, o1 = v, o2 = p; break;
+    case 2: o0 = p, o1 = v, o2 = t; break;
+    case 3: o0 = p, o1 = q, o2 = v; break;
+    case 4: o0 = t, o1 = p, o2 = v; break;
+    case 5: o0 = v, o1 = p, o2 = q; break;
+    default: o0 = 0; o1 = 0, o2 = 0; break;
     }
-  }
+  )
   return 0;
 }
 
 #ifndef TH_REAL_IS_BYTE
 /*
  * Convert an sRGB color channel to a linear sRGB color channel.
+ * Float values in [0, 1] are looked up.
  */
-static inline real image_(gamma_expand_sRGB)(real nonlinear)
+static inline temp_t image_(gamma_expand_sRGB)(temp_t nonlinear)
 {
-  return (nonlinear <= 0.04045) ? (nonlinear / 12.92)
-                                : (pow((nonlinear+0.055)/1.055, 2.4));
+#ifdef TH_REAL_IS_FLOAT
+  if (nonlinear >= 0 && nonlinear <= 1)
+    return image_srgb_lookup(image_srgb_expand_lut, nonlinear);
+#endif
+  return image_srgb_expand(nonlinear);
 }
 
 /*
  * Convert a linear sRGB color channel to a sRGB color channel.
+ * Float values in [0, 1] are looked up.
  */
-static inline real image_(gamma_compress_sRGB)(real linear)
+static inline temp_t image_(gamma_compress_sRGB)(temp_t linear)
 {
-  return (linear <= 0.0031308) ? (12.92 * linear)
-                               : (1.055 * pow(linear, 1.0/2.4) - 0.055);
+#ifdef TH_REAL_IS_FLOAT
+  if (linear >= 0 && linear <= 1)
+    return image_srgb_lookup(image_srgb_compress_lut, linear);
+#endif
+  return image_srgb_compress(linear);
 }
 
 /*
@@ -1467,46 +1437,33 @@ static inline real image_(gamma_compress_sRGB)(real linear)
 int image_(Main_rgb2lab)(lua_State *L) {
   THTensor *rgb = luaT_checkudata(L, 1, torch_Tensor);
   THTensor *lab = luaT_checkudata(L, 2, torch_Tensor);
+  image_(Main_color_validate)(L, rgb, lab, 3, "rgb2lab");
 
   // CIE Standard
-  double epsilon = 216.0/24389.0;
-  double k = 24389.0/27.0;
+  const temp_t epsilon = 216.0/24389.0;
+  const temp_t k = 24389.0/27.0;
   // D65 white point
-  double xn = 0.950456;
-  double zn = 1.088754;
-
-  int y,x;
-  real r,g,b,l,a,_b;
-  for (y=0; y<rgb->size[1]; y++) {
-    for (x=0; x<rgb->size[2]; x++) {
-      // get RGB
-      r = image_(gamma_expand_sRGB)(THTensor_(get3d)(rgb, 0, y, x));
-      g = image_(gamma_expand_sRGB)(THTensor_(get3d)(rgb, 1, y, x));
-      b = image_(gamma_expand_sRGB)(THTensor_(get3d)(rgb, 2, y, x));
-
-      // sRGB to XYZ
-      double X = 0.412453 * r + 0.357580 * g + 0.180423 * b;
-      double Y = 0.212671 * r + 0.715160 * g + 0.072169 * b;
-      double Z = 0.019334 * r + 0.119193 * g + 0.950227 * b;
-
-      // normalize for D65 white point
-      X /= xn;
-      Z /= zn;
-
-      // XYZ normalized to CIE Lab
-      double fx = X > epsilon ? pow(X, 1/3.0) : (k * X + 16)/116;
-      double fy = Y > epsilon ? pow(Y, 1/3.0) : (k * Y + 16)/116;
-      double fz = Z > epsilon ? pow(Z, 1/3.0) : (k * Z + 16)/116;
-      l = 116 * fy - 16;
-      a = 500 * (fx - fy);
-      _b = 200 * (fy - fz);
-
-      // set lab
-      THTensor_(set3d)(lab, 0, y, x, l);
-      THTensor_(set3d)(lab, 1, y, x, a);
-      THTensor_(set3d)(lab, 2, y, x, _b);
-    }
-  }
+  const temp_t xn = 0.950456;
+  const temp_t zn = 1.088754;
+
+  IMAGE_COLOR_LOOP(rgb, lab,
+    temp_t r = image_(gamma_expand_sRGB)(c0);
+    temp_t g = image_(gamma_expand_sRGB)(c1);
+    temp_t b = image_(gamma_expand_sRGB)(c2);
+
+    // sRGB to XYZ, normalized for D65 white point
+    temp_t X = (0.412453 * r + 0.357580 * g + 0.180423 * b) / xn;
+    temp_t Y = 0.212671 * r + 0.715160 * g + 0.072169 * b;
+    temp_t Z = (0.019334 * r + 0.119193 * g + 0.950227 * b) / zn;
+
+    // XYZ normalized to CIE Lab
+    temp_t fx = X > epsilon ? cbrt(X) : (k * X + 16)/116;
+    temp_t fy = Y > epsilon ? cbrt(Y) : (k * Y + 16)/116;
+    temp_t fz = Z > epsilon ? cbrt(Z) : (k * Z + 16)/116;
+    o0 = 116 * fy - 16;
+    o1 = 500 * (fx - fy);
+    o2 = 200 * (fy - fz);
+  )
   return 0;
 }
 
@@ -1518,50 +1475,38 @@ int image_(Main_rgb2lab)(lua_State *L) {
 int image_(Main_lab2rgb)(lua_State *L) {
   THTensor *lab = luaT_checkudata(L, 1, torch_Tensor);
   THTensor *rgb = luaT_checkudata(L, 2, torch_Tensor);
-
-  int y,x;
-  real r,g,b,l,a,_b;
+  image_(Main_color_validate)(L, lab, rgb, 3, "lab2rgb");
 
   // CIE Standard
-  double epsilon = 216.0/24389.0;
-  double k = 24389.0/27.0;
+  const temp_t epsilon = 216.0/24389.0;
+  const temp_t k = 24389.0/27.0;
   // D65 white point
-  double xn = 0.950456;
-  double zn = 1.088754;
-
-  for (y=0; y<lab->size[1]; y++) {
-    for (x=0; x<lab->size[2]; x++) {
-      // get lab
-      l = THTensor_(get3d)(lab, 0, y, x);
-      a = THTensor_(get3d)(lab, 1, y, x);
-      _b = THTensor_(get3d)(lab, 2, y, x);
-
-      // LAB to XYZ
-      double fy = (l + 16) / 116;
-      double fz = fy - _b / 200;
-      double fx = (a / 500) + fy;
-      double X = pow(fx, 3);
-      if (X <= epsilon)
-        X = (116 * fx - 16) / k;
-      double Y = l > (k * epsilon) ? pow((l + 16) / 116, 3) : l/k;
-      double Z = pow(fz, 3);
-      if (Z <= epsilon)
-        Z = (116 * fz - 16) / k;
-
-      X *= xn;
-      Z *= zn;
-
-      // XYZ to sRGB
-      r =  3.2404542 * X - 1.5371385 * Y - 0.4985314 * Z;
-      g = -0.9692660 * X + 1.8760108 * Y + 0.0415560 * Z;
-      b =  0.0556434 * X - 0.2040259 * Y + 1.0572252 * Z;
-
-      // set rgb
-      THTensor_(set3d)(rgb, 0, y, x, image_(gamma_compress_sRGB(r)));
-      THTensor_(set3d)(rgb, 1, y, x, image_(gamma_compress_sRGB(g)));
-      THTensor_(set3d)(rgb, 2, y, x, image_(gamma_compress_sRGB(b)));
-    }
-  }
+  const temp_t xn = 0.950456;
+  const temp_t zn = 1.088754;
+
+  IMAGE_COLOR_LOOP(lab, rgb,
+    temp_t l = c0, a = c1, _b = c2;
+
+    // LAB to XYZ
+    temp_t fy = (l + 16) / 116;
+    temp_t fz = fy - _b / 200;
+    temp_t fx = (a / 500) + fy;
+    temp_t X = fx * fx * fx;
+    if (X <= epsilon)
+      X = (116 * fx - 16) / k;
+    temp_t Y = l > (k * epsilon) ? fy * fy * fy : l/k;
+    temp_t Z = fz * fz * fz;
+    if (Z <= epsilon)
+      Z = (116 * fz - 16) / k;
+
+    X *= xn;
+    Z *= zn;
+
+    // XYZ to sRGB
+    o0 = image_(gamma_compress_sRGB)( 3.2404542 * X - 1.5371385 * Y - 0.4985314 * Z);
+    o1 = image_(gamma_compress_sRGB)(-0.9692660 * X + 1.8760108 * Y + 0.0415560 * Z);
+    o2 = image_(gamma_compress_sRGB)( 0.0556434 * X - 0.2040259 * Y + 1.0572252 * Z);
+  )
   return 0;
 }
 #else
@@ -1574,6 +1519,40 @@ int image_(Main_lab2rgb)(lua_State *L) {
 }
 #endif // TH_REAL_IS_BYTE
 
+/*
+ * Converts an RGB color value to YUV (BT.601). For byte images, U and V
+ * are centered on 128 and clamped to [0, 255].
+ */
+int image_(Main_rgb2yuv)(lua_State *L) {
+  THTensor *rgb = luaT_checkudata(L, 1, torch_Tensor);
+  THTensor *yuv = luaT_checkudata(L, 2, torch_Tensor);
+  image_(Main_color_validate)(L, rgb, yuv, 3, "rgb2yuv");
+
+  IMAGE_COLOR_LOOP(rgb, yuv,
+    o0 =  0.299   * c0 + 0.587   * c1 + 0.114   * c2;
+    o1 = -0.14713 * c0 - 0.28886 * c1 + 0.436   * c2 + IMAGE_CHROMA_OFFSET;
+    o2 =  0.615   * c0 - 0.51499 * c1 - 0.10001 * c2 + IMAGE_CHROMA_OFFSET;
+  )
+  return 0;
+}
+
+/*
+ * Converts a YUV color value to RGB (inverse of rgb2yuv).
+ */
+int image_(Main_yuv2rgb)(lua_State *L) {
+  THTensor *yuv = luaT_checkudata(L, 1, torch_Tensor);
+  THTensor *rgb = luaT_checkudata(L, 2, torch_Tensor);
+  image_(Main_color_validate)(L, yuv, rgb, 3, "yuv2rgb");
+
+  IMAGE_COLOR_LOOP(yuv, rgb,
+    temp_t u = c1 - IMAGE_CHROMA_OFFSET, v = c2 - IMAGE_CHROMA_OFFSET;
+    o0 = c0 + 1.13983 * v;
+    o1 = c0 - 0.39465 * u - 0.58060 * v;
+    o2 = c0 + 2.03211 * u;
+  )
+  return 0;
+}
+
 /* Vertically flip an image */
 int image_(Main_vflip)(lua_State *L) {
   THTensor *dst = luaT_checkudata(L, 1, torch_Tensor);
@@ -1780,6 +1759,171 @@ static inline void image_(Main_bicubicInterpolate)(
   }
 }
 
+/*
+ * Samples src (channels x height x width, strides is) at (ix, iy) for
+ * image.warp, and writes the channels of the destination pixel dst (channel
+ * stride os[0]).
+ */
+static inline void image_(Main_warpPixel)(
+  real *src_data, long *is, long *src_size, real *dst, long *os,
+  float ix, float iy, int mode, int clamp_mode, real pad_value)
+{
+  long channels = src_size[0];
+  long src_height = src_size[1];
+  long src_width = src_size[2];
+  long k, v, u, i, j;
+
+  // borders
+  int off_image = 0;
+  if (iy < 0 || iy > src_height - 1 ||
+      ix < 0 || ix > src_width - 1) {
+    off_image = 1;
+  }
+
+  if (off_image == 1 && clamp_mode == 1) {
+    // We're off the image and we're clamping the input image to 0
+    for (k=0; k<channels; k++) {
+      dst[ k*os[0] ] = pad_value;
+    }
+  } else {
+    ix = MAX(ix,0); ix = MIN(ix,src_width-1);
+    iy = MAX(iy,0); iy = MIN(iy,src_height-1);
+
+    // bilinear?
+    switch (mode) {
+    case 1:  // Bilinear interpolation
+      {
+        // 4 nearest neighbors (ix, iy >= 0: truncation is floor):
+        long ix_nw = (long)ix;
+        long iy_nw = (long)iy;
+        long ix_ne = ix_nw + 1;
+        long iy_ne = iy_nw;
+        long ix_sw = ix_nw;
+        long iy_sw = iy_nw + 1;
+        long ix_se = ix_nw + 1;
+        long iy_se = iy_nw + 1;
+
+        // get surfaces to each neighbor:
+        temp_t nw = (ix_se-ix)*(iy_se-iy);
+        temp_t ne = (ix-ix_sw)*(iy_sw-iy);
+        temp_t sw = (ix_ne-ix)*(iy-iy_ne);
+        temp_t se = (ix-ix_nw)*(iy-iy_nw);
+
+        // weighted sum of neighbors:
+        for (k=0; k<channels; k++) {
+          dst[ k*os[0] ] = image_(FromIntermediate)(
+              src_data[ k*is[0] +               iy_nw*is[1] +              ix_nw*is[2] ] * nw
+            + src_data[ k*is[0] +               iy_ne*is[1] + MIN(ix_ne,src_width-1)*is[2] ] * ne
+            + src_data[ k*is[0] + MIN(iy_sw,src_height-1)*is[1] +              ix_sw*is[2] ] * sw
+            + src_data[ k*is[0] + MIN(iy_se,src_height-1)*is[1] + MIN(ix_se,src_width-1)*is[2] ] * se);
+        }
+      }
+      break;
+    case 0:  // Simple (i.e., nearest neighbor)
+      {
+        // 1 nearest neighbor:
+        long ix_n = (long)(ix+0.5);
+        long iy_n = (long)(iy+0.5);
+
+        // weighted sum of neighbors:
+        for (k=0; k<channels; k++) {
+          dst[ k*os[0] ] = src_data[ k*is[0] + iy_n*is[1] + ix_n*is[2] ];
+        }
+      }
+      break;
+    case 2:  // Bicubic
+      {
+        // We only need to do bounds checking if ix or iy are near the edge
+        int edge = !(iy >= 1 && iy < src_height - 2 && ix >= 1 && ix < src_width - 2);
+
+        if (edge) {
+          image_(Main_bicubicInterpolate)(src_data, is, src_size, ix, iy, dst, os, pad_value, 1);
+        } else {
+          image_(Main_bicubicInterpolate)(src_data, is, src_size, ix, iy, dst, os, pad_value, 0);
+        }
+      }
+      break;
+    case 3:  // Lanczos
+      {
+        // Note: Lanczos can be made fast if the resampling period is
+        // constant... and therefore the Lu, Lv can be cached and reused.
+        // However, unfortunately warp makes no assumptions about resampling
+        // and so we need to perform the O(k^2) convolution on each pixel AND
+        // we have to re-calculate the kernel for every pixel.
+        // See wikipedia for more info.
+        // It is however an extremely good approximation to to full sinc
+        // interpolation (IIR) filter.
+        // Another note is that the version here has been optimized using
+        // pretty aggressive code flow and explicit inlining.  It might not
+        // be very readable (contact me, Jonathan Tompson, if it is not)
+
+        // Calculate fractional and integer components
+        long x_pix = floor(ix);
+        long y_pix = floor(iy);
+
+        // Precalculate the L(x) function evaluations in the u and v direction
+        #define rad (3)  // This is a tunable parameter: 2 to 3 is OK
+        float Lu[2 * rad];  // L(x) for u direction
+        float Lv[2 * rad];  // L(x) for v direction
+        for (u=x_pix-rad+1, i=0; u<=x_pix+rad; u++, i++) {
+          float du = ix - (float)u;  // Lanczos kernel x value
+          du = du < 0 ? -du : du;  // prefer not to used std absf
+          if (du < 0.000001f) {  // TODO: Is there a real eps standard?
+            Lu[i] = 1;
+          } else if (du > (float)rad) {
+            Lu[i] = 0;
+          } else {
+            Lu[i] = ((float)rad * sin((float)M_PI * du) *
+              sin((float)M_PI * du / (float)rad)) /
+              ((float)(M_PI * M_PI) * du * du);
+          }
+        }
+        for (v=y_pix-rad+1, i=0; v<=y_pix+rad; v++, i++) {
+          float dv = iy - (float)v;  // Lanczos kernel x value
+          dv = dv < 0 ? -dv : dv;  // prefer not to used std absf
+          if (dv < 0.000001f) {  // TODO: Is there a real eps standard?
+            Lv[i] = 1;
+          } else if (dv > (float)rad) {
+            Lv[i] = 0;
+          } else {
+            Lv[i] = ((float)rad * sin((float)M_PI * dv) *
+              sin((float)M_PI * dv / (float)rad)) /
+              ((float)(M_PI * M_PI) * dv * dv);
+          }
+        }
+        float sum_weights = 0;
+        for (u=0; u<2*rad; u++) {
+          for (v=0; v<2*rad; v++) {
+            sum_weights += (Lu[u] * Lv[v]);
+          }
+        }
+
+        for (k=0; k<channels; k++) {
+          temp_t result = 0;
+          for (u=x_pix-rad+1, i=0; u<=x_pix+rad; u++, i++) {
+            long curu = MAX(MIN((long)(src_width-1), u), 0);
+            for (v=y_pix-rad+1, j=0; v<=y_pix+rad; v++, j++) {
+              long curv = MAX(MIN((long)(src_height-1), v), 0);
+              temp_t Suv = src_data[k * is[0] + curv * is[1] + curu * is[2]];
+
+              temp_t weight = Lu[i] * Lv[j];
+              result += (Suv * weight);
+            }
+          }
+          // Normalize by the sum of the weights
+          result = result / (float)sum_weights;
+
+          // Again,  I assume that since the image is stored as reals we
+          // don't have to worry about clamping to min and max int (to
+          // prevent over or underflow)
+          dst[ k*os[0] ] = image_(FromIntermediate)(result);
+        }
+      }
+      break;
+    }  // end switch (mode)
+  }  // end else
+}
+
 /*
  * Warps an image, according to an (x,y) flow field. The flow
  * field is in the space of the destination image, each vector
@@ -1797,8 +1941,6 @@ int image_(Main_warp)(lua_State *L) {
   // dims
   int width = dst->size[2];
   int height = dst->size[1];
-  int src_width = src->size[2];
-  int src_height = src->size[1];
   int channels = dst->size[0];
   long *is = src->stride;
   long *os = dst->stride;
@@ -1810,8 +1952,8 @@ int image_(Main_warp)(lua_State *L) {
   real *flow_data = THTensor_(data)(flowfield);
 
   // resample
-  long k,x,y,v,u,i,j;
-#pragma omp parallel for private(k, x, y, v, u, i, j)
+  long x,y;
+#pragma omp parallel for private(x, y) if((long)height*width*channels*IMAGE_TRANSFORM_COST > IMAGE_OMP_THRESHOLD)
   for (y=0; y<height; y++) {
     for (x=0; x<width; x++) {
       // subpixel position:
@@ -1820,164 +1962,189 @@ int image_(Main_warp)(lua_State *L) {
       float iy = offset_mode*y + flow_y;
       float ix = offset_mode*x + flow_x;
 
-      // borders
-      int off_image = 0;
-      if (iy < 0 || iy > src_height - 1 ||
-          ix < 0 || ix > src_width - 1) {
-        off_image = 1;
+      image_(Main_warpPixel)(src_data, is, src->size, dst_data + y*os[1] + x*os[2], os,
+                             ix, iy, mode, clamp_mode, pad_value);
+    }
+  }
+
+  // done
+  return 0;
+}
+
+/*
+ * Applies affine transforms to an image (channels x height x width) or a
+ * batch of images (n x channels x height x width): destination pixel (x, y)
+ * of image i samples its source at
+ *   ix = coeffs[i][0]*x + coeffs[i][1]*y + coeffs[i][2]
+ *   iy = coeffs[i][3]*x + coeffs[i][4]*y + coeffs[i][5]
+ * with the modes, clamp modes and padding of image.warp. Rows run in
+ * parallel; see transform.c for the interior fast path.
+ */
+int image_(Main_affine)(lua_State *L) {
+  THTensor *dst = luaT_checkudata(L, 1, torch_Tensor);
+  THTensor *src = luaT_checkudata(L, 2, torch_Tensor);
+  THDoubleTensor *Tcoeffs = luaT_checkudata(L, 3, "torch.DoubleTensor");
+  int mode = lua_tointeger(L, 4);
+  int clamp_mode = lua_tointeger(L, 5);
+  real pad_value = (real)lua_tonumber(L, 6);
+  int batch = src->nDimension == 4;
+  long nimage = batch ? src->size[0] : 1;
+  long *is = src->stride + batch;
+  long *os = dst->stride + batch;
+  long *src_size = src->size + batch;
+  long src_stride_n = batch ? src->stride[0] : 0;
+  long dst_stride_n = batch ? dst->stride[0] : 0;
+  long channels, height, width;
+  long src_height, src_width;
+  double xmin, xmax, ymin, ymax;
+  const double *coeffs;
+  real *src_data, *dst_data;
+
+  luaL_argcheck(L, src->nDimension == 3 || src->nDimension == 4, 2, "src not 3 or 4 dimensional");
+  luaL_argcheck(L, dst->nDimension == src->nDimension, 1, "src and dst not of same dimension");
+  luaL_argcheck(L, !batch || dst->size[0] == nimage, 1, "src and dst batch sizes do not match");
+  luaL_argcheck(L, dst->size[batch] == src->size[batch], 1, "src and dst depths do not match");
+  luaL_argcheck(L, Tcoeffs->nDimension == 2 && Tcoeffs->size[0] == nimage && Tcoeffs->size[1] == 6,
+                3, "expected one row of 6 coefficients per image");
+  luaL_argcheck(L, mode >= 0 && mode <= 3, 4, "unknown mode");
+
+  channels = src_size[0];
+  src_height = src_size[1];
+  src_width = src_size[2];
+  height = dst->size[batch+1];
+  width = dst->size[batch+2];
+  src_data = THTensor_(data)(src);
+  dst_data = THTensor_(data)(dst);
+  Tcoeffs = THDoubleTensor_newContiguous(Tcoeffs);
+  coeffs = THDoubleTensor_data(Tcoeffs);
+
+  /* source area that every neighbour of a sample stays inside */
+  switch (mode) {
+  case 0:
+  case 1:
+    xmin = 0; xmax = src_width - 1;
+    ymin = 0; ymax = src_height - 1;
+    break;
+  case 2:
+    xmin = 1; xmax = src_width - 2;
+    ymin = 1; ymax = src_height - 2;
+    break;
+  default:
+    /* lanczos: generic path only */
+    xmin = 1; xmax = 0;
+    ymin = 1; ymax = 0;
+    break;
+  }
+
+#pragma omp parallel if(nimage*height*width*channels*IMAGE_TRANSFORM_COST > IMAGE_OMP_THRESHOLD)
+  {
+    long *fx = THAlloc(sizeof(long) * 3 * width);
+    long *fy = fx + width;
+    long *ofs = fy + width;
+    temp_t *w = mode == 2 ? THAlloc(sizeof(temp_t) * 8 * width) : NULL;
+    long r;
+#pragma omp for
+    for (r = 0; r < nimage*height; r++) {
+      long n = r / height, y = r % height;
+      const double *c = coeffs + 6*n;
+      real *s = src_data + n*src_stride_n;
+      real *d = dst_data + n*dst_stride_n + y*os[1];
+      long first, last, x, k;
+
+      image_affine_span(c[1]*y + c[2], c[4]*y + c[5], c[0], c[3], width,
+                        xmin, xmax, ymin, ymax, fx, fy, &first, &last);
+
+      /* pixels near or off the borders: skips the run [first, last) */
+      for (x = 0; x < width; x++) {
+        if (x == first && first < last)
+          x = last;
+        if (x < width)
+          image_(Main_warpPixel)(s, is, src_size, d + x*os[2], os,
+                                 (float)(c[0]*x + c[1]*y + c[2]),
+                                 (float)(c[3]*x + c[4]*y + c[5]),
+                                 mode, clamp_mode, pad_value);
       }
 
-      if (off_image == 1 && clamp_mode == 1) {
-        // We're off the image and we're clamping the input image to 0
-        for (k=0; k<channels; k++) {
-          dst_data[ k*os[0] + y*os[1] + x*os[2] ] = pad_value;
+      switch (mode) {
+      case 0:  // Simple: the nearest neighbour
+        /* rounded from the single precision coordinates, as image.warp
+           (the fixed point ones may fall on the other side of a .5 tie) */
+        for (x = first; x < last; x++) {
+          float ix = (float)(c[0]*x + c[1]*y + c[2]);
+          float iy = (float)(c[3]*x + c[4]*y + c[5]);
+          ofs[x] = (long)(iy+0.5) * is[1] + (long)(ix+0.5) * is[2];
         }
-      } else {
-        ix = MAX(ix,0); ix = MIN(ix,src_width-1);
-        iy = MAX(iy,0); iy = MIN(iy,src_height-1);
-
-        // bilinear?
-        switch (mode) {
-        case 1:  // Bilinear interpolation
-          {
-            // 4 nearest neighbors:
-            long ix_nw = floor(ix);
-            long iy_nw = floor(iy);
-            long ix_ne = ix_nw + 1;
-            long iy_ne = iy_nw;
-            long ix_sw = ix_nw;
-            long iy_sw = iy_nw + 1;
-            long ix_se = ix_nw + 1;
-            long iy_se = iy_nw + 1;
-
-            // get surfaces to each neighbor:
-            temp_t nw = (ix_se-ix)*(iy_se-iy);
-            temp_t ne = (ix-ix_sw)*(iy_sw-iy);
-            temp_t sw = (ix_ne-ix)*(iy-iy_ne);
-            temp_t se = (ix-ix_nw)*(iy-iy_nw);
-
-            // weighted sum of neighbors:
-            for (k=0; k<channels; k++) {
-              dst_data[ k*os[0] + y*os[1] + x*os[2] ] = image_(FromIntermediate)(
-                  src_data[ k*is[0] +               iy_nw*is[1] +              ix_nw*is[2] ] * nw
-                + src_data[ k*is[0] +               iy_ne*is[1] + MIN(ix_ne,src_width-1)*is[2] ] * ne
-                + src_data[ k*is[0] + MIN(iy_sw,src_height-1)*is[1] +              ix_sw*is[2] ] * sw
-                + src_data[ k*is[0] + MIN(iy_se,src_height-1)*is[1] + MIN(ix_se,src_width-1)*is[2] ] * se);
-            }
-          }
-          break;
-        case 0:  // Simple (i.e., nearest neighbor)
-          {
-            // 1 nearest neighbor:
-            long ix_n = floor(ix+0.5);
-            long iy_n = floor(iy+0.5);
-
-            // weighted sum of neighbors:
-            for (k=0; k<channels; k++) {
-              dst_data[ k*os[0] + y*os[1] + x*os[2] ] = src_data[ k*is[0] + iy_n*is[1] + ix_n*is[2] ];
-            }
+        for (k = 0; k < channels; k++) {
+          const real *sk = s + k*is[0];
+          real *dk = d + k*os[0];
+          for (x = first; x < last; x++)
+            dk[x*os[2]] = sk[ofs[x]];
+        }
+        break;
+      case 1:  // Bilinear: the 4 neighbours from the top-left one
+        for (x = first; x < last; x++)
+          ofs[x] = (fy[x] >> IMAGE_FIX_BITS) * is[1] + (fx[x] >> IMAGE_FIX_BITS) * is[2];
+        for (k = 0; k < channels; k++) {
+          const real *sk = s + k*is[0];
+          real *dk = d + k*os[0];
+          for (x = first; x < last; x++) {
+            const real *p = sk + ofs[x];
+#ifdef TH_REAL_IS_BYTE
+            int wx = (fx[x] & IMAGE_FIX_MASK) >> (IMAGE_FIX_BITS - IMAGE_WEIGHT_BITS);
+            int wy = (fy[x] & IMAGE_FIX_MASK) >> (IMAGE_FIX_BITS - IMAGE_WEIGHT_BITS);
+            int top = p[0] * IMAGE_WEIGHT_ONE + (p[is[2]] - p[0]) * wx;
+            int bottom = p[is[1]] * IMAGE_WEIGHT_ONE + (p[is[1] + is[2]] - p[is[1]]) * wx;
+            dk[x*os[2]] = (real)((top * IMAGE_WEIGHT_ONE + (bottom - top) * wy
+                                  + (1 << (2*IMAGE_WEIGHT_BITS - 1))) >> (2*IMAGE_WEIGHT_BITS));
+#else
+            temp_t wx = (fx[x] & IMAGE_FIX_MASK) * (temp_t)(1.0 / IMAGE_FIX_ONE);
+            temp_t wy = (fy[x] & IMAGE_FIX_MASK) * (temp_t)(1.0 / IMAGE_FIX_ONE);
+            temp_t top = p[0] + wx * (p[is[2]] - p[0]);
+            temp_t bottom = p[is[1]] + wx * (p[is[1] + is[2]] - p[is[1]]);
+            dk[x*os[2]] = image_(FromIntermediate)(top + wy * (bottom - top));
+#endif
           }
-          break;
-        case 2:  // Bicubic
-          {
-            // We only need to do bounds checking if ix or iy are near the edge
-            int edge = !(iy >= 1 && iy < src_height - 2 && ix >= 1 && ix < src_width - 2);
-
-            real* dst = dst_data + y*os[1] + x*os[2];
-            if (edge) {
-              image_(Main_bicubicInterpolate)(src_data, is, src->size, ix, iy, dst, os, pad_value, 1);
-            } else {
-              image_(Main_bicubicInterpolate)(src_data, is, src->size, ix, iy, dst, os, pad_value, 0);
-            }
+        }
+        break;
+      case 2:  // Bicubic: the 4x4 neighbours, with separable weights
+        for (x = first; x < last; x++) {
+          double wx[4], wy[4];
+          int t;
+          ofs[x] = ((fy[x] >> IMAGE_FIX_BITS) - 1) * is[1] + ((fx[x] >> IMAGE_FIX_BITS) - 1) * is[2];
+          image_cubic_weights((fx[x] & IMAGE_FIX_MASK) * (1.0 / IMAGE_FIX_ONE), wx);
+          image_cubic_weights((fy[x] & IMAGE_FIX_MASK) * (1.0 / IMAGE_FIX_ONE), wy);
+          for (t = 0; t < 4; t++) {
+            w[8*x + t] = wx[t];
+            w[8*x + 4 + t] = wy[t];
           }
-          break;
-        case 3:  // Lanczos
-          {
-            // Note: Lanczos can be made fast if the resampling period is
-            // constant... and therefore the Lu, Lv can be cached and reused.
-            // However, unfortunately warp makes no assumptions about resampling
-            // and so we need to perform the O(k^2) convolution on each pixel AND
-            // we have to re-calculate the kernel for every pixel.
-            // See wikipedia for more info.
-            // It is however an extremely good approximation to to full sinc
-            // interpolation (IIR) filter.
-            // Another note is that the version here has been optimized using
-            // pretty aggressive code flow and explicit inlining.  It might not
-            // be very readable (contact me, Jonathan Tompson, if it is not)
-
-            // Calculate fractional and integer components
-            long x_pix = floor(ix);
-            long y_pix = floor(iy);
-
-            // Precalculate the L(x) function evaluations in the u and v direction
-            #define rad (3)  // This is a tunable parameter: 2 to 3 is OK
-            float Lu[2 * rad];  // L(x) for u direction
-            float Lv[2 * rad];  // L(x) for v direction
-            for (u=x_pix-rad+1, i=0; u<=x_pix+rad; u++, i++) {
-              float du = ix - (float)u;  // Lanczos kernel x value
-              du = du < 0 ? -du : du;  // prefer not to used std absf
-              if (du < 0.000001f) {  // TODO: Is there a real eps standard?
-                Lu[i] = 1;
-              } else if (du > (float)rad) {
-                Lu[i] = 0;
-              } else {
-                Lu[i] = ((float)rad * sin((float)M_PI * du) *
-                  sin((float)M_PI * du / (float)rad)) /
-                  ((float)(M_PI * M_PI) * du * du);
-              }
-            }
-            for (v=y_pix-rad+1, i=0; v<=y_pix+rad; v++, i++) {
-              float dv = iy - (float)v;  // Lanczos kernel x value
-              dv = dv < 0 ? -dv : dv;  // prefer not to used std absf
-              if (dv < 0.000001f) {  // TODO: Is there a real eps standard?
-                Lv[i] = 1;
-              } else if (dv > (float)rad) {
-                Lv[i] = 0;
-              } else {
-                Lv[i] = ((float)rad * sin((float)M_PI * dv) *
-                  sin((float)M_PI * dv / (float)rad)) /
-                  ((float)(M_PI * M_PI) * dv * dv);
-              }
-            }
-            float sum_weights = 0;
-            for (u=0; u<2*rad; u++) {
-              for (v=0; v<2*rad; v++) {
-                sum_weights += (Lu[u] * Lv[v]);
-              }
-            }
-
-            for (k=0; k<channels; k++) {
-              temp_t result = 0;
-              for (u=x_pix-rad+1, i=0; u<=x_pix+rad; u++, i++) {
-                long curu = MAX(MIN((long)(src_width-1), u), 0);
-                for (v=y_pix-rad+1, j=0; v<=y_pix+rad; v++, j++) {
-                  long curv = MAX(MIN((long)(src_height-1), v), 0);
-                  temp_t Suv = src_data[k * is[0] + curv * is[1] + curu * is[2]];
-
-                  temp_t weight = Lu[i] * Lv[j];
-                  result += (Suv * weight);
-                }
-              }
-              // Normalize by the sum of the weights
-              result = result / (float)sum_weights;
-
-              // Again,  I assume that since the image is stored as reals we
-              // don't have to worry about clamping to min and max int (to
-              // prevent over or underflow)
-              dst_data[ k*os[0] + y*os[1] + x*os[2] ] = image_(FromIntermediate)(result);
+        }
+        for (k = 0; k < channels; k++) {
+          const real *sk = s + k*is[0];
+          real *dk = d + k*os[0];
+          for (x = first; x < last; x++) {
+            const real *p = sk + ofs[x];
+            const temp_t *wx = w + 8*x, *wy = wx + 4;
+            temp_t v = 0;
+            int i;
+            for (i = 0; i < 4; i++) {
+              const real *pi = p + i*is[1];
+              v += wy[i] * (wx[0] * pi[0] + wx[1] * pi[is[2]] +
+                            wx[2] * pi[2*is[2]] + wx[3] * pi[3*is[2]]);
             }
+            dk[x*os[2]] = image_(FromIntermediate)(v);
           }
-          break;
-        }  // end switch (mode)
-      }  // end else
+        }
+        break;
+      }
     }
+    THFree(fx);
+    THFree(w);
   }
 
-  // done
+  THDoubleTensor_free(Tcoeffs);
   return 0;
 }
 
-
 int image_(Main_gaussian)(lua_State *L) {
   THTensor *dst = luaT_checkudata(L, 1, torch_Tensor);
   long width = dst->size[1];
@@ -1999,17 +2166,29 @@ int image_(Main_gaussian)(lua_State *L) {
   temp_t over_sigmau = 1.0 / (sigma_u * width);
   temp_t over_sigmav = 1.0 / (sigma_v * height);
 
+  // The kernel is the product of a horizontal and a vertical gaussian: only
+  // width + height exponentials, and the kernel is exactly separable (see
+  // image.convolve)
+  temp_t *gu = THAlloc(sizeof(temp_t) * (width + height));
+  temp_t *gv = gu + width;
+
   long v, u;
   temp_t du, dv;
-#pragma omp parallel for private(v, u, du, dv)
+  for (u = 0; u < width; u++) {
+    du = (u + 1 - mean_u) * over_sigmau;
+    gu[u] = exp(-0.5 * du*du);
+  }
+  for (v = 0; v < height; v++) {
+    dv = (v + 1 - mean_v) * over_sigmav;
+    gv[v] = amplitude * exp(-0.5 * dv*dv);
+  }
+#pragma omp parallel for private(v, u)
   for (v = 0; v < height; v++) {
     for (u = 0; u < width; u++) {
-      du = (u + 1 - mean_u) * over_sigmau;
-      dv = (v + 1 - mean_v) * over_sigmav;
-      temp_t value = amplitude * exp(-0.5 * (du*du + dv*dv));
-      dst_data[ v*os[0] + u*os[1] ] = image_(FromIntermediate)(value);
+      dst_data[ v*os[0] + u*os[1] ] = image_(FromIntermediate)(gv[v] * gu[u]);
     }
   }
+  THFree(gu);
 
   if (normalize) {
     temp_t sum = 0;
@@ -2030,6 +2209,370 @@ int image_(Main_gaussian)(lua_State *L) {
   return 0;
 }
 
+/* relative error up to which a kernel is taken as separable */
+#undef IMAGE_SEPARABLE_EPS
+#ifdef TH_REAL_IS_FLOAT
+#define IMAGE_SEPARABLE_EPS 1e-6
+#else
+#define IMAGE_SEPARABLE_EPS 1e-12
+#endif
+
+/*
+ * Rank-1 factorization of a 2D kernel: fills kv and kh (DoubleTensors) with
+ * kernel = kv kh^T, up to rounding, and returns true; returns false if the
+ * kernel is not separable.
+ */
+int image_(Main_separate)(lua_State *L) {
+  THTensor *kernel = luaT_checkudata(L, 1, torch_Tensor);
+  THDoubleTensor *Tkv = luaT_checkudata(L, 2, "torch.DoubleTensor");
+  THDoubleTensor *Tkh = luaT_checkudata(L, 3, "torch.DoubleTensor");
+  real *k = THTensor_(data)(kernel);
+  long *ks = kernel->stride;
+  long height, width, i, j, p = 0, q = 0;
+  double pivot = 0, tolerance, *kv, *kh;
+
+  luaL_argcheck(L, kernel->nDimension == 2, 1, "kernel not 2 dimensional");
+  height = kernel->size[0];
+  width = kernel->size[1];
+  THDoubleTensor_resize1d(Tkv, height);
+  THDoubleTensor_resize1d(Tkh, width);
+  luaL_argcheck(L, THDoubleTensor_isContiguous(Tkv), 2, "contiguous tensor expected");
+  luaL_argcheck(L, THDoubleTensor_isContiguous(Tkh), 3, "contiguous tensor expected");
+  kv = THDoubleTensor_data(Tkv);
+  kh = THDoubleTensor_data(Tkh);
+
+  /* largest coefficient: its row and column give the factors */
+  for (i = 0; i < height; i++) {
+    for (j = 0; j < width; j++) {
+      double a = fabs((double)k[i*ks[0] + j*ks[1]]);
+      if (a > pivot) {
+        pivot = a;
+        p = i;
+        q = j;
+      }
+    }
+  }
+  if (pivot == 0) {
+    lua_pushboolean(L, 0);
+    return 1;
+  }
+  for (i = 0; i < height; i++)
+    kv[i] = k[i*ks[0] + q*ks[1]];
+  for (j = 0; j < width; j++)
+    kh[j] = k[p*ks[0] + j*ks[1]] / kv[p];
+
+  tolerance = IMAGE_SEPARABLE_EPS * pivot;
+  for (i = 0; i < height; i++) {
+    for (j = 0; j < width; j++) {
+      if (fabs(kv[i]*kh[j] - k[i*ks[0] + j*ks[1]]) > tolerance) {
+        lua_pushboolean(L, 0);
+        return 1;
+      }
+    }
+  }
+  lua_pushboolean(L, 1);
+  return 1;
+}
+
+/*
+ * Convolution of src (2D, or 3D: plane by plane) by the separable kernel
+ * kv kh^T (DoubleTensors): dst is the window of the full convolution
+ * starting at row oy, column ox.
+ */
+int image_(Main_separable)(lua_State *L) {
+  THTensor *dst = luaT_checkudata(L, 1, torch_Tensor);
+  THTensor *src = luaT_checkudata(L, 2, torch_Tensor);
+  THDoubleTensor *Tkv = luaT_checkudata(L, 3, "torch.DoubleTensor");
+  THDoubleTensor *Tkh = luaT_checkudata(L, 4, "torch.DoubleTensor");
+  long oy = luaL_checklong(L, 5);
+  long ox = luaL_checklong(L, 6);
+  int planar = src->nDimension == 3;
+  long nplane, height, width, dst_height, dst_width, kvn, khn, r0, r1, i;
+  long *is = src->stride + planar;
+  long *os = dst->stride + planar;
+  long src_stride_p = planar ? src->stride[0] : 0;
+  long dst_stride_p = planar ? dst->stride[0] : 0;
+  real *src_data, *dst_data;
+  temp_t *kv, *kh, *buffer;
+
+  luaL_argcheck(L, src->nDimension == 2 || src->nDimension == 3, 2, "src not 2 or 3 dimensional");
+  luaL_argcheck(L, dst->nDimension == src->nDimension, 1, "src and dst not of same dimension");
+  luaL_argcheck(L, !planar || dst->size[0] == src->size[0], 1, "src and dst depths do not match");
+  luaL_argcheck(L, Tkv->nDimension == 1, 3, "kernel not 1 dimensional");
+  luaL_argcheck(L, Tkh->nDimension == 1, 4, "kernel not 1 dimensional");
+
+  nplane = planar ? src->size[0] : 1;
+  height = src->size[planar];
+  width = src->size[planar+1];
+  dst_height = dst->size[planar];
+  dst_width = dst->size[planar+1];
+  kvn = Tkv->size[0];
+  khn = Tkh->size[0];
+  src_data = THTensor_(data)(src);
+  dst_data = THTensor_(data)(dst);
+
+  /* flipped kernels: the passes are correlations */
+  kv = THAlloc(sizeof(temp_t) * (kvn + khn));
+  kh = kv + kvn;
+  for (i = 0; i < kvn; i++)
+    kv[i] = THDoubleTensor_get1d(Tkv, kvn - 1 - i);
+  for (i = 0; i < khn; i++)
+    kh[i] = THDoubleTensor_get1d(Tkh, khn - 1 - i);
+
+  /* source rows [r0, r1) reach the output window */
+  r0 = MAX(oy - kvn + 1, 0);
+  r1 = MIN(oy + dst_height, height);
+  buffer = THAlloc(sizeof(temp_t) * MAX(r1 - r0, 1) * dst_width);
+
+#pragma omp parallel if(nplane*(height*khn + dst_height*kvn)*dst_width > IMAGE_OMP_THRESHOLD)
+  {
+    long line_width = dst_width + khn - 1;
+    temp_t *line = THAlloc(sizeof(temp_t) * (line_width + dst_width));
+    temp_t *acc = line + line_width;
+    long p, y;
+    for (p = 0; p < nplane; p++) {
+      real *s = src_data + p*src_stride_p;
+      real *d = dst_data + p*dst_stride_p;
+
+      /* rows, filtered by kh: line[x] is the source pixel (y, ox - khn + 1 + x) */
+#pragma omp for
+      for (y = r0; y < r1; y++) {
+        const real *sr = s + y*is[0];
+        temp_t *t = buffer + (y - r0)*dst_width;
+        long x, j;
+        for (x = 0; x < line_width; x++) {
+          long sx = ox - khn + 1 + x;
+          line[x] = sx >= 0 && sx < width ? sr[sx*is[1]] : 0;
+        }
+        for (x = 0; x < dst_width; x++)
+          t[x] = 0;
+        for (j = 0; j < khn; j++) {
+          const temp_t w = kh[j];
+          const temp_t *l = line + j;
+          for (x = 0; x < dst_width; x++)
+            t[x] += w * l[x];
+        }
+      }
+
+      /* columns: weighted sums of whole filtered rows */
+#pragma omp for
+      for (y = 0; y < dst_height; y++) {
+        real *dr = d + y*os[0];
+        long x, j;
+        for (x = 0; x < dst_width; x++)
+          acc[x] = 0;
+        for (j = 0; j < kvn; j++) {
+          long r = oy + y - kvn + 1 + j;
+          const temp_t w = kv[j];
+          const temp_t *t;
+          if (r < r0 || r >= r1)
+            continue;
+          t = buffer + (r - r0)*dst_width;
+          for (x = 0; x < dst_width; x++)
+            acc[x] += w * t[x];
+        }
+        for (x = 0; x < dst_width; x++)
+          dr[x*os[1]] = image_(FromIntermediate)(acc[x]);
+      }
+    }
+    THFree(line);
+  }
+
+  THFree(buffer);
+  THFree(kv);
+  return 0;
+}
+
+/*
+ * Box filter: each pixel of dst is the mean of the box_height x box_width
+ * window of src around it (as image.convolve(src, k, 'same') with a
+ * constant kernel k), computed with running sums: the cost per pixel does
+ * not depend on the window size.
+ */
+int image_(Main_boxFilter)(lua_State *L) {
+  THTensor *dst = luaT_checkudata(L, 1, torch_Tensor);
+  THTensor *src = luaT_checkudata(L, 2, torch_Tensor);
+  long box_height = luaL_checklong(L, 3);
+  long box_width = luaL_checklong(L, 4);
+  int planar = src->nDimension == 3;
+  long nplane, height, width, nchunk, ay, ax;
+  long *is = src->stride + planar;
+  long *os = dst->stride + planar;
+  long src_stride_p = planar ? src->stride[0] : 0;
+  long dst_stride_p = planar ? dst->stride[0] : 0;
+  real *src_data, *dst_data;
+  accreal *buffer;
+  temp_t scale;
+
+  luaL_argcheck(L, src->nDimension == 2 || src->nDimension == 3, 2, "src not 2 or 3 dimensional");
+  luaL_argcheck(L, THTensor_(isSameSizeAs)(src, dst), 1, "src and dst sizes do not match");
+  luaL_argcheck(L, box_height > 0, 3, "window height should be positive");
+  luaL_argcheck(L, box_width > 0, 4, "window width should be positive");
+
+  nplane = planar ? src->size[0] : 1;
+  height = src->size[planar];
+  width = src->size[planar+1];
+  src_data = THTensor_(data)(src);
+  dst_data = THTensor_(data)(dst);
+  nchunk = (width + IMAGE_FILTER_CHUNK - 1) / IMAGE_FILTER_CHUNK;
+  scale = (temp_t)1 / (box_height * box_width);
+  /* the window of pixel x is [x - ax, x - ax + box_width) */
+  ay = box_height / 2;
+  ax = box_width / 2;
+  buffer = THAlloc(sizeof(accreal) * height * width);
+
+#pragma omp parallel if(nplane*height*width*4 > IMAGE_OMP_THRESHOLD)
+  {
+    accreal *acc = THAlloc(sizeof(accreal) * IMAGE_FILTER_CHUNK);
+    long p, y, c;
+    for (p = 0; p < nplane; p++) {
+      real *s = src_data + p*src_stride_p;
+      real *d = dst_data + p*dst_stride_p;
+
+      /* row sums */
+#pragma omp for
+      for (y = 0; y < height; y++) {
+        const real *sr = s + y*is[0];
+        accreal *t = buffer + y*width;
+        accreal sum = 0;
+        long x;
+        for (x = MAX(-ax, 0); x < MIN(box_width - ax - 1, width); x++)
+          sum += sr[x*is[1]];
+        for (x = 0; x < width; x++) {
+          long in = x - ax + box_width - 1, out = x - ax;
+          if (in >= 0 && in < width)
+            sum += sr[in*is[1]];
+          t[x] = sum;
+          if (out >= 0)
+            sum -= sr[out*is[1]];
+        }
+      }
+
+      /* column sums, on chunks of whole rows */
+#pragma omp for
+      for (c = 0; c < nchunk; c++) {
+        long c0 = c*IMAGE_FILTER_CHUNK;
+        long n = MIN(IMAGE_FILTER_CHUNK, width - c0);
+        real *dc = d + c0*os[1];
+        long r, x;
+        for (x = 0; x < n; x++)
+          acc[x] = 0;
+        for (r = MAX(-ay, 0); r < MIN(box_height - ay - 1, height); r++) {
+          const accreal *t = buffer + r*width + c0;
+          for (x = 0; x < n; x++)
+            acc[x] += t[x];
+        }
+        for (y = 0; y < height; y++) {
+          long in = y - ay + box_height - 1, out = y - ay;
+          if (in >= 0 && in < height) {
+            const accreal *t = buffer + in*width + c0;
+            for (x = 0; x < n; x++)
+              acc[x] += t[x];
+          }
+          for (x = 0; x < n; x++)
+            dc[y*os[0] + x*os[1]] = image_(FromIntermediate)(acc[x] * scale);
+          if (out >= 0) {
+            const accreal *t = buffer + out*width + c0;
+            for (x = 0; x < n; x++)
+              acc[x] -= t[x];
+          }
+        }
+      }
+    }
+    THFree(acc);
+  }
+
+  THFree(buffer);
+  return 0;
+}
+
+/*
+ * Gaussian blur of standard deviation sigma (in pixels) with the recursive
+ * filter of filter.c, whose cost does not depend on sigma. Pixels outside
+ * the image are zeros.
+ */
+int image_(Main_gaussianIIR)(lua_State *L) {
+  THTensor *dst = luaT_checkudata(L, 1, torch_Tensor);
+  THTensor *src = luaT_checkudata(L, 2, torch_Tensor);
+  double sigma = luaL_checknumber(L, 3);
+  int planar = src->nDimension == 3;
+  long nplane, height, width, nchunk, margin, rows;
+  long *is = src->stride + planar;
+  long *os = dst->stride + planar;
+  long src_stride_p = planar ? src->stride[0] : 0;
+  long dst_stride_p = planar ? dst->stride[0] : 0;
+  real *src_data, *dst_data;
+  double c[4], *buffer, *data;
+
+  luaL_argcheck(L, src->nDimension == 2 || src->nDimension == 3, 2, "src not 2 or 3 dimensional");
+  luaL_argcheck(L, THTensor_(isSameSizeAs)(src, dst), 1, "src and dst sizes do not match");
+  luaL_argcheck(L, sigma >= 0.5, 3, "sigma should be at least 0.5");
+
+  nplane = planar ? src->size[0] : 1;
+  height = src->size[planar];
+  width = src->size[planar+1];
+  src_data = THTensor_(data)(src);
+  dst_data = THTensor_(data)(dst);
+  nchunk = (width + IMAGE_FILTER_CHUNK - 1) / IMAGE_FILTER_CHUNK;
+  image_iir_coefficients(sigma, c);
+  margin = image_iir_margin(sigma);
+
+  /* rows of the planes, followed by margin zero rows, between 3 zero rows */
+  rows = height + margin;
+  buffer = THAlloc(sizeof(double) * (rows + 6) * width);
+  data = buffer + 3*width;
+  memset(buffer, 0, sizeof(double) * 3 * width);
+  memset(data + rows*width, 0, sizeof(double) * 3 * width);
+
+#pragma omp parallel if(nplane*height*width*IMAGE_TRANSFORM_COST > IMAGE_OMP_THRESHOLD)
+  {
+    long line_width = width + margin;
+    double *padded = THAlloc(sizeof(double) * (line_width + 6));
+    double *line = padded + 3;
+    long p, y, x;
+    for (x = 0; x < 3; x++) {
+      line[x - 3] = 0;
+      line[line_width + x] = 0;
+    }
+    for (p = 0; p < nplane; p++) {
+      real *s = src_data + p*src_stride_p;
+      real *d = dst_data + p*dst_stride_p;
+
+#pragma omp for
+      for (y = 0; y < rows; y++) {
+        double *r = data + y*width;
+        if (y >= height) {
+          for (x = 0; x < width; x++)
+            r[x] = 0;
+          continue;
+        }
+        for (x = 0; x < width; x++)
+          line[x] = s[y*is[0] + x*is[1]];
+        for (x = width; x < line_width; x++)
+          line[x] = 0;
+        image_iir_line(line, line_width, c);
+        memcpy(r, line, sizeof(double) * width);
+      }
+
+#pragma omp for
+      for (y = 0; y < nchunk; y++) {
+        long c0 = y*IMAGE_FILTER_CHUNK;
+        long c1 = MIN(c0 + IMAGE_FILTER_CHUNK, width);
+        long r;
+        image_iir_columns(data, width, rows, c0, c1, c);
+        for (r = 0; r < height; r++) {
+          for (x = c0; x < c1; x++)
+            d[r*os[0] + x*os[1]] = image_(FromIntermediate)(data[r*width + x]);
+        }
+      }
+    }
+    THFree(padded);
+  }
+
+  THFree(buffer);
+  return 0;
+}
+
 /*
  * Borrowed from github.com/clementfarabet/lua---imgraph
  * with Clément's permission for implementing y2jet()
@@ -2083,29 +2626,11 @@ int image_(Main_colorize)(lua_State *L) {
 int image_(Main_rgb2y)(lua_State *L) {
   THTensor *rgb = luaT_checkudata(L, 1, torch_Tensor);
   THTensor *yim = luaT_checkudata(L, 2, torch_Tensor);
+  image_(Main_color_validate)(L, rgb, yim, 1, "rgb2y");
 
-  luaL_argcheck(L, rgb->nDimension == 3, 1, "image.rgb2y: src not 3D");
-  luaL_argcheck(L, yim->nDimension == 2, 2, "image.rgb2y: dst not 2D");
-  luaL_argcheck(L, rgb->size[1] == yim->size[0], 2,
-                "image.rgb2y: src and dst not of same height");
-  luaL_argcheck(L, rgb->size[2] == yim->size[1], 2,
-                "image.rgb2y: src and dst not of same width");
-
-  int y, x;
-  temp_t r, g, b, yc;
-  const int height = rgb->size[1];
-  const int width = rgb->size[2];
-  for (y=0; y<height; y++) {
-    for (x=0; x<width; x++) {
-      // get Rgb
-      r = THTensor_(get3d)(rgb, 0, y, x);
-      g = THTensor_(get3d)(rgb, 1, y, x);
-      b = THTensor_(get3d)(rgb, 2, y, x);
-
-      yc = 0.299 * r + 0.587 * g + 0.114 * b;
-      THTensor_(set2d)(yim, y, x, image_(FromIntermediate)(yc));
-    }
-  }
+  IMAGE_COLOR_LOOP(rgb, yim,
+    o0 = 0.299 * c0 + 0.587 * c1 + 0.114 * c2;
+  )
   return 0;
 }
 
@@ -2263,6 +2788,9 @@ static const struct luaL_Reg image_(Main__) [] = {
   {"scaleSimple", image_(Main_scaleSimple)},
   {"scaleBilinear", image_(Main_scaleBilinear)},
   {"scaleBicubic", image_(Main_scaleBicubic)},
+  {"scaleArea", image_(Main_scaleArea)},
+  {"scaleLanczos", image_(Main_scaleLanczos)},
+  {"cropScaleNormalize", image_(Main_cropScaleNormalize)},
   {"rotate", image_(Main_rotate)},
   {"rotateBilinear", image_(Main_rotateBilinear)},
   {"polar", image_(Main_polar)},
@@ -2272,6 +2800,7 @@ static const struct luaL_Reg image_(Main__) [] = {
   {"translate", image_(Main_translate)},
   {"cropNoScale", image_(Main_cropNoScale)},
   {"warp", image_(Main_warp)},
+  {"affine", image_(Main_affine)},
   {"saturate", image_(Main_saturate)},
   {"rgb2y",   image_(Main_rgb2y)},
   {"rgb2hsv", image_(Main_rgb2hsv)},
@@ -2280,7 +2809,13 @@ static const struct luaL_Reg image_(Main__) [] = {
   {"hsl2rgb", image_(Main_hsl2rgb)},
   {"rgb2lab", image_(Main_rgb2lab)},
   {"lab2rgb", image_(Main_lab2rgb)},
+  {"rgb2yuv", image_(Main_rgb2yuv)},
+  {"yuv2rgb", image_(Main_yuv2rgb)},
   {"gaussian", image_(Main_gaussian)},
+  {"separate", image_(Main_separate)},
+  {"separable", image_(Main_separable)},
+  {"boxFilter", image_(Main_boxFilter)},
+  {"gaussianIIR", image_(Main_gaussianIIR)},
   {"vflip", image_(Main_vflip)},
   {"hflip", image_(Main_hflip)},
   {"flip", image_(Main_flip)},
@@ -187,9 +187,37 @@ static int libjpeg_(Main_size)(lua_State *L)
   return 3;
 }
 
+/*
+ * Picks the smallest IDCT scaling (1/8, 1/4, 1/2) such that the decoded image
+ * still covers target_width x target_height, after jpeg_read_header().
+ * Scaled IDCTs skip most of the inverse DCT and upsampling work: this is
+ * much cheaper than decoding at full resolution and downscaling.
+ */
+static void libjpeg_(Main_setscale)(j_decompress_ptr cinfo, int target_width, int target_height)
+{
+  unsigned int denom;
+  for (denom = 8; denom > 1; denom /= 2) {
+    cinfo->scale_num = 1;
+    cinfo->scale_denom = denom;
+    jpeg_calc_output_dimensions(cinfo);
+    if (cinfo->output_width >= (JDIMENSION)target_width &&
+        cinfo->output_height >= (JDIMENSION)target_height)
+      break;
+  }
+  cinfo->scale_num = 1;
+  cinfo->scale_denom = denom;
+  if (denom > 1) {
+    /* the fast integer IDCT is accurate enough once downscaled */
+    cinfo->dct_method = JDCT_IFAST;
+  }
+}
+
 static int libjpeg_(Main_load)(lua_State *L)
 {
   const int load_from_file = luaL_checkint(L, 1);
+  /* optional target size: 0 means full resolution */
+  const int target_width = luaL_optint(L, 3, 0);
+  const int target_height = luaL_optint(L, 4, 0);
 
 #if !defined(HAVE_JPEG_MEM_SRC)
   if (load_from_file != 1) {
@@ -275,9 +303,9 @@ static int libjpeg_(Main_load)(lua_State *L)
 
   /* Step 4: set parameters for decompression */
 
-  /* In this example, we don't need to change any of the defaults set by
-   * jpeg_read_header(), so we do nothing here.
-   */
+  if (target_width > 0 || target_height > 0) {
+    libjpeg_(Main_setscale)(&cinfo, target_width, target_height);
+  }
 
   /* Step 5: Start decompressor */
 
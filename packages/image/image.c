@@ -22,12 +22,18 @@
 #define min( a, b ) ( ((a) < (b)) ? (a) : (b) )
 
 #include "font.c"
+#include "resize.c"
+#include "colorspace.c"
+#include "transform.c"
+#include "filter.c"
 
 #include "generic/image.c"
 #include "THGenerateAllTypes.h"
 
 DLL_EXPORT int luaopen_libimage(lua_State *L)
 {
+  image_srgb_init();
+
   image_FloatMain_init(L);
   image_DoubleMain_init(L);
   image_ByteMain_init(L);
@@ -118,7 +118,7 @@ local function isJPG(magicTensor)
     return torch.all(torch.eq(magicTensor, jpgMagic))
 end
 
-local function decompress(tensor, depth, tensortype)
+local function decompress(tensor, depth, tensortype, size)
     if torch.typename(tensor) ~= 'torch.ByteTensor' then
         dok.error('Input tensor must be a byte tensor',
                   'image.decompress')
@@ -128,7 +128,7 @@ local function decompress(tensor, depth, tensortype)
                   'image.decompress')
     end
     if isJPG(tensor[{{1,3}}]) then
-        return image.decompressJPG(tensor, depth, tensortype)
+        return image.decompressJPG(tensor, depth, tensortype, size)
     elseif isPNG(tensor[{{1,4}}]) then
         return image.decompressPNG(tensor, depth, tensortype)
     else
@@ -227,12 +227,27 @@ local function processJPG(img, depth, tensortype)
    return img
 end
 
-local function loadJPG(filename, depth, tensortype)
+-- target size of a reduced-resolution decode: a number n (the image must
+-- cover n x n), or a table {width, height}
+local function targetsize(size, func)
+   if size == nil then
+      return 0, 0
+   elseif type(size) == 'number' then
+      return size, size
+   elseif type(size) == 'table' and #size == 2 then
+      return size[1], size[2]
+   else
+      dok.error('size must be a number or a table {width, height}', func)
+   end
+end
+
+local function loadJPG(filename, depth, tensortype, size)
    if not xlua.require 'libjpeg' then
       dok.error('libjpeg package not found, please install libjpeg','image.loadJPG')
    end
    local load_from_file = 1
-   local a = template(tensortype).libjpeg.load(load_from_file, filename)
+   local width, height = targetsize(size, 'image.loadJPG')
+   local a = template(tensortype).libjpeg.load(load_from_file, filename, width, height)
    if a == nil then
       return nil
    else
@@ -241,7 +256,7 @@ local function loadJPG(filename, depth, tensortype)
 end
 rawset(image, 'loadJPG', loadJPG)
 
-local function decompressJPG(tensor, depth, tensortype)
+local function decompressJPG(tensor, depth, tensortype, size)
    if not xlua.require 'libjpeg' then
       dok.error('libjpeg package not found, please install libjpeg',
         'image.decompressJPG')
@@ -251,7 +266,8 @@ local function decompressJPG(tensor, depth, tensortype)
         'image.decompressJPG')
    end
    local load_from_file = 0
-   local a = template(tensortype).libjpeg.load(load_from_file, tensor)
+   local width, height = targetsize(size, 'image.decompressJPG')
+   local a = template(tensortype).libjpeg.load(load_from_file, tensor, width, height)
    if a == nil then
       return nil
    else
@@ -350,13 +366,14 @@ local function is_supported(suffix)
 end
 rawset(image, 'is_supported', is_supported)
 
-local function load(filename, depth, tensortype)
+local function load(filename, depth, tensortype, size)
    if not filename then
       print(dok.usage('image.load',
                        'loads an image into a torch.Tensor', nil,
                        {type='string', help='path to file', req=true},
                        {type='number', help='force destination depth: 1 | 3'},
-                       {type='string', help='type: byte | float | double'}))
+                       {type='string', help='type: byte | float | double'},
+                       {type='number | table', help='JPEG only: decode at a reduced resolution still covering size x size (or {width, height})'}))
       dok.error('missing file name', 'image.load')
    end
 
@@ -385,7 +402,8 @@ local function load(filename, depth, tensortype)
 
    local tensor
    if image.is_supported(ext) then
-      tensor = filetypes[ext].loader(filename, depth, tensortype)
+      -- size is only used by the JPEG loader
+      tensor = filetypes[ext].loader(filename, depth, tensortype, size)
    elseif not ext then
       dok.error('unable to determine image type for file: ' .. filename, 'image.load')
    else
@@ -461,6 +479,285 @@ local function save(filename, tensor)
 end
 rawset(image, 'save', save)
 
+----------------------------------------------------------------------
+-- batch decode-and-augment pipeline
+--
+-- Decodes a list of JPEG/PNG images (ByteTensors or filenames), and writes
+-- them, randomly cropped, flipped, jittered and normalized, into a
+-- preallocated N x 3 x height x width FloatTensor. Samples are processed in
+-- parallel, in C.
+--
+local BatchPipeline = torch.class('image.BatchPipeline')
+
+local function perchannel(value, default, name)
+   if value == nil then
+      return {default, default, default}
+   elseif type(value) == 'number' then
+      return {value, value, value}
+   elseif type(value) == 'table' and #value == 3 then
+      return {value[1], value[2], value[3]}
+   end
+   dok.error(name .. ' must be a number or a table of 3 numbers', 'image.BatchPipeline')
+end
+
+function BatchPipeline:__init(spec)
+   spec = spec or {}
+   local crop = spec.crop
+   if crop == true then
+      crop = {}
+   end
+   local flip = spec.flip
+   if flip == true then
+      flip = 0.5
+   end
+   local jitter = spec.jitter or {}
+
+   self.spec = {
+      crop = crop and 1 or 0,
+      scale = crop and crop.scale or {0.08, 1},
+      ratio = crop and crop.ratio or {3/4, 4/3},
+      flip = flip or 0,
+      brightness = jitter.brightness or 0,
+      contrast = jitter.contrast or 0,
+      saturation = jitter.saturation or 0,
+      mean = perchannel(spec.mean, 0, 'mean'),
+      std = perchannel(spec.std, 1, 'std'),
+      nthread = spec.nthread or torch.getnumthreads(),
+      seed = spec.seed or torch.random()
+   }
+   -- number of samples processed so far: each sample has its own random
+   -- stream, so results only depend on the seed and the sample order
+   self.nsample = 0
+end
+
+function BatchPipeline:process(sources, output)
+   if not sources or not output then
+      print(dok.usage('image.BatchPipeline:process',
+                       'decodes and augments a batch of images', nil,
+                       {type='table', help='encoded images: torch.ByteTensor or file names', req=true},
+                       {type='torch.FloatTensor', help='destination (N x 3 x height x width, N >= #sources)', req=true}))
+      dok.error('missing arguments', 'image.BatchPipeline:process')
+   end
+   if not xlua.require 'libimagebatch' then
+      dok.error('libimagebatch package not found, please install libjpeg', 'image.BatchPipeline:process')
+   end
+   require('libimagebatch').process(sources, output, self.spec, self.nsample)
+   self.nsample = self.nsample + #sources
+   return output
+end
+
+----------------------------------------------------------------------
+-- packed datasets
+--
+-- A dataset is a pair of files: <prefix>.bin, the concatenated encoded
+-- images, and <prefix>.idx, an index of 64-bit integers (a header, the n+1
+-- byte offsets of the samples, and their n labels). Both are memory mapped
+-- for reading: samples are ByteTensor views of the data file, and reading
+-- one needs no file operation.
+--
+local packMagic = 0x4b434150474d49 -- "IMGPACK"
+local packVersion = 1
+local packHeader = 3
+
+local function packlib(name)
+   if not xlua.require 'libimagepack' then
+      dok.error('libimagepack package not found', name)
+   end
+   return require 'libimagepack'
+end
+
+local PackWriter = torch.class('image.PackWriter')
+
+function PackWriter:__init(prefix)
+   if type(prefix) ~= 'string' then
+      print(dok.usage('image.PackWriter',
+                       'writes a packed image dataset', nil,
+                       {type='string', help='file prefix (<prefix>.bin and <prefix>.idx)', req=true}))
+      dok.error('missing file prefix', 'image.PackWriter')
+   end
+   self.prefix = prefix
+   self.file = torch.DiskFile(prefix .. '.bin', 'w'):binary()
+   self.offsets = torch.LongTensor(1024)
+   self.labels = torch.LongTensor(1024)
+   self.offsets[1] = 0
+   self.n = 0
+end
+
+-- appends an encoded image (ByteTensor, or file name), returns its number
+function PackWriter:add(sample, label)
+   local data
+   if type(sample) == 'string' then
+      local file = torch.DiskFile(sample, 'r'):binary()
+      file:seekEnd()
+      local size = file:position() - 1
+      file:seek(1)
+      data = size > 0 and file:readByte(size) or torch.ByteStorage()
+      file:close()
+   elseif torch.typename(sample) == 'torch.ByteTensor' then
+      if sample:nElement() == 0 then
+         data = torch.ByteStorage() -- (an empty tensor may have no storage)
+      else
+         if not sample:isContiguous() or sample:storageOffset() ~= 1 or
+            sample:storage():size() ~= sample:nElement() then
+            sample = sample:clone()
+         end
+         data = sample:storage()
+      end
+   else
+      dok.error('expected a torch.ByteTensor or a file name', 'image.PackWriter:add')
+   end
+   if self.n + 2 > self.offsets:size(1) then
+      self.offsets:resize(2 * self.offsets:size(1))
+      self.labels:resize(2 * self.labels:size(1))
+   end
+   self.n = self.n + 1
+   self.offsets[self.n + 1] = self.offsets[self.n] + data:size()
+   self.labels[self.n] = label or 0
+   if data:size() > 0 then
+      self.file:writeByte(data)
+   end
+   return self.n
+end
+
+-- writes the index: the dataset can then be read with image.PackDataset
+function PackWriter:close()
+   local n = self.n
+   local index = torch.LongStorage(packHeader + 2 * n + 1)
+   index[1] = packMagic
+   index[2] = packVersion
+   index[3] = n
+   torch.LongTensor(index, packHeader + 1, torch.LongStorage{n + 1})
+      :copy(self.offsets:narrow(1, 1, n + 1))
+   if n > 0 then
+      torch.LongTensor(index, packHeader + n + 2, torch.LongStorage{n})
+         :copy(self.labels:narrow(1, 1, n))
+   end
+   self.file:close()
+   local file = torch.DiskFile(self.prefix .. '.idx', 'w'):binary()
+   file:writeLong(index)
+   file:close()
+   return n
+end
+
+local PackDataset = torch.class('image.PackDataset')
+
+function PackDataset:__init(prefix)
+   if type(prefix) ~= 'string' then
+      print(dok.usage('image.PackDataset',
+                       'opens a packed image dataset', nil,
+                       {type='string', help='file prefix (<prefix>.bin and <prefix>.idx)', req=true}))
+      dok.error('missing file prefix', 'image.PackDataset')
+   end
+   local pack = packlib('image.PackDataset')
+   local index = torch.LongStorage(prefix .. '.idx', false)
+   if index:size() < packHeader or index[1] ~= packMagic or index[2] ~= packVersion then
+      dok.error(prefix .. '.idx is not a packed dataset index', 'image.PackDataset')
+   end
+   local n = index[3]
+   if index:size() ~= packHeader + 2 * n + 1 then
+      dok.error(prefix .. '.idx is truncated', 'image.PackDataset')
+   end
+   self.n = n
+   self.offsets = torch.LongTensor(index, packHeader + 1, torch.LongStorage{n + 1})
+   self.labels = n > 0 and torch.LongTensor(index, packHeader + n + 2, torch.LongStorage{n})
+                       or torch.LongTensor()
+   if self.offsets[n + 1] > 0 then
+      self.data = torch.ByteStorage(prefix .. '.bin', false)
+      if self.data:size() < self.offsets[n + 1] then
+         dok.error(prefix .. '.bin is truncated', 'image.PackDataset')
+      end
+      -- samples are read in random order: no read-ahead
+      pack.advise(self.data, 'random')
+   end
+end
+
+function PackDataset:size()
+   return self.n
+end
+
+-- returns sample i (a ByteTensor view of the data file) and its label
+function PackDataset:get(i)
+   if i < 1 or i > self.n then
+      dok.error('sample ' .. i .. ' out of range', 'image.PackDataset:get')
+   end
+   local offset = self.offsets[i]
+   local size = self.offsets[i + 1] - offset
+   local sample = size > 0 and torch.ByteTensor(self.data, offset + 1, torch.LongStorage{size})
+                           or torch.ByteTensor()
+   return sample, self.labels[i]
+end
+
+-- returns an iterator over the batches of an epoch, in random order (unless
+-- options.shuffle is false): each step gives a table of samples, a
+-- LongTensor of labels and a LongTensor of sample numbers. The pages of the
+-- next batch are read in the background (unless options.prefetch is false).
+function PackDataset:batches(batchSize, options)
+   options = options or {}
+   batchSize = batchSize or 1
+   local pack = packlib('image.PackDataset:batches')
+   local n = self.n
+   local order = torch.LongTensor()
+   if n > 0 then
+      if options.shuffle == false then
+         torch.range(order, 1, n)
+      else
+         order:resize(n)
+         pack.shuffle(order, options.seed or torch.random())
+      end
+   end
+   local nbatch = math.ceil(n / batchSize)
+   local prefetch = options.prefetch ~= false and self.data
+   local function batch(k)
+      local first = (k - 1) * batchSize + 1
+      return order:narrow(1, first, math.min(batchSize, n - first + 1))
+   end
+
+   local k = 0
+   if prefetch and nbatch > 0 then
+      pack.willneed(self.data, self.offsets, batch(1))
+   end
+   return function()
+      k = k + 1
+      if k > nbatch then
+         return nil
+      end
+      local indices = batch(k)
+      if prefetch and k < nbatch then
+         pack.willneed(self.data, self.offsets, batch(k + 1))
+      end
+      local samples = {}
+      local labels = torch.LongTensor(indices:size(1))
+      for j = 1, indices:size(1) do
+         samples[j], labels[j] = self:get(indices[j])
+      end
+      return samples, labels, indices
+   end
+end
+
+----------------------------------------------------------------------
+-- reusable encoder
+--
+-- Keeps JPEG/PNG compressor state and buffers between calls, to encode
+-- streams of frames. Batches are encoded in parallel, in C.
+--
+local function Encoder(options)
+   options = options or {}
+   local format = options.format or 'jpg'
+   if format == 'jpeg' then
+      format = 'jpg'
+   end
+   if format ~= 'jpg' and format ~= 'png' then
+      dok.error('format must be jpg or png', 'image.Encoder')
+   end
+   if not xlua.require 'libimageencoder' then
+      dok.error('libimageencoder package not found, please install libjpeg', 'image.Encoder')
+   end
+   return require('libimageencoder').Encoder(format, options.quality or 75,
+                                             options.level or -1,
+                                             options.nthread or 1)
+end
+rawset(image, 'Encoder', Encoder)
+
 ----------------------------------------------------------------------
 -- crop
 --
@@ -577,6 +874,59 @@ local function crop(...)
 end
 rawset(image, 'crop', crop)
 
+----------------------------------------------------------------------
+-- cropScaleNormalize
+--
+local function cropScaleNormalize(...)
+   local dst,src,startx,starty,endx,endy,flip,mean,std,mode
+   local args = {...}
+   local nargs = select('#',...)
+   if nargs >= 6 and nargs <= 10 then
+      dst = args[1]
+      src = args[2]
+      startx = args[3]
+      starty = args[4]
+      endx = args[5]
+      endy = args[6]
+      flip = args[7]
+      mean = args[8]
+      std = args[9]
+      mode = args[10]
+   else
+      print(dok.usage('image.cropScaleNormalize',
+                       'crop, rescale, flip and normalize an image into dst, in one pass', nil,
+                       {type='torch.FloatTensor | torch.DoubleTensor', help='destination (e.g. a batch slice)', req=true},
+                       {type='torch.Tensor', help='input image', req=true},
+                       {type='number', help='start x', req=true},
+                       {type='number', help='start y', req=true},
+                       {type='number', help='end x', req=true},
+                       {type='number', help='end y', req=true},
+                       {type='boolean', help='flip horizontally', default=false},
+                       {type='number | table | torch.Tensor', help='mean (per channel)', default=0},
+                       {type='number | table | torch.Tensor', help='standard deviation (per channel)', default=1},
+                       {type='string', help='mode: bilinear | bicubic | area | lanczos', default='bilinear'}))
+      dok.error('incorrect arguments', 'image.cropScaleNormalize')
+   end
+   local depth = src:nDimension() == 3 and src:size(1) or 1
+   local function perchannel(x, default)
+      local t = {}
+      for k=1,depth do
+         if x == nil then
+            t[k] = default
+         elseif type(x) == 'number' then
+            t[k] = x
+         else
+            t[k] = x[k]
+         end
+      end
+      return t
+   end
+   src.image.cropScaleNormalize(src, dst, startx, starty, endx, endy, flip or false,
+                                perchannel(mean, 0), perchannel(std, 1), mode)
+   return dst
+end
+rawset(image, 'cropScaleNormalize', cropScaleNormalize)
+
 ----------------------------------------------------------------------
 -- translate
 --
@@ -654,15 +1004,15 @@ local function scale(...)
                        {type='torch.Tensor', help='input image', req=true},
                        {type='number', help='destination width', req=true},
                        {type='number', help='destination height', req=true},
-                       {type='string', help='mode: bilinear | bicubic |simple', default='bilinear'},
+                       {type='string', help='mode: bilinear | bicubic | area | lanczos | simple', default='bilinear'},
                        '',
                        {type='torch.Tensor', help='input image', req=true},
                        {type='string | number', help='destination size: "WxH" or "MAX" or "^MIN" or "*SC" or "*SCd/SCn" or MAX', req=true},
-                       {type='string', help='mode: bilinear | bicubic | simple', default='bilinear'},
+                       {type='string', help='mode: bilinear | bicubic | area | lanczos | simple', default='bilinear'},
                        '',
                        {type='torch.Tensor', help='destination image', req=true},
                        {type='torch.Tensor', help='input image', req=true},
-                       {type='string', help='mode: bilinear | bicubic | simple', default='bilinear'}))
+                       {type='string', help='mode: bilinear | bicubic | area | lanczos | simple', default='bilinear'}))
       dok.error('incorrect arguments', 'image.scale')
    end
    if size then
@@ -731,10 +1081,14 @@ local function scale(...)
       src.image.scaleBilinear(src,dst)
    elseif mode=='bicubic' then
       src.image.scaleBicubic(src,dst)
+   elseif mode=='area' then
+      src.image.scaleArea(src,dst)
+   elseif mode=='lanczos' then
+      src.image.scaleLanczos(src,dst)
    elseif mode=='simple' then
       src.image.scaleSimple(src,dst)
    else
-      dok.error('mode must be one of: simple | bicubic | bilinear', 'image.scale')
+      dok.error('mode must be one of: simple | bicubic | bilinear | area | lanczos', 'image.scale')
    end
    return dst
 end
@@ -1086,10 +1440,10 @@ local function affinetransform(...)
    if bad_args then
       print(dok.usage('image.warp',
          'warp an image, according to given affine transform', nil,
-         {type='torch.Tensor', help='input image (KxHxW)', req=true},
-         {type='torch.Tensor', help='(y,x) affine translation matrix', req=true},
+         {type='torch.Tensor', help='input image (KxHxW), or batch of images (NxKxHxW)', req=true},
+         {type='torch.Tensor', help='(y,x) affine translation matrix (2x2), or one per image (Nx2x2)', req=true},
          {type='string', help='mode: lanczos | bicubic | bilinear | simple', default='bilinear'},
-         {type='torch.Tensor', help='extra (y,x) translation to be done before transform', default=torch.Tensor{0,0}},
+         {type='torch.Tensor', help='extra (y,x) translation to be done before transform (2), or one per image (Nx2)', default=torch.Tensor{0,0}},
          {type='string', help='clamp mode: how to handle interp of samples off the input image (clamp | pad)', default='clamp'},
          '',
          {type='torch.Tensor', help='input image (KxHxW)', req=true},
@@ -1126,33 +1480,40 @@ local function affinetransform(...)
       src = src:reshape(1,src:size(1),src:size(2))
    end
    dst = dst or src.new()
-   dst:resize(src:size(1), src:size(2), src:size(3))
-
-   -- create field
-   local height = src:size(2)
-   local width = src:size(3)
-
-   local grid_y = torch.ger( torch.linspace(-1,1,height), torch.ones(width) )
-   local grid_x = torch.ger( torch.ones(height), torch.linspace(-1,1,width) )
-
-   local grid_xy = torch.Tensor()
-   grid_xy:resize(2,height,width)
-   grid_xy[1] = grid_y * ((height-1)/2) * -1
-   grid_xy[2] = grid_x * ((width-1)/2) * -1
-   local view_xy = grid_xy:reshape(2,height*width)
-
-   local matrix = matrix:typeAs(torch.Tensor()) -- coerce matrix to default tensor type
-   local field = torch.mm(matrix, view_xy)
-   field = (grid_xy - field:reshape( 2, height, width ))
-
-   -- offset field for translation
-   translation = torch.Tensor(translation)
-   field[1] = field[1] - translation[1]
-   field[2] = field[2] - translation[2]
-
+   dst:resizeAs(src)
 
-   local offset_mode = true
-   src.image.warp(dst, src, field, mode, offset_mode, clamp_mode, pad_value)
+   -- per image (y,x) matrices and translations: one, or one per image of a
+   -- NxKxHxW batch
+   local n = src:nDimension() == 4 and src:size(1) or 1
+   local matrices = matrix:double():contiguous():view(-1, 2, 2)
+   if type(translation) == 'table' then
+      translation = torch.DoubleTensor(translation)
+   end
+   local translations = translation:double():contiguous():view(-1, 2)
+   if (matrices:size(1) ~= 1 and matrices:size(1) ~= n) or
+      (translations:size(1) ~= 1 and translations:size(1) ~= n) then
+      dok.error('expected one matrix and translation, or one per image', 'image.affinetransform')
+   end
+
+   -- source coordinates of destination pixel (x,y), around the center:
+   -- src - c = matrix * (dst - c) - translation
+   local height = src:size(src:nDimension()-1)
+   local width = src:size(src:nDimension())
+   local cy, cx = (height-1)/2, (width-1)/2
+   local coeffs = torch.DoubleTensor(n, 6)
+   for i=1,n do
+      local m = matrices[math.min(i, matrices:size(1))]
+      local t = translations[math.min(i, translations:size(1))]
+      local c = coeffs[i]
+      c[1] = m[2][2]
+      c[2] = m[2][1]
+      c[3] = cx - m[2][1]*cy - m[2][2]*cx - t[2]
+      c[4] = m[1][2]
+      c[5] = m[1][1]
+      c[6] = cy - m[1][1]*cy - m[1][2]*cx - t[1]
+   end
+
+   src.image.affine(dst, src, coeffs, mode, clamp_mode, pad_value)
    if dim2 then
       dst = dst[1]
    end
@@ -1307,6 +1668,51 @@ end
 
 rawset(image, 'flip', flip)
 
+----------------------------------------------------------------------
+-- convolution by a separable (rank-1) 2D kernel, as two 1D passes: returns
+-- nil when the kernel is not separable, or the generic path must be taken
+--
+local function separableConvolve(dst, src, kernel, mode)
+   local ty = src:type()
+   if kernel:nDimension() ~= 2 or kernel:type() ~= ty
+      or (ty ~= 'torch.FloatTensor' and ty ~= 'torch.DoubleTensor')
+      or (src:nDimension() ~= 2 and src:nDimension() ~= 3) then
+      return
+   end
+   local kv, kh = torch.DoubleTensor(), torch.DoubleTensor()
+   if not src.image.separate(kernel, kv, kh) then
+      return
+   end
+   local cx = src:dim()
+   local cy = cx-1
+   local size = src:size()
+   local oy, ox
+   if mode == 'valid' then
+      oy, ox = kv:size(1)-1, kh:size(1)-1
+      size[cy] = size[cy]-oy
+      size[cx] = size[cx]-ox
+      if size[cy] < 1 or size[cx] < 1 then
+         return
+      end
+   elseif mode == 'same' and not dst then
+      -- only computes the part of the full convolution that is kept
+      oy, ox = math.ceil(kv:size(1)/2)-1, math.ceil(kh:size(1)/2)-1
+   else
+      oy, ox = 0, 0
+      size[cy] = size[cy]+kv:size(1)-1
+      size[cx] = size[cx]+kh:size(1)-1
+   end
+   local res = dst or src.new()
+   res:resize(size)
+   src.image.separable(res, src, kv, kh, oy, ox)
+   if mode == 'same' and dst then
+      local ofy = math.ceil(kv:size(1)/2)
+      local ofx = math.ceil(kh:size(1)/2)
+      res = res:narrow(cy, ofy, src:size(cy)):narrow(cx, ofx, src:size(cx))
+   end
+   return res
+end
+
 ----------------------------------------------------------------------
 -- convolve(dst,src,ker,type)
 -- convolve(dst,src,ker)
@@ -1350,6 +1756,10 @@ local function convolve(...)
    if mode and mode ~= 'valid' and mode ~= 'full' and mode ~= 'same' then
       dok.error('mode has to be one of: full | valid | same', 'image.convolve')
    end
+   local res = separableConvolve(dst, src, kernel, mode or 'valid')
+   if res then
+      return res
+   end
    local md = (((mode == 'full') or (mode == 'same')) and 'F') or 'V'
    if kernel:nDimension() == 2 and src:nDimension() == 3 then
       local k3d = src.new(src:size(1), kernel:size(1), kernel:size(2))
@@ -1374,6 +1784,94 @@ local function convolve(...)
 end
 rawset(image, 'convolve', convolve)
 
+----------------------------------------------------------------------
+-- boxfilter(dst,src,width,height)
+-- boxfilter(dst,src,width)
+-- dst = boxfilter(src,width,height)
+-- dst = boxfilter(src,width)
+--
+local function boxfilter(...)
+   local dst,src,width,height
+   local args = {...}
+   if torch.isTensor(args[2]) then
+      dst, src, width, height = args[1], args[2], args[3], args[4]
+   else
+      src, width, height = args[1], args[2], args[3]
+   end
+   if not torch.isTensor(src) or type(width) ~= 'number' then
+      print(dok.usage('image.boxfilter',
+                       'averages the pixels of a sliding window (box blur), returns the result', nil,
+                       {type='torch.Tensor', help='input image', req=true},
+                       {type='number', help='window width', req=true},
+                       {type='number', help='window height', default='width'},
+                       '',
+                       {type='torch.Tensor', help='destination', req=true},
+                       {type='torch.Tensor', help='input image', req=true},
+                       {type='number', help='window width', req=true},
+                       {type='number', help='window height', default='width'}))
+      dok.error('incorrect arguments', 'image.boxfilter')
+   end
+   height = height or width
+   dst = dst or src.new()
+   dst:resizeAs(src)
+   src.image.boxFilter(dst, src, height, width)
+   return dst
+end
+rawset(image, 'boxfilter', boxfilter)
+
+----------------------------------------------------------------------
+-- gaussianblur(dst,src,sigma,method)
+-- gaussianblur(dst,src,sigma)
+-- dst = gaussianblur(src,sigma,method)
+-- dst = gaussianblur(src,sigma)
+--
+local function gaussianblur(...)
+   local dst,src,sigma,method
+   local args = {...}
+   if torch.isTensor(args[2]) then
+      dst, src, sigma, method = args[1], args[2], args[3], args[4]
+   else
+      src, sigma, method = args[1], args[2], args[3]
+   end
+   if not torch.isTensor(src) or type(sigma) ~= 'number' then
+      print(dok.usage('image.gaussianblur',
+                       'blurs an image with a gaussian of given standard deviation, returns the result', nil,
+                       {type='torch.Tensor', help='input image', req=true},
+                       {type='number', help='standard deviation (pixels)', req=true},
+                       {type='string', help='method: auto | fir | iir', default='auto'},
+                       '',
+                       {type='torch.Tensor', help='destination', req=true},
+                       {type='torch.Tensor', help='input image', req=true},
+                       {type='number', help='standard deviation (pixels)', req=true},
+                       {type='string', help='method: auto | fir | iir', default='auto'}))
+      dok.error('incorrect arguments', 'image.gaussianblur')
+   end
+   method = method or 'auto'
+   if method ~= 'auto' and method ~= 'fir' and method ~= 'iir' then
+      dok.error('method has to be one of: auto | fir | iir', 'image.gaussianblur')
+   end
+   if sigma <= 0 or (method == 'iir' and sigma < 0.5) then
+      dok.error('sigma too small', 'image.gaussianblur')
+   end
+   if method == 'auto' then
+      -- the recursive filter is faster from about sigma = 4 (a kernel of 25 taps)
+      method = (sigma > 4 and 'iir') or 'fir'
+   end
+   dst = dst or src.new()
+   dst:resizeAs(src)
+   if method == 'iir' then
+      src.image.gaussianIIR(dst, src, sigma)
+   else
+      local radius = math.ceil(3*sigma)
+      local size = 2*radius+1
+      local kernel = image.gaussian1D{size=size, sigma=sigma/size, normalize=true,
+                                      tensor=torch.DoubleTensor(size)}
+      src.image.separable(dst, src, kernel, kernel, radius, radius)
+   end
+   return dst
+end
+rawset(image, 'gaussianblur', gaussianblur)
+
 ----------------------------------------------------------------------
 -- compresses an image between min and max
 --
@@ -1741,20 +2239,8 @@ function image.rgb2yuv(...)
    output = output or input.new()
    output:resizeAs(input)
 
-   -- input chanels
-   local inputRed = input[1]
-   local inputGreen = input[2]
-   local inputBlue = input[3]
-
-   -- output chanels
-   local outputY = output[1]
-   local outputU = output[2]
-   local outputV = output[3]
-
    -- convert
-   outputY:zero():add(0.299, inputRed):add(0.587, inputGreen):add(0.114, inputBlue)
-   outputU:zero():add(-0.14713, inputRed):add(-0.28886, inputGreen):add(0.436, inputBlue)
-   outputV:zero():add(0.615, inputRed):add(-0.51499, inputGreen):add(-0.10001, inputBlue)
+   input.image.rgb2yuv(input, output)
 
    -- return YUV image
    return output
@@ -1788,20 +2274,8 @@ function image.yuv2rgb(...)
    output = output or input.new()
    output:resizeAs(input)
 
-   -- input chanels
-   local inputY = input[1]
-   local inputU = input[2]
-   local inputV = input[3]
-
-   -- output chanels
-   local outputRed = output[1]
-   local outputGreen = output[2]
-   local outputBlue = output[3]
-
    -- convert
-   outputRed:copy(inputY):add(1.13983, inputV)
-   outputGreen:copy(inputY):add(-0.39465, inputU):add(-0.58060, inputV)
-   outputBlue:copy(inputY):add(2.03211, inputU)
+   input.image.yuv2rgb(input, output)
 
    -- return RGB image
    return output
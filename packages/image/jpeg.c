@@ -6,6 +6,7 @@
 
 #if LUA_VERSION_NUM >= 503
 #define luaL_checkint(L,n)      ((int)luaL_checkinteger(L, (n)))
+#define luaL_optint(L,n,d)      ((int)luaL_optinteger(L, (n), (d)))
 #endif
 
 
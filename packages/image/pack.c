@@ -0,0 +1,127 @@
+/* posix_madvise */
+#define _POSIX_C_SOURCE 200112L
+
+#include <TH.h>
+#include <luaT.h>
+#include <string.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Helpers for the packed image datasets (image.PackDataset).
+ *
+ * A dataset is a data file of concatenated encoded images, and an index
+ * file of 64-bit integers: a header (magic, version, number of samples n),
+ * the n+1 byte offsets of the samples in the data file, and their n labels.
+ * Both files are mapped (THMapAllocator), and samples are ByteTensor views
+ * of the data: accessing a sample is O(1), without any file operation.
+ *
+ * Samples are read in random order: the kernel read-ahead is switched off
+ * on the data mapping, and the pages of the next batch are requested
+ * asynchronously (madvise(WILLNEED)) while the current one is decoded.
+ */
+
+/* advises on the bytes [start, end) of a mapped storage, rounded out to
+   whole pages (the mapping starts on a page boundary) */
+static void pack_advise(THByteStorage *data, long start, long end, int advice)
+{
+#ifndef _WIN32
+  static long page = 0;
+  unsigned char *base = THByteStorage_data(data);
+  if (page == 0)
+    page = sysconf(_SC_PAGESIZE);
+  if (end > THByteStorage_size(data))
+    end = THByteStorage_size(data);
+  if (start >= end)
+    return;
+  start -= start % page;
+  posix_madvise(base + start, end - start, advice);
+#endif
+}
+
+/* advise(data, mode): access pattern of a whole mapped storage */
+static int pack_advise_lua(lua_State *L)
+{
+  THByteStorage *data = luaT_checkudata(L, 1, "torch.ByteStorage");
+  static const char *modes[] = {"normal", "random", "sequential", NULL};
+  int mode = luaL_checkoption(L, 2, "normal", modes);
+#ifndef _WIN32
+  static const int advices[] = {POSIX_MADV_NORMAL, POSIX_MADV_RANDOM, POSIX_MADV_SEQUENTIAL};
+  pack_advise(data, 0, THByteStorage_size(data), advices[mode]);
+#endif
+  return 0;
+}
+
+/* willneed(data, offsets, samples): starts reading the given samples
+   (LongTensor of 1-based sample numbers) in the background */
+static int pack_willneed(lua_State *L)
+{
+  THByteStorage *data = luaT_checkudata(L, 1, "torch.ByteStorage");
+  THLongTensor *offsets = luaT_checkudata(L, 2, "torch.LongTensor");
+  THLongTensor *samples = luaT_checkudata(L, 3, "torch.LongTensor");
+  long n = THLongTensor_nElement(offsets) - 1;
+  long *offset = THLongTensor_data(offsets);
+  long stride = THLongTensor_stride(offsets, 0);
+  long i;
+
+  luaL_argcheck(L, offsets->nDimension == 1, 2, "offsets should be 1D");
+  luaL_argcheck(L, samples->nDimension <= 1, 3, "samples should be 1D");
+  for (i = 0; i < THLongTensor_nElement(samples); i++) {
+    long k = THLongTensor_get1d(samples, i) - 1;
+    if (k < 0 || k >= n)
+      luaL_error(L, "sample %d out of range", (int)(k + 1));
+#ifndef _WIN32
+    pack_advise(data, offset[k*stride], offset[(k+1)*stride], POSIX_MADV_WILLNEED);
+#endif
+  }
+  return 0;
+}
+
+/* splitmix64 */
+static unsigned long long pack_random(unsigned long long *state)
+{
+  unsigned long long z = (*state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+/* shuffle(perm, seed): perm (LongTensor of size n) is set to a random
+   permutation of 1..n, which only depends on the seed */
+static int pack_shuffle(lua_State *L)
+{
+  THLongTensor *perm = luaT_checkudata(L, 1, "torch.LongTensor");
+  unsigned long long state = (unsigned long long)luaL_checknumber(L, 2);
+  long n, i, *p;
+
+  luaL_argcheck(L, perm->nDimension == 1 && THLongTensor_isContiguous(perm), 1,
+                "contiguous 1D tensor expected");
+  n = THLongTensor_size(perm, 0);
+  p = THLongTensor_data(perm);
+  for (i = 0; i < n; i++)
+    p[i] = i + 1;
+  /* Fisher-Yates */
+  for (i = n - 1; i > 0; i--) {
+    long j = (long)(pack_random(&state) % (unsigned long long)(i + 1));
+    long t = p[i];
+    p[i] = p[j];
+    p[j] = t;
+  }
+  return 0;
+}
+
+static const luaL_Reg pack_methods[] = {
+  {"advise", pack_advise_lua},
+  {"willneed", pack_willneed},
+  {"shuffle", pack_shuffle},
+  {NULL, NULL}
+};
+
+DLL_EXPORT int luaopen_libimagepack(lua_State *L)
+{
+  lua_newtable(L);
+  luaT_setfuncs(L, pack_methods, 0);
+  return 1;
+}
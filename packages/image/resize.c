@@ -0,0 +1,263 @@
+/*
+ * Separable resampling filters for image.scale.
+ *
+ * A filter maps a line of src_len pixels onto dst_len pixels: output pixel i
+ * is the weighted sum of the ntap source pixels starting at first[i].
+ * Weights are stored per output pixel (weight[i*ntap + t]).
+ *
+ * Filters only depend on (mode, src_len, dst_len): they are built once and
+ * cached in the Lua registry, so resizing many images of the same shape
+ * reuses them.
+ */
+
+#ifndef M_PI
+#define M_PI    3.14159265358979323846
+#endif
+
+enum {
+  IMAGE_FILTER_BILINEAR,  /* corner-aligned linear upscaling, area averaging for downscaling */
+  IMAGE_FILTER_BICUBIC,   /* corner-aligned Catmull-Rom interpolation */
+  IMAGE_FILTER_AREA,      /* pixel area coverage (box filter) */
+  IMAGE_FILTER_LANCZOS    /* Lanczos-3, stretched when downscaling (antialiased) */
+};
+
+typedef struct {
+  long src_len;
+  long dst_len;
+  long ntap;
+  long *first;
+  float *weight;
+} image_Filter;
+
+/* maximum number of filters cached per Lua state */
+#define IMAGE_FILTER_CACHE_SIZE 64
+
+/* output pixels per chunk of the resampling passes */
+#define IMAGE_SCALE_CHUNK 64
+
+/* minimum work (multiply-adds) of a pass to run it in parallel */
+#define IMAGE_OMP_THRESHOLD 100000
+
+static void image_filter_add(image_Filter *f, long i, long j, double w)
+{
+  if (j < 0) j = 0;
+  if (j >= f->src_len) j = f->src_len - 1;
+  f->weight[i * f->ntap + (j - f->first[i])] += (float)w;
+}
+
+/* places the window of output i, such that it starts as close as possible
+   to lo, and stays in the source */
+static void image_filter_window(image_Filter *f, long i, long lo)
+{
+  if (lo > f->src_len - f->ntap) lo = f->src_len - f->ntap;
+  if (lo < 0) lo = 0;
+  f->first[i] = lo;
+}
+
+static double image_filter_sinc(double x)
+{
+  if (x == 0)
+    return 1;
+  x *= M_PI;
+  return sin(x) / x;
+}
+
+static long image_filter_ntap(int mode, long src_len, long dst_len)
+{
+  double scale = (double)src_len / dst_len;
+  long ntap;
+  if (src_len == dst_len || src_len == 1)
+    return 1;
+  switch (mode) {
+  case IMAGE_FILTER_BILINEAR:
+    ntap = dst_len > src_len ? 2 : (long)ceil(scale) + 2;
+    break;
+  case IMAGE_FILTER_BICUBIC:
+    ntap = 4;
+    break;
+  case IMAGE_FILTER_AREA:
+    ntap = (long)ceil(scale) + 2;
+    break;
+  default:
+    ntap = 2 * (long)ceil(3 * (scale > 1 ? scale : 1)) + 2;
+    break;
+  }
+  return ntap < src_len ? ntap : src_len;
+}
+
+static void image_filter_build(image_Filter *f, int mode)
+{
+  long src_len = f->src_len, dst_len = f->dst_len;
+  long i, j;
+
+  memset(f->weight, 0, sizeof(float) * f->ntap * dst_len);
+
+  if (src_len == dst_len || src_len == 1) {
+    for (i = 0; i < dst_len; i++) {
+      image_filter_window(f, i, src_len == 1 ? 0 : i);
+      image_filter_add(f, i, src_len == 1 ? 0 : i, 1);
+    }
+    return;
+  }
+
+  if (mode == IMAGE_FILTER_BILINEAR && dst_len < src_len) {
+    /* average of the covered pixels (partial pixels at both ends) */
+    float scale = (float)src_len / dst_len;
+    long si0_i = 0, si1_i;
+    float si0_f = 0, si1_f;
+    for (i = 0; i < dst_len; i++) {
+      float n;
+      si1_f = (i + 1) * scale; si1_i = (long)si1_f; si1_f -= si1_i;
+      image_filter_window(f, i, si0_i);
+      n = 1 - si0_f + (si1_i - si0_i - 1) + (si1_i < src_len ? si1_f : 0);
+      image_filter_add(f, i, si0_i, (1 - si0_f) / n);
+      for (j = si0_i + 1; j < si1_i; j++)
+        image_filter_add(f, i, j, 1 / n);
+      if (si1_i < src_len && si1_f > 0)
+        image_filter_add(f, i, si1_i, si1_f / n);
+      si0_i = si1_i; si0_f = si1_f;
+    }
+  }
+  else if (mode == IMAGE_FILTER_BILINEAR || mode == IMAGE_FILTER_BICUBIC) {
+    /* interpolation with corners aligned: the last pixels match */
+    float scale = dst_len == 1 ? (float)(src_len - 1) : (float)(src_len - 1) / (dst_len - 1);
+    for (i = 0; i < dst_len - 1; i++) {
+      float x = i * scale;
+      long si = (long)x;
+      x -= si;
+      if (si + 1 >= src_len) {
+        si = src_len - 2;
+        x = 1;
+      }
+      if (mode == IMAGE_FILTER_BILINEAR) {
+        image_filter_window(f, i, si);
+        image_filter_add(f, i, si, 1 - x);
+        image_filter_add(f, i, si + 1, x);
+      } else {
+        /* Catmull-Rom weights of p0..p3; out of range neighbours are
+           linearly extrapolated (p0 = 2p1 - p2, p3 = 2p2 - p1) */
+        double w0 = 0.5 * x * (-1 + x * (2 - x));
+        double w1 = 1 + x * x * (-2.5 + 1.5 * x);
+        double w2 = 0.5 * x * (1 + x * (4 - 3 * x));
+        double w3 = 0.5 * x * x * (-1 + x);
+        if (si == 0) {
+          w1 += 2 * w0;
+          w2 -= w0;
+          w0 = 0;
+        }
+        if (si + 2 >= src_len) {
+          w2 += 2 * w3;
+          w1 -= w3;
+          w3 = 0;
+        }
+        image_filter_window(f, i, si - 1);
+        if (w0 != 0) image_filter_add(f, i, si - 1, w0);
+        image_filter_add(f, i, si, w1);
+        image_filter_add(f, i, si + 1, w2);
+        if (w3 != 0) image_filter_add(f, i, si + 2, w3);
+      }
+    }
+    image_filter_window(f, dst_len - 1, src_len - 1);
+    image_filter_add(f, dst_len - 1, src_len - 1, 1);
+  }
+  else if (mode == IMAGE_FILTER_AREA) {
+    /* output pixel i covers [i*scale, (i+1)*scale) */
+    double scale = (double)src_len / dst_len;
+    for (i = 0; i < dst_len; i++) {
+      double start = i * scale, end = (i + 1) * scale;
+      long lo = (long)floor(start), hi = (long)ceil(end);
+      if (hi > src_len) hi = src_len;
+      image_filter_window(f, i, lo);
+      for (j = lo; j < hi; j++) {
+        double a = j > start ? j : start;
+        double b = j + 1 < end ? j + 1 : end;
+        if (b > a)
+          image_filter_add(f, i, j, (b - a) / scale);
+      }
+    }
+  }
+  else {
+    /* Lanczos-3 on pixel centers, with the support stretched by the
+       scale factor when downscaling; borders are replicated */
+    double scale = (double)src_len / dst_len;
+    double support = scale > 1 ? scale : 1;
+    for (i = 0; i < dst_len; i++) {
+      double center = (i + 0.5) * scale;
+      long lo = (long)ceil(center - 3 * support - 0.5);
+      long hi = (long)floor(center + 3 * support - 0.5);
+      double total = 0;
+      image_filter_window(f, i, lo);
+      for (j = lo; j <= hi; j++) {
+        double x = (j + 0.5 - center) / support;
+        if (x > -3 && x < 3)
+          total += image_filter_sinc(x) * image_filter_sinc(x / 3);
+      }
+      for (j = lo; j <= hi; j++) {
+        double x = (j + 0.5 - center) / support;
+        if (x > -3 && x < 3)
+          image_filter_add(f, i, j, image_filter_sinc(x) * image_filter_sinc(x / 3) / total);
+      }
+    }
+  }
+}
+
+/*
+ * Returns the filter for (mode, src_len, dst_len), from the cache of the
+ * given Lua state, or newly built. The filter is a userdata, left on the
+ * stack: it stays valid until popped.
+ */
+static image_Filter *image_filter_get(lua_State *L, int mode, long src_len, long dst_len)
+{
+  image_Filter *f;
+  long ntap;
+
+  lua_getfield(L, LUA_REGISTRYINDEX, "image.filters");
+  if (!lua_istable(L, -1)) {
+    lua_pop(L, 1);
+    lua_newtable(L);
+    lua_pushvalue(L, -1);
+    lua_setfield(L, LUA_REGISTRYINDEX, "image.filters");
+  }
+  lua_pushfstring(L, "%d:%d:%d", mode, (int)src_len, (int)dst_len);
+  lua_pushvalue(L, -1);
+  lua_rawget(L, -3);
+  if (lua_isuserdata(L, -1)) {
+    f = lua_touserdata(L, -1);
+    lua_replace(L, -3);
+    lua_pop(L, 1);
+    return f;
+  }
+  lua_pop(L, 1);
+
+  /* full cache: start over */
+  lua_getfield(L, -2, "size");
+  if (lua_tointeger(L, -1) >= IMAGE_FILTER_CACHE_SIZE) {
+    lua_pop(L, 1);
+    lua_remove(L, -2);
+    lua_newtable(L);
+    lua_pushvalue(L, -1);
+    lua_setfield(L, LUA_REGISTRYINDEX, "image.filters");
+    lua_insert(L, -2);
+    lua_pushinteger(L, 0);
+  }
+  lua_pushinteger(L, lua_tointeger(L, -1) + 1);
+  lua_setfield(L, -4, "size");
+  lua_pop(L, 1);
+
+  /* one block: header, first, weights */
+  ntap = image_filter_ntap(mode, src_len, dst_len);
+  f = lua_newuserdata(L, sizeof(image_Filter) + sizeof(long) * dst_len + sizeof(float) * ntap * dst_len);
+  f->src_len = src_len;
+  f->dst_len = dst_len;
+  f->ntap = ntap;
+  f->first = (long *)(f + 1);
+  f->weight = (float *)(f->first + dst_len);
+  image_filter_build(f, mode);
+
+  /* cache[key] = filter, and leave only the filter on the stack */
+  lua_pushvalue(L, -1);
+  lua_insert(L, -4);
+  lua_rawset(L, -3);
+  lua_pop(L, 1);
+  return f;
+}
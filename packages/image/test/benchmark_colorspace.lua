@@ -0,0 +1,51 @@
+require 'image'
+
+cmd = torch.CmdLine()
+
+cmd:text()
+cmd:text('Benchmark the image color space conversions')
+cmd:text()
+cmd:text()
+cmd:text('Misc options:')
+cmd:option('-size', 512, 'image width and height')
+cmd:option('-iter', 20, 'number of conversions per measure')
+cmd:option('-type', 'float', 'tensor type (float, double or byte)')
+
+cmd:text()
+
+local params = cmd:parse(arg)
+
+torch.manualSeed(5555)
+
+local src = torch.rand(3, params.size, params.size)
+if params.type == 'byte' then
+   src = src:mul(255):byte()
+elseif params.type == 'float' then
+   src = src:float()
+end
+-- same pixels, HxWx3 storage (strided rows)
+local strided = src:transpose(1, 3):contiguous():transpose(1, 3)
+
+local conversions = {
+   'rgb2y', 'rgb2yuv', 'yuv2rgb', 'rgb2hsv', 'hsv2rgb',
+   'rgb2hsl', 'hsl2rgb', 'rgb2lab', 'lab2rgb'
+}
+
+local function measure(f, input)
+   local output = f(input)
+   local timer = torch.Timer()
+   for i=1,params.iter do
+      f(output, input)
+   end
+   return timer:time().real*1000/params.iter
+end
+
+print(string.format('# %s 3x%dx%d, %d threads',
+                    src:type(), params.size, params.size, torch.getnumthreads()))
+print('conversion\tcontiguous (ms)\tstrided (ms)')
+for _,name in ipairs(conversions) do
+   if params.type ~= 'byte' or not name:find('lab') then
+      print(string.format('%s\t\t%.2f\t\t%.2f', name,
+                          measure(image[name], src), measure(image[name], strided)))
+   end
+end
@@ -0,0 +1,68 @@
+require 'image'
+
+cmd = torch.CmdLine()
+
+cmd:text()
+cmd:text('Benchmark image.Encoder against image.compressJPG/compressPNG')
+cmd:text()
+cmd:text()
+cmd:text('Misc options:')
+cmd:option('-width', 320, 'image width')
+cmd:option('-height', 240, 'image height')
+cmd:option('-batch', 16, 'number of images per batch')
+cmd:option('-iter', 10, 'number of batches per measure')
+cmd:option('-nthread', 4, 'number of encoder threads')
+cmd:option('-quality', 75, 'JPEG quality')
+cmd:option('-type', 'float', 'tensor type (float, double or byte)')
+
+cmd:text()
+
+local params = cmd:parse(arg)
+
+torch.manualSeed(5555)
+
+local batch = image.scale(image.lena(), params.width, params.height):float()
+batch = batch:view(1, 3, params.height, params.width):expand(params.batch, 3, params.height, params.width):clone()
+batch:add(torch.FloatTensor(batch:size()):uniform(-0.05, 0.05))
+if params.type == 'byte' then
+   batch = batch:clamp(0, 1):mul(255):byte()
+elseif params.type == 'double' then
+   batch = batch:double()
+end
+
+local function measure(f)
+   f()
+   local timer = torch.Timer()
+   for i=1,params.iter do
+      f()
+   end
+   return timer:time().real*1000/(params.iter*params.batch)
+end
+
+print(string.format('# %d x %s 3x%dx%d, %d encoder threads', params.batch,
+                    batch:type(), params.height, params.width, params.nthread))
+print('format\t\tcompress (ms)\tencode (ms)\tencodeBatch (ms)')
+
+local function compare(name, compress, options)
+   local encoder = image.Encoder(options)
+   local parallel = image.Encoder{format=options.format, quality=options.quality,
+                                  level=options.level, nthread=params.nthread}
+   local blobs = {}
+   local t1 = measure(function()
+      for i=1,params.batch do compress(batch[i]) end
+   end)
+   local t2 = measure(function()
+      for i=1,params.batch do blobs[i] = encoder:encode(batch[i], blobs[i]) end
+   end)
+   local t3 = measure(function() parallel:encodeBatch(batch, blobs) end)
+   print(string.format('%s\t%.2f\t\t%.2f\t\t%.2f', name, t1, t2, t3))
+end
+
+compare('jpg q' .. params.quality,
+        function(x) return image.compressJPG(x, params.quality) end,
+        {format='jpg', quality=params.quality})
+compare('png', image.compressPNG, {format='png'})
+for _,level in ipairs{1, 6, 9} do
+   -- compressPNG always uses the default level (6)
+   compare('png level ' .. level, image.compressPNG, {format='png', level=level})
+end
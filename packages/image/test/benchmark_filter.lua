@@ -0,0 +1,53 @@
+require 'image'
+
+cmd = torch.CmdLine()
+
+cmd:text()
+cmd:text('Benchmark the image filters: separable convolution, box filter, gaussian blur')
+cmd:text()
+cmd:text()
+cmd:text('Misc options:')
+cmd:option('-size', 512, 'image width and height')
+cmd:option('-iter', 10, 'number of filterings per measure')
+cmd:option('-type', 'float', 'tensor type (float or double)')
+
+cmd:text()
+
+local params = cmd:parse(arg)
+
+torch.manualSeed(5555)
+
+local src = torch.rand(3, params.size, params.size)
+if params.type == 'float' then
+   src = src:float()
+end
+
+local function measure(f)
+   f()
+   local timer = torch.Timer()
+   for i=1,params.iter do
+      f()
+   end
+   return timer:time().real*1000/params.iter
+end
+
+print(string.format('# %s 3x%dx%d, %d threads',
+                    src:type(), params.size, params.size, torch.getnumthreads()))
+print('kernel\tconv2 (ms)\tseparable (ms)\tbox (ms)')
+for _,k in ipairs{3, 5, 9, 15} do
+   local kernel = torch.ones(k, k):div(k*k):typeAs(src)
+   local k3d = kernel:view(1, k, k):expand(3, k, k):contiguous()
+   local dst = src.new()
+   print(string.format('%dx%d\t%.2f\t\t%.2f\t\t%.2f', k, k,
+                       measure(function() torch.conv2(dst, src, k3d, 'F') end),
+                       measure(function() image.convolve(dst, src, kernel, 'full') end),
+                       measure(function() image.boxfilter(dst, src, k) end)))
+end
+
+print('sigma\tfir (ms)\tiir (ms)')
+for _,sigma in ipairs{1, 2, 4, 8, 16} do
+   local dst = src.new()
+   print(string.format('%g\t%.2f\t\t%.2f', sigma,
+                       measure(function() image.gaussianblur(dst, src, sigma, 'fir') end),
+                       measure(function() image.gaussianblur(dst, src, sigma, 'iir') end)))
+end
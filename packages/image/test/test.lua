@@ -195,6 +195,122 @@ function test.gaussianpyramid()
   end
 end
 
+----------------------------------------------------------------------
+-- Separable filters tests
+--
+-- reference: torch.conv2 on every plane
+local function conv2Reference(src, kernel, mode)
+  local k3d = src.new(src:size(1), kernel:size(1), kernel:size(2))
+  for i = 1,src:size(1) do
+    k3d[i]:copy(kernel)
+  end
+  local res = torch.conv2(src, k3d, mode == 'valid' and 'V' or 'F')
+  if mode == 'same' then
+    res = res:narrow(2, math.ceil(kernel:size(1)/2), src:size(2))
+             :narrow(3, math.ceil(kernel:size(2)/2), src:size(3))
+  end
+  return res
+end
+
+function test.convolveSeparable()
+  for _, type in ipairs{'torch.FloatTensor', 'torch.DoubleTensor'} do
+    local src = torch.rand(3, 20, 25):type(type)
+    local kernels = {
+      image.gaussian{width=5, height=7, sigma=0.3, normalize=true}:type(type),
+      torch.ger(torch.rand(4), torch.rand(6)):type(type),
+      torch.rand(1, 9):type(type),
+    }
+    for _, kernel in ipairs(kernels) do
+      for _, mode in ipairs{'valid', 'full', 'same'} do
+        local expected = conv2Reference(src, kernel, mode)
+        tester:assertTensorEq(image.convolve(src, kernel, mode), expected, precision,
+                              'separable convolution (' .. mode .. ')')
+        local dst = src.new()
+        local res = image.convolve(dst, src, kernel, mode)
+        tester:assertTensorEq(res, expected, precision,
+                              'separable convolution into dst (' .. mode .. ')')
+        tester:assertTensorEq(image.convolve(src[1], kernel, mode), expected[1], precision,
+                              'separable convolution of a 2D image (' .. mode .. ')')
+      end
+    end
+    -- not separable: generic path
+    local kernel = torch.rand(5, 5):type(type)
+    tester:assertTensorEq(image.convolve(src, kernel, 'same'), conv2Reference(src, kernel, 'same'),
+                          precision, 'non separable convolution')
+  end
+end
+
+function test.boxfilter()
+  local src = torch.rand(3, 30, 40)
+  for _, size in ipairs{{3, 3}, {4, 7}, {1, 9}, {45, 5}} do
+    local width, height = size[1], size[2]
+    local kernel = torch.ones(height, width):div(width*height)
+    local expected = conv2Reference(src, kernel, 'same')
+    tester:assertTensorEq(image.boxfilter(src, width, height), expected, precision, 'box filter')
+    local dst = torch.Tensor()
+    image.boxfilter(dst, src[2], width, height)
+    tester:assertTensorEq(dst, expected[2], precision, 'box filter of a 2D image')
+  end
+  tester:assertTensorEq(image.boxfilter(src, 5), image.boxfilter(src, 5, 5), 0, 'square box filter')
+  -- byte images: the mean is rounded
+  local byte = src:clone():mul(255):byte()
+  local actual = image.boxfilter(byte, 5, 3)
+  local expected = image.boxfilter(byte:double(), 5, 3)
+  tester:assertle((actual:double() - expected):abs():max(), 0.5 + 1e-3, 'byte box filter')
+end
+
+function test.gaussianblur()
+  -- smooth image
+  local x = torch.linspace(0, 1, 60):view(1, 1, 60):expand(3, 50, 60)
+  local y = torch.linspace(0, 1, 50):view(1, 50, 1):expand(3, 50, 60)
+  local src = torch.sin(x * 7):cmul(torch.cos(y * 5)):add(1):div(2)
+
+  -- fir: convolution by the sampled gaussian
+  local sigma = 1.5
+  local radius = math.ceil(3*sigma)
+  local k = torch.range(-radius, radius):div(sigma):pow(2):mul(-0.5):exp()
+  k:div(k:sum())
+  local expected = image.convolve(src, torch.ger(k, k), 'same')
+  tester:assertTensorEq(image.gaussianblur(src, sigma), expected, precision, 'gaussian blur')
+  tester:assertTensorEq(image.gaussianblur(src[1], sigma, 'fir'), expected[1], precision,
+                        'gaussian blur of a 2D image')
+
+  -- iir: approximates fir
+  for _, sigma in ipairs{2, 6, 12} do
+    local fir = image.gaussianblur(src, sigma, 'fir')
+    local iir = image.gaussianblur(src, sigma, 'iir')
+    tester:assertlt((fir - iir):abs():max(), 0.04, 'recursive gaussian blur')
+  end
+  tester:assertTensorEq(image.gaussianblur(src, 6), image.gaussianblur(src, 6, 'iir'), 0,
+                        'large sigmas use the recursive filter')
+
+  -- iir error bounds (see the doc) against the exact Gaussian, from the sigma
+  -- where 'auto' switches to it
+  for _, sigma in ipairs{4.01, 4.5, 8} do
+    local r = math.ceil(6*sigma)
+    local g = torch.range(-r, r):div(sigma):pow(2):mul(-0.5):exp()
+    g:div(g:sum())
+    local impulse = torch.zeros(1, 2*r+1, 2*r+1)
+    impulse[1][r+1][r+1] = 1
+    local exact = torch.ger(g, g)
+    local iir = image.gaussianblur(impulse, sigma)[1]
+    tester:assertle((iir - exact):abs():max() / exact:max(), 0.051, 'recursive gaussian blur: impulse')
+    local step = torch.zeros(1, 2*r+1, 4*r+1)
+    step[{1, {}, {2*r+1, 4*r+1}}] = 1
+    local exactStep = g:cumsum()
+    local iirStep = image.gaussianblur(step, sigma)[{1, r+1, {r+1, 3*r+1}}]
+    tester:assertle((iirStep - exactStep):abs():max(), 0.02, 'recursive gaussian blur: step')
+  end
+
+  -- byte images
+  local byte = src:clone():mul(255):byte()
+  for _, method in ipairs{'fir', 'iir'} do
+    local actual = image.gaussianblur(byte, 3, method)
+    local expected = image.gaussianblur(byte:double(), 3, method)
+    tester:assertle((actual:double() - expected):abs():max(), 0.5 + 1e-3, 'byte gaussian blur')
+  end
+end
+
 ----------------------------------------------------------------------
 -- Scale test
 --
@@ -255,6 +371,73 @@ function test.bilinearUpscale_ByteTensor()
 end
 
 
+function test.areaDownscale()
+  local im = outerProduct{1, 2, 4, 2}
+  local expected = outerProduct{1.5, 3}
+  local actual = image.scale(im, expected:size(2), expected:size(1), 'area')
+  tester:assertTensorEq(actual, expected, 1e-5)
+end
+
+
+function test.lanczosScale()
+  local im = torch.Tensor(3, 20, 30):fill(0.25)
+  for _,size in ipairs{{7, 11}, {45, 33}, {30, 20}} do
+    local actual = image.scale(im, size[1], size[2], 'lanczos')
+    tester:assertTensorEq(actual, torch.Tensor(3, size[2], size[1]):fill(0.25), 1e-5,
+                          'constant images should stay constant')
+  end
+  im = torch.rand(3, 20, 30)
+  tester:assertTensorEq(image.scale(im, 30, 20, 'lanczos'), im, 1e-5, 'same size should be the identity')
+  tester:assertlt(math.abs(image.scale(im, 10, 5, 'lanczos'):mean() - im:mean()), 0.05,
+                  'downscaling should preserve the mean')
+end
+
+
+function test.scaleStrided()
+  -- filters are cached by size: same results on repeated calls, and for
+  -- non-contiguous inputs
+  local im = torch.rand(3, 37, 23)
+  local strided = im:transpose(2, 3):clone():transpose(2, 3)
+  for _,mode in ipairs{'bilinear', 'bicubic', 'area', 'lanczos'} do
+    local expected = image.scale(im, 16, 50, mode)
+    tester:assertTensorEq(image.scale(im, 16, 50, mode), expected, 1e-6, mode .. ': repeated call differs')
+    tester:assertTensorEq(image.scale(strided, 16, 50, mode), expected, 1e-6, mode .. ': strided input differs')
+  end
+end
+
+
+function test.cropScaleNormalize()
+  local im = torch.rand(3, 40, 50)
+  local mean, std = {0.4, 0.5, 0.6}, {0.2, 0.25, 0.3}
+  for _,mode in ipairs{'bilinear', 'bicubic', 'area', 'lanczos'} do
+    for _,flip in ipairs{false, true} do
+      local expected = image.scale(image.crop(im, 5, 3, 45, 33), 24, 20, mode)
+      if flip then
+        expected = image.hflip(expected)
+      end
+      for k=1,3 do
+        expected[k]:add(-mean[k]):div(std[k])
+      end
+      -- straight into a batch slot
+      local batch = torch.DoubleTensor(2, 3, 20, 24):zero()
+      image.cropScaleNormalize(batch[2], im, 5, 3, 45, 33, flip, mean, std, mode)
+      tester:assertTensorEq(batch[2], expected, 1e-5, mode .. ': differs from crop/scale/normalize')
+      tester:assertTensorEq(batch[1], torch.zeros(3, 20, 24), 0, mode .. ': wrote outside of the slot')
+    end
+  end
+
+  -- byte images are scaled to [0, 1]
+  local bytes = im:clone():mul(255):byte()
+  local actual = torch.FloatTensor(3, 20, 24)
+  image.cropScaleNormalize(actual, bytes, 5, 3, 45, 33, false, 0.5, 0.25)
+  local expected = image.scale(image.crop(bytes:float():div(255), 5, 3, 45, 33), 24, 20):add(-0.5):div(0.25)
+  tester:assertTensorEq(actual, expected, 1e-4)
+
+  tester:assertError(function() image.cropScaleNormalize(actual, bytes, 5, 3, 55, 33) end,
+                     'box outside of src should fail')
+end
+
+
 ----------------------------------------------------------------------
 -- Scale test
 --
@@ -322,6 +505,60 @@ function test.test_hflip_simple()
     tester:assertTensorEq(expected_odd, im_odd, 1e-16, 'hflip: fails on odd size in place')
 end
 
+----------------------------------------------------------------------
+-- Affine transform test
+--
+local function affineField(height, width, matrix, translation)
+  local grid = torch.Tensor(2, height, width)
+  grid[1] = torch.ger(torch.linspace(-1, 1, height), torch.ones(width)) * (-(height - 1) / 2)
+  grid[2] = torch.ger(torch.ones(height), torch.linspace(-1, 1, width)) * (-(width - 1) / 2)
+  local field = grid - torch.mm(matrix, grid:view(2, height * width)):view(2, height, width)
+  field[1]:add(-translation[1])
+  field[2]:add(-translation[2])
+  return field
+end
+
+
+function test.affinetransform()
+  local img = image.scale(image.lena(), 64, 48)
+  local matrix = torch.Tensor{{0.9, 0.3}, {-0.25, 1.1}}
+  local translation = torch.Tensor{3.2, -7.1}
+  local field = affineField(48, 64, matrix, translation)
+  for _, mode in ipairs{'bilinear', 'bicubic', 'lanczos'} do
+    local expected = image.warp(img, field, mode, true, 'clamp')
+    local actual = image.affinetransform(img, matrix, mode, translation, 'clamp')
+    tester:assertTensorEq(actual, expected, 1e-3, mode .. ': differs from image.warp')
+  end
+  -- the nearest neighbour, also where a scale of 0.5 lands every other pixel
+  -- on a .5 tie
+  local tied = torch.Tensor{{0.5, 0}, {0, 0.5}}
+  local tiedTranslation = torch.Tensor{0.25, 0.25}
+  for _, t in ipairs{{matrix, translation}, {tied, tiedTranslation}} do
+    local expected = image.warp(img, affineField(48, 64, t[1], t[2]), 'simple', true, 'clamp')
+    local actual = image.affinetransform(img, t[1], 'simple', t[2], 'clamp')
+    tester:assertTensorEq(actual, expected, 0, 'simple: differs from image.warp')
+  end
+  -- a ByteTensor is interpolated with integer weights, within a unit of the
+  -- float result on the same values
+  local bytes = img:clone():mul(255):byte()
+  local expected = image.warp(bytes:double(), field, 'bilinear', true, 'clamp')
+  local actual = image.affinetransform(bytes, matrix, 'bilinear', translation, 'clamp'):double()
+  tester:assertTensorEq(actual, expected, 1, 'bilinear: ByteTensor differs from image.warp')
+  -- a batch transforms each image with its own matrix
+  local batch = torch.Tensor(3, 3, 48, 64)
+  local matrices = torch.Tensor(3, 2, 2)
+  for i = 1, 3 do
+    batch[i]:copy(img):mul(i / 3)
+    matrices[i]:copy(matrix):mul(1 + i / 10)
+  end
+  local output = image.affinetransform(batch, matrices, 'bicubic', translation, 'pad', 0.5)
+  for i = 1, 3 do
+    local expected = image.affinetransform(batch[i], matrices[i], 'bicubic', translation, 'pad', 0.5)
+    tester:assertTensorEq(output[i], expected, 1e-12, 'batch differs from single images')
+  end
+end
+
+
 ----------------------------------------------------------------------
 -- decompress jpg test
 --
@@ -368,6 +605,38 @@ function test.CompareLoadAndDecompress()
     'images from load and decompress dont match! ')
 end
 
+function test.LoadReducedJPG()
+  local imfile = getTestImagePath('grace_hopper_512.jpg')
+  local full = image.loadJPG(imfile)
+  local h, w = full:size(2), full:size(3)
+
+  -- smallest 1/2^k scale covering the target
+  local img = image.load(imfile, 3, 'float', 100)
+  tester:asserteq(img:size(2), math.ceil(h/4), 'reduced decode height')
+  tester:asserteq(img:size(3), math.ceil(w/4), 'reduced decode width')
+  img = image.load(imfile, 3, 'float', {w/2, 1})
+  tester:asserteq(img:size(3), w/2, 'reduced decode width')
+
+  -- full resolution when the target is larger than the image
+  img = image.load(imfile, 3, 'float', 2*w)
+  tester:assertTensorEq(img, full:float(), 1e-6, 'full resolution decode expected')
+
+  -- the reduced decode is close to a downscaled full decode
+  img = image.loadJPG(imfile, 3, 'double', 200)
+  local ref = image.scale(full, img:size(3), img:size(2), 'simple')
+  tester:assertlt((img - ref):abs():mean(), 0.05, 'reduced decode differs from downscaling')
+
+  -- same from memory
+  local f = torch.DiskFile(imfile, 'r'):binary()
+  f:seekEnd()
+  local n = f:position() - 1
+  f:seek(1)
+  local bin = torch.ByteTensor(f:readByte(n))
+  f:close()
+  tester:assertTensorEq(image.decompressJPG(bin, 3, 'double', 200), img, 1e-6,
+    'reduced load and decompress dont match')
+end
+
 function test.LoadInvalid()
   -- Make sure nothing nasty happens if we try and load a "garbage" tensor
   local file_size_bytes = 1000
@@ -425,6 +694,38 @@ function test.CompressAndDecompressPNG()
   tester:assertlt(mean_err_png, precision_mean, 'compressPNG error is too high! ')
   tester:assertlt(std_err_png, precision_std, 'compressPNG error is too high! ')
 end
+function test.Encoder()
+  local img = image.lena():float()
+  local strided = img:transpose(1, 3):contiguous():transpose(1, 3)
+  local bytes = img:clone():mul(255):byte()
+  local compress = {
+    jpg = function(x) return image.compressJPG(x, 90) end,
+    png = function(x) return image.compressPNG(x) end,
+  }
+  for format, f in pairs(compress) do
+    local ref = f(img)
+    local encoder = image.Encoder{format=format, quality=90, nthread=2}
+    local blob = encoder:encode(img)
+    tester:assert(blob:equal(ref), format .. ': differs from compress' .. format:upper())
+    -- buffers are reused, and strided images are read directly
+    tester:assert(encoder:encode(strided, blob):equal(ref), format .. ': strided image differs')
+    tester:assert(encoder:encode(bytes, blob):equal(f(bytes)), format .. ': byte image differs')
+    local batch = torch.FloatTensor(3, 3, img:size(2), img:size(3))
+    for i=1,3 do
+      batch[i]:copy(img)
+    end
+    for _,blobs in ipairs{encoder:encodeBatch(batch), encoder:encodeBatch({img, strided, img})} do
+      tester:asserteq(#blobs, 3, format .. ': wrong batch size')
+      for i=1,3 do
+        tester:assert(blobs[i]:equal(ref), format .. ': batch image differs')
+      end
+    end
+  end
+  tester:assertError(function() image.Encoder():encode(torch.FloatTensor(2, 8, 8)) end,
+                     'JPEG images with 2 channels should fail')
+end
+
+
 ----------------------------------------------------------------------
 -- Lab conversion test
 -- These tests break if someone removes lena from the repo
@@ -442,6 +743,28 @@ function test.rgb2lab()
 end
 
 
+function test.rgb2labFloat()
+  local expected = image.lena():float()
+  local actual = image.lab2rgb(image.rgb2lab(expected))
+  tester:assertTensorEq(actual, expected, 1e-4)
+  -- strided input gives the same result
+  local hwc = expected:transpose(1, 3):contiguous():transpose(1, 3)
+  tester:assertTensorEq(image.rgb2lab(hwc), image.rgb2lab(expected), 1e-5)
+end
+
+
+function test.rgb2yuv()
+  testRoundtrip(image.rgb2yuv, image.yuv2rgb)
+  local x = image.lena()
+  local r, g, b = x[1], x[2], x[3]
+  local expected = torch.Tensor():resizeAs(x)
+  expected[1]:copy(r * 0.299 + g * 0.587 + b * 0.114)
+  expected[2]:copy(r * -0.14713 + g * -0.28886 + b * 0.436)
+  expected[3]:copy(r * 0.615 + g * -0.51499 + b * -0.10001)
+  tester:assertTensorEq(image.rgb2yuv(x), expected, 1e-6)
+end
+
+
 function test.rgb2hsv()
   testRoundtrip(image.rgb2hsv, image.hsv2rgb)
 end
@@ -511,6 +834,16 @@ function test.rgb2yByteTensor()
 end
 
 
+function test.rgb2yuvByteTensor()
+  -- greys have centered chroma
+  local grey = torch.ByteTensor(3, 2, 2):fill(100)
+  local yuv = image.rgb2yuv(grey)
+  tester:assertTensorEq(yuv[1]:double(), torch.DoubleTensor(2, 2):fill(100), 0)
+  tester:assertTensorEq(yuv[{{2, 3}}]:double(), torch.DoubleTensor(2, 2, 2):fill(128), 0)
+  tester:assertTensorEq(image.yuv2rgb(yuv):double(), grey:double(), 1)
+end
+
+
 function test.y2jetByteTensor()
   local levels = torch.Tensor{1, 2, 3, 4, 5, 6, 7, 8, 9, 10}
   local expected = toByteImage(image.y2jet(levels))
@@ -590,6 +923,117 @@ function test.LoadCorruptedPNG()
   )
 end
 
+----------------------------------------------------------------------
+-- Batch pipeline test
+--
+local function boxDownscale(img, factor)
+  local c, h, w = img:size(1), img:size(2)/factor, img:size(3)/factor
+  return img:contiguous():view(c, h, factor, w, factor):mean(5):mean(3):view(c, h, w)
+end
+
+function test.BatchPipeline()
+  local jpg = getTestImagePath('grace_hopper_512.jpg')
+  local png = getTestImagePath('grace_hopper_512.png')
+  local output = torch.FloatTensor(4, 3, 128, 128):fill(-1)
+
+  -- no augmentation: whole images, resized
+  image.BatchPipeline():process({jpg, toBlob(jpg), png}, output)
+  local ref = boxDownscale(image.load(jpg, 3, 'float'), 4)
+  tester:assertlt((output[1] - ref):abs():mean(), 0.01, 'resized JPEG differs from reference')
+  tester:assertTensorEq(output[1], output[2], 1e-6, 'file and memory sources should be equal')
+  ref = boxDownscale(image.load(png, 3, 'float'), 4)
+  tester:assertlt((output[3] - ref):abs():mean(), 0.01, 'resized PNG differs from reference')
+  tester:assert(output[4]:eq(-1):all(), 'slots past the sources should not be written')
+
+  -- normalization
+  local mean, std = {0.485, 0.456, 0.406}, {0.229, 0.224, 0.225}
+  local normalized = torch.FloatTensor(1, 3, 128, 128)
+  image.BatchPipeline{mean=mean, std=std}:process({jpg}, normalized)
+  for c=1,3 do
+    normalized[1][c]:mul(std[c]):add(mean[c])
+  end
+  tester:assertTensorEq(normalized[1], output[1], 1e-5, 'normalization is wrong')
+
+  -- flipping
+  local flipped = torch.FloatTensor(1, 3, 128, 128)
+  image.BatchPipeline{flip=1}:process({jpg}, flipped)
+  tester:assertTensorEq(flipped[1], image.hflip(output[1]), 1e-6, 'flip is wrong')
+
+  -- augmentations only depend on the seed and the sample order
+  local spec = {crop=true, flip=true, jitter={brightness=0.4, contrast=0.4, saturation=0.4}, seed=1234}
+  local a = torch.FloatTensor(4, 3, 64, 64)
+  local b = torch.FloatTensor(4, 3, 64, 64)
+  spec.nthread = 1
+  local pipeline = image.BatchPipeline(spec)
+  pipeline:process({jpg, jpg}, a:narrow(1, 1, 2))
+  pipeline:process({jpg, png}, a:narrow(1, 3, 2))
+  spec.nthread = 4
+  image.BatchPipeline(spec):process({jpg, jpg, jpg, png}, b)
+  tester:assertTensorEq(a, b, 1e-6, 'augmentations should not depend on batching or threads')
+  tester:assertgt((a[1] - a[2]):abs():max(), 0.1, 'samples should be augmented independently')
+  tester:assert(a:ge(0):all() and a:le(1):all(), 'jittered values should stay in [0, 1]')
+
+  tester:assertErrorPattern(
+    function() image.BatchPipeline():process({jpg, torch.ByteTensor(16):zero()}, output) end,
+    'sample 2: unknown image format',
+    'invalid sources should raise an error'
+  )
+end
+
+----------------------------------------------------------------------
+-- Packed dataset test
+--
+function test.PackDataset()
+  local prefix = os.tmpname()
+  local jpg = getTestImagePath('grace_hopper_512.jpg')
+  local blobs = {toBlob(jpg), image.compressPNG(image.lena()), torch.ByteTensor(), toBlob(jpg):narrow(1, 5, 100)}
+  local writer = image.PackWriter(prefix)
+  tester:asserteq(writer:add(jpg, 7), 1, 'wrong sample number')
+  for i, blob in ipairs(blobs) do
+    writer:add(blob, i)
+  end
+  tester:asserteq(writer:close(), 5, 'wrong number of samples')
+
+  local dataset = image.PackDataset(prefix)
+  tester:asserteq(dataset:size(), 5, 'wrong dataset size')
+  local sample, label = dataset:get(1)
+  tester:assert(sample:equal(blobs[1]), 'file sample differs')
+  tester:asserteq(label, 7, 'wrong label')
+  for i, blob in ipairs(blobs) do
+    sample, label = dataset:get(i + 1)
+    tester:assert(sample:nElement() == blob:nElement() and (blob:nElement() == 0 or sample:equal(blob)),
+                  'sample ' .. (i + 1) .. ' differs')
+    tester:asserteq(label, i, 'wrong label')
+  end
+  tester:assertTensorEq(image.decompressJPG(dataset:get(1)), image.load(jpg), 1e-8,
+                        'decoded sample differs')
+
+  -- one epoch visits every sample once, in an order given by the seed
+  local seen, order = {}, {}
+  for samples, labels, indices in dataset:batches(2, {seed=5}) do
+    tester:assert(#samples <= 2 and labels:size(1) == #samples, 'wrong batch size')
+    for j = 1, indices:size(1) do
+      local i = indices[j]
+      tester:assert(not seen[i], 'sample seen twice')
+      seen[i] = true
+      table.insert(order, i)
+      tester:asserteq(labels[j], dataset.labels[i], 'wrong batch label')
+    end
+  end
+  tester:asserteq(#order, 5, 'samples missing from the epoch')
+  local again = {}
+  for _, _, indices in dataset:batches(3, {seed=5}) do
+    for j = 1, indices:size(1) do
+      table.insert(again, indices[j])
+    end
+  end
+  tester:assertTableEq(again, order, 'epoch order should only depend on the seed')
+  os.remove(prefix .. '.bin')
+  os.remove(prefix .. '.idx')
+  os.remove(prefix)
+end
+
+
 ----------------------------------------------------------------------
 -- PPM test
 --
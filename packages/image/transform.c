@@ -0,0 +1,59 @@
+/*
+ * Helpers for the affine transforms.
+ *
+ * The source coordinates of a destination row are walked incrementally,
+ * and stored in fixed point: the integer part gives the top-left source
+ * pixel of the interpolation, the IMAGE_FIX_BITS fractional bits give its
+ * weights. The pixels whose neighbourhood lies inside the source (the bulk
+ * of a row) are then resampled, channel by channel, by gather loops without
+ * bounds checks; the others take the generic path of image.warp.
+ */
+
+#define IMAGE_FIX_BITS 16
+#define IMAGE_FIX_ONE (1L << IMAGE_FIX_BITS)
+#define IMAGE_FIX_MASK (IMAGE_FIX_ONE - 1)
+
+/* byte images interpolate with integer weights of this many bits: two
+   weights and a pixel fit in an int */
+#define IMAGE_WEIGHT_BITS 11
+#define IMAGE_WEIGHT_ONE (1 << IMAGE_WEIGHT_BITS)
+
+/* an interpolated pixel costs roughly this many multiply-adds */
+#define IMAGE_TRANSFORM_COST 8
+
+/*
+ * Source coordinates of the destination pixels x = 0 .. width-1 of a row:
+ * (sx + x*dx, sy + x*dy). Finds the first run of pixels sampling inside
+ * [xmin, xmax) x [ymin, ymax), stores their fixed point coordinates in fx
+ * and fy, and returns the run as [*first, *last).
+ */
+static void image_affine_span(double sx, double sy, double dx, double dy, long width,
+                              double xmin, double xmax, double ymin, double ymax,
+                              long *fx, long *fy, long *first, long *last)
+{
+  double ix = sx, iy = sy;
+  long x;
+  for (x = 0; x < width; x++, ix += dx, iy += dy) {
+    if (ix >= xmin && ix < xmax && iy >= ymin && iy < ymax)
+      break;
+  }
+  *first = x;
+  for (; x < width; x++, ix += dx, iy += dy) {
+    if (!(ix >= xmin && ix < xmax && iy >= ymin && iy < ymax))
+      break;
+    /* non negative: truncation is floor */
+    fx[x] = (long)(ix * IMAGE_FIX_ONE);
+    fy[x] = (long)(iy * IMAGE_FIX_ONE);
+  }
+  *last = x;
+}
+
+/* Catmull-Rom weights of the 4 neighbours at fractional position t, as
+   image.warp's bicubic interpolation */
+static inline void image_cubic_weights(double t, double *w)
+{
+  w[0] = 0.5 * t * (-1 + t * (2 - t));
+  w[1] = 1 + 0.5 * t * t * (-5 + 3 * t);
+  w[2] = 0.5 * t * (1 + t * (4 - 3 * t));
+  w[3] = 0.5 * t * t * (t - 1);
+}
@@ -1,5 +1,6 @@
 local nesting = require('nngraph.nesting')
 local utils = require('nngraph.utils')
+local plan = require('nngraph.plan')
 local istensor = torch.isTensor
 local istable = utils.istable
 local istorchclass = utils.istorchclass
@@ -193,7 +194,34 @@ function gModule:__init(inputs,outputs)
    end
 end
 
+-- Freezes the graph into a flat execution plan (see plan.lua). Subsequent
+-- updateOutput/updateGradInput/accGradParameters calls run a tight loop over
+-- preallocated slots, instead of walking the graph and rebuilding the node
+-- input tables. Results are identical to the graph walk.
+-- Call compile(false) to go back to the graph walk. The graph walk is also
+-- used when self.verbose is set.
+function gModule:compile(flag)
+   self.compiled = (flag ~= false)
+   self._plan = nil
+   if self.compiled then
+      self._plan = plan.build(self)
+   end
+   return self
+end
+
+-- returns the execution plan if the module is compiled (building it if needed)
+function gModule:getPlan()
+   if not self.compiled or self.verbose then
+      return
+   end
+   if not self._plan then
+      self._plan = plan.build(self)
+   end
+   return self._plan
+end
+
 function gModule:replace(callback)
+    self._plan = nil
     local out = callback(self)
     local revmodules = {}
     for i,m in ipairs(self.modules) do
@@ -242,6 +270,9 @@ function gModule:type(type, tensorCache)
 
    tensorCache = tensorCache or {}
 
+   -- the plan holds buffers of the previous type
+   self._plan = nil
+
    local function applyTypeToTable(table)
       for key, value in pairs(table) do
          table[key] = recursiveType(table[key], type)
@@ -282,10 +313,16 @@ function gModule:type(type, tensorCache)
 end
 
 function gModule:updateOutput(input)
+   local p = self:getPlan()
+   if p then
+      self.output = plan.updateOutput(p, input)
+      return self.output
+   end
    return self:runForwardFunction('updateOutput',input)
 end
 
 function gModule:clearState()
+   self._plan = nil
    local ret = parent.clearState(self)
    for _,node in ipairs(self.backwardnodes) do
       node.data.gradOutput = nil
@@ -388,6 +425,11 @@ function gModule:runForwardFunction(func,input)
 end
 
 function gModule:updateGradInput(input,gradOutput)
+   local p = self:getPlan()
+   if p then
+      self.gradInput = plan.updateGradInput(p, gradOutput)
+      return self.gradInput
+   end
    local function neteval(node)
       if node.data.selectindex then
          assert(not node.data.module, "the selectindex-handling nodes should have no module")
@@ -460,6 +502,11 @@ function gModule:updateGradInput(input,gradOutput)
 end
 
 function gModule:accGradParameters(input,gradOutput,lr)
+   local p = self:getPlan()
+   if p then
+      plan.accGradParameters(p, gradOutput, lr)
+      return
+   end
    local function neteval(node)
       if node.data.module then
          local module = node.data.module
@@ -491,6 +538,17 @@ function gModule:accGradParameters(input,gradOutput,lr)
    end
 end
 
+function gModule:write(file)
+   -- the plan is rebuilt on demand
+   local var = {}
+   for k,v in pairs(self) do
+      if k ~= '_plan' then
+         var[k] = v
+      end
+   end
+   file:writeObject(var)
+end
+
 function gModule:read(file)
    local data = file:readObject()
    for k, v in pairs(data) do
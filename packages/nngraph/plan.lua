@@ -0,0 +1,303 @@
+local nesting = require('nngraph.nesting')
+local utils = require('nngraph.utils')
+local istable = utils.istable
+
+-- A plan is a gModule graph frozen into two flat instruction lists (forward
+-- and backward), built once by gModule:compile().
+--
+-- Each forward node gets a slot (its index in forwardnodes) holding its
+-- output. Instead of rebuilding node.data.input tables at each call, every
+-- instruction knows the slots of its inputs (in mapindex order), and nodes
+-- with several inputs own a preallocated input table.
+--
+-- Backward instructions follow backwardnodes. The gradOutputs reaching a
+-- node are resolved at compile time into an ordered list of contributions
+-- (the same order the graph walk would insert them), so that the summed
+-- gradOutputs are bit-identical to gModule:updateGradInput().
+--
+-- All the structural checks of the graph walk are done once, at compile
+-- time.
+local plan = {}
+
+-- forward opcodes
+local OP_INPUT = 1    -- the dummy input node
+local OP_NOARG = 2    -- module without input (a parameter node)
+local OP_UNARY = 3    -- module with one input
+local OP_NARY = 4     -- module with a table of inputs
+local OP_IDENTITY = 5 -- no module, one input
+local OP_TABLE = 6    -- no module, several inputs (forwarded as a table)
+local OP_SELECT = 7   -- split() output
+
+function plan.build(gm)
+   local fnodes = gm.forwardnodes
+   local bnodes = gm.backwardnodes
+
+   local index = {}
+   for i,node in ipairs(fnodes) do
+      index[node.data] = i
+   end
+
+   -- input slots of each node, in mapindex order
+   local srcs = {}
+   for i=1,#fnodes do
+      srcs[i] = {}
+   end
+   for i,node in ipairs(fnodes) do
+      for _,child in ipairs(node.children) do
+         local c = index[child.data]
+         local mapindex = child.data.mapindex[node.data]
+         assert(not srcs[c][mapindex], "each input should have one source")
+         srcs[c][mapindex] = i
+      end
+   end
+
+   local innode = index[gm.innode.data]
+   local outnode = index[gm.outnode.data]
+
+   local fwd = {}
+   for i,node in ipairs(fnodes) do
+      local data = node.data
+      local src = srcs[i]
+      local nsrc = 0
+      for _ in pairs(src) do
+         nsrc = nsrc + 1
+      end
+      assert(nsrc == #src, "missing input")
+
+      local ins = {module=data.module, nsplit=data.nSplitOutputs}
+      if i == innode then
+         ins.op = OP_INPUT
+         ins.buf = {}
+      elseif data.selectindex then
+         assert(not data.module, "the selectindex-handling nodes should have no module")
+         assert(nsrc == 1, "only the splitted node should be the input")
+         ins.op = OP_SELECT
+         ins.src = src[1]
+         ins.selectindex = data.selectindex
+      elseif nsrc == 0 then
+         assert(data.module, "a node without input should have a module")
+         ins.op = OP_NOARG
+         ins.buf = {}
+      elseif nsrc == 1 then
+         ins.op = data.module and OP_UNARY or OP_IDENTITY
+         ins.src = src[1]
+      else
+         ins.op = data.module and OP_NARY or OP_TABLE
+         ins.src = src
+         ins.buf = {}
+      end
+      fwd[i] = ins
+   end
+
+   -- backward: resolve the contributions to the gradOutput of each node
+   local bindex = {}
+   for k,node in ipairs(bnodes) do
+      bindex[node.data] = k
+   end
+   assert(bindex[gm.outnode.data] == 1, "expecting the outnode to start the backward graph")
+
+   local bwd = {}
+   for k,node in ipairs(bnodes) do
+      local f = fwd[index[node.data]]
+      bwd[k] = {
+         module = f.module,
+         contribs = {},
+         golist = {},
+         -- input given to the module in the forward
+         src = (f.op == OP_UNARY) and f.src or nil,
+         buf = (f.op == OP_NARY or f.op == OP_NOARG) and f.buf or nil
+      }
+   end
+   for k,node in ipairs(bnodes) do
+      local data = node.data
+      if data.selectindex then
+         assert(#node.children == 1, "only the splitted node should be the input")
+         local child = bwd[bindex[node.children[1].data]]
+         assert(#child.contribs == 0, "the splitted node should be used only once")
+         child.splitgrad = child.splitgrad or {}
+         child.selected = child.selected or {}
+         assert(not child.selected[data.selectindex], "no gradOutput should be assigned yet")
+         child.selected[data.selectindex] = true
+         bwd[k].target = child
+         bwd[k].selectindex = data.selectindex
+      else
+         for _,child in ipairs(node.children) do
+            local c = bwd[bindex[child.data]]
+            assert(not c.splitgrad, "the splitted node should be used only once")
+            table.insert(c.contribs, {
+               from = k,
+               mapindex = (#node.children ~= 1) and data.mapindex[child.data] or nil
+            })
+         end
+      end
+   end
+   for k,ins in ipairs(bwd) do
+      ins.selected = nil
+      ins.ncontribs = #ins.contribs
+   end
+
+   local ininput = bwd[bindex[gm.innode.data]]
+   assert(ininput.splitgrad or ininput.ncontribs == 1, "expecting the innode to be used only once")
+
+   return {
+      fwd = fwd,
+      bwd = bwd,
+      nforward = #fwd,
+      nbackward = #bwd,
+      slots = {},
+      gslots = {},
+      outnode = outnode,
+      innode = bindex[gm.innode.data],
+      nInputs = gm.nInputs or #gm.innode.children,
+      nOutputs = #gm.outnode.children
+   }
+end
+
+function plan.updateOutput(p, input)
+   local fwd, slots = p.fwd, p.slots
+   for i=1,p.nforward do
+      local ins = fwd[i]
+      local op = ins.op
+      local output
+      if op == OP_UNARY then
+         output = ins.module:updateOutput(slots[ins.src])
+      elseif op == OP_NARY then
+         local buf, src = ins.buf, ins.src
+         for j=1,#src do
+            buf[j] = slots[src[j]]
+         end
+         output = ins.module:updateOutput(buf)
+      elseif op == OP_IDENTITY then
+         output = slots[ins.src]
+      elseif op == OP_SELECT then
+         local x = slots[ins.src]
+         if not istable(x) then
+            error("the input for a split should be a table")
+         end
+         output = x[ins.selectindex]
+      elseif op == OP_TABLE then
+         local buf, src = ins.buf, ins.src
+         for j=1,#src do
+            buf[j] = slots[src[j]]
+         end
+         output = buf
+      elseif op == OP_NOARG then
+         output = ins.module:updateOutput(ins.buf)
+      else -- OP_INPUT
+         local nInputs = p.nInputs
+         if nInputs <= 1 then
+            if input == nil then
+               error(string.format('Got 0 inputs instead of %s', nInputs))
+            end
+            output = input
+         else
+            if type(input) ~= "table" then
+               error(string.format("expecting table of %s inputs", nInputs))
+            end
+            if #input ~= nInputs then
+               error(string.format('Got %s inputs instead of %s', #input, nInputs))
+            end
+            local buf = ins.buf
+            for j=1,nInputs do
+               buf[j] = input[j]
+            end
+            output = buf
+         end
+      end
+      if ins.nsplit and ins.nsplit ~= #output then
+         error(string.format("split(%s) cannot split %s outputs",
+                             ins.nsplit, #output))
+      end
+      slots[i] = output
+   end
+   return slots[p.outnode]
+end
+
+-- same as getTotalGradOutput() in gmodule.lua, on a list of n gradOutputs
+local function getTotalGradOutput(ins, gradOutput, n)
+   if n == 1 then
+      return gradOutput[1]
+   end
+   if not ins.gradOutputBuffer then
+      local count = 0
+      local idx = 1
+      for i=1,n do
+         local zero = torch.isTensor(gradOutput[i]) and
+                      gradOutput[i]:storage() ~= nil and
+                      gradOutput[i]:storage():size() == 1 and
+                      gradOutput[i]:storage()[1] == 0
+         if not zero then
+            idx = i
+            count = count + 1
+         end
+      end
+      if count < 2 then
+         return gradOutput[idx]
+      end
+   end
+   ins.gradOutputBuffer = ins.gradOutputBuffer or nesting.cloneNested(gradOutput[1])
+   local gobuff = ins.gradOutputBuffer
+   nesting.resizeNestedAs(gobuff, gradOutput[1])
+   nesting.copyNested(gobuff, gradOutput[1])
+   for i=2,n do
+      nesting.addNestedTo(gobuff, gradOutput[i])
+   end
+   return gobuff
+end
+
+function plan.updateGradInput(p, gradOutput)
+   if p.nOutputs > 1 and #gradOutput ~= p.nOutputs then
+      error(string.format('Got %s gradOutputs instead of %s', #gradOutput, p.nOutputs))
+   end
+   local bwd, slots, gslots = p.bwd, p.slots, p.gslots
+   for k=1,p.nbackward do
+      local ins = bwd[k]
+      local go
+      if k == 1 then
+         go = gradOutput
+      elseif ins.splitgrad then
+         go = ins.splitgrad
+      else
+         local golist, contribs = ins.golist, ins.contribs
+         local n = ins.ncontribs
+         for j=1,n do
+            local c = contribs[j]
+            local gi = gslots[c.from]
+            if c.mapindex then
+               gi = gi[c.mapindex]
+            end
+            golist[j] = gi
+         end
+         go = getTotalGradOutput(ins, golist, n)
+      end
+      ins.gradOutput = go
+
+      if ins.target then
+         ins.target.splitgrad[ins.selectindex] = go
+      else
+         local module = ins.module
+         if module then
+            gslots[k] = module:updateGradInput(ins.src and slots[ins.src] or ins.buf, go)
+         else
+            gslots[k] = go
+         end
+      end
+   end
+   return gslots[p.innode]
+end
+
+function plan.accGradParameters(p, gradOutput, lr)
+   if p.nOutputs > 1 and #gradOutput ~= p.nOutputs then
+      error(string.format('Got %s gradOutputs instead of %s', #gradOutput, p.nOutputs))
+   end
+   local bwd, slots = p.bwd, p.slots
+   for k=1,p.nbackward do
+      local ins = bwd[k]
+      local module = ins.module
+      if module then
+         module:accGradParameters(ins.src and slots[ins.src] or ins.buf, ins.gradOutput, lr)
+      end
+   end
+end
+
+return plan
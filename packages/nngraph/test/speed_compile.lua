@@ -0,0 +1,78 @@
+
+require 'nngraph'
+
+-- Overhead of the graph walk vs the compiled plan (gModule:compile()) on an
+-- unrolled LSTM. Small hidden sizes make the graph overhead dominate.
+
+local function lstm(x, prevH, prevC, nin, nh)
+   local gates = nn.CAddTable()({nn.Linear(nin, 4*nh)(x), nn.Linear(nh, 4*nh)(prevH)})
+   local i, f, o, g = nn.SplitTable(2)(nn.Reshape(4, nh)(gates)):split(4)
+   i, f, o, g = nn.Sigmoid()(i), nn.Sigmoid()(f), nn.Sigmoid()(o), nn.Tanh()(g)
+   local c = nn.CAddTable()({nn.CMulTable()({f, prevC}), nn.CMulTable()({i, g})})
+   local h = nn.CMulTable()({o, nn.Tanh()(c)})
+   return h, c
+end
+
+local function unrolled(nstep, nin, nh)
+   local inputs, outputs = {}, {}
+   local h0, c0 = nn.Identity()(), nn.Identity()()
+   table.insert(inputs, h0)
+   table.insert(inputs, c0)
+   local h, c = h0, c0
+   for t=1,nstep do
+      local x = nn.Identity()()
+      table.insert(inputs, x)
+      h, c = lstm(x, h, c, nin, nh)
+      table.insert(outputs, h)
+   end
+   return nn.gModule(inputs, outputs)
+end
+
+local function time_benchmark(model, input, gradOutput, n)
+   local forward_timer = torch.Timer():stop():reset()
+   local backward_timer = torch.Timer():stop():reset()
+   for i = 1, n do
+      forward_timer:resume()
+      model:forward(input)
+      forward_timer:stop()
+      backward_timer:resume()
+      model:backward(input, gradOutput)
+      backward_timer:stop()
+   end
+   return {forward = forward_timer:time().real, backward = backward_timer:time().real}
+end
+
+local cmd = torch.CmdLine()
+cmd:text('nngraph compiled plan benchmarking')
+cmd:option('-niter', 100, 'number of iterations of forward/backward')
+cmd:option('-nstep', 50, 'number of unrolled LSTM steps')
+cmd:option('-batch_size', 4, 'size of batch')
+cmd:option('-input_size', 8, 'size of input')
+cmd:option('-hidden_size', 8, 'size of hidden layer')
+local opt = cmd:parse(arg)
+print(opt)
+
+local model = unrolled(opt.nstep, opt.input_size, opt.hidden_size)
+local compiled = model:clone():compile()
+
+local input = {torch.randn(opt.batch_size, opt.hidden_size), torch.randn(opt.batch_size, opt.hidden_size)}
+local gradOutput = {}
+for t=1,opt.nstep do
+   table.insert(input, torch.randn(opt.batch_size, opt.input_size))
+   table.insert(gradOutput, torch.randn(opt.batch_size, opt.hidden_size))
+end
+
+print(string.format('%d nodes', #model.forwardnodes))
+
+-- warm up, and check both paths agree
+local out, cout = model:forward(input), compiled:forward(input)
+for t=1,opt.nstep do
+   assert(torch.equal(out[t], cout[t]), 'compiled output differs')
+end
+
+local walk = time_benchmark(model, input, gradOutput, opt.niter)
+local plan = time_benchmark(compiled, input, gradOutput, opt.niter)
+print(string.format('graph walk: forward = %.3f s, backward = %.3f s', walk.forward, walk.backward))
+print(string.format('compiled:   forward = %.3f s, backward = %.3f s', plan.forward, plan.backward))
+print(string.format('speedup:    forward = %.2fx, backward = %.2fx',
+                    walk.forward/plan.forward, walk.backward/plan.backward))
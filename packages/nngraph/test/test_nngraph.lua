@@ -480,4 +480,52 @@ function test.test_gradInputType()
       tester:ne(model.modules[4], l2, "gModule.modules wasn't updated")
    end
 
+   function test.test_compile()
+      -- an LSTM cell: two inputs (one of them split), two outputs
+      local function lstm(nin, nh)
+         local x = nn.Identity()()
+         local prev = nn.Identity()()
+         local prevH, prevC = prev:split(2)
+         local gates = nn.CAddTable()({nn.Linear(nin, 4*nh)(x), nn.Linear(nh, 4*nh)(prevH)})
+         local i, f, o, g = nn.SplitTable(2)(nn.Reshape(4, nh)(gates)):split(4)
+         i, f, o, g = nn.Sigmoid()(i), nn.Sigmoid()(f), nn.Sigmoid()(o), nn.Tanh()(g)
+         local c = nn.CAddTable()({nn.CMulTable()({f, prevC}), nn.CMulTable()({i, g})})
+         local h = nn.CMulTable()({o, nn.Tanh()(c)})
+         return nn.gModule({x, prev}, {h, c})
+      end
+
+      local function check(module, input, gradOutput)
+         local compiled = module:clone():compile()
+         local params, gradParams = module:getParameters()
+         local cparams, cgradParams = compiled:getParameters()
+         for iter=1,2 do
+            gradParams:zero()
+            cgradParams:zero()
+            tester:eq(compiled:forward(input), module:forward(input), "compiled output", 0)
+            tester:eq(compiled:backward(input, gradOutput), module:backward(input, gradOutput),
+                      "compiled gradInput", 0)
+            tester:eq(cgradParams, gradParams, "compiled gradParameters", 0)
+         end
+      end
+
+      local nin, nh = 5, 4
+      local input = {torch.randn(3, nin), {torch.randn(3, nh), torch.randn(3, nh)}}
+      check(lstm(nin, nh), input, {torch.randn(3, nh), torch.randn(3, nh)})
+
+      -- tied parameters, several gradOutputs to sum
+      local x = nn.Identity()()
+      local l = nn.Linear(nh, nh)
+      local h1 = nn.Tanh()(l(x))
+      local h2 = nn.Tanh()(l:clone('weight', 'bias', 'gradWeight', 'gradBias')(h1))
+      local module = nn.gModule({x}, {nn.CAddTable()({h1, h2, x})})
+      check(module, torch.randn(3, nh), torch.randn(3, nh))
+
+      -- the plan survives serialization (and is rebuilt on demand)
+      local compiled = lstm(nin, nh):compile()
+      local clone = compiled:clone()
+      tester:assert(clone.compiled and not clone._plan, "plan should not be serialized")
+      tester:eq(clone:forward(input), compiled:forward(input), "output after clone", 0)
+      checkGradients(compiled, input)
+   end
+
    tester:add(test):run()
@@ -0,0 +1,108 @@
+local threads = require 'threads'
+
+cmd = torch.CmdLine()
+
+cmd:text()
+cmd:text('Benchmark threads.DataLoader against a per-sample addjob loader')
+cmd:text()
+cmd:text()
+cmd:text('Misc options:')
+cmd:option('-nsample', 4096, '# of samples per epoch')
+cmd:option('-size', 64, 'samples are 3 x size x size images')
+cmd:option('-batch', 64, 'batch size')
+cmd:option('-work', 4, 'cost of loading a sample (# of passes over it)')
+cmd:option('-train', 20, 'cost of a training step (ms of main thread work)')
+cmd:option('-maxthreads', 8, 'maximum number of threads (powers of 2 are benchmarked)')
+
+cmd:text()
+
+local params = cmd:parse(arg)
+
+torch.manualSeed(5555)
+torch.setdefaulttensortype('torch.FloatTensor')
+
+local size, work = params.size, params.work
+
+-- "decoding" a sample: a few passes over an image
+local function load(dst, index)
+   torch.manualSeed(index)
+   dst:uniform()
+   for i=1,work do
+      dst:mul(1.01):add(0.01):sqrt()
+   end
+end
+
+-- the main thread trains on each batch for the given time
+local function train()
+   local timer = torch.Timer()
+   while timer:time().real*1000 < params.train do
+   end
+end
+
+-- the usual loader: one job (and one main thread callback) per sample,
+-- batches are built in the main thread
+local function naive(nthread)
+   local pool = threads.Threads(nthread, function() require 'torch' end)
+   local batch = torch.FloatTensor(params.batch, 3, size, size)
+   local perm = torch.randperm(params.nsample)
+   local timer = torch.Timer()
+   local wait = 0
+   for b=0,params.nsample/params.batch-1 do
+      local t0 = timer:time().real
+      for i=1,params.batch do
+         pool:addjob(
+            function(index)
+               local x = torch.FloatTensor(3, size, size)
+               load(x, index)
+               return x
+            end,
+            function(x)
+               batch[i]:copy(x)
+            end,
+            perm[b*params.batch+i]
+         )
+      end
+      pool:synchronize()
+      wait = wait + timer:time().real - t0
+      train()
+   end
+   pool:terminate()
+   return params.nsample/timer:time().real, wait
+end
+
+local function dataloader(nthread)
+   local dl = threads.DataLoader(
+      nthread, {
+         size = params.nsample,
+         batchSize = params.batch,
+         allocate =
+            function(bs)
+               return torch.FloatTensor(bs, 3, size, size)
+            end,
+         fill =
+            function(batch, i, index)
+               load(batch[i], index)
+            end
+      }
+   )
+   local timer = torch.Timer()
+   local wait = 0
+   local t0 = timer:time().real
+   for batch in dl:run() do
+      wait = wait + timer:time().real - t0
+      train()
+      t0 = timer:time().real
+   end
+   local rate = params.nsample/timer:time().real
+   dl:terminate()
+   return rate, wait
+end
+
+print('threads\tnaive (samples/s, wait s)\tDataLoader (samples/s, wait s)')
+local nthread = 1
+while nthread <= params.maxthreads do
+   local r1, w1 = naive(nthread)
+   local r2, w2 = dataloader(nthread)
+   print(string.format('%d\t%.0f\t%.2f\t\t\t%.0f\t%.2f', nthread, r1, w1, r2, w2))
+   nthread = nthread * 2
+end
@@ -0,0 +1,100 @@
+require 'nn'
+local threads = require 'threads'
+
+cmd = torch.CmdLine()
+
+cmd:text()
+cmd:text('Benchmark threads.DataParallel scaling')
+cmd:text()
+cmd:text()
+cmd:text('Misc options:')
+cmd:option('-nex', 16384, '# of examples')
+cmd:option('-batch', 512, 'batch size')
+cmd:option('-ninput', 784, '# of inputs')
+cmd:option('-nhidden', 2048, '# of hidden units')
+cmd:option('-noutput', 10, '# of outputs')
+cmd:option('-iter', 2, 'number of iterations to perform')
+cmd:option('-maxthreads', 64, 'maximum number of threads (powers of 2 are benchmarked)')
+cmd:option('-double', false, 'use doubles instead of floats')
+cmd:option('-serial', false, 'also benchmark the serial sum of gradients in the main thread')
+
+cmd:text()
+
+local params = cmd:parse(arg)
+
+torch.manualSeed(5555)
+torch.setdefaulttensortype(params.double and 'torch.DoubleTensor' or 'torch.FloatTensor')
+
+assert(params.nex % params.batch == 0, '# of examples must be divisible with batch size')
+
+local data = torch.randn(params.nex, params.ninput)
+local label = torch.LongTensor(params.nex)
+for i=1,params.nex do
+   label[i] = (i % params.noutput) + 1
+end
+
+local function newmodel()
+   local mlp = nn.Sequential()
+   mlp:add(nn.Linear(params.ninput, params.nhidden))
+   mlp:add(nn.Tanh())
+   mlp:add(nn.Linear(params.nhidden, params.noutput))
+   mlp:add(nn.LogSoftMax())
+   return mlp
+end
+
+local function train(nthread)
+   collectgarbage()
+   local dpt = threads.DataParallel(nthread, newmodel(), nn.ClassNLLCriterion())
+   local weights, gradWeights = dpt:parameters()
+   local nbatch = params.nex/params.batch
+
+   local t = torch.Timer()
+   local treduce = 0
+   local err
+   for iter=1,params.iter do
+      err = 0
+      for idx=1,nbatch do
+         local x = data:narrow(1, (idx-1)*params.batch+1, params.batch)
+         local y = label:narrow(1, (idx-1)*params.batch+1, params.batch)
+         err = err + dpt:forwardBackward(x, y)
+         weights:add(-0.01, gradWeights)
+      end
+   end
+   local time = t:time().real
+
+   -- isolate the all-reduce cost
+   t:reset()
+   for idx=1,nbatch do
+      dpt:allReduce()
+   end
+   treduce = t:time().real
+
+   local tserial
+   if params.serial and nthread > 1 then
+      t:reset()
+      for idx=1,nbatch do
+         for j=2,nthread do
+            dpt.gradbuffers[1]:add(dpt.gradbuffers[j])
+         end
+      end
+      tserial = t:time().real
+   end
+
+   dpt:terminate()
+   return params.iter*params.nex/time, treduce/nbatch, tserial and tserial/nbatch, err/nbatch
+end
+
+print(string.format('# mlp %d/%d/%d, batch %d, %d parameters',
+                    params.ninput, params.nhidden, params.noutput, params.batch,
+                    (params.ninput+1)*params.nhidden + (params.nhidden+1)*params.noutput))
+print('threads\tex/s\tspeedup\tallreduce(ms)\tserial(ms)\tloss')
+local base
+local nthread = 1
+while nthread <= params.maxthreads and nthread <= params.batch do
+   local exs, treduce, tserial, err = train(nthread)
+   base = base or exs
+   print(string.format('%d\t%.1f\t%.2f\t%.3f\t%s\t%.4f',
+                       nthread, exs, exs/base, treduce*1000,
+                       tserial and string.format('%.3f', tserial*1000) or '-', err))
+   nthread = nthread * 2
+end
@@ -0,0 +1,112 @@
+require 'nn'
+local threads = require 'threads'
+
+cmd = torch.CmdLine()
+
+cmd:text()
+cmd:text('Benchmark threads.Hogwild on a synthetic click-through dataset')
+cmd:text()
+cmd:text()
+cmd:text('Misc options:')
+cmd:option('-nex', 2^20, '# of training examples')
+cmd:option('-ntest', 2^16, '# of held-out examples')
+cmd:option('-nfield', 16, '# of categorical fields (active features per example)')
+cmd:option('-fieldsize', 2^16, '# of distinct values per field')
+cmd:option('-batch', 64, 'batch size')
+cmd:option('-lr', 0.05, 'learning rate')
+cmd:option('-epoch', 3, 'number of epochs')
+cmd:option('-maxthreads', 16, 'maximum number of threads (powers of 2 are benchmarked)')
+
+cmd:text()
+
+local params = cmd:parse(arg)
+
+torch.manualSeed(5555)
+torch.setdefaulttensortype('torch.FloatTensor')
+
+assert(params.nex % params.batch == 0, '# of examples must be divisible with batch size')
+
+local nfeature = params.nfield*params.fieldsize
+
+-- ground truth: a logistic model over one-hot fields, with a skewed
+-- (power-law like) value popularity, and a low average click rate
+local truth = torch.randn(nfeature)
+local truthbias = -2
+
+local function dataset(nex)
+   local idx = torch.rand(nex, params.nfield):pow(3):mul(params.fieldsize):floor()
+   for f=1,params.nfield do
+      idx:select(2, f):add((f-1)*params.fieldsize + 1)
+   end
+   idx = idx:long()
+   local logit = truth:index(1, idx:view(-1)):view(nex, params.nfield):sum(2):add(truthbias)
+   local p = logit:mul(-1):exp():add(1):pow(-1)
+   local click = torch.rand(nex, 1):le(p):float()
+   return idx, click
+end
+
+local input, target = dataset(params.nex)
+local testinput, testtarget = dataset(params.ntest)
+
+local function newmodel()
+   local model = nn.Sequential()
+   model:add(nn.LookupTable(nfeature, 1))
+   model:add(nn.Sum(2))
+   model:add(nn.Add(1))
+   model:add(nn.Sigmoid())
+   model.modules[1].weight:zero()
+   model.modules[3].bias:fill(truthbias)
+   return model
+end
+
+local function testloss(model)
+   local criterion = nn.BCECriterion()
+   return criterion:forward(model:forward(testinput), testtarget)
+end
+
+local function train(nthread, atomic)
+   collectgarbage()
+   local model = newmodel()
+   local hogwild = threads.Hogwild(nthread, model, nn.BCECriterion(),
+                                   {learningRate=params.lr, atomic=atomic})
+   local nbatch = params.nex/params.batch
+   local losses = {}
+   local time = 0
+   for epoch=1,params.epoch do
+      local t = torch.Timer()
+      for idx=1,nbatch do
+         hogwild:addbatch(input:narrow(1, (idx-1)*params.batch+1, params.batch),
+                          target:narrow(1, (idx-1)*params.batch+1, params.batch))
+      end
+      hogwild:synchronize()
+      time = time + t:time().real
+      table.insert(losses, string.format('%.4f', testloss(model)))
+   end
+   hogwild:terminate()
+   return params.epoch*params.nex/time, losses
+end
+
+print(string.format('# %d examples, %d fields of %d values, batch %d, lr %g',
+                    params.nex, params.nfield, params.fieldsize, params.batch, params.lr))
+local function refloss()
+   local criterion = nn.BCECriterion()
+   local logit = truth:index(1, testinput:view(-1)):view(params.ntest, params.nfield):sum(2):add(truthbias)
+   local p = logit:mul(-1):exp():add(1):pow(-1)
+   local rate = torch.FloatTensor(params.ntest, 1):fill(testtarget:mean())
+   return criterion:forward(p, testtarget), criterion:forward(rate, testtarget)
+end
+
+print(string.format('# held-out log-loss: %.4f (true model), %.4f (constant click rate)', refloss()))
+print('mode\tthreads\tex/s\tspeedup\theld-out loss per epoch')
+for _,atomic in ipairs{true, false} do
+   local mode = atomic and 'atomic' or 'relaxed'
+   local base
+   local nthread = 1
+   while nthread <= params.maxthreads do
+      local exs, losses = train(nthread, atomic)
+      base = base or exs
+      print(string.format('%s\t%d\t%.1f\t%.2f\t%s',
+                          mode, nthread, exs, exs/base, table.concat(losses, ' ')))
+      nthread = nthread * 2
+   end
+end
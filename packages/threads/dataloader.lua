@@ -0,0 +1,214 @@
+local Threads = require 'threads.threads'
+
+local DataLoader = {}
+local DataLoader_ctor = {}
+setmetatable(
+   DataLoader_ctor, {
+      __newindex = DataLoader,
+      __index = DataLoader,
+      __call =
+         function(self, ...)
+            return DataLoader.new(...)
+         end
+   }
+)
+
+DataLoader.__index = DataLoader
+
+-- narrow a tensor (or a table of tensors) along the batch dimension
+local function narrowbatch(x, offset, sz)
+   if type(x) == 'table' then
+      local res = {}
+      for k,v in pairs(x) do
+         res[k] = narrowbatch(v, offset, sz)
+      end
+      return res
+   else
+      return x:narrow(1, offset, sz)
+   end
+end
+
+-- runs in the workers: fills slot k with the given samples
+-- (no upvalue: only its code and arguments are serialized per batch)
+local function filljob(k, indices, seed)
+   local state = __dataloader
+   local batch = state.slots[k]
+   torch.manualSeed(seed)
+   if state.fillbatch then
+      state.fillbatch(batch, indices, state.data)
+   else
+      local fill, data = state.fill, state.data
+      for i=1,indices:size(1) do
+         fill(batch, i, indices[i], data)
+      end
+   end
+   return k
+end
+
+function DataLoader.new(N, config, ...)
+   require 'torch'
+   assert(type(N) == 'number' and N >= 1, 'number of threads expected')
+   assert(type(config) == 'table', 'config table expected')
+   assert(type(config.size) == 'number' and config.size >= 1, 'config.size (number of samples) expected')
+   assert(type(config.batchSize) == 'number' and config.batchSize >= 1, 'config.batchSize expected')
+   assert(type(config.allocate) == 'function', 'config.allocate function expected')
+   assert(type(config.fill) == 'function' or type(config.fillbatch) == 'function',
+          'config.fill or config.fillbatch function expected')
+
+   local self = {
+      N = N,
+      nsample = config.size,
+      batchSize = config.batchSize,
+      depth = config.depth or 2*N,
+      shuffle = (config.shuffle ~= false),
+      seed = config.seed or 1,
+      droplast = config.droplast or false,
+      epoch = 0,
+      ready = {}
+   }
+   setmetatable(self, DataLoader)
+   assert(self.depth >= 1, 'prefetch depth must be at least 1')
+
+   -- ring of preallocated batches: workers write them in place
+   local slots = {}
+   for k=1,self.depth do
+      slots[k] = config.allocate(self.batchSize)
+   end
+   self.slots = slots
+
+   local init, fill, fillbatch = config.init, config.fill, config.fillbatch
+   local _unpack = unpack or table.unpack
+   local funcs = {
+      function()
+         require 'torch'
+      end,
+      function()
+         -- workers are the parallelism: one core each
+         torch.setnumthreads(1)
+      end,
+      ...
+   }
+   table.insert(
+      funcs,
+      function(threadid)
+         __dataloader = {
+            slots = slots,
+            fill = fill,
+            fillbatch = fillbatch,
+            data = init and init(threadid)
+         }
+      end
+   )
+
+   local serialization = Threads.serialization()
+   Threads.serialization('threads.sharedserialize')
+   local status, threads = pcall(Threads, N, _unpack(funcs))
+   Threads.serialization(serialization)
+   if not status then
+      error(threads)
+   end
+   self.threads = threads
+
+   return self
+end
+
+-- number of batches per epoch
+function DataLoader:size()
+   if self.droplast then
+      return math.floor(self.nsample/self.batchSize)
+   else
+      return math.ceil(self.nsample/self.batchSize)
+   end
+end
+
+-- sample order of an epoch, and seeds of its batches: they only depend on
+-- (seed, epoch), not on the number of threads
+function DataLoader:permutation(epoch)
+   local gen = torch.Generator()
+   torch.manualSeed(gen, self.seed + epoch - 1)
+   local perm
+   if self.shuffle then
+      perm = torch.randperm(gen, self.nsample):long()
+   else
+      perm = torch.range(1, self.nsample):long()
+   end
+   local seeds = {}
+   for b=1,self:size() do
+      seeds[b] = torch.random(gen)
+   end
+   return perm, seeds
+end
+
+-- iterator over the batches of an epoch (the next one by default):
+--   for batch, n, indices in loader:run() do ... end
+-- batch is valid until the next iteration
+function DataLoader:run(epoch)
+   local threads = self.threads
+   assert(threads, 'data loader is terminated')
+
+   -- batches still in flight (epoch left early)
+   threads:synchronize()
+
+   epoch = epoch or self.epoch + 1
+   self.epoch = epoch
+   local perm, seeds = self:permutation(epoch)
+   local nbatch = self:size()
+   local depth, bs = self.depth, self.batchSize
+   local ready = self.ready
+   local queued, consumed = 0, 0
+   local holding = false
+
+   -- queue the batches that have a free slot, as long as the job queue
+   -- does not block
+   local function push()
+      while queued < nbatch and queued - consumed < depth and threads:acceptsjob() do
+         local b = queued + 1
+         local k = (b-1) % depth + 1
+         local offset = (b-1)*bs + 1
+         local indices = perm:narrow(1, offset, math.min(bs, self.nsample - offset + 1))
+         ready[k] = false
+         threads:addjob(
+            filljob,
+            function(k)
+               ready[k] = true
+            end,
+            k, indices, seeds[b]
+         )
+         queued = b
+      end
+   end
+
+   return function()
+      if holding then
+         -- the trainer is done with the previous batch: its slot is free
+         consumed = consumed + 1
+         holding = false
+      end
+      push()
+      if consumed == nbatch then
+         return
+      end
+      local k = consumed % depth + 1
+      while not ready[k] do
+         threads:dojob()
+         push()
+      end
+      holding = true
+      local offset = consumed*bs + 1
+      local n = math.min(bs, self.nsample - offset + 1)
+      local batch = self.slots[k]
+      if n < bs then
+         batch = narrowbatch(batch, 1, n)
+      end
+      return batch, n, perm:narrow(1, offset, n)
+   end
+end
+
+function DataLoader:terminate()
+   if self.threads then
+      self.threads:terminate()
+      self.threads = nil
+   end
+end
+
+return DataLoader_ctor
@@ -0,0 +1,248 @@
+local Threads = require 'threads.threads'
+
+local DataParallel = {}
+local DataParallel_ctor = {}
+setmetatable(
+   DataParallel_ctor, {
+      __newindex = DataParallel,
+      __index = DataParallel,
+      __call =
+         function(self, ...)
+            return DataParallel.new(...)
+         end
+   }
+)
+
+DataParallel.__index = DataParallel
+
+-- gradient chunks handed to each thread during the all-reduce are aligned
+-- on this many elements, such that two threads never write the same cache line
+DataParallel.chunkalign = 16
+
+-- split n examples in N shards, sizes differing at most by one
+local function shards(n, N)
+   local res = {}
+   local offset = 1
+   for i=1,N do
+      local sz = math.floor(n/N) + ((i <= n % N) and 1 or 0)
+      res[i] = {offset, sz}
+      offset = offset + sz
+   end
+   return res
+end
+
+-- split a gradient vector of size n in N aligned chunks
+local function chunks(n, N, align)
+   local res = {}
+   local chunksz = math.ceil(math.ceil(n/N)/align)*align
+   for i=1,N do
+      local offset = (i-1)*chunksz+1
+      local sz = math.max(0, math.min(chunksz, n-offset+1))
+      res[i] = {offset, sz}
+   end
+   return res
+end
+
+-- narrow a tensor (or a table of tensors) along the batch dimension
+local function narrowbatch(x, offset, sz)
+   if type(x) == 'table' then
+      local res = {}
+      for k,v in pairs(x) do
+         res[k] = narrowbatch(v, offset, sz)
+      end
+      return res
+   else
+      return x:narrow(1, offset, sz)
+   end
+end
+
+local function batchsize(x)
+   if type(x) == 'table' then
+      local _, v = next(x)
+      assert(v, 'non-empty table of tensors expected')
+      return batchsize(v)
+   else
+      return x:size(1)
+   end
+end
+
+function DataParallel.new(N, model, criterion, ...)
+   require 'torch'
+   assert(type(N) == 'number' and N >= 1, 'number of threads expected')
+   assert(model and model.parameters, 'nn module expected')
+   assert(criterion and criterion.forward, 'nn criterion expected')
+
+   local self = {N=N, model=model, criterion=criterion}
+   setmetatable(self, DataParallel)
+
+   -- master parameters: all replicas point on these weights, and the
+   -- gradients of the first replica are accumulated in place in gradParams
+   local params, gradParams = model:getParameters()
+   self.params = params
+   self.gradParams = gradParams
+
+   local gradbuffers = {gradParams}
+   for i=2,N do
+      gradbuffers[i] = gradParams:clone():zero()
+   end
+   self.gradbuffers = gradbuffers
+   self.chunks = chunks(gradParams:nElement(), N, DataParallel.chunkalign)
+
+   local _unpack = unpack or table.unpack
+   local funcs = {
+      function()
+         require 'nn'
+      end,
+      function()
+         -- avoid fighting for cores with the OpenMP pool of each thread
+         torch.setnumthreads(1)
+      end,
+      ...
+   }
+   table.insert(
+      funcs,
+      function(threadid)
+         local gradbuffer = gradbuffers[threadid]
+
+         -- the model upvalue shares its storages with the master model:
+         -- clone it, then share back weights and map gradients on our buffer
+         local replica = model:clone()
+         local mw, mg = model:parameters()
+         local rw, rg = replica:parameters()
+         for i=1,#rw do
+            rw[i]:set(mw[i])
+            rg[i]:set(gradbuffer:storage(), mg[i]:storageOffset(), mg[i]:size(), mg[i]:stride())
+         end
+
+         __dataparallel = {
+            replica = replica,
+            criterion = criterion:clone(),
+            gradbuffer = gradbuffer
+         }
+      end
+   )
+
+   local serialization = Threads.serialization()
+   Threads.serialization('threads.sharedserialize')
+   local status, threads = pcall(Threads, N, _unpack(funcs))
+   Threads.serialization(serialization)
+   if not status then
+      error(threads)
+   end
+
+   threads:specific(true)
+   self.threads = threads
+
+   return self
+end
+
+function DataParallel:training()
+   self.model:training()
+   self:apply(
+      function(state)
+         state.replica:training()
+      end
+   )
+end
+
+function DataParallel:evaluate()
+   self.model:evaluate()
+   self:apply(
+      function(state)
+         state.replica:evaluate()
+      end
+   )
+end
+
+-- run func(state, threadid) on each replica thread, and wait
+function DataParallel:apply(func)
+   for i=1,self.N do
+      self.threads:addjob(
+         i,
+         function()
+            func(__dataparallel, __threadid)
+         end
+      )
+   end
+   self.threads:synchronize()
+end
+
+function DataParallel:parameters()
+   return self.params, self.gradParams
+end
+
+-- forward/backward the batch (split over the replicas), and all-reduce
+-- the gradients in gradParams (which is overwritten)
+-- returns the loss, as computed by the criterion on the full batch
+function DataParallel:forwardBackward(input, target)
+   local N = self.N
+   local n = batchsize(input)
+   assert(n >= N, string.format('batch size (%d) must be >= number of threads (%d)', n, N))
+
+   local shardsz = shards(n, N)
+   local loss = 0
+   for i=1,N do
+      local offset, sz = shardsz[i][1], shardsz[i][2]
+      self.threads:addjob(
+         i,
+         function(input, target)
+            local state = __dataparallel
+            local replica, criterion = state.replica, state.criterion
+            state.gradbuffer:zero()
+            local output = replica:forward(input)
+            local shardloss = criterion:forward(output, target)
+            local gradOutput = criterion:backward(output, target)
+            -- criterion averages over the shard: rescale to the full batch
+            local scale = criterion.sizeAverage == false and 1 or sz/n
+            replica:backward(input, gradOutput, scale)
+            return shardloss*scale
+         end,
+         function(shardloss)
+            loss = loss + shardloss
+         end,
+         narrowbatch(input, offset, sz),
+         narrowbatch(target, offset, sz)
+      )
+   end
+   self.threads:synchronize()
+
+   self:allReduce()
+
+   return loss
+end
+
+-- sum replica gradients in gradParams
+-- thread i reduces chunk i over all replicas (reduce-scatter). As all
+-- replicas live in the same host memory, the all-gather simply amounts to
+-- reading the reduced gradParams (which the first replica owns).
+function DataParallel:allReduce()
+   local N = self.N
+   if N == 1 then
+      return
+   end
+   local gradbuffers = self.gradbuffers
+   for i=1,N do
+      local offset, sz = self.chunks[i][1], self.chunks[i][2]
+      if sz > 0 then
+         self.threads:addjob(
+            i,
+            function()
+               local dst = gradbuffers[1]:narrow(1, offset, sz)
+               for j=2,#gradbuffers do
+                  dst:add(gradbuffers[j]:narrow(1, offset, sz))
+               end
+            end
+         )
+      end
+   end
+   self.threads:synchronize()
+end
+
+function DataParallel:terminate()
+   if self.threads then
+      self.threads:terminate()
+      self.threads = nil
+   end
+end
+
+return DataParallel_ctor
@@ -0,0 +1,153 @@
+local Threads = require 'threads.threads'
+
+local Hogwild = {}
+local Hogwild_ctor = {}
+setmetatable(
+   Hogwild_ctor, {
+      __newindex = Hogwild,
+      __index = Hogwild,
+      __call =
+         function(self, ...)
+            return Hogwild.new(...)
+         end
+   }
+)
+
+Hogwild.__index = Hogwild
+
+-- sparse in-place updaters, per module type: updater(module, input,
+-- gradOutput, lr, atomic) must add -lr*gradient to the module weights, which
+-- are shared by all workers. Other modules use accUpdateGradParameters().
+Hogwild.updaters = {}
+
+Hogwild.updaters['nn.LookupTable'] =
+   function(self, input, gradOutput, lr, atomic)
+      assert(not self.shouldScaleGradByFreq, 'Hogwild: scaleGradByFreq is not supported')
+      input = self.copiedInput and self._input or input
+      local index = input:view(-1)
+      local dim = self.weight:size(2)
+      local C = require 'libthreads'
+      C.hogwild.indexAdd(self.weight, index, gradOutput:contiguous():view(-1, dim),
+                         -lr, atomic, self.paddingValue or 0)
+   end
+
+function Hogwild.new(N, model, criterion, config, ...)
+   require 'torch'
+   assert(type(N) == 'number' and N >= 1, 'number of threads expected')
+   assert(model and model.parameters, 'nn module expected')
+   assert(criterion and criterion.forward, 'nn criterion expected')
+   config = config or {}
+
+   local self = {
+      N = N,
+      model = model,
+      criterion = criterion,
+      learningRate = config.learningRate or 1e-2,
+      atomic = (config.atomic ~= false),
+      loss = 0,
+      nbatch = 0
+   }
+   setmetatable(self, Hogwild)
+
+   local atomic = self.atomic
+   local updaters = Hogwild.updaters
+
+   local _unpack = unpack or table.unpack
+   local funcs = {
+      function()
+         require 'nn'
+      end,
+      function()
+         -- workers are the parallelism: one core each
+         torch.setnumthreads(1)
+      end,
+      ...
+   }
+   table.insert(
+      funcs,
+      function()
+         -- the model upvalue shares its storages with the master model:
+         -- clone it (for private buffers), then share back the weights
+         local replica = model:clone()
+         local mw = model:parameters()
+         local rw = replica:parameters()
+         for i=1,#rw do
+            rw[i]:set(mw[i])
+         end
+
+         -- sparse modules update their rows in place
+         for _,m in ipairs(replica:listModules()) do
+            local updater = updaters[torch.typename(m)]
+            if updater then
+               m.accUpdateGradParameters =
+                  function(self, input, gradOutput, lr)
+                     updater(self, input, gradOutput, lr, atomic)
+                  end
+            end
+         end
+
+         __hogwild = {
+            replica = replica,
+            criterion = criterion:clone()
+         }
+      end
+   )
+
+   local serialization = Threads.serialization()
+   Threads.serialization('threads.sharedserialize')
+   local status, threads = pcall(Threads, N, _unpack(funcs))
+   Threads.serialization(serialization)
+   if not status then
+      error(threads)
+   end
+   self.threads = threads
+
+   return self
+end
+
+function Hogwild:setLearningRate(lr)
+   self.learningRate = lr
+end
+
+-- queue a SGD step on (input, target), and return immediately
+-- the step runs on the first free worker, which writes the shared weights
+-- without waiting for the others
+function Hogwild:addbatch(input, target)
+   local lr = self.learningRate
+   self.threads:addjob(
+      function(input, target)
+         local state = __hogwild
+         local replica, criterion = state.replica, state.criterion
+         local output = replica:forward(input)
+         local loss = criterion:forward(output, target)
+         local gradOutput = criterion:backward(output, target)
+         replica:updateGradInput(input, gradOutput)
+         replica:accUpdateGradParameters(input, gradOutput, lr)
+         return loss
+      end,
+      function(loss)
+         self.loss = self.loss + loss
+         self.nbatch = self.nbatch + 1
+      end,
+      input,
+      target
+   )
+end
+
+-- wait for all queued steps, and return their average loss
+function Hogwild:synchronize()
+   self.threads:synchronize()
+   local loss = self.nbatch > 0 and self.loss/self.nbatch or 0
+   self.loss = 0
+   self.nbatch = 0
+   return loss
+end
+
+function Hogwild:terminate()
+   if self.threads then
+      self.threads:terminate()
+      self.threads = nil
+   end
+end
+
+return Hogwild_ctor
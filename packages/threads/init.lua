@@ -7,6 +7,9 @@ threads.Mutex = C.Mutex
 threads.Condition = C.Condition
 threads.Threads = require 'threads.threads'
 threads.safe = require 'threads.safe'
+threads.DataParallel = require 'threads.dataparallel'
+threads.Hogwild = require 'threads.hogwild'
+threads.DataLoader = require 'threads.dataloader'
 
 -- only for backward compatibility (boo)
 setmetatable(threads, getmetatable(threads.Threads))
@@ -0,0 +1,104 @@
+#include "TH.h"
+#include "luaT.h"
+#include <lua.h>
+#include <lauxlib.h>
+
+/*
+  Lock-free sparse row updates on (possibly) shared weights:
+    dst[index[i]] += alpha * src[i]
+  Rows equal to the padding index (0 for none) are skipped.
+  In atomic mode, each element is added with a compare-and-swap, such that
+  concurrent updates of the same row are never lost. Otherwise, updates are
+  plain (relaxed) read-modify-writes, as in the original Hogwild scheme.
+*/
+
+#define HOGWILD_CHECK_INDEX(L, dst, index, src)                         \
+  do {                                                                  \
+    long i_, n_;                                                        \
+    long *index_data_;                                                  \
+    luaL_argcheck(L, dst->nDimension == 2, 1, "2D weight expected");    \
+    luaL_argcheck(L, index->nDimension == 1, 2, "1D index expected");   \
+    luaL_argcheck(L, src->nDimension == 2, 3, "2D updates expected");   \
+    luaL_argcheck(L, src->size[0] == index->size[0], 3, "one update row per index expected"); \
+    luaL_argcheck(L, src->size[1] == dst->size[1], 3, "update rows do not match weight rows"); \
+    n_ = index->size[0];                                                \
+    index_data_ = THLongTensor_data(index);                             \
+    for(i_ = 0; i_ < n_; i_++) {                                        \
+      long row_ = index_data_[i_*index->stride[0]] - TH_INDEX_BASE;     \
+      if(row_ < 0 || row_ >= dst->size[0])                              \
+        luaL_error(L, "index out of range");                            \
+    }                                                                   \
+  } while(0)
+
+#define HOGWILD_INDEXADD(NAME, TYPE, REAL, ADD)                         \
+  static void hogwild_indexadd_##NAME(TH##TYPE##Tensor *dst, THLongTensor *index, TH##TYPE##Tensor *src, REAL alpha, long padding) \
+  {                                                                     \
+    long n = index->size[0];                                            \
+    long ncol = dst->size[1];                                           \
+    long *index_data = THLongTensor_data(index);                        \
+    REAL *dst_data = TH##TYPE##Tensor_data(dst);                        \
+    REAL *src_data = TH##TYPE##Tensor_data(src);                        \
+    long i, j;                                                          \
+    for(i = 0; i < n; i++) {                                            \
+      long idx = index_data[i*index->stride[0]];                        \
+      REAL *d, *s;                                                      \
+      if(idx == padding)                                                \
+        continue;                                                       \
+      d = dst_data + (idx - TH_INDEX_BASE)*dst->stride[0];              \
+      s = src_data + i*src->stride[0];                                  \
+      for(j = 0; j < ncol; j++) {                                       \
+        ADD(d + j*dst->stride[1], alpha * s[j*src->stride[1]]);         \
+      }                                                                 \
+    }                                                                   \
+  }
+
+#define HOGWILD_RELAXED_ADD(ptr, value) (*(ptr) += (value))
+#define HOGWILD_ATOMIC_ADD(ptr, value) THAtomicAddFloat((ptr), (value))
+
+HOGWILD_INDEXADD(Float, Float, float, HOGWILD_RELAXED_ADD)
+HOGWILD_INDEXADD(FloatAtomic, Float, float, HOGWILD_ATOMIC_ADD)
+HOGWILD_INDEXADD(Double, Double, double, HOGWILD_RELAXED_ADD)
+
+/* indexAdd(dst, index, src, alpha, [atomic], [padding]) */
+static int hogwild_indexadd(lua_State *L)
+{
+  THLongTensor *index = luaT_checkudata(L, 2, "torch.LongTensor");
+  double alpha = luaL_checknumber(L, 4);
+  int atomic = lua_toboolean(L, 5);
+  long padding = (long)luaL_optnumber(L, 6, 0);
+  THFloatTensor *fdst, *fsrc;
+  THDoubleTensor *ddst, *dsrc;
+
+  if((fdst = luaT_toudata(L, 1, "torch.FloatTensor"))) {
+    fsrc = luaT_checkudata(L, 3, "torch.FloatTensor");
+    HOGWILD_CHECK_INDEX(L, fdst, index, fsrc);
+    if(atomic)
+      hogwild_indexadd_FloatAtomic(fdst, index, fsrc, (float)alpha, padding);
+    else
+      hogwild_indexadd_Float(fdst, index, fsrc, (float)alpha, padding);
+  }
+  else if((ddst = luaT_toudata(L, 1, "torch.DoubleTensor"))) {
+    dsrc = luaT_checkudata(L, 3, "torch.DoubleTensor");
+    HOGWILD_CHECK_INDEX(L, ddst, index, dsrc);
+    if(atomic)
+      luaL_error(L, "atomic updates are only supported on torch.FloatTensor");
+    hogwild_indexadd_Double(ddst, index, dsrc, alpha, padding);
+  }
+  else
+    luaL_error(L, "torch.FloatTensor or torch.DoubleTensor expected");
+
+  return 0;
+}
+
+static const struct luaL_Reg hogwild__ [] = {
+  {"indexAdd", hogwild_indexadd},
+  {NULL, NULL}
+};
+
+static void hogwild_init_pkg(lua_State *L)
+{
+  lua_pushstring(L, "hogwild");
+  lua_newtable(L);
+  luaL_setfuncs(L, hogwild__, 0);
+  lua_rawset(L, -3);
+}
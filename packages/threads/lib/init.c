@@ -26,6 +26,7 @@ static void luaL_setfuncs(lua_State *L, const luaL_Reg *l, int nup)
 
 #include "threads.c"
 #include "queue.c"
+#include "hogwild.c"
 
 #if defined(_WIN32)
 __declspec(dllexport) int _cdecl luaopen_libthreads(lua_State *L)
@@ -36,5 +37,6 @@ int luaopen_libthreads(lua_State *L)
   lua_newtable(L);
   thread_init_pkg(L);
   queue_init_pkg(L);
+  hogwild_init_pkg(L);
   return 1;
 }
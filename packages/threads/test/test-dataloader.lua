@@ -0,0 +1,110 @@
+require 'torch'
+local threads = require 'threads'
+
+torch.setdefaulttensortype('torch.FloatTensor')
+torch.manualSeed(1234)
+
+local nsample = 103 -- not divisible by the batch size on purpose
+local batchSize = 10
+local data = torch.randn(nsample, 3, 4)
+
+local function loader(nthread, config)
+   config = config or {}
+   config.size = nsample
+   config.batchSize = batchSize
+   config.allocate =
+      function(bs)
+         return {input = torch.FloatTensor(bs, 3, 4), target = torch.LongTensor(bs)}
+      end
+   config.fill =
+      function(batch, i, index)
+         batch.input[i]:copy(data[index])
+         batch.target[i] = index
+      end
+   return threads.DataLoader(nthread, config)
+end
+
+-- an epoch visits every sample once, in batches filled in place
+local function epoch(dl, e)
+   local order = {}
+   local seen = {}
+   for batch, n, indices in dl:run(e) do
+      assert(batch.input:size(1) == n and batch.target:size(1) == n, 'wrong batch size')
+      assert(n == batchSize or #order + n == nsample, 'partial batch before the end of the epoch')
+      for i=1,n do
+         local index = batch.target[i]
+         assert(indices[i] == index, 'indices do not match the batch')
+         assert(not seen[index], 'sample seen twice')
+         assert(batch.input[i]:equal(data[index]), 'wrong sample')
+         seen[index] = true
+         table.insert(order, index)
+      end
+   end
+   assert(#order == nsample, 'missing samples')
+   return order
+end
+
+local function sameorder(a, b)
+   for i=1,#a do
+      if a[i] ~= b[i] then
+         return false
+      end
+   end
+   return #a == #b
+end
+
+-- the order only depends on the seed and the epoch
+local dl1 = loader(1, {seed=7})
+local dl4 = loader(4, {seed=7, depth=3})
+assert(dl1:size() == 11)
+local o1 = epoch(dl1)
+local o2 = epoch(dl1)
+assert(not sameorder(o1, o2), 'epochs should be shuffled differently')
+assert(sameorder(o1, epoch(dl4)), 'order depends on the number of threads')
+assert(sameorder(o2, epoch(dl4)), 'order depends on the number of threads')
+assert(sameorder(o1, epoch(dl4, 1)), 'epochs can be replayed')
+
+-- leaving an epoch early
+for batch, n in dl4:run() do
+   break
+end
+epoch(dl4)
+dl1:terminate()
+dl4:terminate()
+
+-- no shuffle, last partial batch dropped, fillbatch and per-thread data
+local dl = threads.DataLoader(
+   2, {
+      size = nsample,
+      batchSize = batchSize,
+      shuffle = false,
+      droplast = true,
+      allocate =
+         function(bs)
+            return torch.LongTensor(bs, 2)
+         end,
+      init =
+         function(threadid)
+            return {threadid = threadid}
+         end,
+      fillbatch =
+         function(batch, indices, state)
+            batch:select(2, 1):copy(indices)
+            batch:select(2, 2):fill(state.threadid)
+         end
+   }
+)
+assert(dl:size() == 10)
+local nbatch = 0
+for batch, n, indices in dl:run() do
+   nbatch = nbatch + 1
+   assert(n == batchSize)
+   assert(batch:select(2, 1):equal(torch.range(1, batchSize):long():add((nbatch-1)*batchSize)),
+          'samples should be in order')
+   local threadid = batch[1][2]
+   assert(threadid >= 1 and threadid <= 2, 'wrong thread data')
+end
+assert(nbatch == 10)
+dl:terminate()
+
+print('PASSED')
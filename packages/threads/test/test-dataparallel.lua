@@ -0,0 +1,51 @@
+require 'nn'
+local threads = require 'threads'
+
+torch.setdefaulttensortype('torch.DoubleTensor')
+torch.manualSeed(1234)
+
+local nthread = 4
+local nex = 37 -- not divisible by nthread on purpose
+local ninput = 10
+local nclass = 5
+
+local model = nn.Sequential()
+model:add(nn.Linear(ninput, 20))
+model:add(nn.Tanh())
+model:add(nn.Linear(20, nclass))
+model:add(nn.LogSoftMax())
+local criterion = nn.ClassNLLCriterion()
+
+local input = torch.randn(nex, ninput)
+local target = torch.LongTensor(nex):random(nclass)
+
+-- reference: plain forward/backward on the full batch
+local ref = model:clone()
+local refparams, refgradParams = ref:getParameters()
+refgradParams:zero()
+local refloss = criterion:forward(ref:forward(input), target)
+ref:backward(input, criterion:backward(ref.output, target))
+
+local dpt = threads.DataParallel(nthread, model, criterion)
+local params, gradParams = dpt:parameters()
+assert(params:nElement() == refparams:nElement())
+
+for iter=1,3 do
+   local loss = dpt:forwardBackward(input, target)
+   assert(math.abs(loss - refloss) < 1e-10, 'loss mismatch')
+   assert((gradParams - refgradParams):abs():max() < 1e-10, 'gradient mismatch')
+end
+
+-- weights are shared: an update in the main thread is seen by all replicas
+params:add(-0.1, gradParams)
+refparams:add(-0.1, refgradParams)
+refgradParams:zero()
+refloss = criterion:forward(ref:forward(input), target)
+ref:backward(input, criterion:backward(ref.output, target))
+local loss = dpt:forwardBackward(input, target)
+assert(math.abs(loss - refloss) < 1e-10, 'loss mismatch after update')
+assert((gradParams - refgradParams):abs():max() < 1e-10, 'gradient mismatch after update')
+
+dpt:terminate()
+
+print('PASSED')
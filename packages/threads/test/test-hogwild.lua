@@ -0,0 +1,76 @@
+require 'nn'
+local threads = require 'threads'
+
+torch.setdefaulttensortype('torch.FloatTensor')
+torch.manualSeed(1234)
+
+local C = require 'libthreads'
+
+-- indexAdd matches torch indexAdd (repeated rows included)
+local dst = torch.randn(10, 3)
+local index = torch.LongTensor{3, 1, 3, 10}
+local src = torch.randn(4, 3)
+local ref = dst:clone()
+ref:indexAdd(1, index, src:clone():mul(-0.5)) -- (returns src)
+C.hogwild.indexAdd(dst, index, src, -0.5, true)
+assert((dst - ref):abs():max() < 1e-6, 'atomic indexAdd mismatch')
+
+-- padding rows are skipped
+dst = torch.zeros(4, 2)
+C.hogwild.indexAdd(dst, torch.LongTensor{1, 2}, torch.ones(2, 2), 1, false, 2)
+assert(dst[1][1] == 1 and dst[2][1] == 0, 'padding row should be skipped')
+
+-- concurrent atomic updates of the same rows are never lost
+local nthread = 4
+local nstep = 2000
+local shared = torch.zeros(2, 5)
+threads.Threads.serialization('threads.sharedserialize')
+local pool = threads.Threads(nthread, function() require 'torch' end)
+for t=1,nthread do
+   pool:addjob(
+      function()
+         local C = require 'libthreads'
+         local index = torch.LongTensor{1, 2, 1}
+         local ones = torch.FloatTensor(3, 5):fill(1) -- (workers default to double)
+         for i=1,nstep do
+            C.hogwild.indexAdd(shared, index, ones, 1, true)
+         end
+      end
+   )
+end
+pool:synchronize()
+pool:terminate()
+assert(shared:select(1, 1):eq(2*nthread*nstep):all(), 'lost atomic updates')
+assert(shared:select(1, 2):eq(nthread*nstep):all(), 'lost atomic updates')
+
+-- Hogwild training of a sparse logistic regression converges, and the
+-- master model sees the updates
+local nfeature = 100
+local nex = 512
+local truth = torch.randn(nfeature):mul(3)
+local input = torch.LongTensor(nex, 4):random(nfeature)
+local target = truth:index(1, input:view(-1)):view(nex, 4):sum(2):gt(0):float()
+
+local model = nn.Sequential()
+model:add(nn.LookupTable(nfeature, 1))
+model:add(nn.Sum(2))
+model:add(nn.Sigmoid())
+model.modules[1].weight:zero()
+local criterion = nn.BCECriterion()
+local initloss = criterion:forward(model:forward(input), target)
+
+for _,atomic in ipairs{true, false} do
+   model.modules[1].weight:zero()
+   local hogwild = threads.Hogwild(nthread, model, criterion, {learningRate=0.5, atomic=atomic})
+   for epoch=1,20 do
+      for i=1,nex,16 do
+         hogwild:addbatch(input:narrow(1, i, 16), target:narrow(1, i, 16))
+      end
+      hogwild:synchronize()
+   end
+   hogwild:terminate()
+   local loss = criterion:forward(model:forward(input), target)
+   assert(loss < 0.5*initloss, string.format('no convergence (%g -> %g)', initloss, loss))
+end
+
+print('PASSED')
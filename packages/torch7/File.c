@@ -129,6 +129,85 @@ IMPLEMENT_TORCH_FILE_RW(Long, long)
 IMPLEMENT_TORCH_FILE_RW(Float, float)
 IMPLEMENT_TORCH_FILE_RW(Double, double)
 
+/* half on file, float in memory (converted with the THVector kernels) */
+static int torch_File_readHalfAsFloat(lua_State *L)
+{
+  THFile *self = luaT_checkudata(L, 1, "torch.File");
+  int narg = lua_gettop(L);
+
+  if(narg == 2)
+  {
+    if(lua_isnumber(L, 2))
+    {
+      ptrdiff_t size = lua_tonumber(L, 2);
+      ptrdiff_t nread;
+
+      THFloatStorage *storage = THFloatStorage_newWithSize(size);
+      luaT_pushudata(L, storage, "torch.FloatStorage");
+      nread = THFile_readHalfAsFloat(self, storage);
+      if(nread != size)
+        THFloatStorage_resize(storage, nread);
+      return 1;
+    }
+    else if(luaT_toudata(L, 2, "torch.FloatStorage"))
+    {
+      THFloatStorage *storage = luaT_toudata(L, 2, "torch.FloatStorage");
+      lua_pushnumber(L, THFile_readHalfAsFloat(self, storage));
+      return 1;
+    }
+  }
+
+  luaL_error(L, "number, or FloatStorage expected");
+  return 0;
+}
+
+static int torch_File_writeFloatAsHalf(lua_State *L)
+{
+  THFile *self = luaT_checkudata(L, 1, "torch.File");
+  THFloatStorage *storage = luaT_checkudata(L, 2, "torch.FloatStorage");
+  lua_pushnumber(L, THFile_writeFloatAsHalf(self, storage));
+  return 1;
+}
+
+static int torch_File_readBFloat16AsFloat(lua_State *L)
+{
+  THFile *self = luaT_checkudata(L, 1, "torch.File");
+  int narg = lua_gettop(L);
+
+  if(narg == 2)
+  {
+    if(lua_isnumber(L, 2))
+    {
+      ptrdiff_t size = lua_tonumber(L, 2);
+      ptrdiff_t nread;
+
+      THFloatStorage *storage = THFloatStorage_newWithSize(size);
+      luaT_pushudata(L, storage, "torch.FloatStorage");
+      nread = THFile_readBFloat16AsFloat(self, storage);
+      if(nread != size)
+        THFloatStorage_resize(storage, nread);
+      return 1;
+    }
+    else if(luaT_toudata(L, 2, "torch.FloatStorage"))
+    {
+      THFloatStorage *storage = luaT_toudata(L, 2, "torch.FloatStorage");
+      lua_pushnumber(L, THFile_readBFloat16AsFloat(self, storage));
+      return 1;
+    }
+  }
+
+  luaL_error(L, "number, or FloatStorage expected");
+  return 0;
+}
+
+static int torch_File_writeFloatAsBFloat16(lua_State *L)
+{
+  THFile *self = luaT_checkudata(L, 1, "torch.File");
+  THFloatStorage *storage = luaT_checkudata(L, 2, "torch.FloatStorage");
+  lua_pushnumber(L, THFile_writeFloatAsBFloat16(self, storage));
+  return 1;
+}
+
 static int torch_File_readString(lua_State *L)
 {
   THFile *self = luaT_checkudata(L, 1, "torch.File");
@@ -179,6 +258,8 @@ static const struct luaL_Reg torch_File__ [] = {
   {"readLong", torch_File_readLong},
   {"readFloat", torch_File_readFloat},
   {"readDouble", torch_File_readDouble},
+  {"readHalfAsFloat", torch_File_readHalfAsFloat},
+  {"readBFloat16AsFloat", torch_File_readBFloat16AsFloat},
   {"readString", torch_File_readString},
 
   {"writeByte", torch_File_writeByte},
@@ -188,6 +269,8 @@ static const struct luaL_Reg torch_File__ [] = {
   {"writeLong", torch_File_writeLong},
   {"writeFloat", torch_File_writeFloat},
   {"writeDouble", torch_File_writeDouble},
+  {"writeFloatAsHalf", torch_File_writeFloatAsHalf},
+  {"writeFloatAsBFloat16", torch_File_writeFloatAsBFloat16},
   {"writeString", torch_File_writeString},
 
   {"synchronize", torch_File_synchronize},
@@ -7,6 +7,19 @@ int torch_Generator_new(lua_State *L)
   return 1;
 }
 
+/* torch.Generator([kind]): kind is 'mt' (default) or 'philox' */
+static int torch_Generator_construct(lua_State *L)
+{
+  static const char *kinds[] = {"mt", "philox", NULL};
+  THGenerator *gen;
+  if (luaL_checkoption(L, 1, "mt", kinds) == 1)
+    gen = THGenerator_newPhilox();
+  else
+    gen = THGenerator_new();
+  luaT_pushudata(L, gen, torch_Generator);
+  return 1;
+}
+
 int torch_Generator_free(lua_State *L)
 {
   THGenerator *gen= luaT_checkudata(L, 1, torch_Generator);
@@ -28,7 +41,18 @@ static int torch_Generator_read(lua_State *L)
   THGenerator *gen = luaT_checkudata(L, 1, torch_Generator);
   THFile *file = luaT_checkudata(L, 2, "torch.File");
 
-  THFile_readByteRaw(file, (unsigned char *)gen, sizeof(THGenerator));
+  int version = luaL_optint(L, 3, 0);
+
+  /* version 1 files hold the Mersenne Twister state only */
+  if (version < 2)
+  {
+    THGenerator state;
+    size_t size = THGenerator_mtStateSize();
+    THFile_readByteRaw(file, (unsigned char *)&state, size);
+    THGenerator_copyState(gen, &state, size);
+  }
+  else
+    THFile_readByteRaw(file, (unsigned char *)gen, sizeof(THGenerator));
   return 0;
 }
 
@@ -44,7 +68,10 @@ static const struct luaL_Reg torch_Generator_table_ [] = {
 void torch_Generator_init(lua_State *L)
 {
   luaT_newmetatable(L, torch_Generator, NULL,
-                    torch_Generator_new, torch_Generator_free, torch_Generator_factory);
+                    torch_Generator_construct, torch_Generator_free, torch_Generator_factory);
   luaT_setfuncs(L, torch_Generator_table_, 0);
+  /* version 2: with the Philox fields */
+  lua_pushinteger(L, 2);
+  lua_setfield(L, -2, "__version");
   lua_pop(L, 1);
 }
@@ -265,6 +265,13 @@ for _,Tensor in ipairs({"ByteTensor", "CharTensor",
          {name="IndexTensor", noreadadd=true},
          {name=real}})
 
+   wrap("scatterAdd",
+        cname("scatterAdd"),
+        {{name=Tensor, returned=true},
+         {name="index"},
+         {name="IndexTensor", noreadadd=true},
+         {name=Tensor}})
+
    wrap("dot",
         cname("dot"),
         {{name=Tensor},
@@ -609,6 +616,15 @@ for _,Tensor in ipairs({"ByteTensor", "CharTensor",
             {name="index", default=1}})
    end
 
+   for _,name in ipairs({"cummax", "cummin"}) do
+      wrap(name,
+           cname(name),
+           {{name=Tensor, default=true, returned=true},
+            {name="IndexTensor", default=true, returned=true, noreadadd=true},
+            {name=Tensor},
+            {name="index", default=1}})
+   end
+
    wrap("sum",
         cname("sumall"),
         {{name=Tensor},
@@ -1106,6 +1122,12 @@ static void THTensor_random1__(THTensor *self, THGenerator *gen, long b)
                {name="boolean", default=false},
                {name="boolean", default=true, invisible=true}})
       end
+      wrap("logcumsumexp",
+           cname("logcumsumexp"),
+           {{name=Tensor, default=true, returned=true},
+            {name=Tensor},
+            {name="index", default=1}})
+
       wrap("histc",
            cname("histc"),
            {{name=Tensor, default=true, returned=true},
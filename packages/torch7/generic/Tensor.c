@@ -1296,6 +1296,42 @@ static int torch_Tensor_(read)(lua_State *L)
   return 0;
 }
 
+#if defined(TH_REAL_IS_FLOAT)
+/* r:addmmBFloat16(beta, t, alpha, m1, m2): addmm with m1 and m2 rounded to
+   bfloat16 (and float accumulation), as THFloatTensor_addmmBFloat16 */
+static int torch_Tensor_(addmmBFloat16)(lua_State *L)
+{
+  THTensor *r = luaT_checkudata(L, 1, torch_Tensor);
+  real beta = luaL_checknumber(L, 2);
+  THTensor *t = luaT_checkudata(L, 3, torch_Tensor);
+  real alpha = luaL_checknumber(L, 4);
+  THTensor *m1 = luaT_checkudata(L, 5, torch_Tensor);
+  THTensor *m2 = luaT_checkudata(L, 6, torch_Tensor);
+  THBFloat16Tensor *b1, *b2;
+
+  /* checked before the conversion, which an error would leak */
+  THArgCheck(m1->nDimension == 2, 5, "matrix expected, got %dD tensor", m1->nDimension);
+  THArgCheck(m2->nDimension == 2, 6, "matrix expected, got %dD tensor", m2->nDimension);
+  THArgCheck(m1->size[1] == m2->size[0], 6, "size mismatch, m1: %ldx%ld, m2: %ldx%ld",
+             m1->size[0], m1->size[1], m2->size[0], m2->size[1]);
+  THArgCheck(t->nDimension == 2 && t->size[0] == m1->size[0] && t->size[1] == m2->size[1], 3,
+             "%ldx%ld matrix expected", m1->size[0], m2->size[1]);
+
+  b1 = THBFloat16Tensor_new();
+  b2 = THBFloat16Tensor_new();
+  THBFloat16Tensor_resizeNd(b1, m1->nDimension, m1->size, NULL);
+  THBFloat16Tensor_copyFloat(b1, m1);
+  THBFloat16Tensor_resizeNd(b2, m2->nDimension, m2->size, NULL);
+  THBFloat16Tensor_copyFloat(b2, m2);
+  THTensor_(addmmBFloat16)(r, beta, t, alpha, b1, b2);
+  THBFloat16Tensor_free(b1);
+  THBFloat16Tensor_free(b2);
+
+  lua_settop(L, 1);
+  return 1;
+}
+#endif
+
 static const struct luaL_Reg torch_Tensor_(_) [] = {
   {"retain", torch_Tensor_(retain)},
   {"free", torch_Tensor_(free)},
@@ -1334,6 +1370,9 @@ static const struct luaL_Reg torch_Tensor_(_) [] = {
   {"isSize", torch_Tensor_(isSize)},
   {"nElement", torch_Tensor_(nElement)},
   {"copy", torch_Tensor_(copy)},
+#if defined(TH_REAL_IS_FLOAT)
+  {"addmmBFloat16", torch_Tensor_(addmmBFloat16)},
+#endif
 #ifndef TH_REAL_IS_HALF
   {"apply", torch_Tensor_(apply)},
   {"map", torch_Tensor_(map)},
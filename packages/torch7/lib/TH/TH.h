@@ -4,6 +4,7 @@
 #include "THGeneral.h"
 
 #include "THBlas.h"
+#include "THFFT.h"
 #ifdef USE_LAPACK
 #include "THLapack.h"
 #endif
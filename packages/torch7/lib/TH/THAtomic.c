@@ -265,3 +265,16 @@ ptrdiff_t THAtomicCompareAndSwapPtrdiff(ptrdiff_t volatile *a, ptrdiff_t oldvalu
     return 0;
 #endif
 }
+
+/* the float is swapped as an int: fails to compile if their sizes differ */
+typedef char THAtomicAddFloat_int_is_float_sized[sizeof(float) == sizeof(int) ? 1 : -1];
+
+float THAtomicAddFloat(float volatile *a, float value)
+{
+  union { float f; int i; } oldvalue, newvalue;
+  do {
+    oldvalue.f = *a;
+    newvalue.f = oldvalue.f + value;
+  } while (!THAtomicCompareAndSwap((int volatile *)a, oldvalue.i, newvalue.i));
+  return oldvalue.f;
+}
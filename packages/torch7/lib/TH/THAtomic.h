@@ -115,6 +115,18 @@ TH_API ptrdiff_t THAtomicAddPtrdiff(ptrdiff_t volatile *a, ptrdiff_t value);
 */
 TH_API ptrdiff_t THAtomicCompareAndSwapPtrdiff(ptrdiff_t volatile *a, ptrdiff_t oldvalue, ptrdiff_t newvalue);
 
+
+
+/******************************************************************************
+ * functions for float type
+ ******************************************************************************/
+
+/*
+ * *a += value (compare-and-swap loop on the bits of *a),
+ * return previous *a
+*/
+TH_API float THAtomicAddFloat(float volatile *a, float value);
+
 #if defined(USE_C11_ATOMICS) && defined(ATOMIC_INT_LOCK_FREE) && \
   ATOMIC_INT_LOCK_FREE == 2
 #define TH_ATOMIC_IPC_REFCOUNT 1
@@ -0,0 +1,96 @@
+#include "THBFloat16.h"
+
+#if defined(USE_SSE2)
+#include <emmintrin.h>
+#endif
+
+#if defined(__NEON__)
+#include <arm_neon.h>
+#endif
+
+static inline unsigned short TH_floatbits2bfloat16bits(uint32_t x)
+{
+  /* NaN: return a quiet NaN (rounding could turn it into Inf) */
+  if((x & 0x7fffffffU) > 0x7f800000U)
+    return 0x7fc0U;
+  /* round to nearest even */
+  return (unsigned short)((x + 0x7fffU + ((x >> 16) & 1U)) >> 16);
+}
+
+THBFloat16 TH_float2bfloat16(float f)
+{
+  THBFloat16 h;
+  uint32_t x;
+  memcpy(&x, &f, sizeof(float));
+  h.x = TH_floatbits2bfloat16bits(x);
+  return h;
+}
+
+float TH_bfloat162float(THBFloat16 h)
+{
+  float f;
+  uint32_t x = ((uint32_t)h.x) << 16;
+  memcpy(&f, &x, sizeof(float));
+  return f;
+}
+
+void TH_float2bfloat16_array(THBFloat16 *dst, const float *src, ptrdiff_t n)
+{
+  ptrdiff_t i = 0;
+#if defined(USE_SSE2)
+  const __m128i one = _mm_set1_epi32(1);
+  const __m128i bias = _mm_set1_epi32(0x7fff);
+  const __m128i absmask = _mm_set1_epi32(0x7fffffff);
+  const __m128i inf = _mm_set1_epi32(0x7f800000);
+  const __m128i qnan = _mm_set1_epi32(0x7fc0);
+  for(; i <= n-8; i += 8) {
+    __m128i x0 = _mm_loadu_si128((const __m128i*)(src+i));
+    __m128i x1 = _mm_loadu_si128((const __m128i*)(src+i+4));
+    __m128i nan0 = _mm_cmpgt_epi32(_mm_and_si128(x0, absmask), inf);
+    __m128i nan1 = _mm_cmpgt_epi32(_mm_and_si128(x1, absmask), inf);
+    __m128i r0 = _mm_add_epi32(x0, _mm_add_epi32(bias, _mm_and_si128(_mm_srli_epi32(x0, 16), one)));
+    __m128i r1 = _mm_add_epi32(x1, _mm_add_epi32(bias, _mm_and_si128(_mm_srli_epi32(x1, 16), one)));
+    /* arithmetic shift: values fit in a signed short, so packs does not saturate */
+    r0 = _mm_srai_epi32(r0, 16);
+    r1 = _mm_srai_epi32(r1, 16);
+    r0 = _mm_or_si128(_mm_andnot_si128(nan0, r0), _mm_and_si128(nan0, qnan));
+    r1 = _mm_or_si128(_mm_andnot_si128(nan1, r1), _mm_and_si128(nan1, qnan));
+    _mm_storeu_si128((__m128i*)(dst+i), _mm_packs_epi32(r0, r1));
+  }
+#elif defined(__NEON__)
+  const uint32x4_t one = vdupq_n_u32(1);
+  const uint32x4_t bias = vdupq_n_u32(0x7fff);
+  const uint32x4_t absmask = vdupq_n_u32(0x7fffffff);
+  const uint32x4_t inf = vdupq_n_u32(0x7f800000);
+  const uint16x4_t qnan = vdup_n_u16(0x7fc0);
+  for(; i <= n-4; i += 4) {
+    uint32x4_t x = vld1q_u32((const uint32_t*)(src+i));
+    uint32x4_t nan = vcgtq_u32(vandq_u32(x, absmask), inf);
+    uint32x4_t r = vaddq_u32(x, vaddq_u32(bias, vandq_u32(vshrq_n_u32(x, 16), one)));
+    uint16x4_t h = vshrn_n_u32(r, 16);
+    vst1_u16((uint16_t*)(dst+i), vbsl_u16(vmovn_u32(nan), qnan, h));
+  }
+#endif
+  for(; i < n; i++)
+    dst[i] = TH_float2bfloat16(src[i]);
+}
+
+void TH_bfloat162float_array(float *dst, const THBFloat16 *src, ptrdiff_t n)
+{
+  ptrdiff_t i = 0;
+#if defined(USE_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  for(; i <= n-8; i += 8) {
+    __m128i h = _mm_loadu_si128((const __m128i*)(src+i));
+    _mm_storeu_si128((__m128i*)(dst+i), _mm_unpacklo_epi16(zero, h));
+    _mm_storeu_si128((__m128i*)(dst+i+4), _mm_unpackhi_epi16(zero, h));
+  }
+#elif defined(__NEON__)
+  for(; i <= n-4; i += 4) {
+    uint16x4_t h = vld1_u16((const uint16_t*)(src+i));
+    vst1q_u32((uint32_t*)(dst+i), vshll_n_u16(h, 16));
+  }
+#endif
+  for(; i < n; i++)
+    dst[i] = TH_bfloat162float(src[i]);
+}
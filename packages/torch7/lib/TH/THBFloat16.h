@@ -0,0 +1,40 @@
+#ifndef TH_BFLOAT16_H
+#define TH_BFLOAT16_H
+
+#include "THGeneral.h"
+#include <stdint.h>
+
+/* bfloat16: the upper half of an IEEE float (1 sign, 8 exponent and 7
+   mantissa bits). It keeps the float range, such that conversions are
+   a matter of shifts and rounding. */
+
+#if defined(__GNUC__)
+#define __thalign__(n) __attribute__((aligned(n)))
+#elif defined(_WIN32)
+#define __thalign__(n) __declspec(align(n))
+#else
+#define __thalign__(n)
+#endif
+
+typedef struct __thalign__(2){
+  unsigned short x;
+} __THBFloat16;
+
+typedef __THBFloat16 THBFloat16;
+
+TH_API THBFloat16 TH_float2bfloat16(float);
+TH_API float TH_bfloat162float(THBFloat16);
+
+/* bulk conversions (SIMD when available) */
+TH_API void TH_float2bfloat16_array(THBFloat16 *dst, const float *src, ptrdiff_t n);
+TH_API void TH_bfloat162float_array(float *dst, const THBFloat16 *src, ptrdiff_t n);
+
+#ifndef TH_BFLOAT16_BITS_TO_LITERAL
+# define TH_BFLOAT16_BITS_TO_LITERAL(n) { n }
+#endif
+
+#define TH_BFLOAT16_ZERO 0x0U
+#define TH_BFLOAT16_INF  0x7F80U
+
+#undef __thalign__
+#endif
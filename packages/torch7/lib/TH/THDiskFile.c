@@ -359,6 +359,10 @@ READ_WRITE_METHODS(THHalf, Half,
                    float buf; int ret = fscanf(dfself->handle, "%g", &buf); if(ret <= 0) break; else { data[i]= TH_float2half(buf); nread++; },
                    int ret = fprintf(dfself->handle, "%.9g", TH_half2float(data[i])); if(ret <= 0) break; else nwrite++)
 
+READ_WRITE_METHODS(THBFloat16, BFloat16,
+                   float buf; int ret = fscanf(dfself->handle, "%g", &buf); if(ret <= 0) break; else { data[i]= TH_float2bfloat16(buf); nread++; },
+                   int ret = fprintf(dfself->handle, "%.9g", TH_bfloat162float(data[i])); if(ret <= 0) break; else nwrite++)
+
 READ_WRITE_METHODS(double, Double,
                    int ret = fscanf(dfself->handle, "%lg", &data[i]); if(ret <= 0) break; else nread++,
                    int ret = fprintf(dfself->handle, "%.17g", data[i]); if(ret <= 0) break; else nwrite++)
@@ -622,6 +626,7 @@ THFile *THDiskFile_new(const char *name, const char *mode, int isQuiet)
     THDiskFile_readFloat,
     THDiskFile_readDouble,
     THDiskFile_readHalf,
+    THDiskFile_readBFloat16,
     THDiskFile_readString,
 
     THDiskFile_writeByte,
@@ -632,6 +637,7 @@ THFile *THDiskFile_new(const char *name, const char *mode, int isQuiet)
     THDiskFile_writeFloat,
     THDiskFile_writeDouble,
     THDiskFile_writeHalf,
+    THDiskFile_writeBFloat16,
     THDiskFile_writeString,
 
     THDiskFile_synchronize,
@@ -736,6 +742,7 @@ THFile *THPipeFile_new(const char *name, const char *mode, int isQuiet)
     THDiskFile_readFloat,
     THDiskFile_readDouble,
     THDiskFile_readHalf,
+    THDiskFile_readBFloat16,
     THDiskFile_readString,
 
     THDiskFile_writeByte,
@@ -746,6 +753,7 @@ THFile *THPipeFile_new(const char *name, const char *mode, int isQuiet)
     THDiskFile_writeFloat,
     THDiskFile_writeDouble,
     THDiskFile_writeHalf,
+    THDiskFile_writeBFloat16,
     THDiskFile_writeString,
 
     THDiskFile_synchronize,
@@ -0,0 +1,25 @@
+#include "THFFT.h"
+#include "THAtomic.h"
+
+long THFFT_goodSize(long n, int even)
+{
+  long m;
+  if (n < 1)
+    n = 1;
+  for (;; n++) {
+    if (even && (n & 1))
+      continue;
+    m = n;
+    while (m % 2 == 0)
+      m /= 2;
+    while (m % 3 == 0)
+      m /= 3;
+    while (m % 5 == 0)
+      m /= 5;
+    if (m == 1)
+      return n;
+  }
+}
+
+#include "generic/THFFT.c"
+#include "THGenerateFloatTypes.h"
@@ -0,0 +1,15 @@
+#ifndef TH_FFT_INC
+#define TH_FFT_INC
+
+#include "THGeneral.h"
+
+#define THFFTPlan         TH_CONCAT_3(TH,Real,FFTPlan)
+#define THFFT_(NAME)      TH_CONCAT_4(TH,Real,FFT_,NAME)
+
+/* smallest size >= n whose prime factors are 2, 3 and 5 (and 2 if even) */
+TH_API long THFFT_goodSize(long n, int even);
+
+#include "generic/THFFT.h"
+#include "THGenerateFloatTypes.h"
+
+#endif
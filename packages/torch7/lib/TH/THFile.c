@@ -1,5 +1,6 @@
 #include "THFile.h"
 #include "THFilePrivate.h"
+#include "THVector.h"
 
 #define IMPLEMENT_THFILE_RW(TYPEC, TYPE)                          \
   size_t THFile_read##TYPEC##Raw(THFile *self, TYPE *data, size_t n)  \
@@ -20,6 +21,98 @@ IMPLEMENT_THFILE_RW(Long, long)
 IMPLEMENT_THFILE_RW(Float, float)
 IMPLEMENT_THFILE_RW(Double, double)
 IMPLEMENT_THFILE_RW(Half, THHalf)
+IMPLEMENT_THFILE_RW(BFloat16, THBFloat16)
+
+/* half on file, float in memory: converts through a small bounce buffer,
+   such that fp16 data can be loaded without an intermediate HalfStorage */
+#define TH_FILE_HALF_BUFFER_SIZE 4096
+
+size_t THFile_readHalfAsFloatRaw(THFile *self, float *data, size_t n)
+{
+  THHalf buffer[TH_FILE_HALF_BUFFER_SIZE];
+  size_t nread = 0;
+  while(nread < n)
+  {
+    size_t nchunk = n-nread < TH_FILE_HALF_BUFFER_SIZE ? n-nread : TH_FILE_HALF_BUFFER_SIZE;
+    size_t nchunkread = (*self->vtable->readHalf)(self, buffer, nchunk);
+    THFloatVector_fromHalf(data+nread, buffer, nchunkread);
+    nread += nchunkread;
+    if(nchunkread < nchunk)
+      break;
+  }
+  return nread;
+}
+
+size_t THFile_writeFloatAsHalfRaw(THFile *self, float *data, size_t n)
+{
+  THHalf buffer[TH_FILE_HALF_BUFFER_SIZE];
+  size_t nwrite = 0;
+  while(nwrite < n)
+  {
+    size_t nchunk = n-nwrite < TH_FILE_HALF_BUFFER_SIZE ? n-nwrite : TH_FILE_HALF_BUFFER_SIZE;
+    size_t nchunkwrite;
+    THFloatVector_toHalf(buffer, data+nwrite, nchunk);
+    nchunkwrite = (*self->vtable->writeHalf)(self, buffer, nchunk);
+    nwrite += nchunkwrite;
+    if(nchunkwrite < nchunk)
+      break;
+  }
+  return nwrite;
+}
+
+size_t THFile_readHalfAsFloat(THFile *self, THFloatStorage *storage)
+{
+  return THFile_readHalfAsFloatRaw(self, storage->data, storage->size);
+}
+
+size_t THFile_writeFloatAsHalf(THFile *self, THFloatStorage *storage)
+{
+  return THFile_writeFloatAsHalfRaw(self, storage->data, storage->size);
+}
+
+/* bfloat16 on file, float in memory (same bounce buffer) */
+size_t THFile_readBFloat16AsFloatRaw(THFile *self, float *data, size_t n)
+{
+  THBFloat16 buffer[TH_FILE_HALF_BUFFER_SIZE];
+  size_t nread = 0;
+  while(nread < n)
+  {
+    size_t nchunk = n-nread < TH_FILE_HALF_BUFFER_SIZE ? n-nread : TH_FILE_HALF_BUFFER_SIZE;
+    size_t nchunkread = (*self->vtable->readBFloat16)(self, buffer, nchunk);
+    TH_bfloat162float_array(data+nread, buffer, nchunkread);
+    nread += nchunkread;
+    if(nchunkread < nchunk)
+      break;
+  }
+  return nread;
+}
+
+size_t THFile_writeFloatAsBFloat16Raw(THFile *self, float *data, size_t n)
+{
+  THBFloat16 buffer[TH_FILE_HALF_BUFFER_SIZE];
+  size_t nwrite = 0;
+  while(nwrite < n)
+  {
+    size_t nchunk = n-nwrite < TH_FILE_HALF_BUFFER_SIZE ? n-nwrite : TH_FILE_HALF_BUFFER_SIZE;
+    size_t nchunkwrite;
+    TH_float2bfloat16_array(buffer, data+nwrite, nchunk);
+    nchunkwrite = (*self->vtable->writeBFloat16)(self, buffer, nchunk);
+    nwrite += nchunkwrite;
+    if(nchunkwrite < nchunk)
+      break;
+  }
+  return nwrite;
+}
+
+size_t THFile_readBFloat16AsFloat(THFile *self, THFloatStorage *storage)
+{
+  return THFile_readBFloat16AsFloatRaw(self, storage->data, storage->size);
+}
+
+size_t THFile_writeFloatAsBFloat16(THFile *self, THFloatStorage *storage)
+{
+  return THFile_writeFloatAsBFloat16Raw(self, storage->data, storage->size);
+}
 
 size_t THFile_readStringRaw(THFile *self, const char *format, char **str_)
 {
@@ -135,6 +228,7 @@ IMPLEMENT_THFILE_SCALAR(Long, long)
 IMPLEMENT_THFILE_SCALAR(Float, float)
 IMPLEMENT_THFILE_SCALAR(Double, double)
 IMPLEMENT_THFILE_SCALAR(Half, THHalf)
+IMPLEMENT_THFILE_SCALAR(BFloat16, THBFloat16)
 
 #define IMPLEMENT_THFILE_STORAGE(TYPEC, TYPE)                           \
   size_t THFile_read##TYPEC(THFile *self, TH##TYPEC##Storage *storage)    \
@@ -155,3 +249,4 @@ IMPLEMENT_THFILE_STORAGE(Long, long)
 IMPLEMENT_THFILE_STORAGE(Float, float)
 IMPLEMENT_THFILE_STORAGE(Double, double)
 IMPLEMENT_THFILE_STORAGE(Half, THHalf)
+IMPLEMENT_THFILE_STORAGE(BFloat16, THBFloat16)
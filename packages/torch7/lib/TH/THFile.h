@@ -81,6 +81,25 @@ TH_API size_t THFile_writeHalf(THFile *self, THHalfStorage *storage);
 TH_API size_t THFile_readHalfRaw(THFile *self, THHalf* data, size_t size);
 TH_API size_t THFile_writeHalfRaw(THFile *self, THHalf* data, size_t size);
 
+/* half on file, float in memory */
+TH_API size_t THFile_readHalfAsFloat(THFile *self, THFloatStorage *storage);
+TH_API size_t THFile_writeFloatAsHalf(THFile *self, THFloatStorage *storage);
+TH_API size_t THFile_readHalfAsFloatRaw(THFile *self, float* data, size_t size);
+TH_API size_t THFile_writeFloatAsHalfRaw(THFile *self, float* data, size_t size);
+
+TH_API THBFloat16 THFile_readBFloat16Scalar(THFile *self);
+TH_API void THFile_writeBFloat16Scalar(THFile *self, THBFloat16 scalar);
+TH_API size_t THFile_readBFloat16(THFile *self, THBFloat16Storage *storage);
+TH_API size_t THFile_writeBFloat16(THFile *self, THBFloat16Storage *storage);
+TH_API size_t THFile_readBFloat16Raw(THFile *self, THBFloat16* data, size_t size);
+TH_API size_t THFile_writeBFloat16Raw(THFile *self, THBFloat16* data, size_t size);
+
+/* bfloat16 on file, float in memory */
+TH_API size_t THFile_readBFloat16AsFloat(THFile *self, THFloatStorage *storage);
+TH_API size_t THFile_writeFloatAsBFloat16(THFile *self, THFloatStorage *storage);
+TH_API size_t THFile_readBFloat16AsFloatRaw(THFile *self, float* data, size_t size);
+TH_API size_t THFile_writeFloatAsBFloat16Raw(THFile *self, float* data, size_t size);
+
 TH_API void THFile_synchronize(THFile *self);
 TH_API void THFile_seek(THFile *self, size_t position);
 TH_API void THFile_seekEnd(THFile *self);
@@ -1,6 +1,7 @@
 #include "THGeneral.h"
 
 #include "THHalf.h"
+#include "THBFloat16.h"
 
 
 struct THFile__
@@ -29,6 +30,7 @@ struct THFileVTable
     size_t (*readFloat)(THFile *self, float *data, size_t n);
     size_t (*readDouble)(THFile *self, double *data, size_t n);
     size_t (*readHalf)(THFile *self, THHalf *data, size_t n);
+    size_t (*readBFloat16)(THFile *self, THBFloat16 *data, size_t n);
     size_t (*readString)(THFile *self, const char *format, char **str_);
 
     size_t (*writeByte)(THFile *self, unsigned char *data, size_t n);
@@ -39,6 +41,7 @@ struct THFileVTable
     size_t (*writeFloat)(THFile *self, float *data, size_t n);
     size_t (*writeDouble)(THFile *self, double *data, size_t n);
     size_t (*writeHalf)(THFile *self, THHalf *data, size_t n);
+    size_t (*writeBFloat16)(THFile *self, THBFloat16 *data, size_t n);
     size_t (*writeString)(THFile *self, const char *str, size_t size);
 
     void (*synchronize)(THFile *self);
@@ -29,6 +29,42 @@ THGenerator* THGenerator_new()
   return self;
 }
 
+/* Creates new Philox generator and makes sure it is seeded*/
+THGenerator* THGenerator_newPhilox()
+{
+  THGenerator *self = THGenerator_newUnseeded();
+  self->kind = TH_GENERATOR_PHILOX;
+  THRandom_seed(self);
+  return self;
+}
+
+/* the THGenerator fields before the Philox ones were appended: the layout of
+   the states saved by earlier versions */
+typedef struct THGeneratorMT {
+  unsigned long the_initial_seed;
+  int left;
+  int seeded;
+  unsigned long next;
+  unsigned long state[_MERSENNE_STATE_N];
+  double normal_x;
+  double normal_y;
+  double normal_rho;
+  int normal_is_valid;
+} THGeneratorMT;
+
+size_t THGenerator_mtStateSize(void)
+{
+  return sizeof(THGeneratorMT);
+}
+
+void THGenerator_copyState(THGenerator *self, const void *state, size_t size)
+{
+  if (size != sizeof(THGenerator) && size != sizeof(THGeneratorMT))
+    THError("RNG state is wrong size");
+  memset(self, 0, sizeof(THGenerator));
+  memcpy(self, state, size);
+}
+
 THGenerator* THGenerator_copy(THGenerator *self, THGenerator *from)
 {
     memcpy(self, from, sizeof(THGenerator));
@@ -42,6 +78,9 @@ void THGenerator_free(THGenerator *self)
 
 int THGenerator_isValid(THGenerator *_generator)
 {
+  if (_generator->kind == TH_GENERATOR_PHILOX)
+    return _generator->seeded == 1;
+
   if ((_generator->seeded == 1) &&
     (_generator->left > 0 && _generator->left <= n) && (_generator->next <= n))
     return 1;
@@ -140,13 +179,22 @@ unsigned long THRandom_seed(THGenerator *_generator)
 void THRandom_manualSeed(THGenerator *_generator, unsigned long the_seed_)
 {
   int j;
+  int kind = _generator->kind;
 
   /* This ensures reseeding resets all of the state (i.e. state for Gaussian numbers) */
   THGenerator *blank = THGenerator_newUnseeded();
   THGenerator_copy(_generator, blank);
   THGenerator_free(blank);
 
+  _generator->kind = kind;
   _generator->the_initial_seed = the_seed_;
+  if (kind == TH_GENERATOR_PHILOX)
+  {
+    _generator->philox_key[0] = (unsigned int)(the_seed_ & 0xffffffffUL);
+    _generator->philox_key[1] = (unsigned int)((unsigned long long)the_seed_ >> 32);
+    _generator->seeded = 1;
+    return;
+  }
   _generator->state[0] = _generator->the_initial_seed & 0xffffffffUL;
   for(j = 1; j < n; j++)
   {
@@ -183,10 +231,140 @@ void THRandom_nextState(THGenerator *_generator)
   *p = p[m-n] ^ TWIST(p[0], _generator->state[0]);
 }
 
+/* Code for the Philox4x32-10 random generator, from "Parallel random
+   numbers: as easy as 1, 2, 3" (Salmon, Moraes, Dror and Shaw, 2011). */
+
+#define PHILOX_M0 0xD2511F53U
+#define PHILOX_M1 0xCD9E8D57U
+#define PHILOX_W0 0x9E3779B9U
+#define PHILOX_W1 0xBB67AE85U
+#define PHILOX_ROUNDS 10
+
+/* blocks computed together by THRandom_philoxWords (the compiler
+   vectorizes across them) */
+#define PHILOX_LANES 8
+
+void THRandom_philox(const unsigned int *ctr, const unsigned int *key, unsigned int *out)
+{
+  unsigned int c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+  unsigned int k0 = key[0], k1 = key[1];
+  int r;
+  for (r = 0; r < PHILOX_ROUNDS; r++) {
+    unsigned int hi0 = (unsigned int)(((unsigned long long)PHILOX_M0 * c0) >> 32);
+    unsigned int hi1 = (unsigned int)(((unsigned long long)PHILOX_M1 * c2) >> 32);
+    unsigned int lo0 = PHILOX_M0 * c0;
+    unsigned int lo1 = PHILOX_M1 * c2;
+    c0 = hi1 ^ c1 ^ k0;
+    c2 = hi0 ^ c3 ^ k1;
+    c1 = lo1;
+    c3 = lo0;
+    k0 += PHILOX_W0;
+    k1 += PHILOX_W1;
+  }
+  out[0] = c0;
+  out[1] = c1;
+  out[2] = c2;
+  out[3] = c3;
+}
+
+/* blocks [block, block+PHILOX_LANES[, stored one after the other: the
+   lanes run the rounds of THRandom_philox side by side */
+static void THRandom_philoxLanes(unsigned long long block, const unsigned int *key, unsigned int *out)
+{
+  unsigned int key0 = key[0], key1 = key[1];
+  int l, r;
+  for (l = 0; l < PHILOX_LANES; l++) {
+    unsigned long long b = block + l;
+    unsigned int c0 = (unsigned int)b, c1 = (unsigned int)(b >> 32), c2 = 0, c3 = 0;
+    unsigned int k0 = key0, k1 = key1;
+    for (r = 0; r < PHILOX_ROUNDS; r++) {
+      unsigned int hi0 = (unsigned int)(((unsigned long long)PHILOX_M0 * c0) >> 32);
+      unsigned int hi1 = (unsigned int)(((unsigned long long)PHILOX_M1 * c2) >> 32);
+      unsigned int lo0 = PHILOX_M0 * c0;
+      unsigned int lo1 = PHILOX_M1 * c2;
+      c0 = hi1 ^ c1 ^ k0;
+      c2 = hi0 ^ c3 ^ k1;
+      c1 = lo1;
+      c3 = lo0;
+      k0 += PHILOX_W0;
+      k1 += PHILOX_W1;
+    }
+    out[4*l] = c0;
+    out[4*l+1] = c1;
+    out[4*l+2] = c2;
+    out[4*l+3] = c3;
+  }
+}
+
+static void THRandom_philoxBlock(THGenerator *_generator, unsigned long long block, unsigned int *out)
+{
+  unsigned int ctr[4];
+  ctr[0] = (unsigned int)block;
+  ctr[1] = (unsigned int)(block >> 32);
+  ctr[2] = 0;
+  ctr[3] = 0;
+  THRandom_philox(ctr, _generator->philox_key, out);
+}
+
+void THRandom_philoxWords(THGenerator *_generator, unsigned long long offset, long count, unsigned int *out)
+{
+  unsigned int buffer[4*PHILOX_LANES];
+  unsigned long long block = offset / 4;
+  long skip = (long)(offset % 4);
+  long i;
+
+  THArgCheck(_generator->kind == TH_GENERATOR_PHILOX, 1, "Philox generator expected");
+  while (count > 0) {
+    long nblock = (skip + count + 3) / 4;
+    long len;
+    if (nblock >= PHILOX_LANES) {
+      THRandom_philoxLanes(block, _generator->philox_key, buffer);
+      nblock = PHILOX_LANES;
+    } else {
+      long b;
+      for (b = 0; b < nblock; b++)
+        THRandom_philoxBlock(_generator, block + b, buffer + 4*b);
+    }
+    len = 4*nblock - skip;
+    if (len > count)
+      len = count;
+    for (i = 0; i < len; i++)
+      out[i] = buffer[skip + i];
+    out += len;
+    count -= len;
+    block += nblock;
+    skip = 0;
+  }
+}
+
+static unsigned long THRandom_philoxNext(THGenerator *_generator)
+{
+  unsigned long long block = _generator->philox_offset / 4;
+  if (!_generator->philox_cached || _generator->philox_block != block) {
+    THRandom_philoxBlock(_generator, block, _generator->philox_buffer);
+    _generator->philox_block = block;
+    _generator->philox_cached = 1;
+  }
+  return _generator->philox_buffer[_generator->philox_offset++ % 4];
+}
+
+void THRandom_discard(THGenerator *_generator, long count)
+{
+  THArgCheck(count >= 0, 2, "number of draws must be non-negative");
+  if (_generator->kind == TH_GENERATOR_PHILOX)
+    _generator->philox_offset += count;
+  else
+    while (count-- > 0)
+      THRandom_random(_generator);
+}
+
 unsigned long THRandom_random(THGenerator *_generator)
 {
   unsigned long y;
 
+  if (_generator->kind == TH_GENERATOR_PHILOX)
+    return THRandom_philoxNext(_generator);
+
   if (--(_generator->left) == 0)
     THRandom_nextState(_generator);
   y = *(_generator->state + (_generator->next)++);
@@ -241,6 +419,87 @@ double THRandom_normal(THGenerator *_generator, double mean, double stdv)
     return _generator->normal_rho*sin(2.*M_PI*_generator->normal_x)*stdv+mean;
 }
 
+void THRandom_boxMuller(const unsigned int *words, long count, double *out)
+{
+  long i;
+  for (i = 0; i + 1 < count; i += 2) {
+    double x = (double)words[i] * (1.0/4294967296.0);
+    double y = (double)words[i+1] * (1.0/4294967296.0);
+    double rho = sqrt(-2. * log(1.0-y));
+    out[i] = rho*cos(2.*M_PI*x);
+    out[i+1] = rho*sin(2.*M_PI*x);
+  }
+}
+
+/*
+ * Same, in single precision, without calls to the math library: the loops
+ * below only have arithmetic (selects are computed from integers, as the
+ * compiler keeps branches on float comparisons) and vectorize.
+ *   log: 1-y = m 2^e, with m in [sqrt(1/2), sqrt(2)[, and
+ *        log(m) = 2 atanh(s) with s = (m-1)/(m+1), |s| < 0.172;
+ *        for y < 1/4, s = -y/(2-y) directly, as 1-y lost the low bits of y.
+ *   sin, cos: 2 pi x = q pi/2 + t, with q integer and |t| <= pi/4.
+ */
+#define BOXMULLER_LANES 64
+
+void THRandom_boxMullerFloat(const unsigned int *words, long count, float *out)
+{
+  float v[BOXMULLER_LANES], rho[BOXMULLER_LANES], co[BOXMULLER_LANES], si[BOXMULLER_LANES];
+  unsigned int bits[BOXMULLER_LANES];
+  int ex[BOXMULLER_LANES];
+  long i0, npair = count / 2;
+  int l;
+
+  for (i0 = 0; i0 < npair; i0 += BOXMULLER_LANES) {
+    int len = (npair - i0 < BOXMULLER_LANES ? (int)(npair - i0) : BOXMULLER_LANES);
+    const unsigned int *w = words + 2*i0;
+
+    /* 1-y on ]0,1], from (2^32 - word)/2^32 */
+    for (l = 0; l < len; l++) {
+      unsigned int d = 0U - w[2*l+1];
+      v[l] = ((float)(int)(d >> 1) * 2.0f + (float)(int)(d & 1)) * (1.0f/4294967296.0f)
+        + (float)(d == 0);
+    }
+
+    memcpy(bits, v, len*sizeof(float));
+    for (l = 0; l < len; l++) {
+      unsigned int mant = (bits[l] & 0x007fffffU) | 0x3f800000U;
+      int big = (mant > 0x3fb504f3U); /* m > sqrt(2) */
+      ex[l] = (int)(bits[l] >> 23) - 127 + big;
+      bits[l] = mant - ((unsigned int)big << 23);
+    }
+    memcpy(v, bits, len*sizeof(float));
+
+    for (l = 0; l < len; l++) {
+      float y = (float)(int)(w[2*l+1] >> 1) * (1.0f/2147483648.0f);
+      float small = (float)(int)((4U - (w[2*l+1] >> 30)) >> 2); /* y < 1/4 */
+      float s = small * (-y / (2.0f - y)) + (1.0f - small) * ((v[l] - 1.0f) / (v[l] + 1.0f));
+      float s2 = s*s;
+      float lg = (1.0f - small) * (float)ex[l] * 0.693147181f
+        + 2.0f*s*(1.0f + s2*(1.0f/3 + s2*(1.0f/5 + s2*(1.0f/7 + s2*(1.0f/9)))));
+      rho[l] = sqrtf(-2.0f*lg);
+    }
+
+    for (l = 0; l < len; l++) {
+      float x4 = (float)(int)(w[2*l] >> 1) * (4.0f/2147483648.0f);
+      int q = (int)(x4 + 0.5f);
+      float t = (x4 - (float)q) * 1.57079633f;
+      float t2 = t*t;
+      float s = t*(1.0f - t2*(1.0f/6 - t2*(1.0f/120 - t2*(1.0f/5040 - t2*(1.0f/362880)))));
+      float c = 1.0f - t2*(0.5f - t2*(1.0f/24 - t2*(1.0f/720 - t2*(1.0f/40320))));
+      float cq = (q & 1 ? s : c);
+      float sq = (q & 1 ? c : s);
+      co[l] = ((q + 1) & 2 ? -cq : cq);
+      si[l] = (q & 2 ? -sq : sq);
+    }
+
+    for (l = 0; l < len; l++) {
+      out[2*(i0+l)] = rho[l]*co[l];
+      out[2*(i0+l)+1] = rho[l]*si[l];
+    }
+  }
+}
+
 double THRandom_exponential(THGenerator *_generator, double lambda)
 {
   return(-1. / lambda * log(1-__uniform__(_generator)));
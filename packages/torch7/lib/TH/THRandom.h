@@ -5,6 +5,11 @@
 
 #define _MERSENNE_STATE_N 624
 #define _MERSENNE_STATE_M 397
+
+/* Kinds of generators */
+#define TH_GENERATOR_MT 0     /* Mersenne Twister (the default) */
+#define TH_GENERATOR_PHILOX 1 /* Philox4x32-10 (counter-based) */
+
 /* A THGenerator contains all the state required for a single random number stream */
 typedef struct THGenerator {
   /* The initial seed. */
@@ -20,15 +25,33 @@ typedef struct THGenerator {
   double normal_y;
   double normal_rho;
   int normal_is_valid; /* = 0; */
+
+  /* Philox4x32-10 (kind == TH_GENERATOR_PHILOX): word i of the stream is
+     word i%4 of the block obtained by encrypting the counter i/4 with the
+     key. Any part of the stream can be computed directly. */
+  int kind;
+  unsigned int philox_key[2];
+  unsigned long long philox_offset; /* next word of the stream */
+  unsigned long long philox_block;  /* counter of the cached block */
+  int philox_cached;
+  unsigned int philox_buffer[4];
 } THGenerator;
 
 #define torch_Generator "torch.Generator"
 
 /* Manipulate THGenerator objects */
 TH_API THGenerator * THGenerator_new(void);
+TH_API THGenerator * THGenerator_newPhilox(void);
 TH_API THGenerator * THGenerator_copy(THGenerator *self, THGenerator *from);
 TH_API void THGenerator_free(THGenerator *gen);
 
+/* Size of the states saved before the Philox fields were appended to
+   THGenerator (Mersenne Twister only). */
+TH_API size_t THGenerator_mtStateSize(void);
+/* Copies a saved state of either size in self; the fields missing from an
+   old state are zeroed (kind = TH_GENERATOR_MT, null Philox counter/key). */
+TH_API void THGenerator_copyState(THGenerator *self, const void *state, size_t size);
+
 /* Checks if given generator is valid */
 TH_API int THGenerator_isValid(THGenerator *_generator);
 
@@ -45,6 +68,24 @@ TH_API unsigned long THRandom_initialSeed(THGenerator *_generator);
 /* Generates a uniform 32 bits integer. */
 TH_API unsigned long THRandom_random(THGenerator *_generator);
 
+/* Discards the next n 32 bits integers of the stream. This is O(1) for
+   Philox generators, O(n) for Mersenne Twister ones. */
+TH_API void THRandom_discard(THGenerator *_generator, long n);
+
+/* Philox4x32-10 block function: out = encryption of ctr with key. */
+TH_API void THRandom_philox(const unsigned int *ctr, const unsigned int *key, unsigned int *out);
+
+/* Words [offset, offset+n[ of the stream of a Philox generator, without
+   changing its state (so several threads can fill disjoint ranges). */
+TH_API void THRandom_philoxWords(THGenerator *_generator, unsigned long long offset, long n, unsigned int *out);
+
+/* Box-Muller transforms of n/2 pairs of words (n even): the pair
+   (words[2i], words[2i+1]) gives out[2i] and out[2i+1], the two numbers
+   THRandom_normal(_, 0, 1) draws from them, in that order. The float version
+   uses polynomial approximations (absolute error < 1e-5) and vectorizes. */
+TH_API void THRandom_boxMuller(const unsigned int *words, long n, double *out);
+TH_API void THRandom_boxMullerFloat(const unsigned int *words, long n, float *out);
+
 /* Generates a uniform random number on [0,1[. */
 TH_API double THRandom_uniform(THGenerator *_generator, double a, double b);
 
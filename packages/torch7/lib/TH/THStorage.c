@@ -1,5 +1,6 @@
 #include "THAtomic.h"
 #include "THStorage.h"
+#include "THVector.h"
 
 #include "generic/THStorage.c"
 #include "THGenerateAllTypes.h"
@@ -7,12 +8,18 @@
 #include "generic/THStorage.c"
 #include "THGenerateHalfType.h"
 
+#include "generic/THStorage.c"
+#include "THGenerateBFloat16Type.h"
+
 #include "generic/THStorageCopy.c"
 #include "THGenerateAllTypes.h"
 
 #include "generic/THStorageCopy.c"
 #include "THGenerateHalfType.h"
 
+#include "generic/THStorageCopy.c"
+#include "THGenerateBFloat16Type.h"
+
 
 THDescBuff THLongStorage_sizeDesc(const THLongStorage *size) {
   return _THSizeDesc(size->data, size->size);
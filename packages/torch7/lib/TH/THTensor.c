@@ -4,6 +4,7 @@
 #include "generic/simd/simd.h"
 
 #include "THBlas.h"
+#include "THFFT.h"
 #include "THLapack.h"
 #include "THRandom.h"
 #include "THTensorDimApply.h"
@@ -15,12 +16,18 @@
 #include "generic/THTensor.c"
 #include "THGenerateHalfType.h"
 
+#include "generic/THTensor.c"
+#include "THGenerateBFloat16Type.h"
+
 #include "generic/THTensorCopy.c"
 #include "THGenerateAllTypes.h"
 
 #include "generic/THTensorCopy.c"
 #include "THGenerateHalfType.h"
 
+#include "generic/THTensorCopy.c"
+#include "THGenerateBFloat16Type.h"
+
 #include "generic/THTensorRandom.c"
 #include "THGenerateAllTypes.h"
 
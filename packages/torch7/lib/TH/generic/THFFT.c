@@ -0,0 +1,342 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/THFFT.c"
+#else
+
+/* Mixed radix (2, 3, 4, 5) Stockham transforms: each stage reads its input
+   from one buffer and writes its output, already in order, to the other,
+   so that no bit reversal is needed. The sequences of a batch are
+   interleaved: the butterflies are applied to runs of consecutive elements
+   (one per sequence, and per position in the shorter transforms of the
+   later stages), which the compiler vectorizes, and real and imaginary
+   parts are kept in separate arrays for the same reason. */
+
+static ptrdiff_t THFFT_(planCache) = 0;
+
+THFFTPlan *THFFT_(plan)(long n)
+{
+  THFFTPlan *plan;
+  ptrdiff_t head;
+  long m, l, j;
+  int f, r;
+
+  THArgCheck(n > 0 && THFFT_goodSize(n, 0) == n, 1, "FFT size must be a product of 2, 3 and 5");
+  for (plan = (THFFTPlan *)THAtomicGetPtrdiff(&THFFT_(planCache)); plan; plan = plan->next)
+    if (plan->n == n)
+      return plan;
+
+  plan = THAlloc(sizeof(THFFTPlan));
+  plan->n = n;
+  plan->nfactor = 0;
+  for (m = n; m > 1;) {
+    int p = (m % 4 == 0 ? 4 : m % 2 == 0 ? 2 : m % 3 == 0 ? 3 : 5);
+    plan->factor[plan->nfactor++] = p;
+    m /= p;
+  }
+
+  /* stage f, of radix p, transforms sequences of length l = p*m: its
+     twiddle factors are w^(j*r), for w = exp(-2i pi/l), j < m and 0 < r < p */
+  plan->twr = THAlloc(2 * n * sizeof(real));
+  plan->twi = plan->twr + n;
+  l = n;
+  m = 0;
+  for (f = 0; f < plan->nfactor; f++) {
+    int p = plan->factor[f];
+    long ml = l / p;
+    for (j = 0; j < ml; j++) {
+      for (r = 1; r < p; r++) {
+        double a = -2 * M_PI * (double)(j * r) / (double)l;
+        plan->twr[m] = (real)cos(a);
+        plan->twi[m] = (real)sin(a);
+        m++;
+      }
+    }
+    l = ml;
+  }
+
+  do {
+    head = THAtomicGetPtrdiff(&THFFT_(planCache));
+    plan->next = (THFFTPlan *)head;
+  } while (!THAtomicCompareAndSwapPtrdiff(&THFFT_(planCache), head, (ptrdiff_t)plan));
+  return plan;
+}
+
+#define THFFT_CMUL(RE, IM, WR, WI)              \
+  {                                             \
+    real THFFT_re = (RE) * (WR) - (IM) * (WI);  \
+    IM = (RE) * (WI) + (IM) * (WR);             \
+    RE = THFFT_re;                              \
+  }
+
+static void THFFT_(radix2)(long m, long s, const real *twr, const real *twi,
+                           const real *xr, const real *xi, real *yr, real *yi)
+{
+  long j, t;
+  for (j = 0; j < m; j++) {
+    const real *x0r = xr + s * j, *x0i = xi + s * j;
+    const real *x1r = x0r + s * m, *x1i = x0i + s * m;
+    real *y0r = yr + s * 2 * j, *y0i = yi + s * 2 * j;
+    real *y1r = y0r + s, *y1i = y0i + s;
+    real w1r = twr[j], w1i = twi[j];
+    for (t = 0; t < s; t++) {
+      real ar = x0r[t] - x1r[t], ai = x0i[t] - x1i[t];
+      y0r[t] = x0r[t] + x1r[t];
+      y0i[t] = x0i[t] + x1i[t];
+      THFFT_CMUL(ar, ai, w1r, w1i);
+      y1r[t] = ar;
+      y1i[t] = ai;
+    }
+  }
+}
+
+static void THFFT_(radix3)(long m, long s, const real *twr, const real *twi,
+                           const real *xr, const real *xi, real *yr, real *yi)
+{
+  const real c = -0.5, d = (real)0.86602540378443864676;
+  long j, t;
+  for (j = 0; j < m; j++) {
+    const real *x0r = xr + s * j, *x0i = xi + s * j;
+    const real *x1r = x0r + s * m, *x1i = x0i + s * m;
+    const real *x2r = x1r + s * m, *x2i = x1i + s * m;
+    real *y0r = yr + s * 3 * j, *y0i = yi + s * 3 * j;
+    real *y1r = y0r + s, *y1i = y0i + s;
+    real *y2r = y1r + s, *y2i = y1i + s;
+    real w1r = twr[2*j], w1i = twi[2*j], w2r = twr[2*j+1], w2i = twi[2*j+1];
+    for (t = 0; t < s; t++) {
+      real sr = x1r[t] + x2r[t], si = x1i[t] + x2i[t];
+      real dr = x1r[t] - x2r[t], di = x1i[t] - x2i[t];
+      real ur = x0r[t] + c * sr, ui = x0i[t] + c * si;
+      real b1r = ur + d * di, b1i = ui - d * dr;
+      real b2r = ur - d * di, b2i = ui + d * dr;
+      y0r[t] = x0r[t] + sr;
+      y0i[t] = x0i[t] + si;
+      THFFT_CMUL(b1r, b1i, w1r, w1i);
+      THFFT_CMUL(b2r, b2i, w2r, w2i);
+      y1r[t] = b1r;
+      y1i[t] = b1i;
+      y2r[t] = b2r;
+      y2i[t] = b2i;
+    }
+  }
+}
+
+static void THFFT_(radix4)(long m, long s, const real *twr, const real *twi,
+                           const real *xr, const real *xi, real *yr, real *yi)
+{
+  long j, t;
+  for (j = 0; j < m; j++) {
+    const real *x0r = xr + s * j, *x0i = xi + s * j;
+    const real *x1r = x0r + s * m, *x1i = x0i + s * m;
+    const real *x2r = x1r + s * m, *x2i = x1i + s * m;
+    const real *x3r = x2r + s * m, *x3i = x2i + s * m;
+    real *y0r = yr + s * 4 * j, *y0i = yi + s * 4 * j;
+    real *y1r = y0r + s, *y1i = y0i + s;
+    real *y2r = y1r + s, *y2i = y1i + s;
+    real *y3r = y2r + s, *y3i = y2i + s;
+    real w1r = twr[3*j], w1i = twi[3*j];
+    real w2r = twr[3*j+1], w2i = twi[3*j+1];
+    real w3r = twr[3*j+2], w3i = twi[3*j+2];
+    for (t = 0; t < s; t++) {
+      real t0r = x0r[t] + x2r[t], t0i = x0i[t] + x2i[t];
+      real t1r = x0r[t] - x2r[t], t1i = x0i[t] - x2i[t];
+      real t2r = x1r[t] + x3r[t], t2i = x1i[t] + x3i[t];
+      real t3r = x1r[t] - x3r[t], t3i = x1i[t] - x3i[t];
+      real b1r = t1r + t3i, b1i = t1i - t3r;
+      real b2r = t0r - t2r, b2i = t0i - t2i;
+      real b3r = t1r - t3i, b3i = t1i + t3r;
+      y0r[t] = t0r + t2r;
+      y0i[t] = t0i + t2i;
+      THFFT_CMUL(b1r, b1i, w1r, w1i);
+      THFFT_CMUL(b2r, b2i, w2r, w2i);
+      THFFT_CMUL(b3r, b3i, w3r, w3i);
+      y1r[t] = b1r;
+      y1i[t] = b1i;
+      y2r[t] = b2r;
+      y2i[t] = b2i;
+      y3r[t] = b3r;
+      y3i[t] = b3i;
+    }
+  }
+}
+
+static void THFFT_(radix5)(long m, long s, const real *twr, const real *twi,
+                           const real *xr, const real *xi, real *yr, real *yi)
+{
+  const real c1 = (real)0.30901699437494742410, c2 = (real)-0.80901699437494742410;
+  const real s1 = (real)0.95105651629515357212, s2 = (real)0.58778525229247312917;
+  long j, t;
+  for (j = 0; j < m; j++) {
+    const real *x0r = xr + s * j, *x0i = xi + s * j;
+    const real *x1r = x0r + s * m, *x1i = x0i + s * m;
+    const real *x2r = x1r + s * m, *x2i = x1i + s * m;
+    const real *x3r = x2r + s * m, *x3i = x2i + s * m;
+    const real *x4r = x3r + s * m, *x4i = x3i + s * m;
+    real *y0r = yr + s * 5 * j, *y0i = yi + s * 5 * j;
+    real *y1r = y0r + s, *y1i = y0i + s;
+    real *y2r = y1r + s, *y2i = y1i + s;
+    real *y3r = y2r + s, *y3i = y2i + s;
+    real *y4r = y3r + s, *y4i = y3i + s;
+    real w1r = twr[4*j], w1i = twi[4*j];
+    real w2r = twr[4*j+1], w2i = twi[4*j+1];
+    real w3r = twr[4*j+2], w3i = twi[4*j+2];
+    real w4r = twr[4*j+3], w4i = twi[4*j+3];
+    for (t = 0; t < s; t++) {
+      real s1r = x1r[t] + x4r[t], s1i = x1i[t] + x4i[t];
+      real s2r = x2r[t] + x3r[t], s2i = x2i[t] + x3i[t];
+      real d1r = x1r[t] - x4r[t], d1i = x1i[t] - x4i[t];
+      real d2r = x2r[t] - x3r[t], d2i = x2i[t] - x3i[t];
+      real u1r = x0r[t] + c1 * s1r + c2 * s2r, u1i = x0i[t] + c1 * s1i + c2 * s2i;
+      real u2r = x0r[t] + c2 * s1r + c1 * s2r, u2i = x0i[t] + c2 * s1i + c1 * s2i;
+      real v1r = s1 * d1r + s2 * d2r, v1i = s1 * d1i + s2 * d2i;
+      real v2r = s2 * d1r - s1 * d2r, v2i = s2 * d1i - s1 * d2i;
+      /* b1 = u1 - i v1, b4 = u1 + i v1, b2 = u2 - i v2, b3 = u2 + i v2 */
+      real b1r = u1r + v1i, b1i = u1i - v1r;
+      real b4r = u1r - v1i, b4i = u1i + v1r;
+      real b2r = u2r + v2i, b2i = u2i - v2r;
+      real b3r = u2r - v2i, b3i = u2i + v2r;
+      y0r[t] = x0r[t] + s1r + s2r;
+      y0i[t] = x0i[t] + s1i + s2i;
+      THFFT_CMUL(b1r, b1i, w1r, w1i);
+      THFFT_CMUL(b2r, b2i, w2r, w2i);
+      THFFT_CMUL(b3r, b3i, w3r, w3i);
+      THFFT_CMUL(b4r, b4i, w4r, w4i);
+      y1r[t] = b1r;
+      y1i[t] = b1i;
+      y2r[t] = b2r;
+      y2i[t] = b2i;
+      y3r[t] = b3r;
+      y3i[t] = b3i;
+      y4r[t] = b4r;
+      y4i[t] = b4i;
+    }
+  }
+}
+
+void THFFT_(forward)(THFFTPlan *plan, real *re, real *im, long howmany, real *wre, real *wim)
+{
+  real *xr = re, *xi = im, *yr = wre, *yi = wim, *tmp;
+  long l = plan->n, s = howmany, tw = 0;
+  int f;
+
+  for (f = 0; f < plan->nfactor; f++) {
+    int p = plan->factor[f];
+    long m = l / p;
+    switch (p) {
+      case 2: THFFT_(radix2)(m, s, plan->twr + tw, plan->twi + tw, xr, xi, yr, yi); break;
+      case 3: THFFT_(radix3)(m, s, plan->twr + tw, plan->twi + tw, xr, xi, yr, yi); break;
+      case 4: THFFT_(radix4)(m, s, plan->twr + tw, plan->twi + tw, xr, xi, yr, yi); break;
+      default: THFFT_(radix5)(m, s, plan->twr + tw, plan->twi + tw, xr, xi, yr, yi); break;
+    }
+    tw += m * (p - 1);
+    s *= p;
+    l = m;
+    tmp = xr; xr = yr; yr = tmp;
+    tmp = xi; xi = yi; yi = tmp;
+  }
+  if (xr != re) {
+    memcpy(re, xr, plan->n * howmany * sizeof(real));
+    memcpy(im, xi, plan->n * howmany * sizeof(real));
+  }
+}
+
+/* the backward transform is the forward transform of the sequences with
+   real and imaginary parts exchanged, with its parts exchanged */
+void THFFT_(backward)(THFFTPlan *plan, real *re, real *im, long howmany, real *wre, real *wim)
+{
+  THFFT_(forward)(plan, im, re, howmany, wim, wre);
+}
+
+long THFFT_(realWorkSize)(long d0, long d1, long d2)
+{
+  /* the packed rows, and the buffers of the transforms */
+  long k = d2 / 2 + 1;
+  long w = d1 * k;
+  if (d2 * (d1 / 2) > w)
+    w = d2 * (d1 / 2);
+  return 2 * d0 * d2 * (d1 / 2) + 2 * d0 * w;
+}
+
+/* The rows of x are transformed two at a time, as the real and imaginary
+   parts of one complex sequence; their spectra are then separated using
+   their hermitian symmetry. Only the first d2/2+1 coefficients of each row
+   are kept, and the columns (and planes) are transformed as complex
+   sequences. */
+void THFFT_(realForward)(real *x, long d0, long d1, long d2, real *sre, real *sim, real *work)
+{
+  long h = d1 / 2, k = d2 / 2 + 1;
+  real *zr = work, *zi = work + d0 * d2 * h;
+  real *wr = zi + d0 * d2 * h, *wi;
+  long a, c, p;
+  THFFTPlan *prow = THFFT_(plan)(d2), *pcol = THFFT_(plan)(d1);
+
+  wi = wr + d0 * (d1 * k > d2 * h ? d1 * k : d2 * h);
+  for (a = 0; a < d0; a++) {
+    real *xa = x + a * d1 * d2;
+    real *za = zr + a * d2 * h, *zb = zi + a * d2 * h;
+    real *sa = sre + a * d1 * k, *sb = sim + a * d1 * k;
+    for (p = 0; p < h; p++)
+      for (c = 0; c < d2; c++) {
+        za[c * h + p] = xa[2 * p * d2 + c];
+        zb[c * h + p] = xa[(2 * p + 1) * d2 + c];
+      }
+    THFFT_(forward)(prow, za, zb, h, wr, wi);
+    for (c = 0; c < k; c++) {
+      long cn = (c == 0 ? 0 : d2 - c);
+      real *zcr = za + c * h, *zci = zb + c * h;
+      real *znr = za + cn * h, *zni = zb + cn * h;
+      for (p = 0; p < h; p++) {
+        sa[2 * p * k + c] = (zcr[p] + znr[p]) / 2;
+        sb[2 * p * k + c] = (zci[p] - zni[p]) / 2;
+        sa[(2 * p + 1) * k + c] = (zci[p] + zni[p]) / 2;
+        sb[(2 * p + 1) * k + c] = (znr[p] - zcr[p]) / 2;
+      }
+    }
+    THFFT_(forward)(pcol, sa, sb, k, wr, wi);
+  }
+  if (d0 > 1)
+    THFFT_(forward)(THFFT_(plan)(d0), sre, sim, d1 * k, wr, wi);
+}
+
+void THFFT_(realBackward)(real *sre, real *sim, long d0, long d1, long d2, real *x, real *work)
+{
+  long h = d1 / 2, k = d2 / 2 + 1;
+  real *zr = work, *zi = work + d0 * d2 * h;
+  real *wr = zi + d0 * d2 * h, *wi;
+  long a, c, p;
+  THFFTPlan *prow = THFFT_(plan)(d2), *pcol = THFFT_(plan)(d1);
+
+  wi = wr + d0 * (d1 * k > d2 * h ? d1 * k : d2 * h);
+  if (d0 > 1)
+    THFFT_(backward)(THFFT_(plan)(d0), sre, sim, d1 * k, wr, wi);
+  for (a = 0; a < d0; a++) {
+    real *xa = x + a * d1 * d2;
+    real *za = zr + a * d2 * h, *zb = zi + a * d2 * h;
+    real *sa = sre + a * d1 * k, *sb = sim + a * d1 * k;
+    THFFT_(backward)(pcol, sa, sb, k, wr, wi);
+    /* z = A + iB, with the coefficients past d2/2 taken from the symmetry */
+    for (c = 0; c < d2; c++) {
+      real *zcr = za + c * h, *zci = zb + c * h;
+      if (c < k) {
+        for (p = 0; p < h; p++) {
+          zcr[p] = sa[2 * p * k + c] - sb[(2 * p + 1) * k + c];
+          zci[p] = sb[2 * p * k + c] + sa[(2 * p + 1) * k + c];
+        }
+      } else {
+        long cn = d2 - c;
+        for (p = 0; p < h; p++) {
+          zcr[p] = sa[2 * p * k + cn] + sb[(2 * p + 1) * k + cn];
+          zci[p] = sa[(2 * p + 1) * k + cn] - sb[2 * p * k + cn];
+        }
+      }
+    }
+    THFFT_(backward)(prow, za, zb, h, wr, wi);
+    for (p = 0; p < h; p++)
+      for (c = 0; c < d2; c++) {
+        xa[2 * p * d2 + c] = za[c * h + p];
+        xa[(2 * p + 1) * d2 + c] = zb[c * h + p];
+      }
+  }
+}
+
+#undef THFFT_CMUL
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/THFFT.h"
+#else
+
+/* Complex transforms of length n, for n a product of 2, 3 and 5. Plans are
+   created once per length and kept: they are shared by all the threads. */
+typedef struct THFFTPlan
+{
+  long n;
+  int nfactor;
+  int factor[64];
+  real *twr, *twi;     /* twiddle factors of the stages, real and imaginary parts */
+  struct THFFTPlan *next;
+} THFFTPlan;
+
+TH_API THFFTPlan *THFFT_(plan)(long n);
+
+/* In place transforms of howmany interleaved sequences: element j of
+   sequence b is (re, im)[j*howmany + b]. The backward transform is not
+   normalized. wre and wim are buffers of n*howmany elements. */
+TH_API void THFFT_(forward)(THFFTPlan *plan, real *re, real *im, long howmany, real *wre, real *wim);
+TH_API void THFFT_(backward)(THFFTPlan *plan, real *re, real *im, long howmany, real *wre, real *wim);
+
+/* Transforms of a real array x of d0 x d1 x d2 elements (d1 even) to the
+   d0 x d1 x (d2/2+1) first coefficients of its spectrum (sre, sim), and
+   back (not normalized: x is multiplied by d0*d1*d2). work is a buffer of
+   THFFT_(realWorkSize)(d0, d1, d2) elements. */
+TH_API long THFFT_(realWorkSize)(long d0, long d1, long d2);
+TH_API void THFFT_(realForward)(real *x, long d0, long d1, long d2, real *sre, real *sim, real *work);
+TH_API void THFFT_(realBackward)(real *sre, real *sim, long d0, long d1, long d2, real *x, real *work);
+
+#endif
@@ -50,7 +50,25 @@ void THStorage_(copy##TYPENAMESRC)(THStorage *storage, TH##TYPENAMESRC##Storage
     storage->data[i] = src->data[i];		\
 }
 
-#ifndef TH_REAL_IS_HALF
+#define IMPLEMENT_THStorage_COPY_FROM_BFLOAT16(TYPENAMESRC)		\
+void THStorage_(copy##TYPENAMESRC)(THStorage *storage, TH##TYPENAMESRC##Storage *src) \
+{ \
+  THArgCheck(storage->size == src->size, 2, "size mismatch"); \
+  ptrdiff_t i;								\
+  for(i = 0; i < storage->size; i++)					\
+    storage->data[i] = (real)TH_bfloat162float(src->data[i]);		\
+}
+
+#define IMPLEMENT_THStorage_COPY_TO_BFLOAT16(TYPENAMESRC)		\
+void THStorage_(copy##TYPENAMESRC)(THStorage *storage, TH##TYPENAMESRC##Storage *src) \
+{ \
+  THArgCheck(storage->size == src->size, 2, "size mismatch"); \
+  ptrdiff_t i;								\
+  for(i = 0; i < storage->size; i++)					\
+    storage->data[i] = TH_float2bfloat16((float)(src->data[i]));		\
+}
+
+#if !defined(TH_REAL_IS_HALF) && !defined(TH_REAL_IS_BFLOAT16)
 IMPLEMENT_THStorage_COPY(Byte)
 IMPLEMENT_THStorage_COPY(Char)
 IMPLEMENT_THStorage_COPY(Short)
@@ -58,8 +76,25 @@ IMPLEMENT_THStorage_COPY(Int)
 IMPLEMENT_THStorage_COPY(Long)
 IMPLEMENT_THStorage_COPY(Float)
 IMPLEMENT_THStorage_COPY(Double)
+#if defined(TH_REAL_IS_FLOAT)
+void THStorage_(copyHalf)(THStorage *storage, THHalfStorage *src)
+{
+  THArgCheck(storage->size == src->size, 2, "size mismatch");
+  THVector_(fromHalf)(storage->data, src->data, storage->size);
+}
+#else
 IMPLEMENT_THStorage_COPY_FROM_HALF(Half)
+#endif
+#if defined(TH_REAL_IS_FLOAT)
+void THStorage_(copyBFloat16)(THStorage *storage, THBFloat16Storage *src)
+{
+  THArgCheck(storage->size == src->size, 2, "size mismatch");
+  TH_bfloat162float_array(storage->data, src->data, storage->size);
+}
 #else
+IMPLEMENT_THStorage_COPY_FROM_BFLOAT16(BFloat16)
+#endif
+#elif defined(TH_REAL_IS_HALF)
 /* only allow pass-through for Half */
 IMPLEMENT_THStorage_COPY_TO_FROM_HALF(Half)
 IMPLEMENT_THStorage_COPY_TO_HALF(Byte)
@@ -67,8 +102,40 @@ IMPLEMENT_THStorage_COPY_TO_HALF(Char)
 IMPLEMENT_THStorage_COPY_TO_HALF(Short)
 IMPLEMENT_THStorage_COPY_TO_HALF(Int)
 IMPLEMENT_THStorage_COPY_TO_HALF(Long)
-IMPLEMENT_THStorage_COPY_TO_HALF(Float)
 IMPLEMENT_THStorage_COPY_TO_HALF(Double)
+void THStorage_(copyFloat)(THStorage *storage, THFloatStorage *src)
+{
+  THArgCheck(storage->size == src->size, 2, "size mismatch");
+  THFloatVector_toHalf(storage->data, src->data, storage->size);
+}
+void THStorage_(copyBFloat16)(THStorage *storage, THBFloat16Storage *src)
+{
+  THArgCheck(storage->size == src->size, 2, "size mismatch");
+  ptrdiff_t i;
+  for(i = 0; i < storage->size; i++)
+    storage->data[i] = TH_float2half(TH_bfloat162float(src->data[i]));
+}
+#else
+/* only allow pass-through for BFloat16 */
+IMPLEMENT_THStorage_COPY_TO_FROM_HALF(BFloat16)
+IMPLEMENT_THStorage_COPY_TO_BFLOAT16(Byte)
+IMPLEMENT_THStorage_COPY_TO_BFLOAT16(Char)
+IMPLEMENT_THStorage_COPY_TO_BFLOAT16(Short)
+IMPLEMENT_THStorage_COPY_TO_BFLOAT16(Int)
+IMPLEMENT_THStorage_COPY_TO_BFLOAT16(Long)
+IMPLEMENT_THStorage_COPY_TO_BFLOAT16(Double)
+void THStorage_(copyFloat)(THStorage *storage, THFloatStorage *src)
+{
+  THArgCheck(storage->size == src->size, 2, "size mismatch");
+  TH_float2bfloat16_array(storage->data, src->data, storage->size);
+}
+void THStorage_(copyHalf)(THStorage *storage, THHalfStorage *src)
+{
+  THArgCheck(storage->size == src->size, 2, "size mismatch");
+  ptrdiff_t i;
+  for(i = 0; i < storage->size; i++)
+    storage->data[i] = TH_float2bfloat16(TH_half2float(src->data[i]));
+}
 #endif
 
 
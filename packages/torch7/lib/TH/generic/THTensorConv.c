@@ -2,6 +2,206 @@
 #define TH_GENERIC_FILE "generic/THTensorConv.c"
 #else
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if defined(TH_REAL_IS_FLOAT) || defined(TH_REAL_IS_DOUBLE)
+
+/*
+  Convolutions through FFT, for large kernels and unit strides (overlap-save):
+  the output is cut in blocks, each one obtained from an input tile of f
+  elements per dimension by a circular convolution of length f, of which the
+  first k-1 elements are dropped. The kernel spectrum is computed once per
+  call, the transform plans are cached per length.
+*/
+
+/* cost of the FFT path per tile element and log2 of the tile size, relative
+   to one multiply-add of the direct loops */
+#define TH_CONV_FFT_COST 1.5
+#define TH_CONV_FFT_MAX 256
+
+/* transform length f along a dimension of o outputs and a kernel of k
+   elements: the one minimizing the work per output, with ceil(o/(f-k+1))
+   blocks */
+static long THTensor_(convFFTSize)(long o, long k, int even, long *nblock)
+{
+  long f, best = 0, fmax = THFFT_goodSize(o + k - 1, even);
+  double cost, bestcost = 0;
+  if (k == 1 && !even) {
+    *nblock = o;
+    return 1;
+  }
+  for (f = THFFT_goodSize(k, even); f <= fmax; f = THFFT_goodSize(f + 1, even)) {
+    long n = (o + f - k) / (f - k + 1);
+    cost = (double)n * f * (log((double)f) / log(2.) + 4);
+    if (best == 0 || cost < bestcost) {
+      best = f;
+      bestcost = cost;
+      *nblock = n;
+    }
+    if (f >= TH_CONV_FFT_MAX && f >= 2 * k)
+      break;
+  }
+  return best;
+}
+
+/* copies the tile of input t starting at (s0, s1, s2), zero outside of t */
+static void THTensor_(convFFTTile)(real *x, long f0, long f1, long f2,
+                                   real *t_, long it, long ir, long ic,
+                                   long s0, long s1, long s2)
+{
+  long a, b;
+  long c0 = (s2 < 0 ? -s2 : 0), c1 = (ic - s2 < f2 ? ic - s2 : f2);
+  if (c1 < c0)
+    c1 = c0;
+  for (a = 0; a < f0; a++) {
+    for (b = 0; b < f1; b++) {
+      real *xr = x + (a * f1 + b) * f2;
+      long p = s0 + a, q = s1 + b;
+      if (p < 0 || p >= it || q < 0 || q >= ir || c0 == c1) {
+        memset(xr, 0, f2 * sizeof(real));
+      } else {
+        memset(xr, 0, c0 * sizeof(real));
+        memcpy(xr + c0, t_ + (p * ir + q) * ic + s2 + c0, (c1 - c0) * sizeof(real));
+        memset(xr + c1, 0, (f2 - c1) * sizeof(real));
+      }
+    }
+  }
+}
+
+/* whether the n elements of x are all finite (v*0 is NaN for an inf or a NaN) */
+static int THTensor_(convFFTFinite)(real *x, long n)
+{
+  real s = 0;
+  long i;
+  for (i = 0; i < n; i++)
+    s += x[i] * 0;
+  return s == 0;
+}
+
+/*
+  r += alpha * conv(t, k), for the valid (full = 0) or full convolution with
+  unit strides, the kernel being flipped for a cross-correlation (xcorr = 1).
+  Returns 0, doing nothing, when the direct loops should be faster, or when t
+  or k holds an inf or a NaN (which the transforms would spread to all the
+  outputs of a tile).
+*/
+static int THTensor_(convFFT)(real *r_, real alpha,
+                              real *t_, long it, long ir, long ic,
+                              real *k_, long kt, long kr, long kc,
+                              int full, int xcorr)
+{
+  long ot = (full ? it + kt - 1 : it - kt + 1);
+  long or = (full ? ir + kr - 1 : ir - kr + 1);
+  long oc = (full ? ic + kc - 1 : ic - kc + 1);
+  long f0, f1, f2, n0, n1, n2, nf, nspec, per, ntile, u;
+  real *kre, *kim, *buf;
+  int nthread = 1;
+
+  if (ot < 1 || or < 1 || oc < 1 || kt * kr * kc < 32)
+    return 0;
+  f0 = THTensor_(convFFTSize)(ot, kt, 0, &n0);
+  f1 = THTensor_(convFFTSize)(or, kr, 1, &n1);
+  f2 = THTensor_(convFFTSize)(oc, kc, 0, &n2);
+  nf = f0 * f1 * f2;
+  ntile = n0 * n1 * n2;
+  if (TH_CONV_FFT_COST * ntile * nf * (log((double)nf) / log(2.) + 4)
+      > (double)ot * or * oc * kt * kr * kc)
+    return 0;
+  if (!THTensor_(convFFTFinite)(t_, it * ir * ic) || !THTensor_(convFFTFinite)(k_, kt * kr * kc))
+    return 0;
+
+  nspec = f0 * f1 * (f2 / 2 + 1);
+  per = nf + 2 * nspec + THFFT_(realWorkSize)(f0, f1, f2);
+#ifdef _OPENMP
+  if (!omp_in_parallel())
+    nthread = omp_get_max_threads();
+  if (nthread > ntile)
+    nthread = ntile;
+#endif
+  buf = (real *)THAlloc(sizeof(real) * (2 * nspec + nthread * per));
+  kre = buf;
+  kim = buf + nspec;
+
+  /* spectrum of the kernel, scaled by alpha and the normalization */
+  {
+    real *x = buf + 2 * nspec, *work = x + nf + 2 * nspec;
+    real scale = alpha / nf;
+    long a, b, c;
+    memset(x, 0, nf * sizeof(real));
+    for (a = 0; a < kt; a++)
+      for (b = 0; b < kr; b++)
+        for (c = 0; c < kc; c++) {
+          real v = (xcorr ? k_[((kt-1-a) * kr + kr-1-b) * kc + kc-1-c]
+                          : k_[(a * kr + b) * kc + c]);
+          x[(a * f1 + b) * f2 + c] = v;
+        }
+    THFFT_(realForward)(x, f0, f1, f2, kre, kim, work);
+    for (a = 0; a < nspec; a++) {
+      kre[a] *= scale;
+      kim[a] *= scale;
+    }
+  }
+
+#pragma omp parallel for if (nthread > 1) num_threads(nthread)
+  for (u = 0; u < ntile; u++) {
+    int tid = 0;
+    real *x, *sre, *sim, *work;
+    long o0, o1, o2, l0, l1, l2, a, b, j;
+#ifdef _OPENMP
+    tid = omp_get_thread_num();
+#endif
+    x = buf + 2 * nspec + tid * per;
+    sre = x + nf;
+    sim = sre + nspec;
+    work = sim + nspec;
+
+    /* output block, and the input tile it depends on */
+    o0 = (u / (n1 * n2)) * (f0 - kt + 1);
+    o1 = ((u / n2) % n1) * (f1 - kr + 1);
+    o2 = (u % n2) * (f2 - kc + 1);
+    l0 = THMin(f0 - kt + 1, ot - o0);
+    l1 = THMin(f1 - kr + 1, or - o1);
+    l2 = THMin(f2 - kc + 1, oc - o2);
+    if (full)
+      THTensor_(convFFTTile)(x, f0, f1, f2, t_, it, ir, ic, o0 - kt + 1, o1 - kr + 1, o2 - kc + 1);
+    else
+      THTensor_(convFFTTile)(x, f0, f1, f2, t_, it, ir, ic, o0, o1, o2);
+
+    THFFT_(realForward)(x, f0, f1, f2, sre, sim, work);
+    for (j = 0; j < nspec; j++) {
+      real re = sre[j] * kre[j] - sim[j] * kim[j];
+      real im = sre[j] * kim[j] + sim[j] * kre[j];
+      sre[j] = re;
+      sim[j] = im;
+    }
+    THFFT_(realBackward)(sre, sim, f0, f1, f2, x, work);
+
+    for (a = 0; a < l0; a++)
+      for (b = 0; b < l1; b++) {
+        real *ro = r_ + ((o0 + a) * or + o1 + b) * oc + o2;
+        real *xo = x + ((kt - 1 + a) * f1 + kr - 1 + b) * f2 + kc - 1;
+        THVector_(cadd)(ro, ro, xo, 1, l2);
+      }
+  }
+
+  THFree(buf);
+  return 1;
+}
+
+#else
+
+static int THTensor_(convFFT)(real *r_, real alpha,
+                              real *t_, long it, long ir, long ic,
+                              real *k_, long kt, long kr, long kc,
+                              int full, int xcorr)
+{
+  return 0;
+}
+
+#endif
+
 /*
   2D Input, 2D kernel  : convolve given image with the given kernel.
 */
@@ -16,6 +216,10 @@ void THTensor_(validXCorr2Dptr)(real *r_,
 
   long xx, yy, kx, ky;
 
+  if (sr == 1 && sc == 1 &&
+      THTensor_(convFFT)(r_, alpha, t_, 1, ir, ic, k_, 1, kr, kc, 0, 1))
+    return;
+
   if ((sc != 1) || (oc < 4))  {
     /* regular convolution */
     for(yy = 0; yy < or; yy++) {
@@ -69,6 +273,10 @@ void THTensor_(validConv2Dptr)(real *r_,
 
   long xx, yy, kx, ky;
 
+  if (sr == 1 && sc == 1 &&
+      THTensor_(convFFT)(r_, alpha, t_, 1, ir, ic, k_, 1, kr, kc, 0, 0))
+    return;
+
   if ((sc != 1) || (oc < 4))  {
     /* regular convolution */
     for(yy = 0; yy < or; yy++) {
@@ -121,6 +329,10 @@ void THTensor_(fullConv2Dptr)(real *r_,
 
   long xx, yy, kx, ky;
 
+  if (sr == 1 && sc == 1 &&
+      THTensor_(convFFT)(r_, alpha, t_, 1, ir, ic, k_, 1, kr, kc, 1, 0))
+    return;
+
   if ((sc != 1) || (ic < 4))  {
     /* regular convolution */
     for(yy = 0; yy < ir; yy++) {
@@ -173,6 +385,10 @@ void THTensor_(fullXCorr2Dptr)(real *r_,
 
   long xx, yy, kx, ky;
 
+  if (sr == 1 && sc == 1 &&
+      THTensor_(convFFT)(r_, alpha, t_, 1, ir, ic, k_, 1, kr, kc, 1, 1))
+    return;
+
   if ((sc != 1) || (ic < 4))  {
     /* regular convolution */
     for(yy = 0; yy < ir; yy++) {
@@ -278,6 +494,10 @@ void THTensor_(validXCorr3Dptr)(real *r_,
 
   long zz, xx, yy;
 
+  if (st == 1 && sr == 1 && sc == 1 &&
+      THTensor_(convFFT)(r_, alpha, t_, it, ir, ic, k_, kt, kr, kc, 0, 1))
+    return;
+
   for (zz = 0; zz < ot; zz++)
   {
     for(yy = 0; yy < or; yy++)
@@ -323,6 +543,10 @@ void THTensor_(validConv3Dptr)(real *r_,
 
   long zz, xx, yy;
 
+  if (st == 1 && sr == 1 && sc == 1 &&
+      THTensor_(convFFT)(r_, alpha, t_, it, ir, ic, k_, kt, kr, kc, 0, 0))
+    return;
+
   for(zz = 0; zz < ot; zz++)
   {
     for(yy = 0; yy < or; yy++)
@@ -368,6 +592,10 @@ void THTensor_(fullConv3Dptr)(real *r_,
 
   long zz, xx, yy;
 
+  if (st == 1 && sr == 1 && sc == 1 &&
+      THTensor_(convFFT)(r_, alpha, t_, it, ir, ic, k_, kt, kr, kc, 1, 0))
+    return;
+
   for(zz = 0; zz < it; zz++)
   {
     for(yy = 0; yy < ir; yy++)
@@ -416,6 +644,10 @@ void THTensor_(fullXCorr3Dptr)(real *r_,
 
   long zz, xx, yy;
 
+  if (st == 1 && sr == 1 && sc == 1 &&
+      THTensor_(convFFT)(r_, alpha, t_, it, ir, ic, k_, kt, kr, kc, 1, 1))
+    return;
+
   for(zz = 0; zz < it; zz++)
   {
     for(yy = 0; yy < ir; yy++)
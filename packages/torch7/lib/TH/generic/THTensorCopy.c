@@ -73,12 +73,12 @@ void THTensor_(copy)(THTensor *tensor, THTensor *src)
     real *sp = THTensor_(data)(src);
     real *rp = THTensor_(data)(tensor);
     ptrdiff_t sz = THTensor_(nElement)(tensor);
-#ifndef TH_REAL_IS_HALF
+#if !defined(TH_REAL_IS_HALF) && !defined(TH_REAL_IS_BFLOAT16)
     THVector_(copy)(rp, sp, sz);
 #else
     memcpy(rp, sp, sz * sizeof(real));
 #endif
-#ifndef TH_REAL_IS_HALF
+#if !defined(TH_REAL_IS_HALF) && !defined(TH_REAL_IS_BFLOAT16)
   } else if (THTensor_(copyTransposeValid)(tensor, src)) {
     THTensor_(copyTranspose)(tensor, src);
 #endif
@@ -111,7 +111,19 @@ void THTensor_(copy##TYPENAMESRC)(THTensor *tensor, TH##TYPENAMESRC##Tensor *src
  TH_TENSOR_APPLY2(real, tensor, TYPE_SRC, src, *tensor_data = *src_data;) \
 }
 
-#ifndef TH_REAL_IS_HALF
+#define IMPLEMENT_THTensor_COPY_TO_BFLOAT16(TYPENAMESRC, TYPE_SRC) \
+void THTensor_(copy##TYPENAMESRC)(THTensor *tensor, TH##TYPENAMESRC##Tensor *src) \
+{ \
+ TH_TENSOR_APPLY2(real, tensor, TYPE_SRC, src, *tensor_data = TH_float2bfloat16((float)*src_data);) \
+}
+
+#define IMPLEMENT_THTensor_COPY_FROM_BFLOAT16(TYPENAMESRC, TYPE_SRC) \
+void THTensor_(copy##TYPENAMESRC)(THTensor *tensor, TH##TYPENAMESRC##Tensor *src) \
+{ \
+ TH_TENSOR_APPLY2(real, tensor, TYPE_SRC, src, *tensor_data = (real)TH_bfloat162float(*src_data);) \
+}
+
+#if !defined(TH_REAL_IS_HALF) && !defined(TH_REAL_IS_BFLOAT16)
 IMPLEMENT_THTensor_COPY(Byte, unsigned char)
 IMPLEMENT_THTensor_COPY(Char, char)
 IMPLEMENT_THTensor_COPY(Short, short)
@@ -119,8 +131,35 @@ IMPLEMENT_THTensor_COPY(Int, int)
 IMPLEMENT_THTensor_COPY(Long, long)
 IMPLEMENT_THTensor_COPY(Float, float)
 IMPLEMENT_THTensor_COPY(Double, double)
+#if defined(TH_REAL_IS_FLOAT)
+void THTensor_(copyHalf)(THTensor *tensor, THHalfTensor *src)
+{
+  if(THTensor_(isContiguous)(tensor) && THHalfTensor_isContiguous(src) &&
+     THTensor_(nElement)(tensor) == THHalfTensor_nElement(src)) {
+    THVector_(fromHalf)(THTensor_(data)(tensor), THHalfTensor_data(src),
+                        THTensor_(nElement)(tensor));
+  } else {
+    TH_TENSOR_APPLY2(real, tensor, THHalf, src, *tensor_data = TH_half2float(*src_data);)
+  }
+}
+#else
 IMPLEMENT_THTensor_COPY_FROM_HALF(Half, THHalf)
+#endif
+#if defined(TH_REAL_IS_FLOAT)
+void THTensor_(copyBFloat16)(THTensor *tensor, THBFloat16Tensor *src)
+{
+  if(THTensor_(isContiguous)(tensor) && THBFloat16Tensor_isContiguous(src) &&
+     THTensor_(nElement)(tensor) == THBFloat16Tensor_nElement(src)) {
+    TH_bfloat162float_array(THTensor_(data)(tensor), THBFloat16Tensor_data(src),
+                            THTensor_(nElement)(tensor));
+  } else {
+    TH_TENSOR_APPLY2(real, tensor, THBFloat16, src, *tensor_data = TH_bfloat162float(*src_data);)
+  }
+}
 #else
+IMPLEMENT_THTensor_COPY_FROM_BFLOAT16(BFloat16, THBFloat16)
+#endif
+#elif defined(TH_REAL_IS_HALF)
 /* only allow pass-through for Half */
 IMPLEMENT_THTensor_COPY_TO_FROM_HALF(Half, THHalf)
 IMPLEMENT_THTensor_COPY_TO_HALF(Byte, unsigned char)
@@ -128,9 +167,45 @@ IMPLEMENT_THTensor_COPY_TO_HALF(Char, char)
 IMPLEMENT_THTensor_COPY_TO_HALF(Short, short)
 IMPLEMENT_THTensor_COPY_TO_HALF(Int, int)
 IMPLEMENT_THTensor_COPY_TO_HALF(Long, long)
-IMPLEMENT_THTensor_COPY_TO_HALF(Float, float)
 IMPLEMENT_THTensor_COPY_TO_HALF(Double, double)
+void THTensor_(copyFloat)(THTensor *tensor, THFloatTensor *src)
+{
+  if(THTensor_(isContiguous)(tensor) && THFloatTensor_isContiguous(src) &&
+     THTensor_(nElement)(tensor) == THFloatTensor_nElement(src)) {
+    THFloatVector_toHalf(THTensor_(data)(tensor), THFloatTensor_data(src),
+                         THTensor_(nElement)(tensor));
+  } else {
+    TH_TENSOR_APPLY2(real, tensor, float, src, *tensor_data = TH_float2half(*src_data);)
+  }
+}
+void THTensor_(copyBFloat16)(THTensor *tensor, THBFloat16Tensor *src)
+{
+  TH_TENSOR_APPLY2(real, tensor, THBFloat16, src, *tensor_data = TH_float2half(TH_bfloat162float(*src_data));)
+}
+#else
+/* only allow pass-through for BFloat16 */
+IMPLEMENT_THTensor_COPY_TO_FROM_HALF(BFloat16, THBFloat16)
+IMPLEMENT_THTensor_COPY_TO_BFLOAT16(Byte, unsigned char)
+IMPLEMENT_THTensor_COPY_TO_BFLOAT16(Char, char)
+IMPLEMENT_THTensor_COPY_TO_BFLOAT16(Short, short)
+IMPLEMENT_THTensor_COPY_TO_BFLOAT16(Int, int)
+IMPLEMENT_THTensor_COPY_TO_BFLOAT16(Long, long)
+IMPLEMENT_THTensor_COPY_TO_BFLOAT16(Double, double)
+void THTensor_(copyFloat)(THTensor *tensor, THFloatTensor *src)
+{
+  if(THTensor_(isContiguous)(tensor) && THFloatTensor_isContiguous(src) &&
+     THTensor_(nElement)(tensor) == THFloatTensor_nElement(src)) {
+    TH_float2bfloat16_array(THTensor_(data)(tensor), THFloatTensor_data(src),
+                            THTensor_(nElement)(tensor));
+  } else {
+    TH_TENSOR_APPLY2(real, tensor, float, src, *tensor_data = TH_float2bfloat16(*src_data);)
+  }
+}
+void THTensor_(copyHalf)(THTensor *tensor, THHalfTensor *src)
+{
+  TH_TENSOR_APPLY2(real, tensor, THHalf, src, *tensor_data = TH_float2bfloat16(TH_half2float(*src_data));)
+}
 
-#endif /* REAL_IS_HALF */
+#endif /* REAL_IS_HALF || REAL_IS_BFLOAT16 */
 
 #endif
@@ -237,13 +237,335 @@ void THTensor_(nonzero)(THLongTensor *subscript, THTensor *tensor)
                   ++i;);
 }
 
+/* Indexing engine of indexSelect, indexCopy, indexAdd, gather, scatter and
+   scatterAdd.
+   When the tensors are contiguous, a tensor indexed along a dimension is
+   seen as outer x n x inner. Rows of inner elements are moved with memcpy
+   or added with loops that vectorize, and the rows of the next indices are
+   prefetched while a row is moved. Rows of one element are gathered with
+   THVector_(gather), which uses the hardware gather of AVX2.
+   Indices are checked before any element is written, or while they are
+   read (a faulty index is then skipped by scatter, read as the first one
+   by gather, and reported after the loop), so that no error is raised in
+   a parallel region.
+   Copies and additions into the indexed tensor may hit the same row more
+   than once. When the rows are wide, the threads share out blocks of
+   columns; otherwise they share out ranges of rows, the indices being
+   bucket-sorted by range of rows with a stable counting sort. Either way,
+   each element receives its updates in the order of the indices, as in a
+   sequential loop, and the results do not depend on the number of
+   threads. Other layouts use the generic loops. */
+#define TH_INDEX_CHUNK 1024    /* elements gathered at a time */
+#define TH_INDEX_BLOCK 256     /* minimal number of columns of a block */
+#define TH_INDEX_BUCKETS 4     /* ranges of rows per thread */
+#define TH_INDEX_PREFETCH 4    /* rows read ahead */
+#define TH_INDEX_PREFETCH_BYTES 256
+
+#if defined(__GNUC__)
+#define TH_INDEX_PREFETCH_ROW(P, BYTES)                                 \
+  {                                                                     \
+    size_t TH_INDEX_b;                                                  \
+    for (TH_INDEX_b = 0; TH_INDEX_b < (BYTES) && TH_INDEX_b < TH_INDEX_PREFETCH_BYTES; TH_INDEX_b += 64) \
+      __builtin_prefetch((const char *)(P) + TH_INDEX_b);               \
+  }
+#else
+#define TH_INDEX_PREFETCH_ROW(P, BYTES)
+#endif
+
+/* sizes before and after dimension dim */
+static void THTensor_(indexShape)(int nDimension, long *size, int dim, long *outer, long *inner)
+{
+  int d;
+  *outer = 1;
+  *inner = 1;
+  for (d = 0; d < dim; d++)
+    *outer *= size[d];
+  for (d = dim + 1; d < nDimension; d++)
+    *inner *= size[d];
+}
+
+/* whether two tensors have the same size, except maybe along dimension dim */
+static int THTensor_(indexSameShape)(int nDimension, long *size, int nDimension2, long *size2, int dim)
+{
+  int d;
+  if (nDimension != nDimension2)
+    return 0;
+  for (d = 0; d < nDimension; d++)
+    if (d != dim && size[d] != size2[d])
+      return 0;
+  return 1;
+}
+
+/* whether all the indices are in [TH_INDEX_BASE, size + TH_INDEX_BASE) */
+static int THTensor_(indexValid)(const long *index, ptrdiff_t n, long size)
+{
+  ptrdiff_t i;
+  int valid = 1;
+  for (i = 0; i < n; i++)
+    valid &= ((unsigned long)(index[i] - TH_INDEX_BASE) < (unsigned long)size);
+  return valid;
+}
+
+/* stable counting sort of the positions of n valid indices into size rows,
+   by range of rows: the positions of bucket b are order[start[b] ..
+   start[b+1]), for at most nbucket buckets of consecutive rows */
+static void THTensor_(indexBuckets)(const long *index, long n, long size, long nbucket, int nthread,
+                                    long *order, long *start)
+{
+  long *count = THAlloc(nthread * nbucket * sizeof(long));
+  long b, sum = 0;
+  int shift = 0, t;
+  while (((size - 1) >> shift) >= nbucket)
+    shift++;
+
+#pragma omp parallel for num_threads(nthread)
+  for (t = 0; t < nthread; t++) {
+    long i, i1 = n * (t + 1) / nthread;
+    long *c = count + t * nbucket;
+    memset(c, 0, nbucket * sizeof(long));
+    for (i = n * t / nthread; i < i1; i++)
+      c[(index[i] - TH_INDEX_BASE) >> shift]++;
+  }
+  for (b = 0; b < nbucket; b++) {
+    start[b] = sum;
+    for (t = 0; t < nthread; t++) {
+      long c = count[t * nbucket + b];
+      count[t * nbucket + b] = sum;
+      sum += c;
+    }
+  }
+  start[nbucket] = sum;
+#pragma omp parallel for num_threads(nthread)
+  for (t = 0; t < nthread; t++) {
+    long i, i1 = n * (t + 1) / nthread;
+    long *c = count + t * nbucket;
+    for (i = n * t / nthread; i < i1; i++)
+      order[c[(index[i] - TH_INDEX_BASE) >> shift]++] = i;
+  }
+  THFree(count);
+}
+
+/* y[o][i][:] = x[o][index[i]][:], for x of outer x n x inner elements and
+   y of outer x numel x inner elements */
+static void THTensor_(indexSelectRows)(real *y, const real *x, const long *index, long numel,
+                                       long outer, long n, long inner)
+{
+  long u;
+  if (inner == 1) {
+    long nchunk = (numel + TH_INDEX_CHUNK - 1) / TH_INDEX_CHUNK;
+#pragma omp parallel for if (outer * numel > TH_OMP_OVERHEAD_THRESHOLD)
+    for (u = 0; u < outer * nchunk; u++) {
+      long off[TH_INDEX_CHUNK];
+      long o = u / nchunk, i0 = (u % nchunk) * TH_INDEX_CHUNK;
+      long k, len = (numel - i0 < TH_INDEX_CHUNK ? numel - i0 : TH_INDEX_CHUNK);
+      for (k = 0; k < len; k++)
+        off[k] = index[i0 + k] - TH_INDEX_BASE;
+      THVector_(gather)(y + o * numel + i0, x + o * n, off, len);
+    }
+  } else {
+#pragma omp parallel for if (outer * numel * inner > TH_OMP_OVERHEAD_THRESHOLD)
+    for (u = 0; u < outer * numel; u++) {
+      long o = u / numel, i = u % numel;
+      if (i + TH_INDEX_PREFETCH < numel)
+        TH_INDEX_PREFETCH_ROW(x + (o * n + index[i + TH_INDEX_PREFETCH] - TH_INDEX_BASE) * inner,
+                              inner * sizeof(real));
+      memcpy(y + u * inner, x + (o * n + index[i] - TH_INDEX_BASE) * inner, inner * sizeof(real));
+    }
+  }
+}
+
+/* y[o][index[i]][:] = x[o][i][:] (or += when add), for y of outer x n x
+   inner elements and x of outer x numel x inner elements */
+static void THTensor_(indexUpdateRows)(real *y, const real *x, const long *index, long numel,
+                                       long outer, long n, long inner, int add)
+{
+  long nblock = 1, u;
+  int nthread = 1;
+#ifdef _OPENMP
+  if (outer * numel * inner > TH_OMP_OVERHEAD_THRESHOLD)
+    nthread = omp_get_max_threads();
+#endif
+  if (outer < nthread) {
+    nblock = (nthread + outer - 1) / outer;
+    if (nblock > inner / TH_INDEX_BLOCK)
+      nblock = (inner / TH_INDEX_BLOCK > 1 ? inner / TH_INDEX_BLOCK : 1);
+  }
+
+  if (outer * nblock >= nthread) {
+    /* blocks of columns */
+#pragma omp parallel for if (nthread > 1) num_threads(nthread)
+    for (u = 0; u < outer * nblock; u++) {
+      long o = u / nblock, b = u % nblock;
+      long j0 = inner * b / nblock, w = inner * (b + 1) / nblock - j0;
+      real *yo = y + o * n * inner + j0;
+      const real *xi = x + o * numel * inner + j0;
+      long i, j;
+      for (i = 0; i < numel; i++, xi += inner) {
+        real *yi = yo + (index[i] - TH_INDEX_BASE) * inner;
+        if (i + TH_INDEX_PREFETCH < numel)
+          TH_INDEX_PREFETCH_ROW(yo + (index[i + TH_INDEX_PREFETCH] - TH_INDEX_BASE) * inner, w * sizeof(real));
+        if (add) {
+          for (j = 0; j < w; j++)
+            yi[j] += xi[j];
+        } else {
+          memcpy(yi, xi, w * sizeof(real));
+        }
+      }
+    }
+  } else {
+    /* ranges of rows */
+    long nbucket = TH_INDEX_BUCKETS * nthread;
+    long *order = THAlloc(numel * sizeof(long));
+    long *start = THAlloc((nbucket + 1) * sizeof(long));
+    THTensor_(indexBuckets)(index, numel, n, nbucket, nthread, order, start);
+#pragma omp parallel for schedule(dynamic) num_threads(nthread)
+    for (u = 0; u < outer * nbucket; u++) {
+      long o = u / nbucket, b = u % nbucket;
+      real *yo = y + o * n * inner;
+      const real *xo = x + o * numel * inner;
+      long k, j;
+      for (k = start[b]; k < start[b + 1]; k++) {
+        long i = order[k];
+        real *yi = yo + (index[i] - TH_INDEX_BASE) * inner;
+        const real *xi = xo + i * inner;
+        if (add) {
+          for (j = 0; j < inner; j++)
+            yi[j] += xi[j];
+        } else {
+          for (j = 0; j < inner; j++)
+            yi[j] = xi[j];
+        }
+      }
+    }
+    THFree(order);
+    THFree(start);
+  }
+}
+
+/* y[o][i][j] = x[o][index[o][i][j]][j], for x of outer x n x inner
+   elements, and y and index of outer x m x inner elements: returns 0 if an
+   index is out of range */
+static int THTensor_(gatherRows)(real *y, const real *x, const long *index, long outer, long n, long m,
+                                 long inner)
+{
+  /* lines of contiguous elements: along the gathered dimension when it is
+     the last one, and across it otherwise */
+  long len = (inner == 1 ? m : inner);
+  long nline = (inner == 1 ? outer : outer * m);
+  long nchunk = (len + TH_INDEX_CHUNK - 1) / TH_INDEX_CHUNK;
+  long u;
+  int bad = 0;
+
+#pragma omp parallel for if (outer * m * inner > TH_OMP_OVERHEAD_THRESHOLD) reduction(|:bad)
+  for (u = 0; u < nline * nchunk; u++) {
+    long off[TH_INDEX_CHUNK];
+    long l = u / nchunk, j0 = (u % nchunk) * TH_INDEX_CHUNK;
+    long k, w = (len - j0 < TH_INDEX_CHUNK ? len - j0 : TH_INDEX_CHUNK);
+    const long *il = index + l * len + j0;
+    const real *xl;
+    if (inner == 1) {
+      xl = x + l * n;
+      for (k = 0; k < w; k++) {
+        long v = il[k] - TH_INDEX_BASE;
+        int ok = ((unsigned long)v < (unsigned long)n);
+        bad |= !ok;
+        off[k] = (ok ? v : 0);
+      }
+    } else {
+      xl = x + (l / m) * n * inner + j0;
+      for (k = 0; k < w; k++) {
+        long v = il[k] - TH_INDEX_BASE;
+        int ok = ((unsigned long)v < (unsigned long)n);
+        bad |= !ok;
+        off[k] = (ok ? v : 0) * inner + k;
+      }
+    }
+    THVector_(gather)(y + l * len + j0, xl, off, w);
+  }
+  return !bad;
+}
+
+/* y[o][index[o][i][j]][j] = x[o][i][j] (or += when add), for y of outer x
+   n x inner elements, index of outer x m x inner elements and x of outer x
+   xn x inner elements (xn >= m): returns 0 if an index is out of range */
+static int THTensor_(scatterRows)(real *y, const real *x, const long *index, long outer, long n, long m,
+                                   long xn, long inner, int add)
+{
+  long nblock = 1, u;
+  int nthread = 1, bad = 0;
+#ifdef _OPENMP
+  if (outer * m * inner > TH_OMP_OVERHEAD_THRESHOLD)
+    nthread = omp_get_max_threads();
+#endif
+  if (outer < nthread) {
+    nblock = (nthread + outer - 1) / outer;
+    if (nblock > inner / TH_INDEX_BLOCK)
+      nblock = (inner / TH_INDEX_BLOCK > 1 ? inner / TH_INDEX_BLOCK : 1);
+  }
+
+  if (outer * nblock >= nthread) {
+    /* blocks of columns */
+#pragma omp parallel for if (nthread > 1) num_threads(nthread) reduction(|:bad)
+    for (u = 0; u < outer * nblock; u++) {
+      long o = u / nblock, b = u % nblock;
+      long j0 = inner * b / nblock, j1 = inner * (b + 1) / nblock;
+      real *yo = y + o * n * inner;
+      const real *xo = x + o * xn * inner;
+      const long *io = index + o * m * inner;
+      long i, j;
+      for (i = 0; i < m; i++, xo += inner, io += inner) {
+        for (j = j0; j < j1; j++) {
+          long v = io[j] - TH_INDEX_BASE;
+          if ((unsigned long)v >= (unsigned long)n) {
+            bad = 1;
+          } else if (add) {
+            yo[v * inner + j] += xo[j];
+          } else {
+            yo[v * inner + j] = xo[j];
+          }
+        }
+      }
+    }
+  } else {
+    /* ranges of rows, one slice at a time */
+    long nbucket = TH_INDEX_BUCKETS * nthread;
+    long *order = THAlloc(m * inner * sizeof(long));
+    long *start = THAlloc((nbucket + 1) * sizeof(long));
+    long o;
+    for (o = 0; o < outer; o++) {
+      real *yo = y + o * n * inner;
+      const real *xo = x + o * xn * inner;
+      const long *io = index + o * m * inner;
+      if (!THTensor_(indexValid)(io, m * inner, n)) {
+        bad = 1;
+        break;
+      }
+      THTensor_(indexBuckets)(io, m * inner, n, nbucket, nthread, order, start);
+#pragma omp parallel for schedule(dynamic) num_threads(nthread)
+      for (u = 0; u < nbucket; u++) {
+        long k;
+        for (k = start[u]; k < start[u + 1]; k++) {
+          long p = order[k];
+          real *yp = yo + (io[p] - TH_INDEX_BASE) * inner + p % inner;
+          if (add)
+            *yp += xo[p];
+          else
+            *yp = xo[p];
+        }
+      }
+    }
+    THFree(order);
+    THFree(start);
+  }
+  return !bad;
+}
+
 void THTensor_(indexSelect)(THTensor *tensor, THTensor *src, int dim, THLongTensor *index)
 {
   ptrdiff_t i, numel;
   THLongStorage *newSize;
   THTensor *tSlice, *sSlice;
   long *index_data;
-  real *tensor_data, *src_data;
 
   THArgCheck(index->nDimension == 1, 3, "Index is supposed to be a vector");
   THArgCheck(dim < src->nDimension, 4,"Indexing dim %d is out of bounds of tensor", dim + TH_INDEX_BASE);
@@ -263,30 +585,20 @@ void THTensor_(indexSelect)(THTensor *tensor, THTensor *src, int dim, THLongTens
   index = THLongTensor_newContiguous(index);
   index_data = THLongTensor_data(index);
 
-  if (dim == 0 && THTensor_(isContiguous)(src) && THTensor_(isContiguous)(tensor))
-  {
-    tensor_data = THTensor_(data)(tensor);
-    src_data = THTensor_(data)(src);
-    ptrdiff_t rowsize = THTensor_(nElement)(src) / src->size[0];
-
-    // check that the indices are within range
-    long max = src->size[0] - 1 + TH_INDEX_BASE;
-    for (i=0; i<numel; i++) {
-      if (index_data[i] < TH_INDEX_BASE || index_data[i] > max) {
-        THLongTensor_free(index);
-        THError("index out of range");
-      }
-    }
+  // check that the indices are within range
+  if (!THTensor_(indexValid)(index_data, numel, src->size[dim])) {
+    THLongTensor_free(index);
+    THError("index out of range");
+  }
 
-    if (src->nDimension == 1) {
-      #pragma omp parallel for if(numel > TH_OMP_OVERHEAD_THRESHOLD) private(i)
-      for (i=0; i<numel; i++)
-        tensor_data[i] = src_data[index_data[i] - TH_INDEX_BASE];
-    } else {
-      #pragma omp parallel for if(numel*rowsize > TH_OMP_OVERHEAD_THRESHOLD) private(i)
-      for (i=0; i<numel; i++)
-        memcpy(tensor_data + i*rowsize, src_data + (index_data[i] - TH_INDEX_BASE)*rowsize, rowsize*sizeof(real));
-    }
+  if (THTensor_(isContiguous)(src))
+  {
+    THTensor *r = THTensor_(newContiguous)(tensor);
+    long outer, inner;
+    THTensor_(indexShape)(src->nDimension, src->size, dim, &outer, &inner);
+    THTensor_(indexSelectRows)(THTensor_(data)(r), THTensor_(data)(src), index_data, numel,
+                               outer, src->size[dim], inner);
+    THTensor_(freeCopyTo)(r, tensor);
   }
   else if (src->nDimension == 1)
   {
@@ -324,7 +636,22 @@ void THTensor_(indexCopy)(THTensor *tensor, int dim, THLongTensor *index, THTens
   index = THLongTensor_newContiguous(index);
   index_data = THLongTensor_data(index);
 
-  if (tensor->nDimension > 1 )
+  if (THTensor_(isContiguous)(tensor) && dim < tensor->nDimension &&
+      THTensor_(indexSameShape)(tensor->nDimension, tensor->size, src->nDimension, src->size, dim))
+  {
+    THTensor *srct = THTensor_(newContiguous)(src);
+    long outer, inner;
+    if (!THTensor_(indexValid)(index_data, numel, tensor->size[dim])) {
+      THTensor_(free)(srct);
+      THLongTensor_free(index);
+      THError("index out of range");
+    }
+    THTensor_(indexShape)(tensor->nDimension, tensor->size, dim, &outer, &inner);
+    THTensor_(indexUpdateRows)(THTensor_(data)(tensor), THTensor_(data)(srct), index_data, numel,
+                               outer, tensor->size[dim], inner, 0);
+    THTensor_(free)(srct);
+  }
+  else if (tensor->nDimension > 1 )
   {
     tSlice = THTensor_(new)();
     sSlice = THTensor_(new)();
@@ -363,7 +690,22 @@ void THTensor_(indexAdd)(THTensor *tensor, int dim, THLongTensor *index, THTenso
   index = THLongTensor_newContiguous(index);
   index_data = THLongTensor_data(index);
 
-  if (tensor->nDimension > 1)
+  if (THTensor_(isContiguous)(tensor) && dim < tensor->nDimension &&
+      THTensor_(indexSameShape)(tensor->nDimension, tensor->size, src->nDimension, src->size, dim))
+  {
+    THTensor *srct = THTensor_(newContiguous)(src);
+    long outer, inner;
+    if (!THTensor_(indexValid)(index_data, numel, tensor->size[dim])) {
+      THTensor_(free)(srct);
+      THLongTensor_free(index);
+      THError("index out of range");
+    }
+    THTensor_(indexShape)(tensor->nDimension, tensor->size, dim, &outer, &inner);
+    THTensor_(indexUpdateRows)(THTensor_(data)(tensor), THTensor_(data)(srct), index_data, numel,
+                               outer, tensor->size[dim], inner, 1);
+    THTensor_(free)(srct);
+  }
+  else if (tensor->nDimension > 1)
   {
     tSlice = THTensor_(new)();
     sSlice = THTensor_(new)();
@@ -432,6 +774,18 @@ void THTensor_(gather)(THTensor *tensor, THTensor *src, int dim, THLongTensor *i
 
   elems_per_row = THLongTensor_size(index, dim);
 
+  if (THTensor_(isContiguous)(tensor) && THTensor_(isContiguous)(src) && THLongTensor_isContiguous(index) &&
+      THTensor_(indexSameShape)(tensor->nDimension, tensor->size, index->nDimension, index->size, -1) &&
+      THTensor_(indexSameShape)(tensor->nDimension, tensor->size, src->nDimension, src->size, dim))
+  {
+    long outer, inner;
+    THTensor_(indexShape)(tensor->nDimension, tensor->size, dim, &outer, &inner);
+    if (!THTensor_(gatherRows)(THTensor_(data)(tensor), THTensor_(data)(src), THLongTensor_data(index),
+                               outer, src->size[dim], elems_per_row, inner))
+      THError("Invalid index in gather");
+    return;
+  }
+
   TH_TENSOR_DIM_APPLY3(real, tensor, real, src, long, index, dim,
                        for (i = 0; i < elems_per_row; ++i)
                        {
@@ -457,6 +811,19 @@ void THTensor_(scatter)(THTensor *tensor, int dim, THLongTensor *index, THTensor
 
   elems_per_row = THLongTensor_size(index, dim);
 
+  if (THTensor_(isContiguous)(tensor) && THTensor_(isContiguous)(src) && THLongTensor_isContiguous(index) &&
+      THTensor_(indexSameShape)(tensor->nDimension, tensor->size, index->nDimension, index->size, dim) &&
+      THTensor_(indexSameShape)(tensor->nDimension, tensor->size, src->nDimension, src->size, dim) &&
+      src->size[dim] >= elems_per_row)
+  {
+    long outer, inner;
+    THTensor_(indexShape)(tensor->nDimension, tensor->size, dim, &outer, &inner);
+    if (!THTensor_(scatterRows)(THTensor_(data)(tensor), THTensor_(data)(src), THLongTensor_data(index),
+                                outer, tensor->size[dim], elems_per_row, src->size[dim], inner, 0))
+      THError("Invalid index in scatter");
+    return;
+  }
+
   TH_TENSOR_DIM_APPLY3(real, tensor, real, src, long, index, dim,
                        for (i = 0; i < elems_per_row; ++i)
                        {
@@ -482,6 +849,19 @@ void THTensor_(scatterAdd)(THTensor *tensor, int dim, THLongTensor *index, THTen
 
   elems_per_row = THLongTensor_size(index, dim);
 
+  if (THTensor_(isContiguous)(tensor) && THTensor_(isContiguous)(src) && THLongTensor_isContiguous(index) &&
+      THTensor_(indexSameShape)(tensor->nDimension, tensor->size, index->nDimension, index->size, dim) &&
+      THTensor_(indexSameShape)(tensor->nDimension, tensor->size, src->nDimension, src->size, dim) &&
+      src->size[dim] >= elems_per_row)
+  {
+    long outer, inner;
+    THTensor_(indexShape)(tensor->nDimension, tensor->size, dim, &outer, &inner);
+    if (!THTensor_(scatterRows)(THTensor_(data)(tensor), THTensor_(data)(src), THLongTensor_data(index),
+                                outer, tensor->size[dim], elems_per_row, src->size[dim], inner, 1))
+      THError("Invalid index in scatterAdd");
+    return;
+  }
+
   TH_TENSOR_DIM_APPLY3(real, tensor, real, src, long, index, dim,
                        for (i = 0; i < elems_per_row; ++i)
                        {
@@ -1402,6 +1782,102 @@ void THTensor_(addmm)(THTensor *r_, real beta, THTensor *t, real alpha, THTensor
     THTensor_(freeCopyTo)(r__, r_);
 }
 
+#if defined(TH_REAL_IS_FLOAT)
+#define TH_BFLOAT16_ADDMM_PANEL 512
+
+/* converts rows [0,n) of the bfloat16 matrix src (columns [k, k+kb)) in the
+   contiguous n x kb float matrix dst */
+static void THTensor_(bfloat16Panel)(float *dst, THBFloat16Tensor *src, long k, long kb)
+{
+  long n = src->size[0];
+  long s0 = src->stride[0];
+  long s1 = src->stride[1];
+  THBFloat16 *src_data = THBFloat16Tensor_data(src);
+  long i;
+
+  #pragma omp parallel for if(n*kb > TH_OMP_OVERHEAD_THRESHOLD) private(i)
+  for(i = 0; i < n; i++)
+  {
+    THBFloat16 *sp = src_data + i*s0 + k*s1;
+    float *dp = dst + i*kb;
+    if(s1 == 1)
+      TH_bfloat162float_array(dp, sp, kb);
+    else
+    {
+      long j;
+      for(j = 0; j < kb; j++)
+        dp[j] = TH_bfloat162float(sp[j*s1]);
+    }
+  }
+}
+
+/* r_ = beta*t + alpha*(m1 @ m2), with bfloat16 operands and float accumulation.
+   The reduction dimension is processed by panels, such that only a slice of each
+   operand is converted to float at a time. */
+void THTensor_(addmmBFloat16)(THTensor *r_, real beta, THTensor *t, real alpha, THBFloat16Tensor *m1, THBFloat16Tensor *m2)
+{
+  THTensor *p1, *p2, *p2t;
+  long k, kb, K;
+
+  if( (m1->nDimension != 2) || (m2->nDimension != 2))
+    THError("matrices expected, got %dD, %dD tensors", m1->nDimension, m2->nDimension);
+
+  if(m1->size[1] != m2->size[0])
+    THError("size mismatch, m1: %ldx%ld, m2: %ldx%ld", m1->size[0], m1->size[1], m2->size[0], m2->size[1]);
+
+  if( t->nDimension != 2 )
+    THError("matrix expected, got %dD tensor for t", t->nDimension);
+
+  if( (t->size[0] != m1->size[0]) || (t->size[1] != m2->size[1]) ) {
+    THDescBuff bt  = THTensor_(sizeDesc)(t);
+    THError("size mismatch, t: %s, m1: %ldx%ld, m2: %ldx%ld", bt.str, m1->size[0], m1->size[1], m2->size[0], m2->size[1]);
+  }
+
+  K = m1->size[1];
+  if(K == 0)
+  {
+    if(t != r_)
+    {
+      THTensor_(resizeAs)(r_, t);
+      THTensor_(copy)(r_, t);
+    }
+    THTensor_(mul)(r_, r_, beta);
+    return;
+  }
+
+  p1 = THTensor_(new)();
+  p2 = THTensor_(new)();
+  p2t = THTensor_(new)();
+  for(k = 0; k < K; k += kb)
+  {
+    THBFloat16Tensor *m2t;
+    kb = (K-k < TH_BFLOAT16_ADDMM_PANEL ? K-k : TH_BFLOAT16_ADDMM_PANEL);
+
+    /* p1 = m1[:, k:k+kb], row-major */
+    THTensor_(resize2d)(p1, m1->size[0], kb);
+    THTensor_(bfloat16Panel)(THTensor_(data)(p1), m1, k, kb);
+
+    /* p2 = m2[k:k+kb, :], converted as the rows of m2^T, i.e. column-major */
+    m2t = THBFloat16Tensor_newTranspose(m2, 0, 1);
+    THTensor_(resize2d)(p2t, m2->size[1], kb);
+    THTensor_(bfloat16Panel)(THTensor_(data)(p2t), m2t, k, kb);
+    THBFloat16Tensor_free(m2t);
+    THTensor_(transpose)(p2, p2t, 0, 1);
+
+    if(k == 0)
+      THTensor_(addmm)(r_, beta, t, alpha, p1, p2);
+    else
+      THTensor_(addmm)(r_, 1, r_, alpha, p1, p2);
+  }
+  THTensor_(free)(p1);
+  THTensor_(free)(p2);
+  THTensor_(free)(p2t);
+}
+
+#undef TH_BFLOAT16_ADDMM_PANEL
+#endif
+
+
 void THTensor_(addr)(THTensor *r_, real beta, THTensor *t, real alpha, THTensor *vec1, THTensor *vec2)
 {
   if( (vec1->nDimension != 1) || (vec2->nDimension != 1) )
@@ -1548,165 +2024,907 @@ ptrdiff_t THTensor_(numel)(THTensor *t)
   return THTensor_(nElement)(t);
 }
 
-void THTensor_(max)(THTensor *values_, THLongTensor *indices_, THTensor *t, int dimension, int keepdim)
+/* offsets of the slices of a tensor along a dimension, in the order of
+   TH_TENSOR_DIM_APPLY */
+static void THTensor_(sliceOffsets)(long *offsets, int nDimension, long *size, long *stride, int dimension)
 {
-  THLongStorage *dim;
-
-  THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 2, "dimension %d out of range",
-      dimension + TH_INDEX_BASE);
+  long *counter = THAlloc(nDimension * sizeof(long));
+  long offset = 0, s, nslice = 1;
+  int d;
+
+  for (d = 0; d < nDimension; d++) {
+    counter[d] = 0;
+    if (d != dimension)
+      nslice *= size[d];
+  }
+  for (s = 0; s < nslice; s++) {
+    offsets[s] = offset;
+    for (d = 0; d < nDimension; d++) {
+      if (d == dimension)
+        continue;
+      counter[d]++;
+      offset += stride[d];
+      if (counter[d] < size[d])
+        break;
+      offset -= counter[d] * stride[d];
+      counter[d] = 0;
+    }
+  }
+  THFree(counter);
+}
 
-  dim = THTensor_(newSizeOf)(t);
-  THLongStorage_set(dim, dimension, 1);
-  THTensor_(resize)(values_, dim, NULL);
-  THLongTensor_resize(indices_, dim, NULL);
-  THLongStorage_free(dim);
+/* Reductions along a dimension.
+
+   Slices whose elements are contiguous are reduced one by one; sums are
+   pairwise: blocks of TH_REDUCE_PAIRWISE_BLOCK elements are summed on 8
+   accumulators (which vectorizes), then the block sums are added up as a
+   binary tree, for an error growing in O(log n) rather than O(n).
+   Otherwise the tensor is made contiguous and seen as outer x n x inner
+   (a column sum of a matrix has an outer size of 1): its rows of inner
+   elements are accumulated TH_REDUCE_BLOCK columns at a time, which reads
+   memory sequentially and vectorizes across the columns; the sums over
+   blocks of rows are added up with a compensated (Kahan) sum. Rows
+   narrower than TH_REDUCE_NARROW are instead transposed by blocks into a
+   buffer, and reduced as contiguous slices.
+   Slices or blocks of columns are spread over the threads; when there are
+   too few of them, the reduced dimension is also cut in chunks, whose
+   partial results are then combined in order. */
+#define TH_REDUCE_SUM 0
+#define TH_REDUCE_PROD 1
+#define TH_REDUCE_MAX 2
+#define TH_REDUCE_MIN 3
+#define TH_REDUCE_NORM0 4 /* number of non zero elements */
+#define TH_REDUCE_NORM1 5 /* sum of absolute values */
+#define TH_REDUCE_NORM2 6 /* sum of squares */
+#define TH_REDUCE_NORMP 7 /* sum of |x|^p */
+#define TH_REDUCE_VAR 8   /* sum of squared deviations from the mean */
+#define TH_REDUCE_LOGSUMEXP 9
+
+#define TH_REDUCE_PAIRWISE_BLOCK 128
+#define TH_REDUCE_BLOCK 1024
+#define TH_REDUCE_NARROW 16
+#define TH_REDUCE_CHUNK 16384 /* minimal number of elements per chunk */
+
+#define TH_REDUCE_LEAF(EXPR)                    \
+  for (i = 0; i + 8 <= n; i += 8)               \
+    for (k = 0; k < 8; k++) {                   \
+      real v = x[i+k];                          \
+      s[k] += (EXPR);                           \
+    }                                           \
+  for (; i < n; i++) {                          \
+    real v = x[i];                              \
+    s[0] += (EXPR);                             \
+  }
 
-  // two implementations optimized for data locality
-  if (t->stride[dimension] == 1) {
-    real theMax;
-    real value;
-    long theIndex;
-    long i;
-    TH_TENSOR_DIM_APPLY3(real, t, real, values_, long, indices_, dimension,
-                         theMax = t_data[0];
-                         theIndex = 0;
+/* additive reduction of at most TH_REDUCE_PAIRWISE_BLOCK elements */
+static accreal THTensor_(reduceLeaf)(const real *x, long n, int op, accreal p, accreal mean)
+{
+  accreal s[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  long i, k;
+  switch (op) {
+#if defined(TH_REAL_IS_FLOAT) || defined(TH_REAL_IS_DOUBLE)
+  case TH_REDUCE_NORM0:
+    TH_REDUCE_LEAF(v != 0);
+    break;
+  case TH_REDUCE_NORM1:
+    TH_REDUCE_LEAF(fabs(v));
+    break;
+  case TH_REDUCE_NORM2:
+    TH_REDUCE_LEAF((accreal)v * v);
+    break;
+  case TH_REDUCE_NORMP:
+    TH_REDUCE_LEAF(pow(fabs(v), p));
+    break;
+  case TH_REDUCE_VAR:
+    TH_REDUCE_LEAF(((accreal)v - mean) * ((accreal)v - mean));
+    break;
+#endif
+  default:
+    TH_REDUCE_LEAF(v);
+  }
+  return ((s[0] + s[1]) + (s[2] + s[3])) + ((s[4] + s[5]) + (s[6] + s[7]));
+}
 
-                         for(i = 0; i < t_size; i++)
-                         {
-                           value = t_data[i*t_stride];
-                           /* This is not the same as value>theMax in the case of NaNs */
-                           if(!(value <= theMax))
-                           {
-                             theIndex = i;
-                             theMax = value;
-                             th_isnan_break(value)
-                           }
-                         }
-                         *indices__data = theIndex;
-                         *values__data = theMax;);
-  } else {
-    if (THTensor_(nDimension)(t) > 1) {
-      THTensor *t0 = THTensor_(newSelect)(t, dimension, 0);
-      THTensor_(copy)(values_, t0);
-      THTensor_(free)(t0);
-    } else {
-      THTensor_(fill)(values_, THTensor_(get1d)(t, 0));
-    }
-    THLongTensor_zero(indices_);
+#undef TH_REDUCE_LEAF
 
-    if(t->size[dimension] == 1) {
-      if (!keepdim) {
-        THTensor_(squeeze1d)(values_, values_, dimension);
-        THLongTensor_squeeze1d(indices_, indices_, dimension);
-      }
-      return;
-    }
+static accreal THTensor_(reducePairwise)(const real *x, long n, int op, accreal p, accreal mean)
+{
+  long half;
+  if (n <= TH_REDUCE_PAIRWISE_BLOCK)
+    return THTensor_(reduceLeaf)(x, n, op, p, mean);
+  half = (n / 2 + 7) & ~7L;
+  return THTensor_(reducePairwise)(x, half, op, p, mean)
+    + THTensor_(reducePairwise)(x + half, n - half, op, p, mean);
+}
 
-    THTensor *tempValues_ = THTensor_(newWithTensor)(values_);
-    // tempValues_.expand_as(t)
-    tempValues_->size[dimension] = t->size[dimension];
-    tempValues_->stride[dimension] = 0;
+#if defined(TH_REAL_IS_FLOAT) || defined(TH_REAL_IS_DOUBLE)
+/* log(exp(a) + exp(b)) */
+static inline accreal THTensor_(logAddExp)(accreal a, accreal b)
+{
+  accreal hi = (a > b ? a : b), lo = (a > b ? b : a);
+  if (lo == -INFINITY || hi == INFINITY)
+    return hi;
+  return hi + log1p(exp(lo - hi));
+}
 
-    THLongTensor *tempIndices_ = THLongTensor_newWithTensor(indices_);
-    // tempIndices_.expand_as(t)
-    tempIndices_->size[dimension] = t->size[dimension];
-    tempIndices_->stride[dimension] = 0;
+/* log of the sum of the exponentials of n elements: the largest one is
+   factored out, which keeps the exponentials in range */
+static accreal THTensor_(logSumExp)(const real *x, long n, long stride)
+{
+  accreal hi = -INFINITY, sum = 0;
+  long i;
+  for (i = 0; i < n; i++)
+    if (x[i*stride] > hi)
+      hi = x[i*stride];
+  if (hi == -INFINITY || hi == INFINITY)
+    return hi;
+  for (i = 0; i < n; i++)
+    sum += exp(x[i*stride] - hi);
+  return hi + log(sum);
+}
+#endif
 
-    TH_TENSOR_APPLY3_D(real, t, real, tempValues_, long, tempIndices_, dimension,
-                          if(!(*t_data <= *tempValues__data) && !th_isnan(*tempValues__data)) {
-                            *tempValues__data = *t_data;
-                            *tempIndices__data = *tempIndices__dimOffset;
-                          });
+/* partial reduction of n contiguous elements: the accumulated value (the
+   extremum for max and min, with its index in idx) */
+static void THTensor_(reduceRow)(const real *x, long n, int op, accreal p, accreal mean,
+                                 accreal *acc, long *idx)
+{
+  long i;
+  real best;
+  long bestIndex = 0;
+  switch (op) {
+  case TH_REDUCE_PROD:
+    *acc = 1;
+    for (i = 0; i < n; i++)
+      *acc *= x[i];
+    break;
+  case TH_REDUCE_MAX:
+    best = x[0];
+    for (i = 0; i < n; i++) {
+      real value = x[i];
+      /* This is not the same as value>best in the case of NaNs */
+      if (!(value <= best)) {
+        bestIndex = i;
+        best = value;
+        th_isnan_break(value)
+      }
+    }
+    *acc = best;
+    *idx = bestIndex;
+    break;
+  case TH_REDUCE_MIN:
+    best = x[0];
+    for (i = 0; i < n; i++) {
+      real value = x[i];
+      if (!(value >= best)) {
+        bestIndex = i;
+        best = value;
+        th_isnan_break(value)
+      }
+    }
+    *acc = best;
+    *idx = bestIndex;
+    break;
+#if defined(TH_REAL_IS_FLOAT) || defined(TH_REAL_IS_DOUBLE)
+  case TH_REDUCE_LOGSUMEXP:
+    *acc = THTensor_(logSumExp)(x, n, 1);
+    break;
+#endif
+  default:
+    *acc = THTensor_(reducePairwise)(x, n, op, p, mean);
+  }
+}
 
-    THTensor_(free)(tempValues_);
-    THLongTensor_free(tempIndices_);
+/* merges the partial result of a later part of a slice into acc and idx */
+static void THTensor_(reduceCombine)(int op, accreal *acc, long *idx, accreal pacc, long pidx)
+{
+  switch (op) {
+  case TH_REDUCE_PROD:
+    *acc *= pacc;
+    break;
+  case TH_REDUCE_MAX:
+    if (!(pacc <= *acc) && !th_isnan(*acc)) {
+      *acc = pacc;
+      *idx = pidx;
+    }
+    break;
+  case TH_REDUCE_MIN:
+    if (!(pacc >= *acc) && !th_isnan(*acc)) {
+      *acc = pacc;
+      *idx = pidx;
+    }
+    break;
+#if defined(TH_REAL_IS_FLOAT) || defined(TH_REAL_IS_DOUBLE)
+  case TH_REDUCE_LOGSUMEXP:
+    *acc = THTensor_(logAddExp)(*acc, pacc);
+    break;
+#endif
+  default:
+    *acc += pacc;
   }
+}
 
-  if (!keepdim) {
-    THTensor_(squeeze1d)(values_, values_, dimension);
-    THLongTensor_squeeze1d(indices_, indices_, dimension);
+/* result of a reduction of n elements (for var, p is the biased flag) */
+static real THTensor_(reduceFinal)(int op, accreal acc, long n, accreal p)
+{
+  switch (op) {
+#if defined(TH_REAL_IS_FLOAT) || defined(TH_REAL_IS_DOUBLE)
+  case TH_REDUCE_NORM2:
+    return (real)sqrt(acc);
+  case TH_REDUCE_NORMP:
+    return (real)pow(acc, 1.0/p);
+  case TH_REDUCE_VAR:
+    return (real)(acc / (p ? n : n - 1));
+#endif
+  default:
+    return (real)acc;
   }
 }
 
-void THTensor_(min)(THTensor *values_, THLongTensor *indices_, THTensor *t, int dimension, int keepdim)
+/* partial reductions of w < TH_REDUCE_NARROW columns over the rows
+   [i0, i1), stride elements apart, through a transposed buffer */
+static void THTensor_(reduceNarrow)(const real *x, long stride, long i0, long i1, long w,
+                                    int op, accreal p, const real *mean, accreal *acc, long *idx)
 {
-  THLongStorage *dim;
+  real buffer[TH_REDUCE_NARROW * TH_REDUCE_PAIRWISE_BLOCK];
+  accreal c[TH_REDUCE_NARROW];
+  int additive = (op == TH_REDUCE_SUM || (op >= TH_REDUCE_NORM0 && op <= TH_REDUCE_VAR));
+  long b, i, j;
+  for (b = i0; b < i1; b += TH_REDUCE_PAIRWISE_BLOCK) {
+    long nb = (i1 - b < TH_REDUCE_PAIRWISE_BLOCK ? i1 - b : TH_REDUCE_PAIRWISE_BLOCK);
+    for (i = 0; i < nb; i++)
+      for (j = 0; j < w; j++)
+        buffer[j*TH_REDUCE_PAIRWISE_BLOCK + i] = x[(b + i)*stride + j];
+    for (j = 0; j < w; j++) {
+      accreal pacc;
+      long pidx = 0;
+      THTensor_(reduceRow)(buffer + j*TH_REDUCE_PAIRWISE_BLOCK, nb, op, p, (mean ? mean[j] : 0),
+                           &pacc, &pidx);
+      if (b == i0) {
+        acc[j] = pacc;
+        idx[j] = b + pidx;
+        c[j] = 0;
+      } else if (additive) {
+        /* compensated sum of the block sums */
+        accreal y = pacc - c[j];
+        accreal sum = acc[j] + y;
+        c[j] = (sum - acc[j]) - y;
+        acc[j] = sum;
+      } else {
+        THTensor_(reduceCombine)(op, &acc[j], &idx[j], pacc, b + pidx);
+      }
+    }
+  }
+}
 
-  THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 2, "dimension %d out of range",
-      dimension + TH_INDEX_BASE);
+/* sums over blocks of TH_REDUCE_PAIRWISE_BLOCK rows, added up with a
+   compensated (Kahan) sum: c holds the low order bits lost by acc */
+#define TH_REDUCE_COLUMNS(EXPR)                                         \
+  {                                                                     \
+    accreal block[TH_REDUCE_BLOCK], c[TH_REDUCE_BLOCK];                 \
+    long b;                                                             \
+    for (j = 0; j < w; j++) {                                           \
+      acc[j] = 0;                                                       \
+      c[j] = 0;                                                         \
+    }                                                                   \
+    for (b = i0; b < i1; b += TH_REDUCE_PAIRWISE_BLOCK) {               \
+      long bend = (i1 - b < TH_REDUCE_PAIRWISE_BLOCK ? i1 : b + TH_REDUCE_PAIRWISE_BLOCK); \
+      for (j = 0; j < w; j++)                                           \
+        block[j] = 0;                                                   \
+      for (i = b; i < bend; i++) {                                      \
+        const real *row = x + i*stride;                                 \
+        for (j = 0; j < w; j++) {                                       \
+          real v = row[j];                                              \
+          block[j] += (EXPR);                                           \
+        }                                                               \
+      }                                                                 \
+      for (j = 0; j < w; j++) {                                         \
+        accreal y = block[j] - c[j];                                    \
+        accreal sum = acc[j] + y;                                       \
+        c[j] = (sum - acc[j]) - y;                                      \
+        acc[j] = sum;                                                   \
+      }                                                                 \
+    }                                                                   \
+  }
 
-  dim = THTensor_(newSizeOf)(t);
-  THLongStorage_set(dim, dimension, 1);
-  THTensor_(resize)(values_, dim, NULL);
-  THLongTensor_resize(indices_, dim, NULL);
-  THLongStorage_free(dim);
+/* partial reductions of w <= TH_REDUCE_BLOCK columns over the rows
+   [i0, i1), stride elements apart (mean: the means of the columns, for
+   var) */
+static void THTensor_(reduceColumns)(const real *x, long stride, long i0, long i1, long w,
+                                     int op, accreal p, const real *mean, accreal *acc, long *idx)
+{
+  long i, j;
+  if (w < TH_REDUCE_NARROW) {
+    THTensor_(reduceNarrow)(x, stride, i0, i1, w, op, p, mean, acc, idx);
+    return;
+  }
+  switch (op) {
+  case TH_REDUCE_PROD:
+    for (j = 0; j < w; j++)
+      acc[j] = 1;
+    for (i = i0; i < i1; i++)
+      for (j = 0; j < w; j++)
+        acc[j] *= x[i*stride + j];
+    break;
+  case TH_REDUCE_MAX:
+  case TH_REDUCE_MIN: {
+    /* in the type of the elements, and without branches, which vectorizes */
+    real best[TH_REDUCE_BLOCK];
+    for (j = 0; j < w; j++) {
+      best[j] = x[i0*stride + j];
+      idx[j] = i0;
+    }
+    for (i = i0 + 1; i < i1; i++) {
+      const real *row = x + i*stride;
+      if (op == TH_REDUCE_MAX) {
+        for (j = 0; j < w; j++) {
+          real v = row[j], b = best[j];
+          int take = !(v <= b) && !th_isnan(b);
+          best[j] = (take ? v : b);
+          idx[j] = (take ? i : idx[j]);
+        }
+      } else {
+        for (j = 0; j < w; j++) {
+          real v = row[j], b = best[j];
+          int take = !(v >= b) && !th_isnan(b);
+          best[j] = (take ? v : b);
+          idx[j] = (take ? i : idx[j]);
+        }
+      }
+    }
+    for (j = 0; j < w; j++)
+      acc[j] = best[j];
+    break;
+  }
+#if defined(TH_REAL_IS_FLOAT) || defined(TH_REAL_IS_DOUBLE)
+  case TH_REDUCE_NORM0:
+    TH_REDUCE_COLUMNS(v != 0);
+    break;
+  case TH_REDUCE_NORM1:
+    TH_REDUCE_COLUMNS(fabs(v));
+    break;
+  case TH_REDUCE_NORM2:
+    TH_REDUCE_COLUMNS((accreal)v * v);
+    break;
+  case TH_REDUCE_NORMP:
+    TH_REDUCE_COLUMNS(pow(fabs(v), p));
+    break;
+  case TH_REDUCE_VAR:
+    TH_REDUCE_COLUMNS(((accreal)v - mean[j]) * ((accreal)v - mean[j]));
+    break;
+  case TH_REDUCE_LOGSUMEXP:
+    for (j = 0; j < w; j++)
+      acc[j] = THTensor_(logSumExp)(x + i0*stride + j, i1 - i0, stride);
+    break;
+#endif
+  default:
+    TH_REDUCE_COLUMNS(v);
+  }
+}
 
-  // two implementations optimized for data locality
-  if (t->stride[dimension] == 1) {
-    real theMax;
-    real value;
-    long theIndex;
-    long i;
-    TH_TENSOR_DIM_APPLY3(real, t, real, values_, long, indices_, dimension,
-                         theMax = t_data[0];
-                         theIndex = 0;
+#undef TH_REDUCE_COLUMNS
 
-                         for(i = 0; i < t_size; i++)
-                         {
-                           value = t_data[i*t_stride];
-                           /* This is not the same as value>theMax in the case of NaNs */
-                           if(!(value >= theMax))
-                           {
-                             theIndex = i;
-                             theMax = value;
-                             th_isnan_break(value)
-                           }
-                         }
-                         *indices__data = theIndex;
-                         *values__data = theMax;);
+/* reduces t along dimension into r_ (and ri_, for max and min), which have
+   the size of t but along dimension, where they have a size of 1; for var,
+   r_ holds the means */
+static void THTensor_(reduceDim)(THTensor *r_, THLongTensor *ri_, THTensor *t, int dimension,
+                                 int op, accreal p)
+{
+  long n = t->size[dimension];
+  ptrdiff_t nelem = THTensor_(nElement)(t);
+  THTensor *src, *r;
+  THLongTensor *ri = NULL;
+  real *x, *r_data;
+  long *ri_data = NULL;
+  long nchunk = 1;
+  int nthread = 1;
+
+  if (n == 0) {
+    THTensor_(fill)(r_, (op == TH_REDUCE_PROD ? 1 : 0));
+    if (ri_)
+      THLongTensor_zero(ri_);
+    return;
+  }
+  if (nelem == 0)
+    return;
+#ifdef _OPENMP
+  if (nelem > TH_OMP_OVERHEAD_THRESHOLD)
+    nthread = omp_get_max_threads();
+#endif
+
+  r = THTensor_(newContiguous)(r_);
+  r_data = THTensor_(data)(r);
+  if (ri_) {
+    ri = THLongTensor_newContiguous(ri_);
+    ri_data = THLongTensor_data(ri);
+  }
+  if (t->stride[dimension] == 1 || n == 1) {
+    THTensor_(retain)(t);
+    src = t;
   } else {
-    if (THTensor_(nDimension)(t) > 1) {
-      THTensor *t0 = THTensor_(newSelect)(t, dimension, 0);
-      THTensor_(copy)(values_, t0);
-      THTensor_(free)(t0);
+    src = THTensor_(newContiguous)(t);
+  }
+  x = THTensor_(data)(src);
+
+  if (src->stride[dimension] == 1 || n == 1) {
+    /* contiguous slices */
+    long nslice = nelem / n;
+    long *offsets = THAlloc(nslice * sizeof(long));
+    long *r_offsets = THAlloc(nslice * sizeof(long));
+    long s, u;
+    THTensor_(sliceOffsets)(offsets, src->nDimension, src->size, src->stride, dimension);
+    THTensor_(sliceOffsets)(r_offsets, r->nDimension, r->size, r->stride, dimension);
+    if (nslice < nthread && n >= 2 * TH_REDUCE_CHUNK)
+      nchunk = (n / TH_REDUCE_CHUNK < nthread ? n / TH_REDUCE_CHUNK : nthread);
+
+    if (nchunk == 1) {
+#pragma omp parallel for if (nthread > 1) num_threads(nthread)
+      for (s = 0; s < nslice; s++) {
+        accreal acc;
+        long idx = 0;
+        real *rs = r_data + r_offsets[s];
+        THTensor_(reduceRow)(x + offsets[s], n, op, p, (op == TH_REDUCE_VAR ? *rs : 0), &acc, &idx);
+        *rs = THTensor_(reduceFinal)(op, acc, n, p);
+        if (ri_data)
+          ri_data[r_offsets[s]] = idx;
+      }
     } else {
-      THTensor_(fill)(values_, THTensor_(get1d)(t, 0));
+      accreal *pacc = THAlloc(nslice * nchunk * sizeof(accreal));
+      long *pidx = THAlloc(nslice * nchunk * sizeof(long));
+#pragma omp parallel for num_threads(nthread)
+      for (u = 0; u < nslice * nchunk; u++) {
+        long c = u % nchunk;
+        long i0 = n * c / nchunk, i1 = n * (c + 1) / nchunk;
+        real *rs = r_data + r_offsets[u / nchunk];
+        pidx[u] = 0;
+        THTensor_(reduceRow)(x + offsets[u / nchunk] + i0, i1 - i0, op, p, (op == TH_REDUCE_VAR ? *rs : 0),
+                             &pacc[u], &pidx[u]);
+        pidx[u] += i0;
+      }
+      for (s = 0; s < nslice; s++) {
+        accreal acc = pacc[s * nchunk];
+        long idx = pidx[s * nchunk];
+        for (u = s * nchunk + 1; u < (s + 1) * nchunk; u++)
+          THTensor_(reduceCombine)(op, &acc, &idx, pacc[u], pidx[u]);
+        r_data[r_offsets[s]] = THTensor_(reduceFinal)(op, acc, n, p);
+        if (ri_data)
+          ri_data[r_offsets[s]] = idx;
+      }
+      THFree(pacc);
+      THFree(pidx);
     }
-    THLongTensor_zero(indices_);
-
-    if(t->size[dimension] == 1) {
-      if (!keepdim) {
-        THTensor_(squeeze1d)(values_, values_, dimension);
-        THLongTensor_squeeze1d(indices_, indices_, dimension);
+    THFree(offsets);
+    THFree(r_offsets);
+  } else {
+    /* outer x n x inner: blocks of columns */
+    long inner = src->stride[dimension];
+    long outer = nelem / (n * inner);
+    long width = (inner < TH_REDUCE_BLOCK ? inner : TH_REDUCE_BLOCK);
+    long nblock = (inner + width - 1) / width;
+    long ntask = outer * nblock;
+    long task, u;
+    if (ntask < nthread && n * width >= 2 * TH_REDUCE_CHUNK)
+      nchunk = (n * width / TH_REDUCE_CHUNK < nthread ? n * width / TH_REDUCE_CHUNK : nthread);
+
+    if (nchunk == 1) {
+#pragma omp parallel for if (nthread > 1) num_threads(nthread)
+      for (task = 0; task < ntask; task++) {
+        accreal acc[TH_REDUCE_BLOCK];
+        long idx[TH_REDUCE_BLOCK];
+        long o = task / nblock, j0 = (task % nblock) * width;
+        long w = (inner - j0 < width ? inner - j0 : width);
+        long j;
+        real *rs = r_data + o * inner + j0;
+        THTensor_(reduceColumns)(x + o * n * inner + j0, inner, 0, n, w, op, p,
+                                 (op == TH_REDUCE_VAR ? rs : NULL), acc, idx);
+        for (j = 0; j < w; j++) {
+          rs[j] = THTensor_(reduceFinal)(op, acc[j], n, p);
+          if (ri_data)
+            ri_data[o * inner + j0 + j] = idx[j];
+        }
       }
-      return;
+    } else {
+      accreal *pacc = THAlloc(ntask * nchunk * width * sizeof(accreal));
+      long *pidx = THAlloc(ntask * nchunk * width * sizeof(long));
+#pragma omp parallel for num_threads(nthread)
+      for (u = 0; u < ntask * nchunk; u++) {
+        long task = u / nchunk, c = u % nchunk;
+        long o = task / nblock, j0 = (task % nblock) * width;
+        long w = (inner - j0 < width ? inner - j0 : width);
+        THTensor_(reduceColumns)(x + o * n * inner + j0, inner, n * c / nchunk, n * (c + 1) / nchunk, w,
+                                 op, p, (op == TH_REDUCE_VAR ? r_data + o * inner + j0 : NULL),
+                                 pacc + u * width, pidx + u * width);
+      }
+      for (task = 0; task < ntask; task++) {
+        long o = task / nblock, j0 = (task % nblock) * width;
+        long w = (inner - j0 < width ? inner - j0 : width);
+        long j, c;
+        for (j = 0; j < w; j++) {
+          accreal acc = pacc[task * nchunk * width + j];
+          long idx = pidx[task * nchunk * width + j];
+          for (c = 1; c < nchunk; c++)
+            THTensor_(reduceCombine)(op, &acc, &idx, pacc[(task * nchunk + c) * width + j],
+                                     pidx[(task * nchunk + c) * width + j]);
+          r_data[o * inner + j0 + j] = THTensor_(reduceFinal)(op, acc, n, p);
+          if (ri_data)
+            ri_data[o * inner + j0 + j] = idx;
+        }
+      }
+      THFree(pacc);
+      THFree(pidx);
     }
-
-    THTensor *tempValues_ = THTensor_(newWithTensor)(values_);
-    // tempValues_.expand_as(t)
-    tempValues_->size[dimension] = t->size[dimension];
-    tempValues_->stride[dimension] = 0;
-
-    THLongTensor *tempIndices_ = THLongTensor_newWithTensor(indices_);
-    // tempIndices_.expand_as(t)
-    tempIndices_->size[dimension] = t->size[dimension];
-    tempIndices_->stride[dimension] = 0;
-
-    TH_TENSOR_APPLY3_D(real, t, real, tempValues_, long, tempIndices_, dimension,
-                          if(!(*t_data >= *tempValues__data) && !th_isnan(*tempValues__data)) {
-                            *tempValues__data = *t_data;
-                            *tempIndices__data = *tempIndices__dimOffset;
-                          });
   }
 
-  if (!keepdim) {
-    THTensor_(squeeze1d)(values_, values_, dimension);
-    THLongTensor_squeeze1d(indices_, indices_, dimension);
+  THTensor_(free)(src);
+  THTensor_(freeCopyTo)(r, r_);
+  if (ri)
+    THLongTensor_freeCopyTo(ri, ri_);
+}
+
+/* Scans (cumulative reductions) along a dimension, with the same layouts
+   as the reductions above. Sums and products of contiguous slices go 4
+   elements at a time: their prefix is computed in registers, independently
+   of the running total, which is then added to them, so that the
+   dependency chain on the total is 4 times shorter. Along other
+   dimensions, whole rows of columns are scanned at once. With more threads
+   than slices or blocks of columns, the scanned dimension is cut in
+   chunks: the chunks are reduced in parallel, their totals are scanned,
+   and the chunks are scanned in parallel from them. */
+
+/* state of a scan before its first element x0 */
+static void THTensor_(scanInit)(int op, real x0, accreal *acc, long *idx)
+{
+  *idx = 0;
+  switch (op) {
+  case TH_REDUCE_PROD:
+    *acc = 1;
+    break;
+  case TH_REDUCE_MAX:
+  case TH_REDUCE_MIN:
+    *acc = x0;
+    break;
+#if defined(TH_REAL_IS_FLOAT) || defined(TH_REAL_IS_DOUBLE)
+  case TH_REDUCE_LOGSUMEXP:
+    *acc = -INFINITY;
+    break;
+#endif
+  default:
+    *acc = 0;
   }
 }
 
+/* sum or product of contiguous elements, 4 at a time, into y (stride YS) */
+#define TH_SCAN_ROW(OP, YS)                     \
+  {                                             \
+    for (i = 0; i + 4 <= n; i += 4) {           \
+      accreal v0 = x[i];                        \
+      accreal v1 = v0 OP x[i+1];                \
+      accreal v2 = v1 OP x[i+2];                \
+      accreal v3 = v2 OP x[i+3];                \
+      y[i*(YS)] = (real)(a OP v0);              \
+      y[(i+1)*(YS)] = (real)(a OP v1);          \
+      y[(i+2)*(YS)] = (real)(a OP v2);          \
+      y[(i+3)*(YS)] = (real)(a OP v3);          \
+      a = a OP v3;                              \
+    }                                           \
+    for (; i < n; i++) {                        \
+      a = a OP x[i];                            \
+      y[i*(YS)] = (real)a;                      \
+    }                                           \
+  }
 
-void THTensor_(sum)(THTensor *r_, THTensor *t, int dimension, int keepdim)
+/* scans n contiguous elements into y (and yi, for max and min), from the
+   state acc and idx of the preceding ones, which is updated; i0 is the
+   index of x[0] in the slice */
+static void THTensor_(scanRow)(const real *x, long n, real *y, long ys, long *yi, long yis,
+                               int op, accreal *acc, long *idx, long i0)
+{
+  accreal a = *acc;
+  long bi = *idx;
+  long i;
+
+  switch (op) {
+  case TH_REDUCE_SUM:
+    if (ys == 1)
+      TH_SCAN_ROW(+, 1)
+    else
+      TH_SCAN_ROW(+, ys)
+    break;
+  case TH_REDUCE_PROD:
+    if (ys == 1)
+      TH_SCAN_ROW(*, 1)
+    else
+      TH_SCAN_ROW(*, ys)
+    break;
+  case TH_REDUCE_MAX:
+    for (i = 0; i < n; i++) {
+      real v = x[i];
+      if (!(v <= a) && !th_isnan(a)) {
+        a = v;
+        bi = i0 + i;
+      }
+      y[i*ys] = (real)a;
+      yi[i*yis] = bi;
+    }
+    break;
+  case TH_REDUCE_MIN:
+    for (i = 0; i < n; i++) {
+      real v = x[i];
+      if (!(v >= a) && !th_isnan(a)) {
+        a = v;
+        bi = i0 + i;
+      }
+      y[i*ys] = (real)a;
+      yi[i*yis] = bi;
+    }
+    break;
+#if defined(TH_REAL_IS_FLOAT) || defined(TH_REAL_IS_DOUBLE)
+  case TH_REDUCE_LOGSUMEXP:
+    for (i = 0; i < n; i++) {
+      a = THTensor_(logAddExp)(a, x[i]);
+      y[i*ys] = (real)a;
+    }
+    break;
+#endif
+  }
+  *acc = a;
+  *idx = bi;
+}
+
+#undef TH_SCAN_ROW
+
+/* scans w columns over the rows [i0, i1), stride elements apart, into y
+   and yi (of the same layout), from the states acc and idx */
+static void THTensor_(scanColumns)(const real *x, real *y, long *yi, long stride, long i0, long i1,
+                                   long w, int op, accreal *acc, long *idx)
+{
+  long i, j;
+  for (i = i0; i < i1; i++) {
+    const real *row = x + i*stride;
+    real *yrow = y + i*stride;
+    long *yirow = (yi ? yi + i*stride : NULL);
+    switch (op) {
+    case TH_REDUCE_SUM:
+      for (j = 0; j < w; j++) {
+        acc[j] += row[j];
+        yrow[j] = (real)acc[j];
+      }
+      break;
+    case TH_REDUCE_PROD:
+      for (j = 0; j < w; j++) {
+        acc[j] *= row[j];
+        yrow[j] = (real)acc[j];
+      }
+      break;
+    case TH_REDUCE_MAX:
+      for (j = 0; j < w; j++) {
+        real v = row[j];
+        int take = !(v <= acc[j]) && !th_isnan(acc[j]);
+        acc[j] = (take ? v : acc[j]);
+        idx[j] = (take ? i : idx[j]);
+        yrow[j] = (real)acc[j];
+        yirow[j] = idx[j];
+      }
+      break;
+    case TH_REDUCE_MIN:
+      for (j = 0; j < w; j++) {
+        real v = row[j];
+        int take = !(v >= acc[j]) && !th_isnan(acc[j]);
+        acc[j] = (take ? v : acc[j]);
+        idx[j] = (take ? i : idx[j]);
+        yrow[j] = (real)acc[j];
+        yirow[j] = idx[j];
+      }
+      break;
+#if defined(TH_REAL_IS_FLOAT) || defined(TH_REAL_IS_DOUBLE)
+    case TH_REDUCE_LOGSUMEXP:
+      for (j = 0; j < w; j++) {
+        acc[j] = THTensor_(logAddExp)(acc[j], row[j]);
+        yrow[j] = (real)acc[j];
+      }
+      break;
+#endif
+    }
+  }
+}
+
+/* scans t along dimension into r_ (and ri_, for max and min), which have
+   the size of t */
+static void THTensor_(scanDim)(THTensor *r_, THLongTensor *ri_, THTensor *t, int dimension, int op)
+{
+  long n = t->size[dimension];
+  ptrdiff_t nelem = THTensor_(nElement)(t);
+  THTensor *src;
+  real *x;
+  long nchunk = 1;
+  int nthread = 1;
+
+  if (nelem == 0)
+    return;
+#ifdef _OPENMP
+  if (nelem > TH_OMP_OVERHEAD_THRESHOLD)
+    nthread = omp_get_max_threads();
+#endif
+
+  if (t->stride[dimension] == 1 || n == 1) {
+    THTensor_(retain)(t);
+    src = t;
+  } else {
+    src = THTensor_(newContiguous)(t);
+  }
+  x = THTensor_(data)(src);
+
+  if (src->stride[dimension] == 1 || n == 1) {
+    /* contiguous slices, scanned into r_ and ri_ whatever their layout */
+    long nslice = nelem / n;
+    long *offsets = THAlloc(nslice * sizeof(long));
+    long *r_offsets = THAlloc(nslice * sizeof(long));
+    long *ri_offsets = (ri_ ? THAlloc(nslice * sizeof(long)) : NULL);
+    real *r_data = THTensor_(data)(r_);
+    long *ri_data = (ri_ ? THLongTensor_data(ri_) : NULL);
+    long ys = r_->stride[dimension];
+    long yis = (ri_ ? ri_->stride[dimension] : 0);
+    long s, u;
+    THTensor_(sliceOffsets)(offsets, src->nDimension, src->size, src->stride, dimension);
+    THTensor_(sliceOffsets)(r_offsets, r_->nDimension, r_->size, r_->stride, dimension);
+    if (ri_)
+      THTensor_(sliceOffsets)(ri_offsets, ri_->nDimension, ri_->size, ri_->stride, dimension);
+    if (nslice < nthread && n >= 2 * TH_REDUCE_CHUNK)
+      nchunk = (n / TH_REDUCE_CHUNK < nthread ? n / TH_REDUCE_CHUNK : nthread);
+
+    if (nchunk == 1) {
+#pragma omp parallel for if (nthread > 1) num_threads(nthread)
+      for (s = 0; s < nslice; s++) {
+        accreal acc;
+        long idx;
+        THTensor_(scanInit)(op, x[offsets[s]], &acc, &idx);
+        THTensor_(scanRow)(x + offsets[s], n, r_data + r_offsets[s], ys,
+                           (ri_data ? ri_data + ri_offsets[s] : NULL), yis, op, &acc, &idx, 0);
+      }
+    } else {
+      accreal *pacc = THAlloc(nslice * nchunk * sizeof(accreal));
+      long *pidx = THAlloc(nslice * nchunk * sizeof(long));
+      /* totals of the chunks (but the last ones) */
+#pragma omp parallel for num_threads(nthread)
+      for (u = 0; u < nslice * nchunk; u++) {
+        long c = u % nchunk;
+        long i0 = n * c / nchunk, i1 = n * (c + 1) / nchunk;
+        pidx[u] = 0;
+        if (c < nchunk - 1) {
+          THTensor_(reduceRow)(x + offsets[u / nchunk] + i0, i1 - i0, op, 0, 0, &pacc[u], &pidx[u]);
+          pidx[u] += i0;
+        }
+      }
+      /* states at the start of the chunks */
+      for (s = 0; s < nslice; s++) {
+        accreal acc;
+        long idx;
+        THTensor_(scanInit)(op, x[offsets[s]], &acc, &idx);
+        for (u = s * nchunk; u < (s + 1) * nchunk; u++) {
+          accreal total = pacc[u];
+          long totalIndex = pidx[u];
+          pacc[u] = acc;
+          pidx[u] = idx;
+          if (u < (s + 1) * nchunk - 1)
+            THTensor_(reduceCombine)(op, &acc, &idx, total, totalIndex);
+        }
+      }
+#pragma omp parallel for num_threads(nthread)
+      for (u = 0; u < nslice * nchunk; u++) {
+        long c = u % nchunk;
+        long i0 = n * c / nchunk, i1 = n * (c + 1) / nchunk;
+        long slice = u / nchunk;
+        THTensor_(scanRow)(x + offsets[slice] + i0, i1 - i0, r_data + r_offsets[slice] + i0 * ys, ys,
+                           (ri_data ? ri_data + ri_offsets[slice] + i0 * yis : NULL), yis,
+                           op, &pacc[u], &pidx[u], i0);
+      }
+      THFree(pacc);
+      THFree(pidx);
+    }
+    THFree(offsets);
+    THFree(r_offsets);
+    THFree(ri_offsets);
+  } else {
+    /* outer x n x inner: blocks of columns, into contiguous outputs */
+    THTensor *r;
+    THLongTensor *ri = NULL;
+    real *r_data;
+    long *ri_data = NULL;
+    long inner = src->stride[dimension];
+    long outer = nelem / (n * inner);
+    long width = (inner < TH_REDUCE_BLOCK ? inner : TH_REDUCE_BLOCK);
+    long nblock = (inner + width - 1) / width;
+    long ntask = outer * nblock;
+    long task, u;
+
+    if (THTensor_(isContiguous)(r_)) {
+      THTensor_(retain)(r_);
+      r = r_;
+    } else {
+      r = THTensor_(new)();
+      THTensor_(resizeNd)(r, r_->nDimension, r_->size, NULL);
+    }
+    r_data = THTensor_(data)(r);
+    if (ri_) {
+      if (THLongTensor_isContiguous(ri_)) {
+        THLongTensor_retain(ri_);
+        ri = ri_;
+      } else {
+        ri = THLongTensor_new();
+        THLongTensor_resizeNd(ri, ri_->nDimension, ri_->size, NULL);
+      }
+      ri_data = THLongTensor_data(ri);
+    }
+    if (ntask < nthread && n * width >= 2 * TH_REDUCE_CHUNK)
+      nchunk = (n * width / TH_REDUCE_CHUNK < nthread ? n * width / TH_REDUCE_CHUNK : nthread);
+
+    if (nchunk == 1) {
+#pragma omp parallel for if (nthread > 1) num_threads(nthread)
+      for (task = 0; task < ntask; task++) {
+        accreal acc[TH_REDUCE_BLOCK];
+        long idx[TH_REDUCE_BLOCK];
+        long o = task / nblock, j0 = (task % nblock) * width;
+        long w = (inner - j0 < width ? inner - j0 : width);
+        long offset = o * n * inner + j0;
+        long j;
+        for (j = 0; j < w; j++)
+          THTensor_(scanInit)(op, x[offset + j], &acc[j], &idx[j]);
+        THTensor_(scanColumns)(x + offset, r_data + offset, (ri_data ? ri_data + offset : NULL),
+                               inner, 0, n, w, op, acc, idx);
+      }
+    } else {
+      accreal *pacc = THAlloc(ntask * nchunk * width * sizeof(accreal));
+      long *pidx = THAlloc(ntask * nchunk * width * sizeof(long));
+#pragma omp parallel for num_threads(nthread)
+      for (u = 0; u < ntask * nchunk; u++) {
+        long task = u / nchunk, c = u % nchunk;
+        long o = task / nblock, j0 = (task % nblock) * width;
+        long w = (inner - j0 < width ? inner - j0 : width);
+        if (c < nchunk - 1)
+          THTensor_(reduceColumns)(x + o * n * inner + j0, inner, n * c / nchunk, n * (c + 1) / nchunk, w,
+                                   op, 0, NULL, pacc + u * width, pidx + u * width);
+      }
+      for (task = 0; task < ntask; task++) {
+        long o = task / nblock, j0 = (task % nblock) * width;
+        long w = (inner - j0 < width ? inner - j0 : width);
+        long j, c;
+        for (j = 0; j < w; j++) {
+          accreal acc;
+          long idx;
+          THTensor_(scanInit)(op, x[o * n * inner + j0 + j], &acc, &idx);
+          for (c = 0; c < nchunk; c++) {
+            long k = (task * nchunk + c) * width + j;
+            accreal total = pacc[k];
+            long totalIndex = pidx[k];
+            pacc[k] = acc;
+            pidx[k] = idx;
+            if (c < nchunk - 1)
+              THTensor_(reduceCombine)(op, &acc, &idx, total, totalIndex);
+          }
+        }
+      }
+#pragma omp parallel for num_threads(nthread)
+      for (u = 0; u < ntask * nchunk; u++) {
+        long task = u / nchunk, c = u % nchunk;
+        long o = task / nblock, j0 = (task % nblock) * width;
+        long w = (inner - j0 < width ? inner - j0 : width);
+        long offset = o * n * inner + j0;
+        THTensor_(scanColumns)(x + offset, r_data + offset, (ri_data ? ri_data + offset : NULL),
+                               inner, n * c / nchunk, n * (c + 1) / nchunk, w, op,
+                               pacc + u * width, pidx + u * width);
+      }
+      THFree(pacc);
+      THFree(pidx);
+    }
+    THTensor_(freeCopyTo)(r, r_);
+    if (ri)
+      THLongTensor_freeCopyTo(ri, ri_);
+  }
+
+  THTensor_(free)(src);
+}
+
+void THTensor_(max)(THTensor *values_, THLongTensor *indices_, THTensor *t, int dimension, int keepdim)
 {
   THLongStorage *dim;
 
@@ -1715,27 +2933,53 @@ void THTensor_(sum)(THTensor *r_, THTensor *t, int dimension, int keepdim)
 
   dim = THTensor_(newSizeOf)(t);
   THLongStorage_set(dim, dimension, 1);
-  THTensor_(resize)(r_, dim, NULL);
+  THTensor_(resize)(values_, dim, NULL);
+  THLongTensor_resize(indices_, dim, NULL);
   THLongStorage_free(dim);
 
-  // two implementations optimized for data locality
-  if (t->stride[dimension] == 1) {
-    TH_TENSOR_DIM_APPLY2(real, t, real, r_, dimension,
-                         accreal sum = 0;
-                         long i;
-                         for(i = 0; i < t_size; i++)
-                           sum += t_data[i*t_stride];
-                         *r__data = (real)sum;);
-  } else {
-    THTensor_(zero)(r_);
-    THTensor *temp_ = THTensor_(newWithTensor)(r_);
-    // r_.expand_as(t)
-    temp_->size[dimension] = t->size[dimension];
-    temp_->stride[dimension] = 0;
+  THTensor_(reduceDim)(values_, indices_, t, dimension, TH_REDUCE_MAX, 0);
+
+  if (!keepdim) {
+    THTensor_(squeeze1d)(values_, values_, dimension);
+    THLongTensor_squeeze1d(indices_, indices_, dimension);
+  }
+}
+
+void THTensor_(min)(THTensor *values_, THLongTensor *indices_, THTensor *t, int dimension, int keepdim)
+{
+  THLongStorage *dim;
+
+  THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 2, "dimension %d out of range",
+      dimension + TH_INDEX_BASE);
 
-    TH_TENSOR_APPLY2(real, temp_, real, t, *temp__data = *temp__data + *t_data;);
-    THTensor_(free)(temp_);
+  dim = THTensor_(newSizeOf)(t);
+  THLongStorage_set(dim, dimension, 1);
+  THTensor_(resize)(values_, dim, NULL);
+  THLongTensor_resize(indices_, dim, NULL);
+  THLongStorage_free(dim);
+
+  THTensor_(reduceDim)(values_, indices_, t, dimension, TH_REDUCE_MIN, 0);
+
+  if (!keepdim) {
+    THTensor_(squeeze1d)(values_, values_, dimension);
+    THLongTensor_squeeze1d(indices_, indices_, dimension);
   }
+}
+
+
+void THTensor_(sum)(THTensor *r_, THTensor *t, int dimension, int keepdim)
+{
+  THLongStorage *dim;
+
+  THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 2, "dimension %d out of range",
+      dimension + TH_INDEX_BASE);
+
+  dim = THTensor_(newSizeOf)(t);
+  THLongStorage_set(dim, dimension, 1);
+  THTensor_(resize)(r_, dim, NULL);
+  THLongStorage_free(dim);
+
+  THTensor_(reduceDim)(r_, NULL, t, dimension, TH_REDUCE_SUM, 0);
 
   if (!keepdim) {
     THTensor_(squeeze1d)(r_, r_, dimension);
@@ -1754,24 +2998,7 @@ void THTensor_(prod)(THTensor *r_, THTensor *t, int dimension, int keepdim)
   THTensor_(resize)(r_, dim, NULL);
   THLongStorage_free(dim);
 
-  // two implementations optimized for data locality
-  if (t->stride[dimension] == 1) {
-    TH_TENSOR_DIM_APPLY2(real, t, real, r_, dimension,
-                         accreal prod = 1;
-                         long i;
-                         for(i = 0; i < t_size; i++)
-                           prod *= t_data[i*t_stride];
-                         *r__data = (real)prod;);
-  } else {
-    THTensor_(fill)(r_, 1);
-    THTensor *temp_ = THTensor_(newWithTensor)(r_);
-    // r_.expand_as(t)
-    temp_->size[dimension] = t->size[dimension];
-    temp_->stride[dimension] = 0;
-
-    TH_TENSOR_APPLY2(real, temp_, real, t, *temp__data = *temp__data * *t_data;);
-    THTensor_(free)(temp_);
-  }
+  THTensor_(reduceDim)(r_, NULL, t, dimension, TH_REDUCE_PROD, 0);
 
   if (!keepdim) {
     THTensor_(squeeze1d)(r_, r_, dimension);
@@ -1784,15 +3011,7 @@ void THTensor_(cumsum)(THTensor *r_, THTensor *t, int dimension)
       dimension + TH_INDEX_BASE);
 
   THTensor_(resizeAs)(r_, t);
-
-  TH_TENSOR_DIM_APPLY2(real, t, real, r_, dimension,
-                       accreal cumsum = 0;
-                       long i;
-                       for(i = 0; i < t_size; i++)
-                       {
-                         cumsum += t_data[i*t_stride];
-                         r__data[i*r__stride] = (real)cumsum;
-                       });
+  THTensor_(scanDim)(r_, NULL, t, dimension, TH_REDUCE_SUM);
 }
 
 void THTensor_(cumprod)(THTensor *r_, THTensor *t, int dimension)
@@ -1801,15 +3020,35 @@ void THTensor_(cumprod)(THTensor *r_, THTensor *t, int dimension)
       dimension + TH_INDEX_BASE);
 
   THTensor_(resizeAs)(r_, t);
+  THTensor_(scanDim)(r_, NULL, t, dimension, TH_REDUCE_PROD);
+}
 
-  TH_TENSOR_DIM_APPLY2(real, t, real, r_, dimension,
-                       accreal cumprod = 1;
-                       long i;
-                       for(i = 0; i < t_size; i++)
-                       {
-                         cumprod *= t_data[i*t_stride];
-                         r__data[i*r__stride] = (real)cumprod;
-                       });
+void THTensor_(cummax)(THTensor *values_, THLongTensor *indices_, THTensor *t, int dimension)
+{
+  THLongStorage *size;
+
+  THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 2, "dimension %d out of range",
+      dimension + TH_INDEX_BASE);
+
+  THTensor_(resizeAs)(values_, t);
+  size = THTensor_(newSizeOf)(t);
+  THLongTensor_resize(indices_, size, NULL);
+  THLongStorage_free(size);
+  THTensor_(scanDim)(values_, indices_, t, dimension, TH_REDUCE_MAX);
+}
+
+void THTensor_(cummin)(THTensor *values_, THLongTensor *indices_, THTensor *t, int dimension)
+{
+  THLongStorage *size;
+
+  THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 2, "dimension %d out of range",
+      dimension + TH_INDEX_BASE);
+
+  THTensor_(resizeAs)(values_, t);
+  size = THTensor_(newSizeOf)(t);
+  THLongTensor_resize(indices_, size, NULL);
+  THLongStorage_free(size);
+  THTensor_(scanDim)(values_, indices_, t, dimension, TH_REDUCE_MIN);
 }
 
 
@@ -2285,8 +3524,219 @@ static void THTensor_(quicksortdescend)(real *arr, long *idx, long elements, lon
 #undef MAX_LEVELS
 #undef M_SMALL
 
+/* Sorting of large slices.
+
+   Values are mapped to unsigned integer keys of the same order: the sign
+   bit of integers is flipped, negative floats have all their bits flipped
+   and positive ones their sign bit (descending order flips all the bits
+   of the keys). The keys are sorted by a LSD radix sort on 8-bit digits,
+   which only reads and writes memory sequentially, and is stable: equal
+   values keep the order of their indices. A single large slice is cut in
+   chunks, radix sorted in parallel, then merged in parallel (the output of
+   each merge is split in as many parts as threads, by binary search). */
+#define TH_SORT_RADIX_THRESHOLD 512    /* smaller slices use quicksort */
+#define TH_SORT_PARALLEL_THRESHOLD 65536 /* per thread */
+
+#if defined(TH_REAL_IS_DOUBLE) || defined(TH_REAL_IS_LONG)
+#define sortkey_t unsigned long long
+#define SORTKEY_SIGN 0x8000000000000000ULL
+#else
+#define sortkey_t unsigned int
+#define SORTKEY_SIGN 0x80000000U
+#endif
+
+static inline sortkey_t THTensor_(sortKey)(real v)
+{
+#if defined(TH_REAL_IS_FLOAT)
+  union { float f; unsigned int i; } u;
+  u.f = v;
+  return (u.i & SORTKEY_SIGN ? ~u.i : u.i ^ SORTKEY_SIGN);
+#elif defined(TH_REAL_IS_DOUBLE)
+  union { double f; unsigned long long i; } u;
+  u.f = v;
+  return (u.i & SORTKEY_SIGN ? ~u.i : u.i ^ SORTKEY_SIGN);
+#elif defined(TH_REAL_IS_LONG)
+  return (sortkey_t)(long long)v ^ SORTKEY_SIGN;
+#else
+  return (sortkey_t)(int)v ^ SORTKEY_SIGN;
+#endif
+}
+
+static inline real THTensor_(sortValue)(sortkey_t k)
+{
+#if defined(TH_REAL_IS_FLOAT)
+  union { float f; unsigned int i; } u;
+  u.i = (k & SORTKEY_SIGN ? k ^ SORTKEY_SIGN : ~k);
+  return u.f;
+#elif defined(TH_REAL_IS_DOUBLE)
+  union { double f; unsigned long long i; } u;
+  u.i = (k & SORTKEY_SIGN ? k ^ SORTKEY_SIGN : ~k);
+  return u.f;
+#elif defined(TH_REAL_IS_LONG)
+  return (real)(long long)(k ^ SORTKEY_SIGN);
+#else
+  return (real)(int)(k ^ SORTKEY_SIGN);
+#endif
+}
+
+/* sorts key[0..n) and idx[0..n) with it, using tkey and tidx as buffers */
+static void THTensor_(radixSort)(sortkey_t *key, long *idx, sortkey_t *tkey, long *tidx, long n)
+{
+  long count[sizeof(sortkey_t)][256];
+  long i, offset;
+  int d, b;
+  int swapped = 0;
+
+  memset(count, 0, sizeof(count));
+  for (i = 0; i < n; i++) {
+    sortkey_t k = key[i];
+    for (d = 0; d < (int)sizeof(sortkey_t); d++)
+      count[d][(k >> (8*d)) & 255]++;
+  }
+
+  for (d = 0; d < (int)sizeof(sortkey_t); d++) {
+    long *c = count[d];
+    sortkey_t *skey;
+    long *sidx;
+    /* all the keys have the same digit */
+    if (c[(key[0] >> (8*d)) & 255] == n)
+      continue;
+    for (b = 0, offset = 0; b < 256; b++) {
+      long cb = c[b];
+      c[b] = offset;
+      offset += cb;
+    }
+    for (i = 0; i < n; i++) {
+      long pos = c[(key[i] >> (8*d)) & 255]++;
+      tkey[pos] = key[i];
+      tidx[pos] = idx[i];
+    }
+    skey = key; key = tkey; tkey = skey;
+    sidx = idx; idx = tidx; tidx = sidx;
+    swapped = !swapped;
+  }
+
+  if (swapped) {
+    memcpy(tkey, key, n*sizeof(sortkey_t));
+    memcpy(tidx, idx, n*sizeof(long));
+  }
+}
+
+/* number of elements of a that are among the first p of the stable merge
+   of a (na elements) and b (nb elements) */
+static long THTensor_(mergeSplit)(const sortkey_t *a, long na, const sortkey_t *b, long nb, long p)
+{
+  long lo = (p > nb ? p - nb : 0);
+  long hi = (p < na ? p : na);
+  while (lo < hi) {
+    long mid = (lo + hi) / 2;
+    if (a[mid] <= b[p - mid - 1])
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/* outputs [p0, p1) of the stable merge of a and b */
+static void THTensor_(mergeRange)(const sortkey_t *a, const long *ai, long na,
+                                  const sortkey_t *b, const long *bi, long nb,
+                                  sortkey_t *out, long *outi, long p0, long p1)
+{
+  long i = THTensor_(mergeSplit)(a, na, b, nb, p0);
+  long j = p0 - i;
+  long p;
+  for (p = p0; p < p1; p++) {
+    if (j >= nb || (i < na && a[i] <= b[j])) {
+      out[p] = a[i];
+      outi[p] = ai[i++];
+    } else {
+      out[p] = b[j];
+      outi[p] = bi[j++];
+    }
+  }
+}
+
+/* radix sort of large arrays, with all the threads */
+static void THTensor_(parallelSort)(sortkey_t *key, long *idx, sortkey_t *tkey, long *tidx, long n, int nchunk)
+{
+  long *bound = THAlloc((nchunk + 1) * sizeof(long));
+  long c, width;
+  int swapped = 0;
+
+  for (c = 0; c <= nchunk; c++)
+    bound[c] = n * c / nchunk;
+
+#pragma omp parallel for
+  for (c = 0; c < nchunk; c++)
+    THTensor_(radixSort)(key + bound[c], idx + bound[c], tkey + bound[c], tidx + bound[c],
+                         bound[c+1] - bound[c]);
+
+  for (width = 1; width < nchunk; width *= 2) {
+    sortkey_t *skey;
+    long *sidx;
+    for (c = 0; c < nchunk; c += 2*width) {
+      long start = bound[c];
+      long mid = bound[(c + width < nchunk ? c + width : nchunk)];
+      long end = bound[(c + 2*width < nchunk ? c + 2*width : nchunk)];
+      long part;
+#pragma omp parallel for
+      for (part = 0; part < nchunk; part++)
+        THTensor_(mergeRange)(key + start, idx + start, mid - start,
+                              key + mid, idx + mid, end - mid,
+                              tkey + start, tidx + start,
+                              (end - start) * part / nchunk, (end - start) * (part + 1) / nchunk);
+    }
+    skey = key; key = tkey; tkey = skey;
+    sidx = idx; idx = tidx; tidx = sidx;
+    swapped = !swapped;
+  }
+
+  if (swapped) {
+    memcpy(tkey, key, n*sizeof(sortkey_t));
+    memcpy(tidx, idx, n*sizeof(long));
+  }
+  THFree(bound);
+}
+
+/* sorts a slice, with quicksort (small slices, which expects the same
+   stride for rt and ri) or radix sort (key and idx: buffers of 2n
+   elements) */
+static void THTensor_(sortSlice)(real *rt, long rt_stride, long *ri, long ri_stride, long n, int descendingOrder,
+                                 sortkey_t *key, long *idx)
+{
+  sortkey_t flip = (descendingOrder ? ~(sortkey_t)0 : 0);
+  long i;
+  if (n < TH_SORT_RADIX_THRESHOLD) {
+    for (i = 0; i < n; i++)
+      ri[i*ri_stride] = i;
+    if (descendingOrder)
+      THTensor_(quicksortdescend)(rt, ri, n, rt_stride);
+    else
+      THTensor_(quicksortascend)(rt, ri, n, rt_stride);
+    return;
+  }
+  for (i = 0; i < n; i++) {
+    key[i] = THTensor_(sortKey)(rt[i*rt_stride]) ^ flip;
+    idx[i] = i;
+  }
+  THTensor_(radixSort)(key, idx, key + n, idx + n, n);
+  for (i = 0; i < n; i++) {
+    rt[i*rt_stride] = THTensor_(sortValue)(key[i] ^ flip);
+    ri[i*ri_stride] = idx[i];
+  }
+}
+
 void THTensor_(sort)(THTensor *rt_, THLongTensor *ri_, THTensor *t, int dimension, int descendingOrder)
 {
+  long n, nslice, s;
+  long *rt_offsets, *ri_offsets;
+  real *rt_data;
+  long *ri_data;
+  sortkey_t *key = NULL;
+  long *idx = NULL;
+  int nthread = 1;
+
   THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 2, "invalid dimension %d",
       dimension + TH_INDEX_BASE);
 
@@ -2299,24 +3749,72 @@ void THTensor_(sort)(THTensor *rt_, THLongTensor *ri_, THTensor *t, int dimensio
     THLongStorage_free(size);
   }
 
-  if(descendingOrder)
-  {
-    TH_TENSOR_DIM_APPLY2(real, rt_, long, ri_, dimension,
-                         long i;
-                         for(i = 0; i < ri__size; i++)
-                           ri__data[i*ri__stride] = i;
-                         THTensor_(quicksortdescend)(rt__data, ri__data, rt__size, rt__stride);)
-      }
-  else
-  {
-    TH_TENSOR_DIM_APPLY2(real, rt_, long, ri_, dimension,
-                         long i;
-                         for(i = 0; i < ri__size; i++)
-                           ri__data[i*ri__stride] = i;
-                         THTensor_(quicksortascend)(rt__data, ri__data, rt__size, rt__stride);)
-      }
+  n = THTensor_(size)(t, dimension);
+  if (n == 0)
+    return;
+  nslice = THTensor_(nElement)(t) / n;
+  rt_data = THTensor_(data)(rt_);
+  ri_data = THLongTensor_data(ri_);
+#ifdef _OPENMP
+  nthread = omp_get_max_threads();
+#endif
+
+  /* a single large slice: all the threads sort it */
+  if (nslice == 1 && nthread > 1 && n >= (long)nthread * TH_SORT_PARALLEL_THRESHOLD) {
+    long rt_stride = THTensor_(stride)(rt_, dimension);
+    long ri_stride = THLongTensor_stride(ri_, dimension);
+    sortkey_t flip = (descendingOrder ? ~(sortkey_t)0 : 0);
+    long i;
+    key = THAlloc(2 * n * sizeof(sortkey_t));
+    idx = THAlloc(2 * n * sizeof(long));
+#pragma omp parallel for
+    for (i = 0; i < n; i++) {
+      key[i] = THTensor_(sortKey)(rt_data[i*rt_stride]) ^ flip;
+      idx[i] = i;
+    }
+    THTensor_(parallelSort)(key, idx, key + n, idx + n, n, nthread);
+#pragma omp parallel for
+    for (i = 0; i < n; i++) {
+      rt_data[i*rt_stride] = THTensor_(sortValue)(key[i] ^ flip);
+      ri_data[i*ri_stride] = idx[i];
+    }
+    THFree(key);
+    THFree(idx);
+    return;
+  }
+
+  /* independent slices, in parallel (the buffers are allocated here: THAlloc
+     may run the garbage collector) */
+  if (nslice == 1 || nslice * n <= TH_OMP_OVERHEAD_THRESHOLD)
+    nthread = 1;
+  rt_offsets = THAlloc(nslice * sizeof(long));
+  ri_offsets = THAlloc(nslice * sizeof(long));
+  THTensor_(sliceOffsets)(rt_offsets, rt_->nDimension, rt_->size, rt_->stride, dimension);
+  THTensor_(sliceOffsets)(ri_offsets, ri_->nDimension, ri_->size, ri_->stride, dimension);
+  if (n >= TH_SORT_RADIX_THRESHOLD) {
+    key = THAlloc(nthread * 2 * n * sizeof(sortkey_t));
+    idx = THAlloc(nthread * 2 * n * sizeof(long));
+  }
+#pragma omp parallel for if (nthread > 1) num_threads(nthread) schedule(dynamic)
+  for (s = 0; s < nslice; s++) {
+    int tid = 0;
+#ifdef _OPENMP
+    tid = omp_get_thread_num();
+#endif
+    THTensor_(sortSlice)(rt_data + rt_offsets[s], rt_->stride[dimension],
+                         ri_data + ri_offsets[s], ri_->stride[dimension],
+                         n, descendingOrder,
+                         (key ? key + tid * 2 * n : NULL), (idx ? idx + tid * 2 * n : NULL));
+  }
+  THFree(rt_offsets);
+  THFree(ri_offsets);
+  THFree(key);
+  THFree(idx);
 }
 
+#undef sortkey_t
+#undef SORTKEY_SIGN
+
 /* Implementation of the Quickselect algorithm, based on Nicolas Devillard's
 public domain implementation at http://ndevilla.free.fr/median/median/
 Adapted similarly to the above Quicksort algorithm.
@@ -2539,6 +4037,103 @@ void THTensor_(median)(THTensor *values_, THLongTensor *indices_, THTensor *t, i
   THTensor_(kthvalue)(values_, indices_, t, k+1, dimension, keepdim);
 }
 
+/* topk of small k: the slice is read once, updating a heap of the k best
+   elements seen so far, whose root is the worst of them */
+#define TH_TOPK_HEAP_RATIO 16 /* used when k * TH_TOPK_HEAP_RATIO <= slice size */
+
+/* is (a, ia) better than (b, ib)? ties go to the lowest index */
+#define TOPK_BETTER(a, ia, b, ib) \
+  ((dir ? (a) > (b) : (a) < (b)) || ((a) == (b) && (ia) < (ib)))
+
+static void THTensor_(topkSiftDown)(real *hv, long *hi, long m, int dir)
+{
+  real v = hv[0];
+  long vi = hi[0];
+  long pos = 0, child;
+  while ((child = 2*pos + 1) < m) {
+    if (child + 1 < m && TOPK_BETTER(hv[child], hi[child], hv[child+1], hi[child+1]))
+      child++;
+    if (!TOPK_BETTER(v, vi, hv[child], hi[child]))
+      break;
+    hv[pos] = hv[child];
+    hi[pos] = hi[child];
+    pos = child;
+  }
+  hv[pos] = v;
+  hi[pos] = vi;
+}
+
+/* the k best elements of a slice (the largest if dir, else the smallest),
+   best first, in hv and hi */
+static void THTensor_(topkHeap)(real *t, long t_stride, long n, long k, int dir, real *hv, long *hi)
+{
+  long i, m;
+  for (i = 0; i < k; i++) {
+    real v = t[i*t_stride];
+    long pos = i;
+    while (pos > 0 && TOPK_BETTER(hv[(pos-1)/2], hi[(pos-1)/2], v, i)) {
+      hv[pos] = hv[(pos-1)/2];
+      hi[pos] = hi[(pos-1)/2];
+      pos = (pos-1)/2;
+    }
+    hv[pos] = v;
+    hi[pos] = i;
+  }
+  for (; i < n; i++) {
+    real v = t[i*t_stride];
+    if (TOPK_BETTER(v, i, hv[0], hi[0])) {
+      hv[0] = v;
+      hi[0] = i;
+      THTensor_(topkSiftDown)(hv, hi, k, dir);
+    }
+  }
+  /* heapsort: the worst goes last */
+  for (m = k - 1; m > 0; m--) {
+    real v = hv[0];
+    long vi = hi[0];
+    hv[0] = hv[m];
+    hi[0] = hi[m];
+    hv[m] = v;
+    hi[m] = vi;
+    THTensor_(topkSiftDown)(hv, hi, m, dir);
+  }
+}
+
+#undef TOPK_BETTER
+
+/* the k best elements of a slice, with quickselect; tmp and tmpi hold
+   sliceSize elements */
+static void THTensor_(topkSelect)(real *t, long t_stride, long sliceSize, long k, int dir, int sorted,
+                                  real *tmp, long *tmpi, real *rt, long rt_stride, long *ri, long ri_stride)
+{
+  long i;
+  for (i = 0; i < sliceSize; i++) {
+    tmp[i] = t[i*t_stride];
+    tmpi[i] = i;
+  }
+  if (dir) {
+    /* k largest elements, descending order (optional: see sorted) */
+    long K = sliceSize - k;
+    if (K > 0)
+      THTensor_(quickselect)(tmp, tmpi, K - 1, sliceSize, 1);
+    if (sorted)
+      THTensor_(quicksortdescend)(tmp + K, tmpi + K, k, 1);
+    for (i = 0; i < k; i++) {
+      rt[i*rt_stride] = tmp[i + K];
+      ri[i*ri_stride] = tmpi[i + K];
+    }
+  } else {
+    /* k smallest elements, ascending order (optional: see sorted) */
+    THTensor_(quickselect)(tmp, tmpi, k - 1, sliceSize, 1);
+    if (sorted)
+      THTensor_(quicksortascend)(tmp, tmpi, k - 1, 1);
+    for (i = 0; i < k; i++) {
+      rt[i*rt_stride] = tmp[i];
+      ri[i*ri_stride] = tmpi[i];
+    }
+  }
+}
+
 void THTensor_(topk)(THTensor *rt_, THLongTensor *ri_, THTensor *t, long k, int dim, int dir, int sorted)
 {
   int numDims = THTensor_(nDimension)(t);
@@ -2547,13 +4142,11 @@ void THTensor_(topk)(THTensor *rt_, THLongTensor *ri_, THTensor *t, long k, int
   long sliceSize = THTensor_(size)(t, dim);
   THArgCheck(k > 0 && k <= sliceSize, 2, "k not in range for dimension");
 
-  THTensor *tmpResults = THTensor_(new)();
-  THTensor_(resize1d)(tmpResults, sliceSize);
-  real *tmp__data = THTensor_(data)(tmpResults);
-
-  THLongTensor *tmpIndices = THLongTensor_new();
-  THLongTensor_resize1d(tmpIndices, sliceSize);
-  long *tmpi__data = THLongTensor_data(tmpIndices);
+  long nslice = THTensor_(nElement)(t) / sliceSize;
+  int useHeap = (k * TH_TOPK_HEAP_RATIO <= sliceSize);
+  long bufferSize = (useHeap ? k : sliceSize);
+  int nthread = 1;
+  long s;
 
   THLongStorage *topKSize = THTensor_(newSizeOf)(t);
   THLongStorage_set(topKSize, dim, k);
@@ -2561,47 +4154,57 @@ void THTensor_(topk)(THTensor *rt_, THLongTensor *ri_, THTensor *t, long k, int
   THLongTensor_resize(ri_, topKSize, NULL);
   THLongStorage_free(topKSize);
 
-  if (dir) {
-    /* k largest elements, descending order (optional: see sorted) */
-    long K = sliceSize - k;
-    TH_TENSOR_DIM_APPLY3(real, t, real, rt_, long, ri_, dim,
-                         long i;
-                         for(i = 0; i < sliceSize; i++)
-                         {
-                           tmp__data[i] = t_data[i*t_stride];
-                           tmpi__data[i] = i;
-                         }
-                         if (K > 0)
-                           THTensor_(quickselect)(tmp__data, tmpi__data, K - 1, sliceSize, 1);
-                         if (sorted)
-                           THTensor_(quicksortdescend)(tmp__data + K, tmpi__data + K, k, 1);
-                         for(i = 0; i < k; i++)
-                         {
-                           rt__data[i*rt__stride] = tmp__data[i + K];
-                           ri__data[i*ri__stride] = tmpi__data[i + K];
-                         })
-  }
-  else {
-    /* k smallest elements, ascending order (optional: see sorted) */
-    TH_TENSOR_DIM_APPLY3(real, t, real, rt_, long, ri_, dim,
-                         long i;
-                         for(i = 0; i < sliceSize; i++)
-                         {
-                           tmp__data[i] = t_data[i*t_stride];
-                           tmpi__data[i] = i;
-                         }
-                         THTensor_(quickselect)(tmp__data, tmpi__data, k - 1, sliceSize, 1);
-                         if (sorted)
-                           THTensor_(quicksortascend)(tmp__data, tmpi__data, k - 1, 1);
-                         for(i = 0; i < k; i++)
-                         {
-                           rt__data[i*rt__stride] = tmp__data[i];
-                           ri__data[i*ri__stride] = tmpi__data[i];
-                         })
+#ifdef _OPENMP
+  if (nslice > 1 && nslice * sliceSize > TH_OMP_OVERHEAD_THRESHOLD)
+    nthread = omp_get_max_threads();
+#endif
+
+  /* slices in parallel, with buffers allocated here (THAlloc may run the
+     garbage collector) */
+  long *t_offsets = THAlloc(nslice * sizeof(long));
+  long *rt_offsets = THAlloc(nslice * sizeof(long));
+  long *ri_offsets = THAlloc(nslice * sizeof(long));
+  real *tmp = THAlloc(nthread * bufferSize * sizeof(real));
+  long *tmpi = THAlloc(nthread * bufferSize * sizeof(long));
+  real *t_data = THTensor_(data)(t);
+  real *rt_data = THTensor_(data)(rt_);
+  long *ri_data = THLongTensor_data(ri_);
+  long t_stride = THTensor_(stride)(t, dim);
+  long rt_stride = THTensor_(stride)(rt_, dim);
+  long ri_stride = THLongTensor_stride(ri_, dim);
+  THTensor_(sliceOffsets)(t_offsets, t->nDimension, t->size, t->stride, dim);
+  THTensor_(sliceOffsets)(rt_offsets, rt_->nDimension, rt_->size, rt_->stride, dim);
+  THTensor_(sliceOffsets)(ri_offsets, ri_->nDimension, ri_->size, ri_->stride, dim);
+
+#pragma omp parallel for if (nthread > 1) num_threads(nthread)
+  for (s = 0; s < nslice; s++) {
+    int tid = 0;
+    real *stmp;
+    long *stmpi;
+#ifdef _OPENMP
+    tid = omp_get_thread_num();
+#endif
+    stmp = tmp + tid * bufferSize;
+    stmpi = tmpi + tid * bufferSize;
+    if (useHeap) {
+      long i;
+      THTensor_(topkHeap)(t_data + t_offsets[s], t_stride, sliceSize, k, dir, stmp, stmpi);
+      for (i = 0; i < k; i++) {
+        rt_data[rt_offsets[s] + i*rt_stride] = stmp[i];
+        ri_data[ri_offsets[s] + i*ri_stride] = stmpi[i];
+      }
+    } else {
+      THTensor_(topkSelect)(t_data + t_offsets[s], t_stride, sliceSize, k, dir, sorted,
+                            stmp, stmpi, rt_data + rt_offsets[s], rt_stride,
+                            ri_data + ri_offsets[s], ri_stride);
+    }
   }
 
-  THTensor_(free)(tmpResults);
-  THLongTensor_free(tmpIndices);
+  THFree(t_offsets);
+  THFree(rt_offsets);
+  THFree(ri_offsets);
+  THFree(tmp);
+  THFree(tmpi);
 }
 
 void THTensor_(tril)(THTensor *r_, THTensor *t, long k)
@@ -2970,47 +4573,8 @@ void THTensor_(mean)(THTensor *r_, THTensor *t, int dimension, int keepdim)
 
 void THTensor_(std)(THTensor *r_, THTensor *t, int dimension, int biased, int keepdim)
 {
-  THLongStorage *dim;
-
-  THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 3, "invalid dimension %d",
-      dimension + TH_INDEX_BASE);
-
-  dim = THTensor_(newSizeOf)(t);
-  THLongStorage_set(dim, dimension, 1);
-  THTensor_(resize)(r_, dim, NULL);
-  THLongStorage_free(dim);
-
-  TH_TENSOR_DIM_APPLY2(real, t, real, r_, dimension,
-                       accreal sum = 0;
-                       accreal sum2 = 0;
-                       long i;
-                       for(i = 0; i < t_size; i++)
-                       {
-                         real z = t_data[i*t_stride];
-                         sum += z;
-                         sum2 += z*z;
-                       }
-
-                       if(biased)
-                       {
-                         sum /= t_size;
-                         sum2 /= t_size;
-                         sum2 -= sum*sum;
-                         sum2 = (sum2 < 0 ? 0 : sum2);
-                         *r__data = (real)TH_MATH_NAME(sqrt)(sum2);
-                       }
-                       else
-                       {
-                         sum /= t_size;
-                         sum2 /= t_size-1;
-                         sum2 -= ((real)t_size)/((real)(t_size-1))*sum*sum;
-                         sum2 = (sum2 < 0 ? 0 : sum2);
-                         *r__data = (real)TH_MATH_NAME(sqrt)(sum2);
-                       });
-
-  if (!keepdim) {
-    THTensor_(squeeze1d)(r_, r_, dimension);
-  }
+  THTensor_(var)(r_, t, dimension, biased, keepdim);
+  THTensor_(sqrt)(r_, r_);
 }
 
 void THTensor_(var)(THTensor *r_, THTensor *t, int dimension, int biased, int keepdim)
@@ -3025,33 +4589,10 @@ void THTensor_(var)(THTensor *r_, THTensor *t, int dimension, int biased, int ke
   THTensor_(resize)(r_, dim, NULL);
   THLongStorage_free(dim);
 
-  TH_TENSOR_DIM_APPLY2(real, t, real, r_, dimension,
-                       accreal sum = 0;
-                       accreal sum2 = 0;
-                       long i;
-                       for(i = 0; i < t_size; i++)
-                       {
-                         real z = t_data[i*t_stride];
-                         sum += z;
-                         sum2 += z*z;
-                       }
-
-                       if(biased)
-                       {
-                         sum /= t_size;
-                         sum2 /= t_size;
-                         sum2 -= sum*sum;
-                         sum2 = (sum2 < 0 ? 0 : sum2);
-                         *r__data = sum2;
-                       }
-                       else
-                       {
-                         sum /= t_size;
-                         sum2 /= t_size-1;
-                         sum2 -= ((real)t_size)/((real)(t_size-1))*sum*sum;
-                         sum2 = (sum2 < 0 ? 0 : sum2);
-                         *r__data = (real)sum2;
-                       });
+  /* two passes: the mean, then the squared deviations from it */
+  THTensor_(reduceDim)(r_, NULL, t, dimension, TH_REDUCE_SUM, 0);
+  THTensor_(div)(r_, r_, t->size[dimension]);
+  THTensor_(reduceDim)(r_, NULL, t, dimension, TH_REDUCE_VAR, biased);
 
   if (!keepdim) {
     THTensor_(squeeze1d)(r_, r_, dimension);
@@ -3070,29 +4611,29 @@ void THTensor_(norm)(THTensor *r_, THTensor *t, real value, int dimension, int k
   THTensor_(resize)(r_, dim, NULL);
   THLongStorage_free(dim);
 
-  if(value == 0) {
-    TH_TENSOR_DIM_APPLY2(real, t, real, r_, dimension,
-                         accreal sum = 0;
-                         long i;
-                         for(i = 0; i < t_size; i++)
-                           sum += t_data[i*t_stride] != 0.0;
-                         *r__data = sum;)
-  } else {
-    TH_TENSOR_DIM_APPLY2(real, t, real, r_, dimension,
-                         accreal sum = 0;
-                         long i;
-                         for(i = 0; i < t_size; i++) {
-                           sum += TH_MATH_NAME(pow)(
-                             TH_MATH_NAME(fabs)(t_data[i*t_stride]), value);
-                         }
-                         *r__data = TH_MATH_NAME(pow)(sum, 1.0/value);)
-  }
+  if(value == 0)
+    THTensor_(reduceDim)(r_, NULL, t, dimension, TH_REDUCE_NORM0, 0);
+  else if(value == 1)
+    THTensor_(reduceDim)(r_, NULL, t, dimension, TH_REDUCE_NORM1, 0);
+  else if(value == 2)
+    THTensor_(reduceDim)(r_, NULL, t, dimension, TH_REDUCE_NORM2, 0);
+  else
+    THTensor_(reduceDim)(r_, NULL, t, dimension, TH_REDUCE_NORMP, value);
 
   if (!keepdim) {
     THTensor_(squeeze1d)(r_, r_, dimension);
   }
 }
 
+void THTensor_(logcumsumexp)(THTensor *r_, THTensor *t, int dimension)
+{
+  THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 2, "dimension %d out of range",
+      dimension + TH_INDEX_BASE);
+
+  THTensor_(resizeAs)(r_, t);
+  THTensor_(scanDim)(r_, NULL, t, dimension, TH_REDUCE_LOGSUMEXP);
+}
+
 accreal THTensor_(normall)(THTensor *tensor, real value)
 {
   accreal sum = 0;
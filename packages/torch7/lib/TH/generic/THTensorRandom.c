@@ -2,6 +2,12 @@
 #define TH_GENERIC_FILE "generic/THTensorRandom.c"
 #else
 
+/* Philox generators fill contiguous tensors by chunks of words of their
+   stream, computed in parallel: the elements get the values of sequential
+   draws, whatever the number of threads. */
+#define TH_RANDOM_CHUNK 1024
+#define TH_RANDOM_OMP_THRESHOLD 32768
+
 void THTensor_(random)(THTensor *self, THGenerator *_generator)
 {
 #if defined(TH_REAL_IS_BYTE)
@@ -40,6 +46,25 @@ void THTensor_(geometric)(THTensor *self, THGenerator *_generator, double p)
 
 void THTensor_(bernoulli)(THTensor *self, THGenerator *_generator, double p)
 {
+  if (_generator->kind == TH_GENERATOR_PHILOX && THTensor_(isContiguous)(self))
+  {
+    real *data = THTensor_(data)(self);
+    ptrdiff_t size = THTensor_(nElement)(self);
+    unsigned long long offset = _generator->philox_offset;
+    ptrdiff_t i0;
+    THArgCheck(p >= 0 && p <= 1, 1, "must be >= 0 and <= 1");
+    THRandom_discard(_generator, size);
+#pragma omp parallel for if (size > TH_RANDOM_OMP_THRESHOLD)
+    for (i0 = 0; i0 < size; i0 += TH_RANDOM_CHUNK) {
+      unsigned int words[TH_RANDOM_CHUNK];
+      long len = (long)(size - i0 < TH_RANDOM_CHUNK ? size - i0 : TH_RANDOM_CHUNK);
+      long i;
+      THRandom_philoxWords(_generator, offset + i0, len, words);
+      for (i = 0; i < len; i++)
+        data[i0+i] = (real)((double)words[i] * (1.0/4294967296.0) <= p);
+    }
+    return;
+  }
   TH_TENSOR_APPLY(real, self, *self_data = (real)THRandom_bernoulli(_generator, p););
 }
 
@@ -57,11 +82,63 @@ void THTensor_(bernoulli_DoubleTensor)(THTensor *self, THGenerator *_generator,
 
 void THTensor_(uniform)(THTensor *self, THGenerator *_generator, double a, double b)
 {
+  if (_generator->kind == TH_GENERATOR_PHILOX && THTensor_(isContiguous)(self))
+  {
+    real *data = THTensor_(data)(self);
+    ptrdiff_t size = THTensor_(nElement)(self);
+    unsigned long long offset = _generator->philox_offset;
+    ptrdiff_t i0;
+    THRandom_discard(_generator, size);
+#pragma omp parallel for if (size > TH_RANDOM_OMP_THRESHOLD)
+    for (i0 = 0; i0 < size; i0 += TH_RANDOM_CHUNK) {
+      unsigned int words[TH_RANDOM_CHUNK];
+      long len = (long)(size - i0 < TH_RANDOM_CHUNK ? size - i0 : TH_RANDOM_CHUNK);
+      long i;
+      THRandom_philoxWords(_generator, offset + i0, len, words);
+      for (i = 0; i < len; i++)
+        data[i0+i] = (real)((double)words[i] * (1.0/4294967296.0) * (b - a) + a);
+    }
+    return;
+  }
   TH_TENSOR_APPLY(real, self, *self_data = (real)THRandom_uniform(_generator, a, b););
 }
 
 void THTensor_(normal)(THTensor *self, THGenerator *_generator, double mean, double stdv)
 {
+  if (_generator->kind == TH_GENERATOR_PHILOX && THTensor_(isContiguous)(self))
+  {
+    real *data = THTensor_(data)(self);
+    ptrdiff_t size = THTensor_(nElement)(self);
+    unsigned long long offset;
+    ptrdiff_t i0, npair;
+    THArgCheck(stdv > 0, 2, "standard deviation must be strictly positive");
+    /* the second number of a pair already drawn */
+    if (size > 0 && _generator->normal_is_valid) {
+      *data++ = (real)THRandom_normal(_generator, mean, stdv);
+      size--;
+    }
+    npair = size / 2;
+    offset = _generator->philox_offset;
+    THRandom_discard(_generator, 2*npair);
+#pragma omp parallel for if (size > TH_RANDOM_OMP_THRESHOLD)
+    for (i0 = 0; i0 < 2*npair; i0 += TH_RANDOM_CHUNK) {
+      unsigned int words[TH_RANDOM_CHUNK];
+      long len = (long)(2*npair - i0 < TH_RANDOM_CHUNK ? 2*npair - i0 : TH_RANDOM_CHUNK);
+      long i;
+      THRandom_philoxWords(_generator, offset + i0, len, words);
+#if defined(TH_REAL_IS_FLOAT)
+      THRandom_boxMullerFloat(words, len, data + i0);
+#else
+      THRandom_boxMuller(words, len, data + i0);
+#endif
+      for (i = 0; i < len; i++)
+        data[i0+i] = data[i0+i] * stdv + mean;
+    }
+    /* the first number of a new pair, as sequential draws would do */
+    if (size % 2)
+      data[size-1] = (real)THRandom_normal(_generator, mean, stdv);
+    return;
+  }
   TH_TENSOR_APPLY(real, self, *self_data = (real)THRandom_normal(_generator, mean, stdv););
 }
 
@@ -381,12 +458,14 @@ void THTensor_(getRNGState)(THGenerator *_generator, THTensor *self)
 void THTensor_(setRNGState)(THGenerator *_generator, THTensor *self)
 {
   static const size_t size = sizeof(THGenerator);
-  THGenerator *rng_state;
-  THArgCheck(THTensor_(nElement)(self) == size, 1, "RNG state is wrong size");
+  THGenerator rng_state;
+  /* also accept the states saved before the Philox fields were appended */
+  THArgCheck(THTensor_(nElement)(self) == size ||
+             THTensor_(nElement)(self) == THGenerator_mtStateSize(), 1, "RNG state is wrong size");
   THArgCheck(THTensor_(isContiguous)(self), 1, "RNG state needs to be contiguous");
-  rng_state = (THGenerator *)THTensor_(data)(self);
-  THArgCheck(THGenerator_isValid(rng_state), 1, "Invalid RNG state");
-  THGenerator_copy(_generator, rng_state);
+  THGenerator_copyState(&rng_state, THTensor_(data)(self), THTensor_(nElement)(self));
+  THArgCheck(THGenerator_isValid(&rng_state), 1, "Invalid RNG state");
+  THGenerator_copy(_generator, &rng_state);
 }
 #endif
 
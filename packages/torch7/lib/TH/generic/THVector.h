@@ -10,6 +10,14 @@ TH_API void THVector_(muls)(real *y, const real *x, const real c, const ptrdiff_
 TH_API void THVector_(cdiv)(real *z, const real *x, const real *y, const ptrdiff_t n);
 TH_API void THVector_(divs)(real *y, const real *x, const real c, const ptrdiff_t n);
 TH_API void THVector_(copy)(real *y, const real *x, const ptrdiff_t n);
+/* y[i] = x[index[i]] */
+TH_API void THVector_(gather)(real *y, const real *x, const long *index, const ptrdiff_t n);
+
+#if defined(TH_REAL_IS_FLOAT)
+/* bulk conversions between float and half */
+TH_API void THVector_(fromHalf)(real *y, const THHalf *x, const ptrdiff_t n);
+TH_API void THVector_(toHalf)(THHalf *y, const real *x, const ptrdiff_t n);
+#endif
 
 /* Initialize the dispatch pointers */
 TH_API void THVector_(vectorDispatchInit)(void);
@@ -17,6 +17,29 @@ void THVector_(copy_DEFAULT)(real *x, const real *y, const ptrdiff_t n) {
     x[i] = y[i];
 }
 
+void THVector_(gather_DEFAULT)(real *y, const real *x, const long *index, const ptrdiff_t n) {
+  ptrdiff_t i = 0;
+
+  for(; i < n; i++)
+    y[i] = x[index[i]];
+}
+
+#if defined(TH_REAL_IS_FLOAT)
+void THVector_(fromHalf_DEFAULT)(real *y, const THHalf *x, const ptrdiff_t n) {
+  ptrdiff_t i = 0;
+
+  for(; i < n; i++)
+    y[i] = TH_half2float(x[i]);
+}
+
+void THVector_(toHalf_DEFAULT)(THHalf *y, const real *x, const ptrdiff_t n) {
+  ptrdiff_t i = 0;
+
+  for(; i < n; i++)
+    y[i] = TH_float2half(x[i]);
+}
+#endif
+
 void THVector_(fill_DEFAULT)(real *x, const real c, const ptrdiff_t n) {
   ptrdiff_t i = 0;
 
@@ -239,6 +239,54 @@ void THVector_(copy)(real *y, const real *x, const ptrdiff_t n) {
   THVector_(copy_DISPATCHPTR)(y, x, n);
 }
 
+static void (*THVector_(gather_DISPATCHPTR))(real *, const real *, const long *, const ptrdiff_t) = &THVector_(gather_DEFAULT);
+static FunctionDescription THVector_(gather_DISPATCHTABLE)[] = {
+  #if defined(USE_AVX2)
+    #if defined(TH_REAL_IS_DOUBLE) || defined(TH_REAL_IS_FLOAT)
+      FUNCTION_IMPL(THVector_(gather_AVX2), SIMDExtension_AVX2),
+    #endif
+  #endif
+
+  FUNCTION_IMPL(THVector_(gather_DEFAULT), SIMDExtension_DEFAULT)
+};
+void THVector_(gather)(real *y, const real *x, const long *index, const ptrdiff_t n) {
+  THVector_(gather_DISPATCHPTR)(y, x, index, n);
+}
+
+#if defined(TH_REAL_IS_FLOAT)
+static void (*THVector_(fromHalf_DISPATCHPTR))(real *, const THHalf *, const ptrdiff_t) = &THVector_(fromHalf_DEFAULT);
+static FunctionDescription THVector_(fromHalf_DISPATCHTABLE)[] = {
+  #if defined(__NEON__) && defined(TH_NEON_FP16)
+    FUNCTION_IMPL(THVector_(fromHalf_NEON), SIMDExtension_NEON),
+  #endif
+
+  #if defined(USE_F16C)
+    FUNCTION_IMPL(THVector_(fromHalf_F16C), SIMDExtension_F16C),
+  #endif
+
+  FUNCTION_IMPL(THVector_(fromHalf_DEFAULT), SIMDExtension_DEFAULT)
+};
+void THVector_(fromHalf)(real *y, const THHalf *x, const ptrdiff_t n) {
+  THVector_(fromHalf_DISPATCHPTR)(y, x, n);
+}
+
+static void (*THVector_(toHalf_DISPATCHPTR))(THHalf *, const real *, const ptrdiff_t) = &THVector_(toHalf_DEFAULT);
+static FunctionDescription THVector_(toHalf_DISPATCHTABLE)[] = {
+  #if defined(__NEON__) && defined(TH_NEON_FP16)
+    FUNCTION_IMPL(THVector_(toHalf_NEON), SIMDExtension_NEON),
+  #endif
+
+  #if defined(USE_F16C)
+    FUNCTION_IMPL(THVector_(toHalf_F16C), SIMDExtension_F16C),
+  #endif
+
+  FUNCTION_IMPL(THVector_(toHalf_DEFAULT), SIMDExtension_DEFAULT)
+};
+void THVector_(toHalf)(THHalf *y, const real *x, const ptrdiff_t n) {
+  THVector_(toHalf_DISPATCHPTR)(y, x, n);
+}
+#endif
+
 /* This needs to be called in order to initialize the dispatch pointers at runtime.
  * This function simply checks what SIMD extensions are available, and then walks the dispatch table
  * to choose the best function.
@@ -257,6 +305,11 @@ void THVector_(vectorDispatchInit)(void)
   INIT_DISPATCH_PTR(cdiv);
   INIT_DISPATCH_PTR(divs);
   INIT_DISPATCH_PTR(copy);
+  INIT_DISPATCH_PTR(gather);
+#if defined(TH_REAL_IS_FLOAT)
+  INIT_DISPATCH_PTR(fromHalf);
+  INIT_DISPATCH_PTR(toHalf);
+#endif
 }
 
 #endif
@@ -4,6 +4,7 @@
 #else
 #include <intrin.h>
 #endif
+#include <limits.h>
 #include "AVX2.h"
 
 void THDoubleVector_cadd_AVX2(double *z, const double *x, const double *y, const double c, const ptrdiff_t n) {
@@ -44,4 +45,43 @@ void THFloatVector_cadd_AVX2(float *z, const float *x, const float *y, const flo
   }
 }
 
+/* long indices are 64 bits, except on LLP64 platforms */
+#if LONG_MAX > 2147483647L
+#define TH_AVX2_GATHER_PD(x, index) _mm256_i64gather_pd(x, _mm256_loadu_si256((const __m256i *)(index)), 8)
+#define TH_AVX2_GATHER_PS(x, index) _mm256_insertf128_ps(                                            \
+    _mm256_castps128_ps256(_mm256_i64gather_ps(x, _mm256_loadu_si256((const __m256i *)(index)), 4)), \
+    _mm256_i64gather_ps(x, _mm256_loadu_si256((const __m256i *)((index)+4)), 4), 1)
+#else
+#define TH_AVX2_GATHER_PD(x, index) _mm256_i32gather_pd(x, _mm_loadu_si128((const __m128i *)(index)), 8)
+#define TH_AVX2_GATHER_PS(x, index) _mm256_i32gather_ps(x, _mm256_loadu_si256((const __m256i *)(index)), 4)
+#endif
+
+void THDoubleVector_gather_AVX2(double *y, const double *x, const long *index, const ptrdiff_t n) {
+  ptrdiff_t i;
+  __m256d YMM0, YMM1;
+  for (i=0; i<=((n)-8); i+=8) {
+    YMM0 = TH_AVX2_GATHER_PD(x, index+i);
+    YMM1 = TH_AVX2_GATHER_PD(x, index+i+4);
+    _mm256_storeu_pd(y+i, YMM0);
+    _mm256_storeu_pd(y+i+4, YMM1);
+  }
+  for (; i<(n); i++) {
+    y[i] = x[index[i]];
+  }
+}
+
+void THFloatVector_gather_AVX2(float *y, const float *x, const long *index, const ptrdiff_t n) {
+  ptrdiff_t i;
+  __m256 YMM0, YMM1;
+  for (i=0; i<=((n)-16); i+=16) {
+    YMM0 = TH_AVX2_GATHER_PS(x, index+i);
+    YMM1 = TH_AVX2_GATHER_PS(x, index+i+8);
+    _mm256_storeu_ps(y+i, YMM0);
+    _mm256_storeu_ps(y+i+8, YMM1);
+  }
+  for (; i<(n); i++) {
+    y[i] = x[index[i]];
+  }
+}
+
 #endif // defined(__AVX2__)
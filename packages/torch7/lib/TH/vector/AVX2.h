@@ -5,5 +5,7 @@
 
 void THDoubleVector_cadd_AVX2(double *z, const double *x, const double *y, const double c, const ptrdiff_t n);
 void THFloatVector_cadd_AVX2(float *z, const float *x, const float *y, const float c, const ptrdiff_t n);
+void THDoubleVector_gather_AVX2(double *y, const double *x, const long *index, const ptrdiff_t n);
+void THFloatVector_gather_AVX2(float *y, const float *x, const long *index, const ptrdiff_t n);
 
 #endif
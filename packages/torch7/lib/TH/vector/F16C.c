@@ -0,0 +1,37 @@
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX__))
+#ifndef _MSC_VER
+#include <x86intrin.h>
+#else
+#include <intrin.h>
+#endif
+#include "F16C.h"
+
+void THFloatVector_fromHalf_F16C(float *y, const THHalf *x, const ptrdiff_t n) {
+  ptrdiff_t i;
+  __m128i XMM0, XMM1;
+  for (i=0; i<=((n)-16); i+=16) {
+    XMM0 = _mm_loadu_si128((const __m128i*)(x+i));
+    XMM1 = _mm_loadu_si128((const __m128i*)(x+i+8));
+    _mm256_storeu_ps(y+i, _mm256_cvtph_ps(XMM0));
+    _mm256_storeu_ps(y+i+8, _mm256_cvtph_ps(XMM1));
+  }
+  for (; i<(n); i++) {
+    y[i] = _cvtsh_ss(x[i].x);
+  }
+}
+
+void THFloatVector_toHalf_F16C(THHalf *y, const float *x, const ptrdiff_t n) {
+  ptrdiff_t i;
+  __m256 YMM0, YMM1;
+  for (i=0; i<=((n)-16); i+=16) {
+    YMM0 = _mm256_loadu_ps(x+i);
+    YMM1 = _mm256_loadu_ps(x+i+8);
+    _mm_storeu_si128((__m128i*)(y+i), _mm256_cvtps_ph(YMM0, _MM_FROUND_TO_NEAREST_INT));
+    _mm_storeu_si128((__m128i*)(y+i+8), _mm256_cvtps_ph(YMM1, _MM_FROUND_TO_NEAREST_INT));
+  }
+  for (; i<(n); i++) {
+    y[i].x = _cvtss_sh(x[i], _MM_FROUND_TO_NEAREST_INT);
+  }
+}
+
+#endif // defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX__))
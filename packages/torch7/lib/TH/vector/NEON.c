@@ -103,3 +103,38 @@ static void THFloatVector_divs_NEON(float *y, const float *x, const float c, con
   for(; i < n; i++)
     y[i] = x[i] / c;
 }
+
+#if defined(__aarch64__) || defined(__ARM_FP16_FORMAT_IEEE)
+#define TH_NEON_FP16
+#include <arm_neon.h>
+
+static void THFloatVector_fromHalf_NEON(float *y, const THHalf *x, const ptrdiff_t n) {
+  long i = 0;
+
+  for(; i <= n-8; i += 8)
+  {
+    uint16x4_t h0 = vld1_u16((const uint16_t*)(x+i));
+    uint16x4_t h1 = vld1_u16((const uint16_t*)(x+i+4));
+    vst1q_f32(y+i, vcvt_f32_f16(vreinterpret_f16_u16(h0)));
+    vst1q_f32(y+i+4, vcvt_f32_f16(vreinterpret_f16_u16(h1)));
+  }
+
+  for(; i < n; i++)
+    y[i] = TH_half2float(x[i]);
+}
+
+static void THFloatVector_toHalf_NEON(THHalf *y, const float *x, const ptrdiff_t n) {
+  long i = 0;
+
+  for(; i <= n-8; i += 8)
+  {
+    float32x4_t f0 = vld1q_f32(x+i);
+    float32x4_t f1 = vld1q_f32(x+i+4);
+    vst1_u16((uint16_t*)(y+i), vreinterpret_u16_f16(vcvt_f16_f32(f0)));
+    vst1_u16((uint16_t*)(y+i+4), vreinterpret_u16_f16(vcvt_f16_f32(f1)));
+  }
+
+  for(; i < n; i++)
+    y[i] = TH_float2half(x[i]);
+}
+#endif
@@ -25,6 +25,11 @@ interface:wrap('manualSeed',
                {{name='Generator', default=true},
                 {name="long"}})
 
+interface:wrap('discard',
+               'THRandom_discard',
+               {{name='Generator', default=true},
+                {name="long"}})
+
 interface:wrap('getRNGState',
                 'THByteTensor_getRNGState',
                 {{name='Generator', default=true},
@@ -1664,6 +1664,42 @@ function torchtest.prod()
       mytester:asserteq(maxdiff(a, b), 0, 'torch.sum value')
    end
 end
+function torchtest.reduceLarge()
+   -- wide and narrow inner sizes, and long reduced dimensions
+   for _, size in ipairs({{3, 5000, 40}, {2, 20000, 3}, {1, 300, 1500}}) do
+      local x = torch.rand(unpack(size)):add(0.5)
+      for _, xd in ipairs({x, x:transpose(1, 3)}) do
+         for d = 1, 3 do
+            local n = xd:size(d)
+            local sum = xd:narrow(d, 1, 1):clone():zero()
+            local mx = xd:narrow(d, 1, 1):clone()
+            local sq = sum:clone()
+            for j = 1, n do
+               sum:add(xd:narrow(d, j, 1))
+               mx:cmax(xd:narrow(d, j, 1))
+               sq:add(torch.pow(xd:narrow(d, j, 1), 2))
+            end
+            local msg = ' (dim ' .. d .. ' of ' .. table.concat(xd:size():totable(), 'x') .. ')'
+            mytester:assertTensorEq(xd:sum(d), sum, 1e-9 * n, 'torch.sum' .. msg)
+            mytester:assertTensorEq(xd:mean(d), sum / n, 1e-9, 'torch.mean' .. msg)
+            mytester:assertTensorEq(xd:norm(2, d), torch.sqrt(sq), 1e-9 * n, 'torch.norm' .. msg)
+            -- (the unbiased estimate is NaN over a single element)
+            local biased = (n == 1)
+            local var = (sq - torch.pow(sum, 2) / n) / (biased and n or n - 1)
+            mytester:assertTensorEq(xd:var(d, biased), var, 1e-8, 'torch.var' .. msg)
+            mytester:assertTensorEq(xd:std(d, biased), torch.sqrt(var:clamp(0, math.huge)), 1e-8, 'torch.std' .. msg)
+            local val, ind = xd:max(d)
+            mytester:assertTensorEq(val, mx, 0, 'torch.max' .. msg)
+            mytester:assertTensorEq(xd:gather(d, ind), mx, 0, 'torch.max indices' .. msg)
+         end
+      end
+   end
+
+   -- float sums are accumulated in double
+   local x = torch.FloatTensor(2000000, 2):fill(0.1)
+   mytester:assertlt(math.abs(x:sum(1)[1][1] - 200000), 1, 'torch.sum float accuracy')
+   mytester:assertlt(math.abs(x:t():sum(2)[1][1] - 200000), 1, 'torch.sum float accuracy')
+end
 function torchtest.cumsum()
    local x = torch.rand(msize,msize)
    local mx = torch.cumsum(x,2)
@@ -1678,6 +1714,58 @@ function torchtest.cumprod()
    torch.cumprod(mxx,x,2)
    mytester:asserteq(maxdiff(mx,mxx),0,'torch.cumprod value')
 end
+function torchtest.cumScanLarge()
+   -- long vectors (scanned in chunks) and scans across columns
+   local v = torch.rand(200000):add(-0.5)
+   local cs, cm, ci = v:clone(), v:clone(), torch.LongTensor(v:size(1)):fill(1)
+   for i = 2, v:size(1) do
+      cs[i] = cs[i-1] + v[i]
+      if v[i] > cm[i-1] then
+         cm[i], ci[i] = v[i], i
+      else
+         cm[i], ci[i] = cm[i-1], ci[i-1]
+      end
+   end
+   mytester:assertTensorEq(torch.cumsum(v), cs, 1e-8, 'torch.cumsum long vector')
+   local val, ind = torch.cummax(v)
+   mytester:assertTensorEq(val, cm, 0, 'torch.cummax long vector')
+   mytester:assertTensorEq(ind, ci, 0, 'torch.cummax long vector indices')
+   local val, ind = torch.cummin(-v)
+   mytester:assertTensorEq(val, -cm, 0, 'torch.cummin long vector')
+   mytester:assertTensorEq(ind, ci, 0, 'torch.cummin long vector indices')
+
+   local x = torch.rand(300, 400):add(0.5)
+   for _, xd in ipairs({x, x:t()}) do
+      for d = 1, 2 do
+         local s = xd:narrow(d, 1, 1):clone()
+         local p = s:clone()
+         local m = s:clone()
+         local e = torch.exp(s)
+         local ms = torch.cumsum(xd, d)
+         local mp = torch.cumprod(xd, d)
+         local mm, mi = torch.cummin(xd, d)
+         local ml = torch.logcumsumexp(xd, d)
+         for j = 2, xd:size(d) do
+            local xj = xd:narrow(d, j, 1)
+            s:add(xj)
+            p:cmul(xj)
+            m:cmin(xj)
+            e:add(torch.exp(xj))
+            local msg = ' (dim ' .. d .. ', index ' .. j .. ')'
+            mytester:assertTensorEq(ms:narrow(d, j, 1), s, 1e-9 * j, 'torch.cumsum' .. msg)
+            mytester:assertTensorEq(mp:narrow(d, j, 1), p, 1e-9 * p:max(), 'torch.cumprod' .. msg)
+            mytester:assertTensorEq(mm:narrow(d, j, 1), m, 0, 'torch.cummin' .. msg)
+            mytester:assertTensorEq(xd:gather(d, mi:narrow(d, j, 1)), m, 0, 'torch.cummin indices' .. msg)
+            mytester:assertTensorEq(ml:narrow(d, j, 1), torch.log(e), 1e-9, 'torch.logcumsumexp' .. msg)
+         end
+      end
+   end
+
+   -- no overflow
+   local y = torch.Tensor{1000, 1000, -1000}
+   mytester:assertTensorEq(torch.logcumsumexp(y), torch.Tensor{1000, 1000 + math.log(2), 1000 + math.log(2)},
+                           1e-9, 'torch.logcumsumexp large values')
+end
 function torchtest.cross()
    local x = torch.rand(msize,3,msize)
    local y = torch.rand(msize,3,msize)
@@ -1984,6 +2072,71 @@ function torchtest.sortDescending()
    assertIsOrdered('descending', x, mxx, ixx, 'random with duplicate keys')
 end
 
+function torchtest.sortLarge()
+   -- long slices take the radix sort path
+   for _, typename in ipairs({'torch.DoubleTensor', 'torch.FloatTensor',
+                              'torch.IntTensor', 'torch.LongTensor'}) do
+      local x = torch.randn(3, 2000):mul(1000)
+      -- a row with many equal keys
+      x:select(1, 2):div(100):floor()
+      x = x:type(typename)
+      for _, dim in ipairs({1, 2}) do
+         local xd = dim == 1 and x:t() or x
+         for _, desc in ipairs({false, true}) do
+            local order = desc and 'descending' or 'ascending'
+            local msg = 'torch.sort (' .. order .. ') large ' .. typename
+            local mx, ix = torch.sort(xd, dim, desc)
+            local n = mx:size(dim)
+            local a, b = mx:narrow(dim, 1, n-1), mx:narrow(dim, 2, n-1)
+            local unordered = desc and a:lt(b) or a:gt(b)
+            mytester:asserteq(unordered:sum(), 0, msg .. ' values unordered')
+            mytester:assertTensorEq(xd:gather(dim, ix):double(), mx:double(), 0,
+                                    msg .. ' indices wrong')
+            local shape = dim == 1 and {n, 1} or {1, n}
+            local range = torch.range(1, n):view(unpack(shape)):expandAs(mx:double())
+            mytester:assertTensorEq(torch.sort(ix, dim):double(), range, 0,
+                                    msg .. ' indices not a permutation')
+         end
+      end
+   end
+
+   -- equal keys keep their order
+   local x = torch.Tensor(5000):random(4)
+   local mx, ix = torch.sort(x)
+   local stable = true
+   for i = 2, x:size(1) do
+      if mx[i] == mx[i-1] and ix[i] < ix[i-1] then
+         stable = false
+      end
+   end
+   mytester:assert(stable, 'torch.sort large sort is not stable')
+
+   -- negative zeros, infinities
+   local x = torch.randn(1000)
+   x[1] = -0; x[2] = 0; x[3] = math.huge; x[4] = -math.huge
+   local mx = torch.sort(x)
+   mytester:asserteq(mx[1], -math.huge, 'torch.sort large -inf')
+   mytester:asserteq(mx[1000], math.huge, 'torch.sort large inf')
+end
+
+function torchtest.topKSmall()
+   -- k small against the slice size takes the heap path
+   local t = torch.rand(20, 5000)
+   t:select(1, 3):fill(0.5)
+   for _, k in ipairs({1, 5, 100}) do
+      for _, dir in ipairs({false, true}) do
+         for _, dim in ipairs({1, 2}) do
+            local td = dim == 1 and t:t() or t
+            local val, ind = td:topk(k, dim, dir, true)
+            local sval = td:sort(dim, dir):narrow(dim, 1, k)
+            local msg = 'topk(' .. k .. ', ' .. dim .. ', ' .. tostring(dir) .. ')'
+            mytester:assertTensorEq(val, sval, 0, msg)
+            mytester:assertTensorEq(td:gather(dim, ind), val, 0, msg .. ' indices')
+         end
+      end
+   end
+end
+
 function torchtest.topK()
    local function topKViaSort(t, k, dim, dir)
       local sorted, indices = t:sort(dim, dir)
@@ -2762,6 +2915,78 @@ function torchtest.conv2()
    mytester:asserteq(maxdiff(immfc[1],imfc),0,'torch.conv2')
 end
 
+function torchtest.conv2Large()
+   -- kernels large enough for the FFT path, against sums of shifted images
+   local x = torch.rand(math.floor(torch.uniform(90,130)),math.floor(torch.uniform(90,130)))
+   local k = torch.rand(math.floor(torch.uniform(20,32)),math.floor(torch.uniform(20,32)))
+   local kr, kc = k:size(1), k:size(2)
+   local xf = torch.zeros(x:size(1)+2*(kr-1), x:size(2)+2*(kc-1))
+   xf:narrow(1,kr,x:size(1)):narrow(2,kc,x:size(2)):copy(x)
+   for _,m in ipairs{'V','F'} do
+      local xm = (m == 'V') and x or xf
+      local ref = torch.zeros(xm:size(1)-kr+1, xm:size(2)-kc+1)
+      for i=1,kr do
+         for j=1,kc do
+            ref:add(k[i][j], xm:narrow(1,i,ref:size(1)):narrow(2,j,ref:size(2)))
+         end
+      end
+      mytester:assertlt(maxdiff(torch.xcorr2(x,k,m),ref),precision,'torch.xcorr2 large kernel ' .. m)
+      local kf = k:index(1,torch.range(kr,1,-1):long()):index(2,torch.range(kc,1,-1):long())
+      mytester:assertlt(maxdiff(torch.conv2(x,kf,m),ref),precision,'torch.conv2 large kernel ' .. m)
+      mytester:assertlt(maxdiff(torch.xcorr2(x:float(),k:float(),m):double(),ref),1e-3,'torch.xcorr2 large kernel float ' .. m)
+   end
+end
+
+function torchtest.conv2LargeNonFinite()
+   -- an inf or a NaN only reaches the outputs the kernel covers (as with the
+   -- direct loops), not a whole FFT tile
+   local x = torch.rand(200,200)
+   local k = torch.rand(15,15)
+   local ref = torch.xcorr2(x,k)
+   for _,v in ipairs{math.huge, 0/0} do
+      local xv = x:clone()
+      xv[100][100] = v
+      local r = torch.xcorr2(xv,k)
+      local covered = torch.ByteTensor(r:size()):zero()
+      covered:narrow(1,86,15):narrow(2,86,15):fill(1)
+      local finite = r:eq(r):cmul(r:ne(math.huge)):cmul(r:ne(-math.huge))
+      mytester:assertTensorEq(finite:add(covered), torch.ByteTensor(r:size()):fill(1), 0,
+                              'torch.xcorr2 large kernel non-finite outputs ' .. v)
+      r:maskedFill(covered, 0)
+      ref:maskedFill(covered, 0)
+      mytester:assertlt(maxdiff(r,ref),precision,'torch.xcorr2 large kernel non-finite ' .. v)
+   end
+end
+
+function torchtest.conv3Large()
+   -- kernels large enough for the FFT path, against sums of shifted volumes
+   local x = torch.rand(math.floor(torch.uniform(26,34)),
+                        math.floor(torch.uniform(26,34)),
+                        math.floor(torch.uniform(26,34)))
+   local k = torch.rand(math.floor(torch.uniform(7,10)),
+                        math.floor(torch.uniform(7,10)),
+                        math.floor(torch.uniform(7,10)))
+   local kt, kr, kc = k:size(1), k:size(2), k:size(3)
+   local xf = torch.zeros(x:size(1)+2*(kt-1), x:size(2)+2*(kr-1), x:size(3)+2*(kc-1))
+   xf:narrow(1,kt,x:size(1)):narrow(2,kr,x:size(2)):narrow(3,kc,x:size(3)):copy(x)
+   local kf = k:clone()
+   local ks, kfs = k:storage(), kf:storage()
+   for i=ks:size(),1,-1 do kfs[ks:size()-i+1]=ks[i] end
+   for _,m in ipairs{'V','F'} do
+      local xm = (m == 'V') and x or xf
+      local ref = torch.zeros(xm:size(1)-kt+1, xm:size(2)-kr+1, xm:size(3)-kc+1)
+      for i=1,kt do
+         for j=1,kr do
+            for l=1,kc do
+               ref:add(k[i][j][l], xm:narrow(1,i,ref:size(1)):narrow(2,j,ref:size(2)):narrow(3,l,ref:size(3)))
+            end
+         end
+      end
+      mytester:assertlt(maxdiff(torch.xcorr3(x,k,m),ref),precision,'torch.xcorr3 large kernel ' .. m)
+      mytester:assertlt(maxdiff(torch.conv3(x,kf,m),ref),precision,'torch.conv3 large kernel ' .. m)
+   end
+end
+
 function torchtest.conv3()
    local x = torch.rand(math.floor(torch.uniform(20,40)),
                         math.floor(torch.uniform(20,40)),
@@ -2956,6 +3181,37 @@ function torchtest.serializeGenerator()
    mytester:assertne(generated, differentGenerated, 'Generators with different random seed should not produce the same output')
 end
 
+function torchtest.RNGStateOldSize()
+   -- states saved before the Philox fields were appended: the Mersenne
+   -- Twister prefix of the current state, the only shorter size accepted
+   local gen = torch.Generator()
+   torch.manualSeed(gen, 321)
+   torch.rand(gen, 10)
+   local state = torch.getRNGState(gen)
+   local oldSize
+   for size = state:size(1) - 1, 1, -1 do
+      if pcall(torch.setRNGState, torch.Generator(), state:narrow(1, 1, size)) then
+         mytester:assert(oldSize == nil, 'more than one RNG state size accepted')
+         oldSize = size
+      end
+   end
+   mytester:assert(oldSize ~= nil, 'old RNG state size not accepted')
+   local expected = torch.rand(gen, 100)
+   local restored = torch.Generator('philox')
+   torch.setRNGState(restored, state:narrow(1, 1, oldSize):clone())
+   mytester:assertTensorEq(torch.rand(restored, 100), expected, 0, 'old size RNG state')
+
+   -- generators serialized before: version 1, same prefix
+   torch.manualSeed(gen, 321)
+   local serialized = torch.serialize(gen)
+   local payload = serialized:sub(1, #serialized - (state:size(1) - oldSize))
+   local old, n = payload:gsub('V 2', 'V 1', 1)
+   mytester:asserteq(n, 1, 'torch.Generator version')
+   local deserialized = torch.deserialize(old)
+   torch.manualSeed(gen, 321)
+   mytester:assertTensorEq(torch.rand(deserialized, 100), torch.rand(gen, 100), 0, 'version 1 torch.Generator')
+end
+
 function torchtest.testBoxMullerState()
     torch.manualSeed(123)
     local odd_number = 101
@@ -2970,6 +3226,74 @@ function torchtest.testBoxMullerState()
     mytester:assertTensorEq(seeded, reseeded, 1e-16, 'repeated calls to manualSeed not generating same sequence of normally distributed numbers')
 end
 
+function torchtest.philoxGenerator()
+   local gen = torch.Generator('philox')
+   -- Philox4x32-10 known answer: counter 0, key 0
+   torch.manualSeed(gen, 0)
+   mytester:asserteq(torch.random(gen), 0x6627e8d5, 'Philox4x32-10 known answer')
+   mytester:asserteq(torch.random(gen), 0xe169c58d, 'Philox4x32-10 known answer')
+
+   -- tensor fills draw the same numbers as sequential calls
+   local n = 100003
+   local function draws(f)
+      local x = torch.DoubleTensor(n)
+      for i=1,n do
+         x[i] = f()
+      end
+      return x
+   end
+   torch.manualSeed(gen, 123)
+   local u = torch.DoubleTensor(n):uniform(gen, -1, 2)
+   local z = torch.DoubleTensor(n):normal(gen, 1, 3)
+   local b = torch.DoubleTensor(n):bernoulli(gen, 0.3)
+   torch.manualSeed(gen, 123)
+   mytester:assertTensorEq(u, draws(function() return torch.uniform(gen, -1, 2) end), 1e-16, 'Philox uniform fill')
+   mytester:assertTensorEq(z, draws(function() return torch.normal(gen, 1, 3) end), 1e-16, 'Philox normal fill')
+   mytester:assertTensorEq(b, draws(function() return torch.bernoulli(gen, 0.3) end), 1e-16, 'Philox bernoulli fill')
+
+   -- single precision normals: approximated, vectorized
+   torch.manualSeed(gen, 7)
+   local zf = torch.FloatTensor(n):normal(gen)
+   torch.manualSeed(gen, 7)
+   mytester:assertTensorEq(zf:double(), torch.DoubleTensor(n):normal(gen), 1e-5, 'Philox float normal fill')
+   mytester:assertlt(math.abs(zf:mean()), 0.02, 'Philox normal mean')
+   mytester:assertlt(math.abs(zf:std() - 1), 0.02, 'Philox normal standard deviation')
+
+   -- skipping ahead is the same as drawing
+   torch.manualSeed(gen, 5)
+   torch.rand(gen, 1001)
+   local expected = torch.rand(gen, 10)
+   torch.manualSeed(gen, 5)
+   torch.discard(gen, 1001)
+   mytester:assertTensorEq(torch.rand(gen, 10), expected, 1e-16, 'Philox discard')
+   local mt = torch.Generator()
+   torch.manualSeed(mt, 5)
+   torch.rand(mt, 1001)
+   expected = torch.rand(mt, 10)
+   torch.manualSeed(mt, 5)
+   torch.discard(mt, 1001)
+   mytester:assertTensorEq(torch.rand(mt, 10), expected, 1e-16, 'Mersenne Twister discard')
+
+   -- fills do not depend on the number of threads
+   local nthread = torch.getnumthreads()
+   torch.setnumthreads(1)
+   torch.manualSeed(gen, 11)
+   local x1 = torch.FloatTensor(1000000):normal(gen)
+   torch.setnumthreads(4)
+   torch.manualSeed(gen, 11)
+   local x4 = torch.FloatTensor(1000000):normal(gen)
+   torch.setnumthreads(nthread)
+   mytester:assertTensorEq(x1, x4, 0, 'Philox fill depends on the number of threads')
+
+   -- state and serialization
+   local state = torch.getRNGState(gen)
+   local before = torch.rand(gen, 100)
+   torch.setRNGState(gen, state)
+   mytester:assertTensorEq(torch.rand(gen, 100), before, 1e-16, 'Philox getRNGState/setRNGState')
+   local copy = torch.deserialize(torch.serialize(gen))
+   mytester:asserteq(torch.random(copy), torch.random(gen), 'Philox generator serialization')
+end
+
 function torchtest.testCholesky()
    local x = torch.rand(10,10)
    local A = torch.mm(x, x:t())
@@ -3199,6 +3523,52 @@ function torchtest.indexAdd()
    mytester:assertTensorEq(dest, dest2, 0.000001, "indexAdd scalar error")
 end
 
+function torchtest.indexLarge()
+   -- long indices with repetitions, rows of one and of many elements
+   for _, size in ipairs({{1000}, {500, 3}, {50, 700}}) do
+      local x = torch.Tensor(unpack(size)):random(100)
+      local n = math.floor(200000 * x:size(1) / x:nElement())
+      local idx = torch.LongTensor(n):random(x:size(1))
+      local src = torch.Tensor(n, unpack(size, 2)):random(100)
+      local msg = ' (' .. table.concat(size, 'x') .. ')'
+
+      local sel = x:index(1, idx)
+      local ref = sel:clone():zero()
+      local sum, cpy = x:clone(), x:clone()
+      local gi = torch.LongTensor(n, unpack(size, 2))
+      for i = 1, n do
+         ref:narrow(1, i, 1):copy(x:narrow(1, idx[i], 1))
+         sum:narrow(1, idx[i], 1):add(src:narrow(1, i, 1))
+         cpy:narrow(1, idx[i], 1):copy(src:narrow(1, i, 1))
+         gi:narrow(1, i, 1):fill(idx[i])
+      end
+      mytester:assertTensorEq(sel, ref, 0, 'torch.index' .. msg)
+      -- (indexAdd and indexCopy return src)
+      local xsum, xcpy = x:clone(), x:clone()
+      xsum:indexAdd(1, idx, src)
+      xcpy:indexCopy(1, idx, src)
+      mytester:assertTensorEq(xsum, sum, 0, 'torch.indexAdd' .. msg)
+      mytester:assertTensorEq(xcpy, cpy, 0, 'torch.indexCopy' .. msg)
+      mytester:assertTensorEq(x:gather(1, gi), sel, 0, 'torch.gather' .. msg)
+      mytester:assertTensorEq(x:clone():scatter(1, gi, src), cpy, 0, 'torch.scatter' .. msg)
+      -- (a strided src takes the generic loops)
+      local ssz = src:size():totable()
+      table.insert(ssz, 2)
+      local srcs = src.new(unpack(ssz)):select(src:dim() + 1, 1):copy(src)
+      mytester:assertTensorEq(x:clone():scatterAdd(1, gi, src), sum, 0, 'torch.scatterAdd' .. msg)
+      mytester:assertTensorEq(x:clone():scatterAdd(1, gi, srcs), sum, 0, 'torch.scatterAdd (generic)' .. msg)
+      if x:dim() == 2 then
+         local t = x:t():contiguous()
+         mytester:assertTensorEq(t:index(2, idx), sel:t(), 0, 'torch.index (dim 2)' .. msg)
+         mytester:assertTensorEq(t:gather(2, gi:t():contiguous()), sel:t(), 0, 'torch.gather (dim 2)' .. msg)
+         mytester:assertTensorEq(t:clone():scatterAdd(2, gi:t():contiguous(), src:t():contiguous()), sum:t(), 0,
+                                 'torch.scatterAdd (dim 2)' .. msg)
+         t:indexAdd(2, idx, src:t():contiguous())
+         mytester:assertTensorEq(t, sum:t(), 0, 'torch.indexAdd (dim 2)' .. msg)
+      end
+   end
+end
+
 -- Fill idx with valid indices.
 local function fillIdx(idx, dim, dim_size, elems_per_row, m, n, o)
    for i = 1, (dim == 1 and 1 or m) do
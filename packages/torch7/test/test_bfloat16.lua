@@ -0,0 +1,211 @@
+local mytester
+local torchtest = torch.TestSuite()
+
+-- there is no BFloat16Tensor in Lua: conversions are reached through the
+-- File methods, and bit patterns are read back as integers
+local function fromBits(bits)
+   local file = torch.MemoryFile()
+   file:binary()
+   for i = 1, #bits do
+      file:writeInt(bits[i] >= 2^31 and bits[i] - 2^32 or bits[i])
+   end
+   file:seek(1)
+   local x = file:readFloat(#bits)
+   file:close()
+   return x
+end
+
+local function floatBits(x)
+   local file = torch.MemoryFile()
+   file:binary()
+   file:writeFloat(x)
+   file:seek(1)
+   local s = file:readInt(x:size())
+   file:close()
+   local bits = {}
+   for i = 1, s:size() do bits[i] = s[i] % 2^32 end
+   return bits
+end
+
+local function bfloat16Bits(x)
+   local file = torch.MemoryFile()
+   file:binary()
+   mytester:asserteq(file:writeFloatAsBFloat16(x), x:size(), 'writeFloatAsBFloat16 count')
+   file:seek(1)
+   local s = file:readShort(x:size())
+   file:close()
+   local bits = {}
+   for i = 1, s:size() do bits[i] = s[i] % 2^16 end
+   return bits
+end
+
+-- reference float->bfloat16 conversion: quiet NaN, else round to nearest even
+local function refBits(u)
+   if u % 2^31 > 0x7f800000 then
+      return 0x7fc0
+   end
+   return math.floor((u + 0x7fff + math.floor(u / 2^16) % 2) / 2^16)
+end
+
+local function randomBits(n)
+   local bits = {}
+   for i = 1, n do bits[i] = math.random(0, 2^16 - 1) * 2^16 + math.random(0, 2^16 - 1) end
+   return bits
+end
+
+-- rounds a FloatTensor to bfloat16 (and back)
+local function round(x)
+   local file = torch.MemoryFile()
+   file:binary()
+   file:writeFloatAsBFloat16(x:contiguous():storage())
+   file:seek(1)
+   local y = torch.FloatTensor(file:readBFloat16AsFloat(x:nElement())):resizeAs(x)
+   file:close()
+   return y
+end
+
+function torchtest.roundNearestEven()
+   local cases = {
+      {0x3f800000, 0x3f80}, -- 1
+      {0x3f808000, 0x3f80}, -- tie, even below
+      {0x3f818000, 0x3f82}, -- tie, even above
+      {0x3f808001, 0x3f81}, -- above the tie
+      {0x3f807fff, 0x3f80}, -- below the tie
+      {0xbf808000, 0xbf80}, -- negative tie
+      {0xbf818000, 0xbf82},
+      {0x00000001, 0x0000}, -- smallest denormal
+      {0x00008000, 0x0000}, -- denormal tie
+      {0x00018000, 0x0002},
+      {0x80000000, 0x8000}, -- -0
+      {0x7f7fffff, 0x7f80}, -- largest float rounds to inf
+      {0x7f800000, 0x7f80}, -- inf
+      {0xff800000, 0xff80}, -- -inf
+      {0x7fc00000, 0x7fc0}, -- quiet NaN
+      {0x7f800001, 0x7fc0}, -- signaling NaN, would round to inf
+      {0x7fffffff, 0x7fc0}, -- would carry into the sign bit
+      {0xff800001, 0x7fc0}, -- negative NaN
+      {0xffffffff, 0x7fc0},
+   }
+   -- repeated at shifted offsets, such that each case goes through both the
+   -- vectorized loop and the scalar tail
+   local input, expected = {}, {}
+   for rep = 0, 8 do
+      for i = 1, #cases do
+         table.insert(input, cases[(i + rep) % #cases + 1][1])
+         table.insert(expected, cases[(i + rep) % #cases + 1][2])
+      end
+   end
+   local bits = bfloat16Bits(fromBits(input))
+   for i = 1, #input do
+      mytester:asserteq(bits[i], expected[i], string.format('float 0x%08x -> bfloat16', input[i]))
+   end
+   local x = fromBits({0x7f800000, 0xff800000})
+   local file = torch.MemoryFile()
+   file:binary()
+   file:writeFloatAsBFloat16(x)
+   file:seek(1)
+   local y = file:readBFloat16AsFloat(2)
+   mytester:asserteq(y[1], math.huge, 'bfloat16 inf -> float')
+   mytester:asserteq(y[2], -math.huge, 'bfloat16 -inf -> float')
+   file:close()
+end
+
+function torchtest.simdTails()
+   -- every length up to a few vector widths, and a long one with a tail
+   local sizes = {}
+   for n = 1, 33 do sizes[n] = n end
+   table.insert(sizes, 1000 + 5)
+   for _, n in ipairs(sizes) do
+      local input = randomBits(n)
+      local bits = bfloat16Bits(fromBits(input))
+      for i = 1, n do
+         if bits[i] ~= refBits(input[i]) then
+            mytester:asserteq(bits[i], refBits(input[i]), string.format('float->bfloat16 (n=%d, i=%d)', n, i))
+            break
+         end
+      end
+
+      -- bfloat16->float is a shift
+      local file = torch.MemoryFile()
+      file:binary()
+      local b16 = {}
+      for i = 1, n do
+         b16[i] = math.random(0, 2^16 - 1)
+         file:writeShort(b16[i] >= 2^15 and b16[i] - 2^16 or b16[i])
+      end
+      file:seek(1)
+      local x = file:readBFloat16AsFloat(n)
+      file:close()
+      mytester:asserteq(x:size(), n, 'readBFloat16AsFloat count')
+      local xbits = floatBits(x)
+      for i = 1, n do
+         if xbits[i] ~= b16[i] * 2^16 then
+            mytester:asserteq(xbits[i], b16[i] * 2^16, string.format('bfloat16->float (n=%d, i=%d)', n, i))
+            break
+         end
+      end
+   end
+end
+
+function torchtest.fileBFloat16AsFloat()
+   local n = 10000 + 3 -- (several bounce buffers, not a multiple of the vector width)
+   local x = torch.FloatStorage(n)
+   for i = 1, n do x[i] = (i - n/2) / 7 end
+   local ref = {}
+   for i, u in ipairs(floatBits(x)) do ref[i] = refBits(u) * 2^16 end
+   ref = torch.FloatTensor(fromBits(ref))
+   local filename = os.tmpname()
+   for _, file in ipairs({torch.MemoryFile(), torch.DiskFile(filename, 'rw')}) do
+      file:binary()
+      mytester:asserteq(file:writeFloatAsBFloat16(x), n, 'writeFloatAsBFloat16 count')
+      file:seek(1)
+      local h = file:readBFloat16AsFloat(n)
+      mytester:asserteq(h:size(), n, 'readBFloat16AsFloat count')
+      mytester:assertTensorEq(torch.FloatTensor(h), ref, 0, 'readBFloat16AsFloat values')
+      local y = torch.FloatStorage(n):fill(0)
+      file:seek(1)
+      mytester:asserteq(file:readBFloat16AsFloat(y), n, 'readBFloat16AsFloat (storage) count')
+      mytester:assertTensorEq(torch.FloatTensor(y), ref, 0, 'readBFloat16AsFloat (storage) values')
+      file:close()
+   end
+   os.remove(filename)
+end
+
+function torchtest.addmmBFloat16()
+   -- K > 512 goes through several panels
+   for _, K in ipairs({1, 7, 512, 513, 1100}) do
+      local m1 = torch.randn(5, K):float()
+      local m2 = torch.randn(6, K):float():t() -- (not contiguous)
+      local t = torch.randn(5, 6):float()
+      local msg = ' (K=' .. K .. ')'
+      local r = torch.FloatTensor():addmmBFloat16(0.5, t, 2, m1, m2)
+      mytester:assertTableEq(r:size():totable(), {5, 6}, 'addmmBFloat16 size' .. msg)
+
+      -- same as float addmm on the rounded operands (up to the summation order)
+      local rounded = torch.FloatTensor(5, 6):addmm(0.5, t, 2, round(m1), round(m2))
+      mytester:assertTensorEq(r, rounded, 1e-3, 'addmmBFloat16 vs addmm on bfloat16 operands' .. msg)
+
+      -- and within the bfloat16 rounding of float addmm (2^-8 per operand, alpha = 2)
+      local exact = torch.FloatTensor(5, 6):addmm(0.5, t, 2, m1, m2)
+      local bound = torch.mm(torch.abs(m1), torch.abs(m2)):mul(2 * 2^-7):add(1e-3)
+      local err = (r - exact):abs()
+      mytester:assert(err:le(bound):all(), 'addmmBFloat16 vs addmm' .. msg)
+   end
+   -- in place (r == t)
+   local m1 = torch.randn(4, 600):float()
+   local m2 = torch.randn(600, 3):float()
+   local t = torch.randn(4, 3):float()
+   local ref = torch.FloatTensor():addmmBFloat16(1, t, 1, m1, m2)
+   t:addmmBFloat16(1, t, 1, m1, m2)
+   mytester:assertTensorEq(t, ref, 1e-4, 'addmmBFloat16 in place')
+   -- sizes are checked before the operands are converted
+   mytester:assertError(function() t:addmmBFloat16(1, t, 1, m1, m2:t()) end, 'addmmBFloat16 size mismatch')
+   mytester:assertError(function() t:addmmBFloat16(1, t:t(), 1, m1, m2) end, 'addmmBFloat16 t size mismatch')
+   mytester:assertError(function() t:addmmBFloat16(1, t, 1, m1:view(-1), m2) end, 'addmmBFloat16 1D m1')
+end
+
+torch.setheaptracking(true)
+math.randomseed(os.time())
+mytester = torch.Tester()
+mytester:add(torchtest)
+mytester:run(tests)
@@ -48,6 +48,55 @@ function torchtest.selectClone()
    mytester:assert(y[1][1] == 0, 'clone broken')
 end
 
+function torchtest.floatHalfCopy()
+   -- odd sizes exercise the tails of the vectorized conversions, and the
+   -- transposed copies go through the element-wise path
+   for _,n in ipairs({1, 7, 17, 1023}) do
+      local x = torch.randn(n, 3):float():mul(1000)
+      x[1][1] = 1e-6 -- half denormal
+      x[n][3] = 1e6  -- overflows to inf
+      local h = x:half()
+      local ht = torch.HalfTensor(3, n):copy(x:t()):t()
+      mytester:assert(h:float():eq(ht:float()):all(), 'contiguous and strided float->half copies differ')
+      local y = h:float()
+      local yt = torch.FloatTensor(3, n):copy(h:t()):t()
+      mytester:assert(y:eq(yt):all(), 'contiguous and strided half->float copies differ')
+      mytester:assert(y[n][3] == math.huge, 'float->half should overflow to inf')
+      y[n][3] = x[n][3]
+      local relerr = (y - x):abs():cdiv(x:clone():abs():add(1)):max()
+      mytester:assertlt(relerr, 1e-3, 'float->half->float roundtrip')
+   end
+   local s = torch.FloatStorage(33)
+   for i=1,33 do s[i] = i/3 end
+   local hs = torch.HalfStorage(33):copy(s)
+   local fs = torch.FloatStorage(33):copy(hs)
+   for i=1,33 do
+      mytester:assert(math.abs(fs[i]-s[i]) < 1e-2, 'storage float->half->float roundtrip')
+   end
+end
+
+function torchtest.fileHalfAsFloat()
+   local n = 10000 + 3 -- (not a multiple of the vector width)
+   local x = torch.FloatStorage(n)
+   for i = 1, n do x[i] = (i - n/2) / 7 end
+   local ref = torch.FloatStorage(n):copy(torch.HalfStorage(n):copy(x))
+   local filename = os.tmpname()
+   for _, file in ipairs({torch.MemoryFile(), torch.DiskFile(filename, 'rw')}) do
+      file:binary()
+      mytester:asserteq(file:writeFloatAsHalf(x), n, 'writeFloatAsHalf count')
+      file:seek(1)
+      local h = file:readHalfAsFloat(n)
+      mytester:asserteq(h:size(), n, 'readHalfAsFloat count')
+      mytester:assertTensorEq(torch.FloatTensor(h), torch.FloatTensor(ref), 0, 'readHalfAsFloat values')
+      local y = torch.FloatStorage(n):fill(0)
+      file:seek(1)
+      mytester:asserteq(file:readHalfAsFloat(y), n, 'readHalfAsFloat (storage) count')
+      mytester:assertTensorEq(torch.FloatTensor(y), torch.FloatTensor(ref), 0, 'readHalfAsFloat (storage) values')
+      file:close()
+   end
+   os.remove(filename)
+end
+
 torch.setheaptracking(true)
 math.randomseed(os.time())
 mytester = torch.Tester()
@@ -0,0 +1,48 @@
+-- Time float <-> half conversions (tensor copies, and half checkpoints loaded
+-- into float), e.g. to check the vectorized kernels are picked up on this host.
+-- Run with TH_NO_F16C=1 to compare against the scalar path.
+require 'torch'
+
+local cmd = torch.CmdLine()
+cmd:option('-N', 2^24, 'Number of elements')
+cmd:option('-r', 10, 'Number of repetitions')
+
+local options = cmd:parse(arg or {})
+
+local function time(name, nbytes, f)
+   f() -- warm up
+   local timer = torch.Timer()
+   for _=1,options.r do
+      f()
+   end
+   local t = timer:time().real/options.r
+   print(string.format('%-24s %8.3f ms  %8.2f GB/s', name, t*1000, nbytes/t/2^30))
+end
+
+local N = options.N
+local x = torch.FloatTensor(N):uniform(-100, 100)
+local h = torch.HalfTensor(N)
+local y = torch.FloatTensor(N)
+local nbytes = N*(4+2)
+
+print(string.format('%d elements, %d repetitions', N, options.r))
+time('float -> half', nbytes, function() h:copy(x) end)
+time('half -> float', nbytes, function() y:copy(h) end)
+
+local xs = x:view(N/2, 2):t()
+local hs = torch.HalfTensor(2, N/2)
+time('float -> half (strided)', nbytes, function() hs:copy(xs) end)
+time('half -> float (strided)', nbytes, function() y:view(N/2, 2):t():copy(hs) end)
+
+local filename = os.tmpname()
+torch.save(filename, h)
+time('load half -> float', N*2, function() y:copy(torch.load(filename)) end)
+local file = torch.DiskFile(filename, 'w'):binary()
+file:writeFloatAsHalf(x:storage())
+file:close()
+time('readHalfAsFloat', N*2, function()
+   local file = torch.DiskFile(filename, 'r'):binary()
+   file:readHalfAsFloat(y:storage())
+   file:close()
+end)
+os.remove(filename)
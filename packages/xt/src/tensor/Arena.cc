@@ -0,0 +1,150 @@
+#include "Tensor.h"
+#include <array>
+#include "TH.h"
+#undef THTensor
+
+namespace xt {
+
+thread_local ScopedArena* ScopedArena::current_ = nullptr;
+
+// elements which fit in the storage of t (0 if it cannot be resized)
+template<typename T> static int64_t room(void* t)
+{
+  T* th = (T*)t;
+  if(th->storageOffset != 0 || !th->storage || !(th->storage->flag & TH_STORAGE_RESIZABLE)) {
+    return 0;
+  }
+  return th->storage->size;
+}
+
+template<typename T> static int64_t ndim(void* t)
+{
+  return ((T*)t)->nDimension;
+}
+
+static int64_t room(TensorType type, void* t)
+{
+  static std::array<std::function<int64_t (void*)>, 7> dyn = {{
+      room<THByteTensor>,
+      room<THCharTensor>,
+      room<THShortTensor>,
+      room<THIntTensor>,
+      room<THLongTensor>,
+      room<THFloatTensor>,
+      room<THDoubleTensor>
+    }};
+  return dyn.at(type)(t);
+}
+
+static int64_t ndim(TensorType type, void* t)
+{
+  static std::array<std::function<int64_t (void*)>, 7> dyn = {{
+      ndim<THByteTensor>,
+      ndim<THCharTensor>,
+      ndim<THShortTensor>,
+      ndim<THIntTensor>,
+      ndim<THLongTensor>,
+      ndim<THFloatTensor>,
+      ndim<THDoubleTensor>
+    }};
+  return dyn.at(type)(t);
+}
+
+static void resize(TensorType type, void* t, int dim, long* sizes)
+{
+  static std::array<std::function<void (void*, int, long*)>, 7> dyn = {{
+      [](void* t, int dim, long* sizes) {THByteTensor_resizeNd((THByteTensor*)t, dim, sizes, NULL);},
+      [](void* t, int dim, long* sizes) {THCharTensor_resizeNd((THCharTensor*)t, dim, sizes, NULL);},
+      [](void* t, int dim, long* sizes) {THShortTensor_resizeNd((THShortTensor*)t, dim, sizes, NULL);},
+      [](void* t, int dim, long* sizes) {THIntTensor_resizeNd((THIntTensor*)t, dim, sizes, NULL);},
+      [](void* t, int dim, long* sizes) {THLongTensor_resizeNd((THLongTensor*)t, dim, sizes, NULL);},
+      [](void* t, int dim, long* sizes) {THFloatTensor_resizeNd((THFloatTensor*)t, dim, sizes, NULL);},
+      [](void* t, int dim, long* sizes) {THDoubleTensor_resizeNd((THDoubleTensor*)t, dim, sizes, NULL);}
+    }};
+  dyn.at(type)(t, dim, sizes);
+}
+
+static void destroy(TensorType type, void* t)
+{
+  static std::array<std::function<void (void*)>, 7> dyn = {{
+      [](void* t) {THByteTensor_free((THByteTensor*)t);},
+      [](void* t) {THCharTensor_free((THCharTensor*)t);},
+      [](void* t) {THShortTensor_free((THShortTensor*)t);},
+      [](void* t) {THIntTensor_free((THIntTensor*)t);},
+      [](void* t) {THLongTensor_free((THLongTensor*)t);},
+      [](void* t) {THFloatTensor_free((THFloatTensor*)t);},
+      [](void* t) {THDoubleTensor_free((THDoubleTensor*)t);}
+    }};
+  dyn.at(type)(t);
+}
+
+ScopedArena::ScopedArena()
+  : previous_(current_), n_(0)
+{
+  current_ = this;
+}
+
+ScopedArena::~ScopedArena()
+{
+  for(int64_t i = 0; i < n_; i++) {
+    destroy(entries_[i].type, entries_[i].th_tensor);
+  }
+  current_ = previous_;
+}
+
+bool ScopedArena::recycle(Tensor& t)
+{
+  ScopedArena* arena = current_;
+  if(!arena || arena->n_ == capacity || t.device_ != kCPU
+     || room(t.type_, t.th_tensor_) == 0 || !t.unique()) {
+    return false;
+  }
+  arena->entries_[arena->n_].type = t.type_;
+  arena->entries_[arena->n_].th_tensor = t.th_tensor_;
+  arena->n_++;
+  t.th_tensor_ = nullptr;
+  return true;
+}
+
+bool ScopedArena::take(Tensor& r, TensorType type, int64_t dim, const int64_t* sizes)
+{
+  ScopedArena* arena = current_;
+  if(!arena) {
+    return false;
+  }
+  long one = 1;
+  long* th_sizes = (dim == 0 ? &one : (long*)sizes); // (long is 64 bits)
+  int64_t th_dim = (dim == 0 ? 1 : dim);
+  int64_t n = 1;
+  for(int64_t i = 0; i < th_dim; i++) {
+    n *= th_sizes[i];
+  }
+  // most recent first; same dimension preferred (no size/stride realloc)
+  int64_t found = -1;
+  for(int64_t i = arena->n_-1; i >= 0; i--) {
+    Entry& e = arena->entries_[i];
+    if(e.type == type && room(e.type, e.th_tensor) >= n) {
+      if(found < 0) {
+        found = i;
+      }
+      if(ndim(e.type, e.th_tensor) == th_dim) {
+        found = i;
+        break;
+      }
+    }
+  }
+  if(found < 0) {
+    return false;
+  }
+  void* th_tensor = arena->entries_[found].th_tensor;
+  arena->entries_[found] = arena->entries_[--arena->n_];
+  resize(type, th_tensor, th_dim, th_sizes);
+  r.clear();
+  r.type_ = type;
+  r.device_ = kCPU;
+  r.isValue_ = (dim == 0);
+  r.th_tensor_ = th_tensor;
+  return true;
+}
+
+}
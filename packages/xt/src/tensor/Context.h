@@ -1,6 +1,7 @@
 #ifndef XT_CONTEXT_H
 #define XT_CONTEXT_H
 
+#include <memory>
 #include <thread>
 
 struct THGenerator;
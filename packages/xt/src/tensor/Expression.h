@@ -0,0 +1,497 @@
+#ifndef XT_EXPRESSION_H
+#define XT_EXPRESSION_H
+
+#include "Tensor.h"
+#include "dispatch.h"
+#include <type_traits>
+#include <utility>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Elementwise expressions: a + b*2 - c/d builds a tree of terms, which is
+// only evaluated when converted to a Tensor (or assigned). Operands are
+// broadcast as in numpy: sizes are aligned on the right, and dimensions of
+// size 1 (or missing) are repeated. When all the tensors of the tree are CPU
+// tensors of the same type, the evaluation is a single (parallel) loop over
+// the result, reading each operand through its strides (0 for broadcast
+// dimensions); no intermediate tensor is created, and views (narrow,
+// transpose, expand) are read and written in place. Otherwise each node is
+// evaluated with the corresponding TH operation, on expanded operands.
+// Terms keep (shallow) copies of their tensors: an expression stored with
+// auto stays valid, and sees later changes of the tensor contents. Tensors
+// moved into an expression (std::move(a) + b, or temporaries) are kept as
+// such, and a temporary expression is computed in the storage of one of
+// them, when it holds the only reference to it, and it has the size of the
+// result: no allocation.
+
+namespace xt {
+
+bool isContiguous(const Tensor& ccarg1);
+void add_(Tensor& ccarg1, const Tensor& ccarg2, const Tensor& ccarg4);
+void copy_(Tensor& d, const Tensor& s);
+
+// sizes or strides of a fused loop
+struct Dims
+{
+  static const int64_t max = 8;
+  int64_t n;
+  int64_t v[max];
+  Dims() : n(0) {}
+  bool operator==(const Dims& o) const
+  {
+    for(int64_t d = 0; d < n; d++) {
+      if(v[d] != o.v[d]) {
+        return false;
+      }
+    }
+    return n == o.n;
+  }
+  // removes the dimensions where shape is 1 (keeping at least one, set to x)
+  void squeeze(const Dims& shape, int64_t x)
+  {
+    int64_t k = 0;
+    for(int64_t d = 0; d < n; d++) {
+      if(shape.v[d] != 1) {
+        v[k++] = v[d];
+      }
+    }
+    n = k;
+    if(n == 0) {
+      v[n++] = x;
+    }
+  }
+  // strides: dimensions d and d+1 can be walked as one
+  bool mergeable(const Dims& shape, int64_t d) const { return v[d] == v[d+1]*shape.v[d+1]; }
+  void merge(int64_t d)
+  {
+    v[d] = v[d+1];
+    for(int64_t k = d+1; k < n-1; k++) {
+      v[k] = v[k+1];
+    }
+    n--;
+  }
+};
+
+// broadcasts shape with the sizes of t; false if they are not compatible
+// (or if there are too many dimensions)
+inline bool broadcast(Dims& shape, const Tensor& t)
+{
+  int64_t dim = t.dim();
+  if(dim < 0 || dim > Dims::max) {
+    return false;
+  }
+  if(dim > shape.n) {
+    int64_t k = dim-shape.n;
+    for(int64_t d = shape.n-1; d >= 0; d--) {
+      shape.v[d+k] = shape.v[d];
+    }
+    for(int64_t d = 0; d < k; d++) {
+      shape.v[d] = 1;
+    }
+    shape.n = dim;
+  }
+  for(int64_t i = 0; i < dim; i++) {
+    int64_t d = shape.n-dim+i;
+    int64_t size = t.size(i);
+    if(shape.v[d] == 1) {
+      shape.v[d] = size;
+    } else if(size != 1 && size != shape.v[d]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// strides of t, broadcast to shape
+inline Dims strides(const Tensor& t, const Dims& shape)
+{
+  Dims st;
+  int64_t dim = t.dim();
+  st.n = shape.n;
+  for(int64_t d = 0; d < shape.n; d++) {
+    int64_t i = d-(shape.n-dim);
+    st.v[d] = (i >= 0 && t.size(i) != 1) ? t.stride(i) : 0;
+  }
+  return st;
+}
+
+// operations
+struct add_op
+{
+  template<typename T> static T apply(T x, T y) { return x + y; }
+  static Tensor eval(const Tensor& x, const Tensor& y);
+};
+
+struct sub_op
+{
+  template<typename T> static T apply(T x, T y) { return x - y; }
+  static Tensor eval(const Tensor& x, const Tensor& y);
+};
+
+struct mul_op
+{
+  template<typename T> static T apply(T x, T y) { return x * y; }
+  static Tensor eval(const Tensor& x, const Tensor& y);
+};
+
+struct div_op
+{
+  template<typename T> static T apply(T x, T y) { return x / y; }
+  static Tensor eval(const Tensor& x, const Tensor& y);
+};
+
+template<class E> class Expression
+{
+public:
+  const E& self() const { return static_cast<const E&>(*this); }
+  operator Tensor() const &;
+  operator Tensor() &&; // may reuse a moved tensor
+};
+
+// evaluates e into r in a single loop, when r, and all the tensors of e,
+// are CPU tensors of the same type, and their sizes broadcast to the size
+// of r (allocated if allocate is true); returns false (doing nothing)
+// otherwise
+template<class E> bool fuse(const Expression<E>& e, Tensor& r, bool allocate);
+
+// Terms of the fused loop are walked row by row: seek() points them at a
+// row (multi-index), and at<T, unit>(j) reads the j-th element of the row
+// (unit: all the innermost strides are 1).
+
+class TensorTerm : public Expression<TensorTerm>
+{
+public:
+  TensorTerm(const Tensor& t) : t_(t), moved_(false), data_(nullptr), p_(nullptr), s_(0) {}
+  TensorTerm(Tensor&& t) : t_(std::move(t)), moved_(true), data_(nullptr), p_(nullptr), s_(0) {}
+  bool fusable(const Tensor*& ref, Dims& shape) const
+  {
+    if(t_.device() != kCPU || (ref && t_.type() != ref->type())) {
+      return false;
+    }
+    if(!ref) {
+      ref = &t_;
+    }
+    return broadcast(shape, t_);
+  }
+  template<typename T> void bind(const Dims& shape) const
+  {
+    data_ = t_.data<T>();
+    st_ = strides(t_, shape);
+    st_.squeeze(shape, 0);
+  }
+  bool mergeable(const Dims& shape, int64_t d) const { return st_.mergeable(shape, d); }
+  void merge(int64_t d) const { st_.merge(d); }
+  bool unit() const { return s_ == 1; }
+  // (a term reading exactly the elements written is fine)
+  template<typename T> bool overlaps(const T* r, const Dims& rst, const Dims& shape) const
+  {
+    const T* d = static_cast<const T*>(data_);
+    if(d == r && st_ == rst) {
+      return false;
+    }
+    int64_t dn = 1, rn = 1;
+    for(int64_t k = 0; k < shape.n; k++) {
+      dn += (shape.v[k]-1)*st_.v[k];
+      rn += (shape.v[k]-1)*rst.v[k];
+    }
+    return d < r + rn && r < d + dn;
+  }
+  template<typename T> void seek(const Dims& index) const
+  {
+    int64_t offset = 0;
+    for(int64_t d = 0; d < index.n; d++) {
+      offset += index.v[d]*st_.v[d];
+    }
+    p_ = static_cast<const T*>(data_) + offset;
+    s_ = st_.v[st_.n-1];
+  }
+  template<typename T, bool unit> T at(int64_t j) const
+  {
+    return static_cast<const T*>(p_)[unit ? j : j*s_];
+  }
+  // r set to the tensor, if it was moved in and can hold the result
+  bool reuse(Tensor& r) const
+  {
+    if(moved_ && t_.device() == kCPU && t_.unique() && isContiguous(t_)) {
+      r = t_;
+      return true;
+    }
+    return false;
+  }
+  Tensor eval() const { return t_; }
+private:
+  Tensor t_;
+  bool moved_;
+  mutable const void* data_;
+  mutable const void* p_;
+  mutable int64_t s_;
+  mutable Dims st_;
+};
+
+class ValueTerm : public Expression<ValueTerm>
+{
+public:
+  ValueTerm(double v) : v_(v) {}
+  bool fusable(const Tensor*&, Dims&) const { return true; }
+  template<typename T> void bind(const Dims&) const {}
+  bool mergeable(const Dims&, int64_t) const { return true; }
+  void merge(int64_t) const {}
+  bool unit() const { return true; }
+  template<typename T> bool overlaps(const T*, const Dims&, const Dims&) const { return false; }
+  template<typename T> void seek(const Dims&) const {}
+  template<typename T, bool unit> T at(int64_t) const { return (T)v_; }
+  bool reuse(Tensor&) const { return false; }
+  Tensor eval() const { return Tensor(v_); }
+private:
+  double v_;
+};
+
+template<class Op, class L, class R> class BinaryExpression : public Expression<BinaryExpression<Op, L, R> >
+{
+public:
+  template<class X, class Y> BinaryExpression(X&& l, Y&& r) : l_(std::forward<X>(l)), r_(std::forward<Y>(r)) {}
+  bool fusable(const Tensor*& ref, Dims& shape) const { return l_.fusable(ref, shape) && r_.fusable(ref, shape); }
+  template<typename T> void bind(const Dims& shape) const { l_.template bind<T>(shape); r_.template bind<T>(shape); }
+  bool mergeable(const Dims& shape, int64_t d) const { return l_.mergeable(shape, d) && r_.mergeable(shape, d); }
+  void merge(int64_t d) const { l_.merge(d); r_.merge(d); }
+  bool unit() const { return l_.unit() && r_.unit(); }
+  template<typename T> bool overlaps(const T* r, const Dims& rst, const Dims& shape) const
+  {
+    return l_.template overlaps<T>(r, rst, shape) || r_.template overlaps<T>(r, rst, shape);
+  }
+  template<typename T> void seek(const Dims& index) const { l_.template seek<T>(index); r_.template seek<T>(index); }
+  template<typename T, bool unit> T at(int64_t j) const
+  {
+    return Op::apply(l_.template at<T, unit>(j), r_.template at<T, unit>(j));
+  }
+  bool reuse(Tensor& r) const { return l_.reuse(r) || r_.reuse(r); }
+  Tensor eval() const { return Op::eval(l_.eval(), r_.eval()); }
+private:
+  L l_;
+  R r_;
+};
+
+// term of an operand: tensors, expressions and numbers
+template<class X, class Enable = void> struct ExpressionTerm {};
+
+template<> struct ExpressionTerm<Tensor>
+{
+  typedef TensorTerm type;
+};
+
+template<class X> struct ExpressionTerm<X, typename std::enable_if<std::is_base_of<Expression<X>, X>::value>::type>
+{
+  typedef X type;
+};
+
+template<class X> struct ExpressionTerm<X, typename std::enable_if<std::is_arithmetic<X>::value>::type>
+{
+  typedef ValueTerm type;
+};
+
+// type of x op y: defined when x and y are operands, and not both numbers
+template<class Op, class L, class R, class Enable = void> struct ExpressionResult {};
+
+template<class Op, class L, class R>
+struct ExpressionResult<Op, L, R, typename std::enable_if<
+  !(std::is_arithmetic<L>::value && std::is_arithmetic<R>::value)
+  && std::is_class<typename ExpressionTerm<L>::type>::value
+  && std::is_class<typename ExpressionTerm<R>::type>::value>::type>
+{
+  typedef BinaryExpression<Op, typename ExpressionTerm<L>::type, typename ExpressionTerm<R>::type> type;
+};
+
+// operands are forwarded: moved tensors are moved into the expression
+template<class Op, class L, class R>
+using ExpressionResultOf = typename ExpressionResult<Op, typename std::decay<L>::type, typename std::decay<R>::type>::type;
+
+template<class L, class R> ExpressionResultOf<add_op, L, R> operator+(L&& lhs, R&& rhs)
+{
+  return ExpressionResultOf<add_op, L, R>(std::forward<L>(lhs), std::forward<R>(rhs));
+}
+
+template<class L, class R> ExpressionResultOf<sub_op, L, R> operator-(L&& lhs, R&& rhs)
+{
+  return ExpressionResultOf<sub_op, L, R>(std::forward<L>(lhs), std::forward<R>(rhs));
+}
+
+template<class L, class R> ExpressionResultOf<div_op, L, R> operator/(L&& lhs, R&& rhs)
+{
+  return ExpressionResultOf<div_op, L, R>(std::forward<L>(lhs), std::forward<R>(rhs));
+}
+
+// between tensors, * is a matrix product: only products with numbers are
+// elementwise
+template<class L, class R> typename std::enable_if<std::is_arithmetic<typename std::decay<R>::type>::value, ExpressionResultOf<mul_op, L, R> >::type
+operator*(L&& lhs, R&& rhs)
+{
+  return ExpressionResultOf<mul_op, L, R>(std::forward<L>(lhs), std::forward<R>(rhs));
+}
+
+template<class L, class R> typename std::enable_if<std::is_arithmetic<typename std::decay<L>::type>::value, ExpressionResultOf<mul_op, L, R> >::type
+operator*(L&& lhs, R&& rhs)
+{
+  return ExpressionResultOf<mul_op, L, R>(std::forward<L>(lhs), std::forward<R>(rhs));
+}
+
+template<class E> struct fuse_op
+{
+  static const int64_t threshold = 100000; // below, no OpenMP
+
+  template<typename T> bool cpu(const E& e, Tensor& r, Dims& shape)
+  {
+    T* r_p = r.data<T>();
+    Dims rst = strides(r, shape);
+    rst.squeeze(shape, 0);
+    e.template bind<T>(shape);
+    shape.squeeze(Dims(shape), 1);
+    if(e.template overlaps<T>(r_p, rst, shape)) {
+      return false;
+    }
+    // walk contiguous dimensions as one
+    for(int64_t d = shape.n-2; d >= 0; d--) {
+      if(rst.mergeable(shape, d) && e.mergeable(shape, d)) {
+        rst.merge(d);
+        e.merge(d);
+        shape.v[d+1] *= shape.v[d];
+        shape.merge(d);
+      }
+    }
+    int64_t n = 1;
+    for(int64_t d = 0; d < shape.n; d++) {
+      n *= shape.v[d];
+    }
+#ifdef _OPENMP
+    if(n > threshold && !omp_in_parallel()) {
+#pragma omp parallel
+      {
+        E local(e);
+        int64_t nt = omp_get_num_threads();
+        int64_t t = omp_get_thread_num();
+        run<T>(local, r_p, rst, shape, n*t/nt, n*(t+1)/nt);
+      }
+      return true;
+    }
+#endif
+    run<T>(e, r_p, rst, shape, 0, n);
+    return true;
+  }
+  template<typename T> bool gpu(const E&, Tensor&, Dims&)
+  {
+    return false;
+  }
+
+  // elements [begin, end) of r (in row-major order)
+  template<typename T> static void run(const E& e, T* r_p, const Dims& rst, const Dims& shape, int64_t begin, int64_t end)
+  {
+    int64_t last = shape.n-1;
+    Dims index;
+    index.n = shape.n;
+    for(int64_t d = last, k = begin; d >= 0; d--) {
+      index.v[d] = k % shape.v[d];
+      k /= shape.v[d];
+    }
+    int64_t rs = rst.v[last];
+    while(begin < end) {
+      int64_t len = std::min(shape.v[last]-index.v[last], end-begin);
+      e.template seek<T>(index);
+      T* r = r_p;
+      for(int64_t d = 0; d < shape.n; d++) {
+        r += index.v[d]*rst.v[d];
+      }
+      if(rs == 1 && e.unit()) {
+#pragma omp simd
+        for(int64_t j = 0; j < len; j++) {
+          r[j] = e.template at<T, true>(j);
+        }
+      } else {
+        for(int64_t j = 0; j < len; j++) {
+          r[j*rs] = e.template at<T, false>(j);
+        }
+      }
+      begin += len;
+      index.v[last] = 0;
+      for(int64_t d = last-1; d >= 0; d--) {
+        if(++index.v[d] < shape.v[d]) {
+          break;
+        }
+        index.v[d] = 0;
+      }
+    }
+  }
+};
+
+template<class E> bool fuse(const Expression<E>& e, Tensor& r, bool allocate)
+{
+  const E& self = e.self();
+  const Tensor* ref = nullptr;
+  Dims shape;
+  if(!allocate && (r.device() != kCPU || !broadcast(shape, r))) {
+    return false;
+  }
+  Dims target = shape;
+  if(!self.fusable(ref, shape) || !ref) {
+    return false;
+  }
+  if(allocate) {
+    if(!ScopedArena::take(r, ref->type(), shape.n, shape.v)) {
+      r.resize(std::vector<int64_t>(shape.v, shape.v+shape.n), ref->type(), kCPU);
+    }
+  } else if(r.type() != ref->type() || !(shape == target)) {
+    return false;
+  }
+  TensorType type = r.type();
+  TensorDevice device = r.device();
+  return dispatch<fuse_op<E> >(type, device, self, r, shape);
+}
+
+template<class E> Expression<E>::operator Tensor() const &
+{
+  Tensor r;
+  if(!fuse(*this, r, true)) {
+    r = self().eval();
+  }
+  return r;
+}
+
+template<class E> Expression<E>::operator Tensor() &&
+{
+  Tensor r;
+  if(self().reuse(r) && fuse(*this, r, false)) {
+    return r;
+  }
+  if(!fuse(*this, r, true)) {
+    r = self().eval();
+  }
+  return r;
+}
+
+template<class E> Tensor& Tensor::operator=(const Expression<E>& e) &&
+{
+  if(!fuse(e, *this, false)) {
+    copy_(*this, e.self().eval());
+  }
+  return *this;
+}
+
+template<class E> Tensor& Tensor::operator+=(const Expression<E>& rhs)
+{
+  if(!fuse(*this + rhs.self(), *this, false)) {
+    add_(*this, *this, rhs);
+  }
+  return *this;
+}
+
+template<class E> Tensor& Tensor::operator/=(const Expression<E>& rhs)
+{
+  if(!fuse(*this / rhs.self(), *this, false)) {
+    *this /= Tensor(rhs);
+  }
+  return *this;
+}
+
+} // namespace xt
+
+#endif
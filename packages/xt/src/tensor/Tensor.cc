@@ -161,7 +161,7 @@ Tensor& Tensor::tovalue()
   return *this;
 }
 
-template<typename T> Tensor::Tensor(T v)
+template<typename T, typename std::enable_if<std::is_arithmetic<T>::value, int>::type> Tensor::Tensor(T v)
   : type_(kDouble), device_(kUnknown), isValue_(false), th_tensor_(nullptr)
 {
   value(v);
@@ -244,16 +244,6 @@ Tensor::Tensor(const std::vector<int64_t>& sizes, const std::vector<int64_t>& st
   resize(sizes, strides, type, device);
 }
 
-TensorType Tensor::type() const
-{
-  return type_;
-}
-
-TensorDevice Tensor::device() const
-{
-  return device_;
-}
-
 template<> THByteTensor* Tensor::THTensor<THByteTensor>() const
 {
   if(device_ == kCPU) {
@@ -623,7 +613,7 @@ Tensor& Tensor::resizeAs(const Tensor &o, bool wtype)
 
 Tensor& Tensor::clear()
 {
-  if((device_ != kUnknown) && th_tensor_) {
+  if((device_ != kUnknown) && th_tensor_ && !ScopedArena::recycle(*this)) {
     release();
   }
   type_ = kDouble;
@@ -633,6 +623,39 @@ Tensor& Tensor::clear()
   return *this;
 }
 
+bool Tensor::unique() const
+{
+  if(device_ == kUnknown || !th_tensor_) {
+    return false;
+  } else if(device_ == kCPU) {
+    static std::array<std::function<bool (const Tensor&)>, 7> dyn = {{
+        [](const Tensor& t) {auto th = t.THTensor<THByteTensor>(); return th->refcount == 1 && (!th->storage || th->storage->refcount == 1);},
+        [](const Tensor& t) {auto th = t.THTensor<THCharTensor>(); return th->refcount == 1 && (!th->storage || th->storage->refcount == 1);},
+        [](const Tensor& t) {auto th = t.THTensor<THShortTensor>(); return th->refcount == 1 && (!th->storage || th->storage->refcount == 1);},
+        [](const Tensor& t) {auto th = t.THTensor<THIntTensor>(); return th->refcount == 1 && (!th->storage || th->storage->refcount == 1);},
+        [](const Tensor& t) {auto th = t.THTensor<THLongTensor>(); return th->refcount == 1 && (!th->storage || th->storage->refcount == 1);},
+        [](const Tensor& t) {auto th = t.THTensor<THFloatTensor>(); return th->refcount == 1 && (!th->storage || th->storage->refcount == 1);},
+        [](const Tensor& t) {auto th = t.THTensor<THDoubleTensor>(); return th->refcount == 1 && (!th->storage || th->storage->refcount == 1);}
+      }};
+    return dyn.at(type_)(*this);
+#ifdef XT_HAS_CUDA
+  } else if(device_ == kGPU) {
+    static std::array<std::function<bool (const Tensor&)>, 7> dyn = {{
+        [](const Tensor& t) {auto th = t.THTensor<THCudaByteTensor>(); return th->refcount == 1 && (!th->storage || th->storage->refcount == 1);},
+        [](const Tensor& t) {auto th = t.THTensor<THCudaCharTensor>(); return th->refcount == 1 && (!th->storage || th->storage->refcount == 1);},
+        [](const Tensor& t) {auto th = t.THTensor<THCudaShortTensor>(); return th->refcount == 1 && (!th->storage || th->storage->refcount == 1);},
+        [](const Tensor& t) {auto th = t.THTensor<THCudaIntTensor>(); return th->refcount == 1 && (!th->storage || th->storage->refcount == 1);},
+        [](const Tensor& t) {auto th = t.THTensor<THCudaLongTensor>(); return th->refcount == 1 && (!th->storage || th->storage->refcount == 1);},
+        [](const Tensor& t) {auto th = t.THTensor<THCudaTensor>(); return th->refcount == 1 && (!th->storage || th->storage->refcount == 1);},
+        [](const Tensor& t) {auto th = t.THTensor<THCudaDoubleTensor>(); return th->refcount == 1 && (!th->storage || th->storage->refcount == 1);}
+      }};
+    return dyn.at(type_)(*this);
+#endif
+  } else {
+    throw std::invalid_argument("unsupported device");
+  }
+}
+
 Tensor& Tensor::empty()
 {
   auto type = type_;
@@ -756,6 +779,75 @@ Tensor& Tensor::resize(const std::vector<int64_t>& sizes, const std::vector<int6
   return *this;
 }
 
+Tensor::Tensor(const Tensor& o, int64_t offset, const std::vector<int64_t>& sizes, const std::vector<int64_t>& strides)
+  : type_(kDouble), device_(kUnknown), isValue_(false), th_tensor_(nullptr)
+{
+  if(sizes.size() != strides.size()) {
+    throw std::invalid_argument("sizes and strides size mismatch");
+  }
+  resize(o.type_, o.device_);
+  int64_t dim = sizes.size();
+  isValue_ = (dim == 0 ? true : false);
+  auto sizes_s = std::shared_ptr<THLongStorage>(THLongStorage_newWithSize(isValue_ ? 1 : dim), THLongStorage_free);
+  auto strides_s = std::shared_ptr<THLongStorage>(THLongStorage_newWithSize(isValue_ ? 1 : dim), THLongStorage_free);
+  if(isValue_) {
+    sizes_s->data[0] = 1;
+    strides_s->data[0] = 1;
+  } else {
+    for(int64_t i = 0; i < dim; i++) {
+      sizes_s->data[i] = sizes[i];
+      strides_s->data[i] = strides[i];
+    }
+  }
+  if(device_ == kCPU) {
+    static std::array<std::function<void (Tensor&, const Tensor&, int64_t, THLongStorage*, THLongStorage*)>, 7> dyn = {{
+        [](Tensor& t, const Tensor& o, int64_t offset, THLongStorage *sizes, THLongStorage *strides) {THByteTensor_setStorage(t.THTensor<THByteTensor>(), THByteTensor_storage(o.THTensor<THByteTensor>()), offset, sizes, strides);},
+        [](Tensor& t, const Tensor& o, int64_t offset, THLongStorage *sizes, THLongStorage *strides) {THCharTensor_setStorage(t.THTensor<THCharTensor>(), THCharTensor_storage(o.THTensor<THCharTensor>()), offset, sizes, strides);},
+        [](Tensor& t, const Tensor& o, int64_t offset, THLongStorage *sizes, THLongStorage *strides) {THShortTensor_setStorage(t.THTensor<THShortTensor>(), THShortTensor_storage(o.THTensor<THShortTensor>()), offset, sizes, strides);},
+        [](Tensor& t, const Tensor& o, int64_t offset, THLongStorage *sizes, THLongStorage *strides) {THIntTensor_setStorage(t.THTensor<THIntTensor>(), THIntTensor_storage(o.THTensor<THIntTensor>()), offset, sizes, strides);},
+        [](Tensor& t, const Tensor& o, int64_t offset, THLongStorage *sizes, THLongStorage *strides) {THLongTensor_setStorage(t.THTensor<THLongTensor>(), THLongTensor_storage(o.THTensor<THLongTensor>()), offset, sizes, strides);},
+        [](Tensor& t, const Tensor& o, int64_t offset, THLongStorage *sizes, THLongStorage *strides) {THFloatTensor_setStorage(t.THTensor<THFloatTensor>(), THFloatTensor_storage(o.THTensor<THFloatTensor>()), offset, sizes, strides);},
+        [](Tensor& t, const Tensor& o, int64_t offset, THLongStorage *sizes, THLongStorage *strides) {THDoubleTensor_setStorage(t.THTensor<THDoubleTensor>(), THDoubleTensor_storage(o.THTensor<THDoubleTensor>()), offset, sizes, strides);}
+      }};
+    dyn.at(type_)(*this, o, offset, sizes_s.get(), strides_s.get());
+#ifdef XT_HAS_CUDA
+  } else if(device_ == kGPU) {
+    static std::array<std::function<void (Tensor&, const Tensor&, int64_t, THLongStorage*, THLongStorage*)>, 7> dyn = {{
+        [](Tensor& t, const Tensor& o, int64_t offset, THLongStorage *sizes, THLongStorage *strides) {THCudaByteTensor_setStorage(thcstate(), t.THTensor<THCudaByteTensor>(), THCudaByteTensor_storage(thcstate(), o.THTensor<THCudaByteTensor>()), offset, sizes, strides);},
+        [](Tensor& t, const Tensor& o, int64_t offset, THLongStorage *sizes, THLongStorage *strides) {THCudaCharTensor_setStorage(thcstate(), t.THTensor<THCudaCharTensor>(), THCudaCharTensor_storage(thcstate(), o.THTensor<THCudaCharTensor>()), offset, sizes, strides);},
+        [](Tensor& t, const Tensor& o, int64_t offset, THLongStorage *sizes, THLongStorage *strides) {THCudaShortTensor_setStorage(thcstate(), t.THTensor<THCudaShortTensor>(), THCudaShortTensor_storage(thcstate(), o.THTensor<THCudaShortTensor>()), offset, sizes, strides);},
+        [](Tensor& t, const Tensor& o, int64_t offset, THLongStorage *sizes, THLongStorage *strides) {THCudaIntTensor_setStorage(thcstate(), t.THTensor<THCudaIntTensor>(), THCudaIntTensor_storage(thcstate(), o.THTensor<THCudaIntTensor>()), offset, sizes, strides);},
+        [](Tensor& t, const Tensor& o, int64_t offset, THLongStorage *sizes, THLongStorage *strides) {THCudaLongTensor_setStorage(thcstate(), t.THTensor<THCudaLongTensor>(), THCudaLongTensor_storage(thcstate(), o.THTensor<THCudaLongTensor>()), offset, sizes, strides);},
+        [](Tensor& t, const Tensor& o, int64_t offset, THLongStorage *sizes, THLongStorage *strides) {THCudaTensor_setStorage(thcstate(), t.THTensor<THCudaTensor>(), THCudaTensor_storage(thcstate(), o.THTensor<THCudaTensor>()), offset, sizes, strides);},
+        [](Tensor& t, const Tensor& o, int64_t offset, THLongStorage *sizes, THLongStorage *strides) {THCudaDoubleTensor_setStorage(thcstate(), t.THTensor<THCudaDoubleTensor>(), THCudaDoubleTensor_storage(thcstate(), o.THTensor<THCudaDoubleTensor>()), offset, sizes, strides);}
+      }};
+    dyn.at(type_)(*this, o, offset, sizes_s.get(), strides_s.get());
+#endif
+  } else {
+    throw std::invalid_argument("unsupported device");
+  }
+}
+
+Tensor expand(const Tensor& t, const std::vector<int64_t>& sizes)
+{
+  int64_t dim = t.dim();
+  int64_t n = sizes.size();
+  if(dim < 0 || dim > n) {
+    throw std::invalid_argument("expand: too many dimensions");
+  }
+  std::vector<int64_t> strides(n, 0);
+  for(int64_t i = 0; i < dim; i++) {
+    int64_t d = n-dim+i;
+    int64_t size = t.size(i);
+    if(size == sizes[d]) {
+      strides[d] = t.stride(i);
+    } else if(size != 1) {
+      throw std::invalid_argument("expand: incompatible sizes");
+    }
+  }
+  return Tensor(t, t.offset(), sizes, strides);
+}
+
 template<> uint8_t* Tensor::data() const
 {
   if(type_ != kUInt8) {
@@ -7,6 +7,7 @@
 #include <map>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
 
 // for now, we rely on TH for mem alloc
 #include "Context.h"
@@ -21,6 +22,9 @@ enum TensorDevice {
   kGPU,
 };
 
+template<class E> class Expression;
+class ScopedArena;
+
 enum TensorType {
   kUInt8,
   kInt8,
@@ -42,8 +46,9 @@ public:
   Tensor(TensorType type, TensorDevice device = kCPU); /* TH struct allocated, not the data */
   Tensor(const std::vector<int64_t>& sizes, TensorType type, TensorDevice device = kCPU); /* full allocated */
   Tensor(const std::vector<int64_t>& sizes, const std::vector<int64_t>& strides, TensorType type, TensorDevice device = kCPU); /* full allocated */
-  template<typename T> Tensor(T value); /* creates a 0-dim tensor with given value */
-  //  Tensor(Tensor &o, int64_t offset, std::vector<int64_t> sizes, std::vector<int64_t> strides); /* view */
+  template<typename T, typename std::enable_if<std::is_arithmetic<T>::value, int>::type = 0>
+  Tensor(T value); /* creates a 0-dim tensor with given value */
+  Tensor(const Tensor& o, int64_t offset, const std::vector<int64_t>& sizes, const std::vector<int64_t>& strides); /* view (on the storage of o) */
   int64_t dim() const;
   int64_t offset() const; /* no notion of storage */
   int64_t size(int64_t dim) const;
@@ -59,12 +64,13 @@ public:
   Tensor& resize(const std::vector<int64_t>& sizes, TensorType type, TensorDevice device = kCPU);
   Tensor& resize(const std::vector<int64_t>& sizes, const std::vector<int64_t>& strides, TensorType type, TensorDevice device = kCPU);
   Tensor& resizeAs(const Tensor& o, bool wtype=false); // wtype = true: use same type/device than o
-  TensorDevice device() const;
-  TensorType type() const;
+  TensorDevice device() const { return device_; }
+  TensorType type() const { return type_; }
   std::string typedesc() const;
   std::string devicedesc() const;
   Tensor& empty(); /* keep type */
   Tensor& clear(); /* clear everything (unknown tensor) */
+  bool unique() const; /* no other tensor shares the TH tensor or its storage */
   template<typename T> static TensorType type();
   template<typename T> static std::string typedesc();
   template<typename T> T* data() const;
@@ -79,12 +85,13 @@ public:
   Tensor& operator++(int);
   Tensor& operator+=(const Tensor& rhs);
   Tensor& operator/=(const Tensor& rhs);
+  // +, -, / and products with numbers are lazy (see Expression.h)
+  template<class E> Tensor& operator=(const Expression<E>& e) &&; // evaluated in place
+  template<class E> Tensor& operator+=(const Expression<E>& rhs);
+  template<class E> Tensor& operator/=(const Expression<E>& rhs);
   friend bool operator==(const Tensor& lhs, const Tensor& rhs);
   friend bool operator!=(const Tensor& lhs, const Tensor& rhs);
   friend Tensor operator*(const Tensor& lhs, const Tensor& rhs);
-  friend Tensor operator/(const Tensor& lhs, const Tensor& rhs);
-  friend Tensor operator-(const Tensor& lhs, const Tensor& rhs);
-  friend Tensor operator+(const Tensor& lhs, const Tensor& rhs);
   friend std::ostream& operator<<(std::ostream& stream, const Tensor& self);
 
   // return a view from a THTensor
@@ -93,6 +100,7 @@ public:
   ~Tensor();
 
 private:
+  friend class ScopedArena;
   void retain() const;
   void release() const;
   TensorType type_;
@@ -105,6 +113,54 @@ private:
   void* th_tensor_;
 };
 
+// view of t with the given sizes: dimensions of size 1 (or missing, on the
+// left) are repeated with a 0 stride, as in numpy broadcasting
+Tensor expand(const Tensor& t, const std::vector<int64_t>& sizes);
+
+// While a ScopedArena is alive, CPU tensors released on its thread, and
+// which are the only owners of their data, are not freed but kept in the
+// arena; tensors computed by expressions then reuse them. A loop of small
+// tensor expressions makes no heap allocation after its first iterations:
+//
+//   ScopedArena arena;
+//   for(...) {
+//     Tensor r = a*2 + b;
+//   }
+//
+// Kept tensors are freed when the arena is destroyed. Arenas can be nested
+// (the innermost one is used).
+class ScopedArena
+{
+public:
+  static const int64_t capacity = 64; // tensors kept, at most
+  ScopedArena();
+  ScopedArena(const ScopedArena&) = delete;
+  ScopedArena& operator=(const ScopedArena&) = delete;
+  ~ScopedArena();
+
+  // keeps t (and clears it) if an arena is active and t can be reused
+  static bool recycle(Tensor& t);
+  // resizes r to sizes with a kept tensor of the given type, if any
+  static bool take(Tensor& r, TensorType type, int64_t dim, const int64_t* sizes);
+
+private:
+  struct Entry
+  {
+    TensorType type;
+    void* th_tensor;
+  };
+  ScopedArena* previous_;
+  int64_t n_;
+  Entry entries_[capacity];
+  static thread_local ScopedArena* current_;
+};
+
+// also found for expressions
+Tensor operator*(const Tensor& lhs, const Tensor& rhs);
+std::ostream& operator<<(std::ostream& stream, const Tensor& self);
+
 } // namespace xt
 
+#include "Expression.h"
+
 #endif
@@ -4,18 +4,40 @@
 
 namespace xt {
 
+// x and y expanded to their broadcast size, when they differ (and are
+// compatible)
+static void broadcast(Tensor& x, Tensor& y)
+{
+  Dims shape;
+  if(x.dim() > 0 && y.dim() > 0 && x.size() != y.size()
+     && broadcast(shape, x) && broadcast(shape, y)) {
+    std::vector<int64_t> sizes(shape.v, shape.v+shape.n);
+    x = expand(x, sizes);
+    y = expand(y, sizes);
+  }
+}
+
 Tensor& Tensor::operator+=(const Tensor& rhs)
 {
-  add_(*this, *this, rhs);
+  if(!fuse(*this + rhs, *this, false)) {
+    Tensor x(*this), y(rhs);
+    broadcast(x, y);
+    add_(*this, *this, y);
+  }
   return *this;
 }
 
 Tensor& Tensor::operator/=(const Tensor& rhs)
 {
-  if(rhs.dim() == 0)
-    div_(*this, *this, rhs);
+  if(fuse(*this / rhs, *this, false)) {
+    return *this;
+  }
+  Tensor x(*this), y(rhs);
+  broadcast(x, y);
+  if(y.dim() == 0)
+    div_(*this, *this, y);
   else
-    cdiv_(*this, *this, rhs);
+    cdiv_(*this, *this, y);
   return *this;
 }
 
@@ -49,14 +71,47 @@ Tensor Tensor::operator[](const Tensor &rhs)
   return (*this)[rhs.value<int64_t>()];
 }
 
-Tensor operator+(const Tensor& lhs, const Tensor& rhs)
+Tensor add_op::eval(const Tensor& x0, const Tensor& y0)
 {
-  return add(lhs, rhs);
+  Tensor x(x0), y(y0);
+  broadcast(x, y);
+  if(x.dim() == 0 && y.dim() != 0) {
+    return add(y, x);
+  }
+  return add(x, y);
 }
 
-Tensor operator-(const Tensor& lhs, const Tensor& rhs)
+Tensor sub_op::eval(const Tensor& x0, const Tensor& y0)
 {
-  return add(lhs, -1, rhs);
+  Tensor x(x0), y(y0);
+  broadcast(x, y);
+  if(x.dim() == 0 && y.dim() != 0) {
+    return add(mul(y, -1), x);
+  }
+  return add(x, -1, y);
+}
+
+Tensor mul_op::eval(const Tensor& x, const Tensor& y)
+{
+  if(x.dim() == 0) {
+    return mul(y, x);
+  }
+  return mul(x, y);
+}
+
+Tensor div_op::eval(const Tensor& x0, const Tensor& y0)
+{
+  Tensor x(x0), y(y0);
+  broadcast(x, y);
+  if(y.dim() == 0) {
+    return div(x, y);
+  } else if(x.dim() == 0) {
+    Tensor z(y.type(), y.device());
+    z.resizeAs(y);
+    fill_(z, x);
+    return cdiv(z, y);
+  }
+  return cdiv(x, y);
 }
 
 Tensor operator*(const Tensor& lhs, const Tensor& rhs)
@@ -78,11 +133,6 @@ Tensor& Tensor::operator++(int)
   return *this;
 }
 
-Tensor operator/(const Tensor& lhs, const Tensor& rhs)
-{
-  return div(lhs, rhs);
-}
-
 std::ostream& operator<<(std::ostream& stream, const Tensor& self)
 {
   return self.print(stream);
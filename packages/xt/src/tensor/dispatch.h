@@ -2,42 +2,50 @@
 #define XT_DISPATCH_H
 
 #include "Tensor.h"
-#include <array>
+#include <stdexcept>
+#include <type_traits>
 
 namespace xt {
 
+// The type switches are plain switch statements: F::cpu<T> (or gpu<T>) is
+// called directly, and can be inlined.
+
+#define XT_DISPATCH_TYPES(_, ...)               \
+  _(kUInt8, uint8_t, __VA_ARGS__)               \
+  _(kInt8, int8_t, __VA_ARGS__)                 \
+  _(kInt16, int16_t, __VA_ARGS__)               \
+  _(kInt32, int32_t, __VA_ARGS__)               \
+  _(kInt64, int64_t, __VA_ARGS__)               \
+  _(kFloat, float, __VA_ARGS__)                 \
+  _(kDouble, double, __VA_ARGS__)
+
+#define XT_DISPATCH_CASE(TYPE, CTYPE, DEVICE)   \
+  case TYPE: return functor.template DEVICE<CTYPE>(args...);
+
+template<class F, class R, class ... T>
+inline R dispatch_type(TensorType ttype, TensorDevice tdev, T&... args)
+{
+  F functor;
+  if(tdev == kCPU) {
+    switch(ttype) {
+      XT_DISPATCH_TYPES(XT_DISPATCH_CASE, cpu)
+    }
+  } else if(tdev == kGPU) {
+    switch(ttype) {
+      XT_DISPATCH_TYPES(XT_DISPATCH_CASE, gpu)
+    }
+  } else {
+    throw std::invalid_argument("unsupported device");
+  }
+  throw std::invalid_argument("unsupported type");
+}
+
 // Tensor version
 template<class F, class ... T>
 auto dispatch(Tensor& t, T&... args) -> typename std::result_of<decltype(&F::template cpu<int64_t>)(F&, Tensor&, T&...)>::type
 {
   using ReturnType = typename std::result_of<decltype(&F::template cpu<int64_t>)(F&, Tensor&, T&...)>::type;
-  if(t.device() == kCPU) {
-    static std::array<std::function<ReturnType (F&, Tensor&, T&...)>, 7> dyn = {{
-        &F::template cpu<uint8_t>,
-        &F::template cpu<int8_t>,
-        &F::template cpu<int16_t>,
-        &F::template cpu<int32_t>,
-        &F::template cpu<int64_t>,
-        &F::template cpu<float>,
-        &F::template cpu<double>,
-      }};
-    F functor;
-    return dyn.at(t.type())(functor, t, args...);
-  } else if(t.device() == kGPU) {
-    static std::array<std::function<ReturnType (F&, Tensor&, T&...)>, 7> dyn = {{
-        &F::template gpu<uint8_t>,
-        &F::template gpu<int8_t>,
-        &F::template gpu<int16_t>,
-        &F::template gpu<int32_t>,
-        &F::template gpu<int64_t>,
-        &F::template gpu<float>,
-        &F::template gpu<double>,
-      }};
-    F functor;
-    return dyn.at(t.type())(functor, t, args...);
-  } else {
-    throw std::invalid_argument("unsupported device");
-  }
+  return dispatch_type<F, ReturnType, Tensor, T...>(t.type(), t.device(), t, args...);
 }
 
 // Context, Tensor version
@@ -45,33 +53,7 @@ template<class F, class ... T>
 auto dispatch(Context& ctx, Tensor& t, T&... args) -> typename std::result_of<decltype(&F::template cpu<int64_t>)(F&, Context&, Tensor&, T&...)>::type
 {
   using ReturnType = typename std::result_of<decltype(&F::template cpu<int64_t>)(F&, Context&, Tensor&, T&...)>::type;
-  if(t.device() == kCPU) {
-    static std::array<std::function<ReturnType (F&, Context&, Tensor&, T&...)>, 7> dyn = {{
-        &F::template cpu<uint8_t>,
-        &F::template cpu<int8_t>,
-        &F::template cpu<int16_t>,
-        &F::template cpu<int32_t>,
-        &F::template cpu<int64_t>,
-        &F::template cpu<float>,
-        &F::template cpu<double>,
-      }};
-    F functor;
-    return dyn.at(t.type())(functor, t, args...);
-  } else if(t.device() == kGPU) {
-    static std::array<std::function<ReturnType (F&, Context&, Tensor&, T&...)>, 7> dyn = {{
-        &F::template gpu<uint8_t>,
-        &F::template gpu<int8_t>,
-        &F::template gpu<int16_t>,
-        &F::template gpu<int32_t>,
-        &F::template gpu<int64_t>,
-        &F::template gpu<float>,
-        &F::template gpu<double>,
-      }};
-    F functor;
-    return dyn.at(t.type())(functor, ctx, t, args...);
-  } else {
-    throw std::invalid_argument("unsupported device");
-  }
+  return dispatch_type<F, ReturnType, Context, Tensor, T...>(t.type(), t.device(), ctx, t, args...);
 }
 
 // const Tensor version
@@ -79,33 +61,7 @@ template<class F, class ... T>
 auto dispatch(const Tensor& t, T&... args) -> typename std::result_of<decltype(&F::template cpu<int64_t>)(F&, const Tensor&, T&...)>::type
 {
   using ReturnType = typename std::result_of<decltype(&F::template cpu<int64_t>)(F&, const Tensor&, T&...)>::type;
-  if(t.device() == kCPU) {
-    static std::array<std::function<ReturnType (F&, const Tensor&, T&...)>, 7> dyn = {{
-        &F::template cpu<uint8_t>,
-        &F::template cpu<int8_t>,
-        &F::template cpu<int16_t>,
-        &F::template cpu<int32_t>,
-        &F::template cpu<int64_t>,
-        &F::template cpu<float>,
-        &F::template cpu<double>,
-      }};
-    F functor;
-    return dyn.at(t.type())(functor, t, args...);
-  } else if(t.device() == kGPU) {
-    static std::array<std::function<ReturnType (F&, const Tensor&, T&...)>, 7> dyn = {{
-        &F::template gpu<uint8_t>,
-        &F::template gpu<int8_t>,
-        &F::template gpu<int16_t>,
-        &F::template gpu<int32_t>,
-        &F::template gpu<int64_t>,
-        &F::template gpu<float>,
-        &F::template gpu<double>,
-      }};
-    F functor;
-    return dyn.at(t.type())(functor, t, args...);
-  } else {
-    throw std::invalid_argument("unsupported device");
-  }
+  return dispatch_type<F, ReturnType, const Tensor, T...>(t.type(), t.device(), t, args...);
 }
 
 // Context, const Tensor version
@@ -113,33 +69,7 @@ template<class F, class ... T>
 auto dispatch(Context& ctx, const Tensor& t, T&... args) -> typename std::result_of<decltype(&F::template cpu<int64_t>)(F&, Context&, const Tensor&, T&...)>::type
 {
   using ReturnType = typename std::result_of<decltype(&F::template cpu<int64_t>)(F&, Context&, const Tensor&, T&...)>::type;
-  if(t.device() == kCPU) {
-    static std::array<std::function<ReturnType (F&, Context&, const Tensor&, T&...)>, 7> dyn = {{
-        &F::template cpu<uint8_t>,
-        &F::template cpu<int8_t>,
-        &F::template cpu<int16_t>,
-        &F::template cpu<int32_t>,
-        &F::template cpu<int64_t>,
-        &F::template cpu<float>,
-        &F::template cpu<double>,
-      }};
-    F functor;
-    return dyn.at(t.type())(functor, ctx, t, args...);
-  } else if(t.device() == kGPU) {
-    static std::array<std::function<ReturnType (F&, Context&, const Tensor&, T&...)>, 7> dyn = {{
-        &F::template gpu<uint8_t>,
-        &F::template gpu<int8_t>,
-        &F::template gpu<int16_t>,
-        &F::template gpu<int32_t>,
-        &F::template gpu<int64_t>,
-        &F::template gpu<float>,
-        &F::template gpu<double>,
-      }};
-    F functor;
-    return dyn.at(t.type())(functor, ctx, t, args...);
-  } else {
-    throw std::invalid_argument("unsupported device");
-  }
+  return dispatch_type<F, ReturnType, Context, const Tensor, T...>(t.type(), t.device(), ctx, t, args...);
 }
 
 // type/device version
@@ -147,33 +77,47 @@ template<class F, class ... T>
 auto dispatch(TensorType ttype, TensorDevice tdev, T&... args) -> typename std::result_of<decltype(&F::template cpu<int64_t>)(F&, T&...)>::type
 {
   using ReturnType = typename std::result_of<decltype(&F::template cpu<int64_t>)(F&, T&...)>::type;
-  if(tdev == kCPU) {
-    static std::array<std::function<ReturnType (F&, T&...)>, 7> dyn = {{
-        &F::template cpu<uint8_t>,
-        &F::template cpu<int8_t>,
-        &F::template cpu<int16_t>,
-        &F::template cpu<int32_t>,
-        &F::template cpu<int64_t>,
-        &F::template cpu<float>,
-        &F::template cpu<double>,
-      }};
-    F functor;
-    return dyn.at(ttype)(functor, args...);
-  } else if(tdev == kGPU) {
-    static std::array<std::function<ReturnType (F&, T&...)>, 7> dyn = {{
-        &F::template gpu<uint8_t>,
-        &F::template gpu<int8_t>,
-        &F::template gpu<int16_t>,
-        &F::template gpu<int32_t>,
-        &F::template gpu<int64_t>,
-        &F::template gpu<float>,
-        &F::template gpu<double>,
-      }};
-    F functor;
-    return dyn.at(ttype)(functor, args...);
+  return dispatch_type<F, ReturnType, T...>(ttype, tdev, args...);
+}
+
+// Two tensors (of the same device) version: calls F::cpu<T1, T2>, with a
+// single switch over the (t1.type(), t2.type()) pairs
+
+#define XT_DISPATCH_CASE2(TYPE2, CTYPE2, TYPE1, CTYPE1, DEVICE) \
+  case TYPE1*7+TYPE2: return functor.template DEVICE<CTYPE1, CTYPE2>(t1, t2, args...);
+
+#define XT_DISPATCH_CASES2(TYPE1, CTYPE1, DEVICE)               \
+  XT_DISPATCH_TYPES2(XT_DISPATCH_CASE2, TYPE1, CTYPE1, DEVICE)
+
+// (a macro cannot expand itself: second copy of the type list)
+#define XT_DISPATCH_TYPES2(_, ...)              \
+  _(kUInt8, uint8_t, __VA_ARGS__)               \
+  _(kInt8, int8_t, __VA_ARGS__)                 \
+  _(kInt16, int16_t, __VA_ARGS__)               \
+  _(kInt32, int32_t, __VA_ARGS__)               \
+  _(kInt64, int64_t, __VA_ARGS__)               \
+  _(kFloat, float, __VA_ARGS__)                 \
+  _(kDouble, double, __VA_ARGS__)
+
+template<class F, class T1, class T2, class ... T>
+auto dispatch2(T1& t1, T2& t2, T&... args) -> typename std::result_of<decltype(&F::template cpu<int64_t, int64_t>)(F&, T1&, T2&, T&...)>::type
+{
+  F functor;
+  if(t1.device() != t2.device()) {
+    throw std::invalid_argument("tensors on different devices");
+  }
+  if(t1.device() == kCPU) {
+    switch(t1.type()*7+t2.type()) {
+      XT_DISPATCH_TYPES(XT_DISPATCH_CASES2, cpu)
+    }
+  } else if(t1.device() == kGPU) {
+    switch(t1.type()*7+t2.type()) {
+      XT_DISPATCH_TYPES(XT_DISPATCH_CASES2, gpu)
+    }
   } else {
     throw std::invalid_argument("unsupported device");
   }
+  throw std::invalid_argument("unsupported type");
 }
 
 }
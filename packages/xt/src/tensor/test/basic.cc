@@ -190,6 +190,107 @@ static void test(TensorDevice device)
     std::cout << dispatch<sum_op>(a) << " == " << sum(a) << std::endl;
   }
 
+  {
+    std::cout << "expressions:" << std::endl;
+    Tensor a = rand({3, 4}, kFloat, device);
+    Tensor b = rand({3, 4}, kFloat, device);
+    Tensor c = rand({3, 4}, kFloat, device);
+    Tensor d = add(rand({3, 4}, kFloat, device), 1);
+    Tensor e = a*2 + b - c/d;
+    Tensor f = add(add(mul(a, 2), b), -1, cdiv(c, d));
+    std::cout << e << std::endl;
+    std::cout << norm(add(e, -1, f)) << " -- should be 0" << std::endl;
+    Tensor at = transpose(rand({4, 3}, kFloat, device)); // not contiguous
+    e = at + b/2;
+    f = add(at, div(b, 2));
+    std::cout << norm(add(e, -1, f)) << " -- should be 0" << std::endl;
+    narrow(e, 0, 1, 2) = 1 - narrow(e, 0, 1, 2);
+    std::cout << e << std::endl;
+    e += a + 1;
+    std::cout << e << std::endl;
+  }
+
+  {
+    std::cout << "broadcasting:" << std::endl;
+    Tensor a = rand({3, 4}, kFloat, device);
+    Tensor row = rand({4}, kFloat, device);
+    Tensor col = rand({3, 1}, kFloat, device);
+    Tensor v = expand(row, {3, 4}); // view, 0 stride
+    std::cout << v.stride(0) << " " << v.stride(1) << std::endl;
+    Tensor e = a - row*2 + col;
+    Tensor f = add(add(a, -2, expand(row, {3, 4})), expand(col, {3, 4}));
+    std::cout << e << std::endl;
+    std::cout << norm(add(e, -1, f)) << " -- should be 0" << std::endl;
+    e = row + col; // 3x4 result
+    f = add(expand(row, {3, 4}), expand(col, {3, 4}));
+    std::cout << norm(add(e, -1, f)) << " -- should be 0" << std::endl;
+    Tensor b = a + 0;
+    Tensor(a, a.offset()+1, {3, 2}, {4, 2}) += narrow(row, 0, 0, 2); // columns 1 and 3
+    Tensor c = a - b;
+    std::cout << c << std::endl;
+    transpose(a) += transpose(col);
+    std::cout << norm(a - b - c - col) << " -- should be 0" << std::endl;
+  }
+
+  {
+    std::cout << "loads of expressions:" << std::endl;
+    Tensor a = rand({1000, 1000}, kFloat, device);
+    Tensor b = rand({1000, 1000}, kFloat, device);
+    Tensor c = rand({1000, 1000}, kFloat, device);
+    Tensor r;
+    auto begin = std::chrono::high_resolution_clock::now();
+    for(auto i = 0; i < 100; i++) {
+      r = add(add(mul(a, 2), b), -1, div(c, 3));
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << std::dec << "   eager: " << std::chrono::duration_cast<std::chrono::milliseconds>(end-begin).count() << " ms" << std::endl;
+    begin = std::chrono::high_resolution_clock::now();
+    for(auto i = 0; i < 100; i++) {
+      r = a*2 + b - c/3;
+    }
+    end = std::chrono::high_resolution_clock::now();
+    std::cout << std::dec << "   fused: " << std::chrono::duration_cast<std::chrono::milliseconds>(end-begin).count() << " ms" << std::endl;
+    std::cout << "   norm: " << norm(r).value<double>() << std::endl;
+  }
+
+  if(device == kCPU)
+  {
+    std::cout << "moved tensors:" << std::endl;
+    Tensor a = rand({3, 4}, kFloat, device);
+    Tensor b = rand({3, 4}, kFloat, device);
+    Tensor c = a*2 + b; // a and b kept
+    float* a_p = a.data<float>();
+    Tensor r = std::move(a)*2 + b; // computed in the storage of a
+    std::cout << (r.data<float>() == a_p) << " -- should be 1" << std::endl;
+    std::cout << norm(add(r, -1, c)) << " -- should be 0" << std::endl;
+    Tensor v = narrow(r, 0, 0, 2);
+    Tensor s = std::move(v) + 1; // v shares its storage: not reused
+    std::cout << (s.data<float>() == r.data<float>()) << " -- should be 0" << std::endl;
+  }
+
+  {
+    std::cout << "loads of small expressions:" << std::endl;
+    Tensor a = rand({3, 4}, kFloat, device);
+    Tensor b = rand({3, 4}, kFloat, device);
+    Tensor r = zeros({3, 4}, kFloat, device);
+    auto begin = std::chrono::high_resolution_clock::now();
+    for(auto i = 0; i < 100000; i++) {
+      r = r*0.5 + a - b/2;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << std::dec << "   " << std::chrono::duration_cast<std::chrono::milliseconds>(end-begin).count() << " ms" << std::endl;
+    std::cout << "   norm: " << norm(r).value<double>() << std::endl;
+    ScopedArena arena; // no allocation after the first iteration
+    r = zeros({3, 4}, kFloat, device);
+    begin = std::chrono::high_resolution_clock::now();
+    for(auto i = 0; i < 100000; i++) {
+      r = r*0.5 + a - b/2;
+    }
+    end = std::chrono::high_resolution_clock::now();
+    std::cout << std::dec << "   arena: " << std::chrono::duration_cast<std::chrono::milliseconds>(end-begin).count() << " ms" << std::endl;
+    std::cout << "   norm: " << norm(r).value<double>() << std::endl;
+  }
+
   {
     std::cout << "operators:" << std::endl;
     Tensor a = rand({3, 7}, kFloat, device);
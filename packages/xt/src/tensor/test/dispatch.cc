@@ -0,0 +1,127 @@
+#include "xttensor.h"
+#include <iostream>
+#include <chrono>
+#include <array>
+#include <functional>
+
+using namespace xt;
+
+// previous dispatch (std::function tables), for comparison
+template<class F, class ... T>
+auto dispatch_table(const Tensor& t, T&... args) -> typename std::result_of<decltype(&F::template cpu<int64_t>)(F&, const Tensor&, T&...)>::type
+{
+  using ReturnType = typename std::result_of<decltype(&F::template cpu<int64_t>)(F&, const Tensor&, T&...)>::type;
+  if(t.device() == kCPU) {
+    static std::array<std::function<ReturnType (F&, const Tensor&, T&...)>, 7> dyn = {{
+        &F::template cpu<uint8_t>,
+        &F::template cpu<int8_t>,
+        &F::template cpu<int16_t>,
+        &F::template cpu<int32_t>,
+        &F::template cpu<int64_t>,
+        &F::template cpu<float>,
+        &F::template cpu<double>,
+      }};
+    F functor;
+    return dyn.at(t.type())(functor, t, args...);
+  } else {
+    throw std::invalid_argument("unsupported device");
+  }
+}
+
+// element size: no work besides the dispatch
+struct size_op
+{
+  template<typename T> int64_t cpu(const Tensor& x)
+  {
+    return sizeof(T);
+  };
+  template<typename T> int64_t gpu(const Tensor& x)
+  {
+    throw std::invalid_argument("device not supported");
+  };
+};
+
+// first element of x plus first element of y
+struct first_op
+{
+  template<typename T> double cpu(const Tensor& x, const Tensor& y)
+  {
+    return x.data<T>()[0] + y.data<T>()[0];
+  };
+  template<typename T> double gpu(const Tensor& x, const Tensor& y)
+  {
+    throw std::invalid_argument("device not supported");
+  };
+};
+
+// sum of the element sizes of x and y
+struct size2_op
+{
+  template<typename T1, typename T2> int64_t cpu(const Tensor& x, const Tensor& y)
+  {
+    return sizeof(T1) + sizeof(T2);
+  };
+  template<typename T1, typename T2> int64_t gpu(const Tensor& x, const Tensor& y)
+  {
+    throw std::invalid_argument("device not supported");
+  };
+};
+
+// nested switches: dispatch on x, then on y
+struct nested_op
+{
+  template<typename T1> struct inner
+  {
+    template<typename T2> int64_t cpu(const Tensor& y, const Tensor& x)
+    {
+      return sizeof(T1) + sizeof(T2);
+    };
+    template<typename T2> int64_t gpu(const Tensor& y, const Tensor& x)
+    {
+      throw std::invalid_argument("device not supported");
+    };
+  };
+  template<typename T1> int64_t cpu(const Tensor& x, const Tensor& y)
+  {
+    return dispatch<inner<T1> >(y, x);
+  };
+  template<typename T1> int64_t gpu(const Tensor& x, const Tensor& y)
+  {
+    throw std::invalid_argument("device not supported");
+  };
+};
+
+template<class F> static void bench(const char *name, F f)
+{
+  const int64_t n = 10000000;
+  double sum = 0;
+  auto begin = std::chrono::high_resolution_clock::now();
+  for(int64_t i = 0; i < n; i++) {
+    sum += f();
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  std::cout << "   " << name << ": "
+            << std::chrono::duration_cast<std::chrono::nanoseconds>(end-begin).count()/(double)n
+            << " ns/call (" << sum << ")" << std::endl;
+}
+
+int main()
+{
+  Tensor a = ones({3, 4}, kFloat);
+  Tensor b = ones({3, 4}, kFloat);
+  Tensor c = ones({3, 4}, kDouble);
+
+  std::cout << "dispatch only:" << std::endl;
+  bench("std::function table", [&]() { return dispatch_table<size_op>(a); });
+  bench("switch", [&]() { return dispatch<size_op>(a); });
+
+  std::cout << "dispatch and data:" << std::endl;
+  bench("std::function table", [&]() { return dispatch_table<first_op>(a, b); });
+  bench("switch", [&]() { return dispatch<first_op>(a, b); });
+
+  std::cout << "two types:" << std::endl;
+  bench("nested switches", [&]() { return dispatch<nested_op>(a, c); });
+  bench("single switch", [&]() { return dispatch2<size2_op>(a, c); });
+
+  return 0;
+}